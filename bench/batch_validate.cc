@@ -0,0 +1,80 @@
+// Measures how util::Batch_Validator scales with the number of threads
+// when validating many small messages (streaming, from memory).
+//
+// Usage:
+//
+//     bench_batch_validate MESSAGES MAX_THREADS
+
+#include <xxxml/batch_validator.hh>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <stdlib.h>
+
+using namespace std;
+using namespace xxxml;
+
+static const char xsd[] =
+R"(<?xml version='1.0' encoding='UTF-8'?>
+<xs:schema xmlns:xs='http://www.w3.org/2001/XMLSchema'>
+  <xs:element name='msg'>
+    <xs:complexType>
+      <xs:sequence>
+        <xs:element name='from' type='xs:string'/>
+        <xs:element name='to' type='xs:string'/>
+        <xs:element name='amount' type='xs:decimal' maxOccurs='unbounded'/>
+      </xs:sequence>
+      <xs:attribute name='id' type='xs:unsignedLong' use='required'/>
+    </xs:complexType>
+  </xs:element>
+</xs:schema>
+)";
+
+int main(int argc, char **argv)
+{
+  unsigned long n = argc > 1 ? strtoul(argv[1], nullptr, 10) : 100000;
+  unsigned max_threads = argc > 2 ? strtoul(argv[2], nullptr, 10)
+    : max(thread::hardware_concurrency(), 1u);
+  try {
+    Library lib;
+    vector<string> messages;
+    messages.reserve(n);
+    for (unsigned long i = 0; i < n; ++i) {
+      string s("<msg id='" + to_string(i) + "'><from>account "
+          + to_string(i % 977) + "</from><to>account "
+          + to_string(i % 613) + "</to>");
+      for (unsigned j = 0; j < 1 + i % 8; ++j)
+        s += "<amount>" + to_string(i % 10000) + ".25</amount>";
+      s += "</msg>";
+      messages.push_back(std::move(s));
+    }
+    vector<util::Batch_Validator::Range> inputs;
+    for (auto &m : messages)
+      inputs.emplace_back(m.data(), m.data() + m.size());
+
+    double base = 0;
+    for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+      auto pc = schema::new_mem_parser_ctxt(xsd);
+      util::Batch_Validator b(schema::parse(pc), threads);
+      auto start = chrono::steady_clock::now();
+      auto rs = b.validate(inputs);
+      double t = chrono::duration<double>(
+          chrono::steady_clock::now() - start).count();
+      for (auto &r : rs)
+        if (!r.valid)
+          throw runtime_error("invalid message");
+      if (threads == 1)
+        base = t;
+      cout << threads << " threads: " << n / t << " msgs/s, speedup "
+        << base / t << '\n';
+    }
+  } catch (const std::exception &e) {
+    cerr << "Error: " << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,177 @@
+// Compares the extraction of records into structs via a DOM
+// (read_file() + XPath) with a streaming bind::Binding, and the
+// serialization with a Binding with the equivalent text_writer calls.
+//
+// Usage:
+//
+//     bench_bind write FILE RECORDS
+//     bench_bind write-calls FILE RECORDS
+//     bench_bind dom FILE
+//     bench_bind stream FILE
+//
+// The peak RSS is reported per mode, thus, each mode is executed
+// in its own process.
+
+#include <xxxml/bind.hh>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+using namespace std;
+using namespace xxxml;
+namespace bind = xxxml::util::bind;
+
+struct Rec {
+  long id {0};
+  string name;
+  double amount {0};
+  string currency;
+  vector<string> tags;
+};
+
+static const bind::Binding<Rec> binding("rec", {
+    bind::attribute("id", &Rec::id),
+    bind::element("name", &Rec::name),
+    bind::element("amount", &Rec::amount),
+    bind::attribute("amount/currency", &Rec::currency),
+    bind::element("tags/tag", &Rec::tags) });
+
+static Rec record(unsigned long i)
+{
+  Rec r;
+  r.id = i;
+  r.name = "record " + to_string(i);
+  r.amount = i % 1000 / 4.0;
+  r.currency = i % 2 ? "EUR" : "USD";
+  r.tags = { "x", "y" };
+  return r;
+}
+
+static pair<size_t, double> write(const char *filename, unsigned long n,
+    bool calls)
+{
+  auto w = new_text_writer_filename(filename);
+  text_writer::start_document(w, nullptr, "UTF-8");
+  text_writer::start_element(w, "records");
+  double sum = 0;
+  for (unsigned long i = 0; i < n; ++i) {
+    Rec r = record(i);
+    sum += r.amount;
+    if (!calls) {
+      binding.write(w, r);
+      continue;
+    }
+    text_writer::start_element(w, "rec");
+    text_writer::write_attribute(w, "id", to_string(r.id).c_str());
+    text_writer::write_element(w, "name", r.name.c_str());
+    text_writer::start_element(w, "amount");
+    text_writer::write_attribute(w, "currency", r.currency.c_str());
+    text_writer::write_string(w, to_string(r.amount).c_str());
+    text_writer::end_element(w);
+    text_writer::start_element(w, "tags");
+    for (auto &t : r.tags)
+      text_writer::write_element(w, "tag", t.c_str());
+    text_writer::end_element(w);
+    text_writer::end_element(w);
+  }
+  text_writer::end_document(w);
+  return make_pair(n, sum);
+}
+
+static string string_value(const xmlNode *rec, const char *expr,
+    xpath::Context_Ptr &c)
+{
+  auto o = xpath::node_eval(expr, rec, c);
+  return reinterpret_cast<const char*>(o->stringval);
+}
+
+static pair<size_t, double> dom(const char *filename)
+{
+  doc::Ptr d = read_file(filename);
+  auto c = xpath::new_context(d);
+  auto o = xpath::eval("/records/rec", c);
+  size_t n = 0;
+  double sum = 0;
+  if (o->nodesetval) {
+    n = o->nodesetval->nodeNr;
+    Rec r;
+    for (size_t i = 0; i < n; ++i) {
+      const xmlNode *rec = o->nodesetval->nodeTab[i];
+      r.id = xpath::node_eval("number(@id)", rec, c)->floatval;
+      r.name = string_value(rec, "string(name)", c);
+      r.amount = xpath::node_eval("number(amount)", rec, c)->floatval;
+      r.currency = string_value(rec, "string(amount/@currency)", c);
+      r.tags.clear();
+      auto ts = xpath::node_eval("tags/tag", rec, c);
+      if (ts->nodesetval)
+        for (int j = 0; j < ts->nodesetval->nodeNr; ++j) {
+          auto s = xmlNodeGetContent(ts->nodesetval->nodeTab[j]);
+          r.tags.emplace_back(reinterpret_cast<const char*>(s));
+          xmlFree(s);
+        }
+      sum += r.amount;
+    }
+  }
+  return make_pair(n, sum);
+}
+
+static pair<size_t, double> stream(const char *filename)
+{
+  auto reader = text_reader::for_file(filename);
+  Rec r;
+  size_t n = 0;
+  double sum = 0;
+  while (binding.next(reader, r)) {
+    sum += r.amount;
+    ++n;
+  }
+  return make_pair(n, sum);
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 3) {
+    cerr << "call: " << argv[0] << " write FILE RECORDS|write-calls FILE"
+      " RECORDS|dom FILE|stream FILE\n";
+    return 2;
+  }
+  try {
+    Library lib;
+    unsigned long n = argc > 3 ? strtoul(argv[3], nullptr, 10) : 1000000;
+    auto start = chrono::steady_clock::now();
+    pair<size_t, double> r;
+    if (!strcmp(argv[1], "write"))
+      r = write(argv[2], n, false);
+    else if (!strcmp(argv[1], "write-calls"))
+      r = write(argv[2], n, true);
+    else if (!strcmp(argv[1], "dom"))
+      r = dom(argv[2]);
+    else if (!strcmp(argv[1], "stream"))
+      r = stream(argv[2]);
+    else
+      throw runtime_error("unknown mode: " + string(argv[1]));
+    chrono::duration<double> d = chrono::steady_clock::now() - start;
+
+    struct stat st;
+    if (stat(argv[2], &st))
+      throw runtime_error("stat failed");
+    struct rusage u;
+    getrusage(RUSAGE_SELF, &u);
+    cout << argv[1] << ": " << r.first << " records (sum " << r.second
+      << ") in " << d.count() << " s, "
+      << r.first / d.count() << " records/s, "
+      << st.st_size / 1024.0 / 1024.0 / d.count() << " MiB/s, max RSS "
+      << u.ru_maxrss / 1024 << " MiB\n";
+  } catch (const std::exception &e) {
+    cerr << "error: " << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
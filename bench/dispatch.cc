@@ -0,0 +1,106 @@
+// Compares the dispatch of element names to handler indices with a
+// strcmp() chain, the compile-time perfect hash table, the runtime one
+// and the interned pointer table.
+//
+// The element names of a generated document are collected with a text
+// reader, first, thus, only the dispatch is measured.
+//
+// Usage:
+//
+//     bench_dispatch RECORDS ROUNDS
+
+#include <xxxml/dispatch.hh>
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <stdlib.h>
+#include <string.h>
+
+using namespace std;
+using namespace xxxml;
+namespace dispatch = xxxml::util::dispatch;
+
+using Names = dispatch::Table<XXXML_STR("rec"), XXXML_STR("id"),
+      XXXML_STR("name"), XXXML_STR("first"), XXXML_STR("last"),
+      XXXML_STR("address"), XXXML_STR("street"), XXXML_STR("city"),
+      XXXML_STR("zip"), XXXML_STR("amount"), XXXML_STR("currency"),
+      XXXML_STR("tag")>;
+
+static string generate(unsigned long n)
+{
+  ostringstream o;
+  o << "<records>";
+  for (unsigned long i = 0; i < n; ++i)
+    o << "<rec><id>" << i << "</id><name><first>a</first><last>b</last>"
+      "</name><address><street>s</street><city>c</city><zip>1</zip>"
+      "<country>x</country></address><amount>1</amount>"
+      "<currency>EUR</currency><tag>t</tag><tag>u</tag><note/></rec>";
+  o << "</records>";
+  return o.str();
+}
+
+static int strcmp_chain(const char *s)
+{
+  if (!strcmp(s, "rec")) return 0;
+  if (!strcmp(s, "id")) return 1;
+  if (!strcmp(s, "name")) return 2;
+  if (!strcmp(s, "first")) return 3;
+  if (!strcmp(s, "last")) return 4;
+  if (!strcmp(s, "address")) return 5;
+  if (!strcmp(s, "street")) return 6;
+  if (!strcmp(s, "city")) return 7;
+  if (!strcmp(s, "zip")) return 8;
+  if (!strcmp(s, "amount")) return 9;
+  if (!strcmp(s, "currency")) return 10;
+  if (!strcmp(s, "tag")) return 11;
+  return -1;
+}
+
+template <typename F>
+static void run(const char *label, const vector<const char*> &names,
+    unsigned rounds, F f)
+{
+  auto start = chrono::steady_clock::now();
+  long sum = 0;
+  for (unsigned k = 0; k < rounds; ++k)
+    for (const char *s : names)
+      sum += f(s);
+  chrono::duration<double> d = chrono::steady_clock::now() - start;
+  cout << label << ": " << names.size() * rounds / d.count() / 1e6
+    << " M names/s (sum " << sum << ")\n";
+}
+
+int main(int argc, char **argv)
+{
+  unsigned long n = argc > 1 ? strtoul(argv[1], nullptr, 10) : 100000;
+  unsigned rounds = argc > 2 ? strtoul(argv[2], nullptr, 10) : 10;
+  try {
+    Library lib;
+    string doc = generate(n);
+    auto r = text_reader::for_memory(doc);
+    vector<const char*> names;
+    while (text_reader::read(r))
+      if (text_reader::node_type(r) == XML_READER_TYPE_ELEMENT)
+        names.push_back(text_reader::const_local_name(r));
+    // the names are interned in the reader's dictionary
+    dispatch::Interned in(r, Names::names, Names::size);
+    dispatch::Name_Table t(vector<string>(Names::names,
+          Names::names + Names::size));
+
+    run("strcmp", names, rounds, strcmp_chain);
+    run("Table", names, rounds, [](const char *s) {
+        return Names::find(s); });
+    run("Name_Table", names, rounds, [&t](const char *s) {
+        return t.find(s); });
+    run("Interned", names, rounds, [&in](const char *s) {
+        return in.find(s); });
+  } catch (const std::exception &e) {
+    cerr << "Error: " << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,110 @@
+// Compares libxml2's escaping in the text writer with the SIMD
+// escaping of text_writer::write_element()/write_attribute() on a
+// text-heavy document, and the throughput of the available scanners.
+//
+// Usage:
+//
+//     bench_escape RECORDS TEXT_LENGTH
+
+#include <xxxml/xxxml.hh>
+#include <xxxml/escape.hh>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <stdlib.h>
+
+using namespace std;
+using namespace xxxml;
+
+static vector<string> generate(unsigned long n, size_t len)
+{
+  static const char words[] = "lorem ipsum dolor sit amet consectetur "
+    "adipiscing elit sed do eiusmod tempor incididunt ut labore ";
+  vector<string> r;
+  r.reserve(n);
+  for (unsigned long i = 0; i < n; ++i) {
+    string s;
+    for (size_t k = i; s.size() < len; k += 7)
+      s += words[k % (sizeof words - 1)];
+    // most text doesn't need escaping
+    if (i % 10 == 0)
+      s[len / 2] = '&';
+    r.push_back(s);
+  }
+  return r;
+}
+
+static double seconds_since(chrono::steady_clock::time_point start)
+{
+  return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+template <typename F>
+static double run(const vector<string> &texts, string &out, F f)
+{
+  out.clear();
+  auto start = chrono::steady_clock::now();
+  auto w = new_text_writer(out);
+  text_writer::start_document(w);
+  text_writer::start_element(w, "records");
+  for (auto &t : texts)
+    f(w, t);
+  text_writer::end_element(w);
+  text_writer::end_document(w);
+  return seconds_since(start);
+}
+
+int main(int argc, char **argv)
+{
+  unsigned long n = argc > 1 ? strtoul(argv[1], nullptr, 10) : 300000;
+  size_t len = argc > 2 ? strtoul(argv[2], nullptr, 10) : 200;
+  try {
+    Library lib;
+    auto texts = generate(n, len);
+    string a, b;
+    a.reserve(n * (2 * len + 64));
+    b.reserve(a.capacity());
+    auto xml = [](const string &s) {
+      return reinterpret_cast<const xmlChar*>(s.c_str()); };
+
+    double libxml = run(texts, a, [&xml](text_writer::Ptr &w, const string &t) {
+        xmlTextWriterStartElement(w.get(), xml("rec"));
+        xmlTextWriterWriteAttribute(w.get(), xml("note"), xml(t));
+        xmlTextWriterWriteElement(w.get(), xml("text"), xml(t));
+        xmlTextWriterEndElement(w.get());
+        });
+    double simd = run(texts, b, [](text_writer::Ptr &w, const string &t) {
+        text_writer::start_element(w, "rec");
+        text_writer::write_attribute(w, "note", t.data(),
+            t.data() + t.size());
+        text_writer::write_element(w, "text", t.data(),
+            t.data() + t.size());
+        text_writer::end_element(w);
+        });
+    if (a != b)
+      throw runtime_error("output differs");
+    double mb = a.size() / 1e6;
+    cout << "libxml2 escaping: " << libxml << " s (" << mb / libxml
+      << " MB/s)\n"
+      << "xxxml escaping:   " << simd << " s (" << mb / simd << " MB/s)\n";
+
+    for (auto &s : detail::scanners()) {
+      auto start = chrono::steady_clock::now();
+      size_t k = 0;
+      for (unsigned r = 0; r < 10; ++r)
+        for (auto &t : texts)
+          k += s.scan(t.data(), t.data() + t.size(), detail::Escape::TEXT)
+            - t.data();
+      double d = seconds_since(start);
+      cout << "scan " << s.name << ": " << 10 * n * len / 1e6 / d
+        << " MB/s (" << k << ")\n";
+    }
+  } catch (const std::exception &e) {
+    cerr << "Error: " << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,101 @@
+// Compares a per-call text reader loop with util::Event_Batch.
+//
+// Usage:
+//
+//     bench_event_batch [RECORDS [BATCH_SIZE]]
+
+#include <xxxml/event_batch.hh>
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <stdlib.h>
+#include <string.h>
+
+using namespace std;
+using namespace xxxml;
+
+struct Result {
+  size_t elements {0};
+  size_t attributes {0};
+  size_t bytes {0};
+};
+
+static Result per_call(const string &xml)
+{
+  Result r;
+  auto reader = text_reader::for_memory(xml);
+  while (text_reader::read(reader)) {
+    int t = text_reader::node_type(reader);
+    text_reader::depth(reader);
+    const char *name = text_reader::const_local_name(reader);
+    if (t == XML_READER_TYPE_ELEMENT && !strcmp(name, "v")) {
+      ++r.elements;
+      for (bool b = text_reader::move_to_first_attribute(reader); b;
+          b = text_reader::move_to_next_attribute(reader)) {
+        ++r.attributes;
+        r.bytes += strlen(text_reader::const_value(reader));
+      }
+    } else if (t == XML_READER_TYPE_TEXT) {
+      r.bytes += strlen(text_reader::const_value(reader));
+    }
+  }
+  return r;
+}
+
+static Result batched(const string &xml, size_t batch_size)
+{
+  Result r;
+  auto reader = text_reader::for_memory(xml);
+  util::Event_Batch b;
+  const char *v = util::Event_Batch::interned(reader, "v");
+  while (size_t n = b.read(reader, batch_size)) {
+    for (size_t i = 0; i < n; ++i) {
+      if (b.type[i] == XML_READER_TYPE_ELEMENT && b.name[i] == v) {
+        ++r.elements;
+        for (size_t j = b.attr_begin[i]; j < b.attr_begin[i+1]; ++j) {
+          ++r.attributes;
+          r.bytes += b.attr_value_size[j];
+        }
+      } else if (b.type[i] == XML_READER_TYPE_TEXT) {
+        r.bytes += b.value_size[i];
+      }
+    }
+  }
+  return r;
+}
+
+template <typename F>
+static void run(const char *label, F f)
+{
+  auto start = chrono::steady_clock::now();
+  Result r = f();
+  chrono::duration<double> d = chrono::steady_clock::now() - start;
+  cout << label << ": " << r.elements << " elements, " << r.attributes
+    << " attributes, " << r.bytes << " value bytes in " << d.count()
+    << " s\n";
+}
+
+int main(int argc, char **argv)
+{
+  unsigned long n = argc > 1 ? strtoul(argv[1], nullptr, 10) : 200000;
+  size_t batch_size = argc > 2 ? strtoul(argv[2], nullptr, 10) : 256;
+  try {
+    Library lib;
+    ostringstream o;
+    o << "<root>\n";
+    for (unsigned long i = 0; i < n; ++i)
+      o << "  <v id='" << i << "' kind='k" << i % 7 << "'>value " << i
+        << "</v>\n";
+    o << "</root>\n";
+    string xml(o.str());
+    run("per call", [&xml]{ return per_call(xml); });
+    run("batched", [&xml, batch_size]{ return batched(xml, batch_size); });
+  } catch (const std::exception &e) {
+    cerr << "error: " << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,86 @@
+// Measures util::gzip::save_format_file_enc() with an increasing number
+// of threads, compared to libxml2's compressed file output, and
+// util::gzip::read_file(), compared to libxml2's read_file().
+//
+// Usage:
+//
+//     bench_gzip RECORDS MAX_THREADS [LEVEL]
+
+#include <xxxml/gzip.hh>
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace xxxml;
+
+static off_t file_size(const char *filename)
+{
+  struct stat st;
+  return stat(filename, &st) ? -1 : st.st_size;
+}
+
+int main(int argc, char **argv)
+{
+  unsigned long n = argc > 1 ? strtoul(argv[1], nullptr, 10) : 200000;
+  unsigned max_threads = argc > 2 ? strtoul(argv[2], nullptr, 10)
+    : max(thread::hardware_concurrency(), 1u);
+  int level = argc > 3 ? atoi(argv[3]) : 6;
+  try {
+    Library lib;
+    ostringstream o;
+    o << "<root>";
+    for (unsigned long i = 0; i < n; ++i)
+      o << "<rec id='" << i << "'><from>account " << i % 977
+        << "</from><to>account " << i % 613 << "</to><amount>"
+        << i % 10000 << ".25</amount></rec>";
+    o << "</root>";
+    doc::Ptr d = read_memory(o.str());
+    size_t bytes = o.str().size();
+    const char name[] = "bench_gzip.xml.gz";
+
+    xmlSetDocCompressMode(d.get(), level);
+    auto start = chrono::steady_clock::now();
+    save_format_file_enc(name, d, "UTF-8", true);
+    double base = chrono::duration<double>(
+        chrono::steady_clock::now() - start).count();
+    cout << "libxml2: " << bytes / base / 1024 / 1024 << " MiB/s, "
+      << file_size(name) << " bytes\n";
+    xmlSetDocCompressMode(d.get(), 0);
+
+    for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+      start = chrono::steady_clock::now();
+      util::gzip::save_format_file_enc(name, d, "UTF-8", true, level,
+          threads);
+      double t = chrono::duration<double>(
+          chrono::steady_clock::now() - start).count();
+      cout << threads << " threads: " << bytes / t / 1024 / 1024
+        << " MiB/s, " << file_size(name) << " bytes, speedup "
+        << base / t << '\n';
+    }
+
+    start = chrono::steady_clock::now();
+    doc::Ptr e = read_file(name);
+    base = chrono::duration<double>(
+        chrono::steady_clock::now() - start).count();
+    cout << "libxml2 read: " << bytes / base / 1024 / 1024 << " MiB/s\n";
+    start = chrono::steady_clock::now();
+    doc::Ptr f = util::gzip::read_file(name);
+    double t = chrono::duration<double>(
+        chrono::steady_clock::now() - start).count();
+    cout << "gzip::read_file: " << bytes / t / 1024 / 1024
+      << " MiB/s, speedup " << base / t << '\n';
+    unlink(name);
+  } catch (const std::exception &e) {
+    cerr << "Error: " << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,70 @@
+// Measures util::parallel::save_format_fd() of a large document with
+// an increasing number of threads, compared to save_format_file_enc().
+//
+// Usage:
+//
+//     bench_parallel_save RECORDS MAX_THREADS [ENCODING]
+
+#include <xxxml/parallel_save.hh>
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace xxxml;
+
+int main(int argc, char **argv)
+{
+  unsigned long n = argc > 1 ? strtoul(argv[1], nullptr, 10) : 200000;
+  unsigned max_threads = argc > 2 ? strtoul(argv[2], nullptr, 10)
+    : max(thread::hardware_concurrency(), 1u);
+  const char *encoding = argc > 3 ? argv[3] : "UTF-8";
+  try {
+    Library lib;
+    ostringstream o;
+    o << "<root xmlns='urn:d'>";
+    for (unsigned long i = 0; i < n; ++i)
+      o << "<rec id='" << i << "'><from>account " << i % 977
+        << "</from><to>account " << i % 613 << "</to><amount>"
+        << i % 10000 << ".25</amount><note>a &amp; b</note></rec>";
+    o << "</root>";
+    doc::Ptr d = read_memory(o.str());
+    size_t bytes = o.str().size();
+
+    char name[] = "bench_parallel_save_XXXXXX";
+    int fd = mkstemp(name);
+    if (fd == -1)
+      throw runtime_error("mkstemp failed");
+
+    auto start = chrono::steady_clock::now();
+    save_format_file_enc(name, d, encoding, true);
+    double base = chrono::duration<double>(
+        chrono::steady_clock::now() - start).count();
+    cout << "save_format_file_enc: " << bytes / base / 1024 / 1024
+      << " MiB/s\n";
+
+    for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+      if (ftruncate(fd, 0) || lseek(fd, 0, SEEK_SET))
+        throw runtime_error("truncate failed");
+      start = chrono::steady_clock::now();
+      util::parallel::save_format_fd(fd, d, encoding, true, threads);
+      double t = chrono::duration<double>(
+          chrono::steady_clock::now() - start).count();
+      cout << threads << " threads: " << bytes / t / 1024 / 1024
+        << " MiB/s, speedup " << base / t << '\n';
+    }
+    close(fd);
+    unlink(name);
+  } catch (const std::exception &e) {
+    cerr << "Error: " << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
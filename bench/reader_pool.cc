@@ -0,0 +1,60 @@
+// Compares creating a text reader per (small) document with
+// re-using readers from a util::Reader_Pool.
+//
+// Usage:
+//
+//     bench_reader_pool [DOCUMENTS]
+
+#include <xxxml/reader_pool.hh>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include <stdlib.h>
+
+using namespace std;
+using namespace xxxml;
+
+static const char msg[] =
+  "<msg id='4711'><from>a</from><to>b</to><body>Hello World</body></msg>";
+
+static size_t consume(text_reader::Ptr &reader)
+{
+  size_t n = 0;
+  while (text_reader::read(reader))
+    ++n;
+  return n;
+}
+
+template <typename F>
+static void run(const char *label, unsigned long n, F f)
+{
+  auto start = chrono::steady_clock::now();
+  size_t events = 0;
+  for (unsigned long i = 0; i < n; ++i)
+    events += f();
+  chrono::duration<double> d = chrono::steady_clock::now() - start;
+  cout << label << ": " << n << " documents (" << events << " events) in "
+    << d.count() << " s, " << n / d.count() << " documents/s\n";
+}
+
+int main(int argc, char **argv)
+{
+  unsigned long n = argc > 1 ? strtoul(argv[1], nullptr, 10) : 200000;
+  try {
+    Library lib;
+    run("new reader", n, []{
+        auto reader = text_reader::for_memory(msg);
+        return consume(reader);
+        });
+    run("pooled reader", n, []{
+        auto lease = util::Reader_Pool::local().for_memory(msg);
+        return consume(lease.reader());
+        });
+  } catch (const std::exception &e) {
+    cerr << "error: " << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
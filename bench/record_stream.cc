@@ -0,0 +1,108 @@
+// Compares the extraction of records via a DOM (read_file() + XPath)
+// with the streaming Record_Stream.
+//
+// Usage:
+//
+//     bench_record_stream generate FILE RECORDS
+//     bench_record_stream dom FILE
+//     bench_record_stream stream FILE
+//
+// The peak RSS is reported per mode, thus, each mode is executed
+// in its own process.
+
+#include <xxxml/record_stream.hh>
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+using namespace std;
+using namespace xxxml;
+
+static void generate(const char *filename, unsigned long n)
+{
+  ofstream f(filename);
+  f << "<?xml version='1.0' encoding='UTF-8'?>\n<records>\n";
+  for (unsigned long i = 0; i < n; ++i)
+    f << "  <rec id='" << i << "'>\n"
+      << "    <name>record " << i << "</name>\n"
+      << "    <value>" << i % 1000 << "</value>\n"
+      << "    <tags><tag>x</tag><tag>y</tag></tags>\n"
+      << "  </rec>\n";
+  f << "</records>\n";
+}
+
+static double sum_value(const xmlNode *rec, xpath::Context_Ptr &c)
+{
+  auto o = xpath::node_eval("number(./value)", rec, c);
+  return o->floatval;
+}
+
+static pair<size_t, double> dom(const char *filename)
+{
+  doc::Ptr d = read_file(filename);
+  auto c = xpath::new_context(d);
+  auto o = xpath::eval("/records/rec", c);
+  size_t n = 0;
+  double sum = 0;
+  if (o->nodesetval) {
+    n = o->nodesetval->nodeNr;
+    for (size_t i = 0; i < n; ++i)
+      sum += sum_value(o->nodesetval->nodeTab[i], c);
+  }
+  return make_pair(n, sum);
+}
+
+static pair<size_t, double> stream(const char *filename)
+{
+  auto reader = text_reader::for_file(filename);
+  util::Record_Stream s(reader, "rec");
+  double sum = 0;
+  while (xmlNode *rec = s.next())
+    sum += sum_value(rec, s.context());
+  return make_pair(s.count(), sum);
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 3) {
+    cerr << "call: " << argv[0] << " generate FILE RECORDS|dom FILE|stream FILE\n";
+    return 2;
+  }
+  try {
+    Library lib;
+    if (!strcmp(argv[1], "generate")) {
+      generate(argv[2], argc > 3 ? strtoul(argv[3], nullptr, 10) : 1000000);
+      return 0;
+    }
+    auto start = chrono::steady_clock::now();
+    pair<size_t, double> r;
+    if (!strcmp(argv[1], "dom"))
+      r = dom(argv[2]);
+    else if (!strcmp(argv[1], "stream"))
+      r = stream(argv[2]);
+    else
+      throw runtime_error("unknown mode: " + string(argv[1]));
+    chrono::duration<double> d = chrono::steady_clock::now() - start;
+
+    struct stat st;
+    if (stat(argv[2], &st))
+      throw runtime_error("stat failed");
+    struct rusage u;
+    getrusage(RUSAGE_SELF, &u);
+    cout << argv[1] << ": " << r.first << " records (sum " << r.second
+      << ") in " << d.count() << " s, "
+      << st.st_size / 1024.0 / 1024.0 / d.count() << " MiB/s, max RSS "
+      << u.ru_maxrss / 1024 << " MiB\n";
+  } catch (const std::exception &e) {
+    cerr << "error: " << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
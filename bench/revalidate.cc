@@ -0,0 +1,88 @@
+// Compares RelaxNG revalidation of a complete document after an edit
+// with util::Revalidator, which just revalidates the modified subtree.
+//
+// Usage:
+//
+//     bench_revalidate RECORDS EDITS
+
+#include <xxxml/revalidator.hh>
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <stdlib.h>
+
+using namespace std;
+using namespace xxxml;
+
+static const char rng[] =
+R"(<element name='records' xmlns='http://relaxng.org/ns/structure/1.0'
+    datatypeLibrary='http://www.w3.org/2001/XMLSchema-datatypes'>
+  <oneOrMore>
+    <element name='rec'>
+      <attribute name='id'><data type='unsignedLong'/></attribute>
+      <element name='name'><text/></element>
+      <element name='value'><data type='int'/></element>
+    </element>
+  </oneOrMore>
+</element>
+)";
+
+static string generate(unsigned long n)
+{
+  ostringstream o;
+  o << "<records>\n";
+  for (unsigned long i = 0; i < n; ++i)
+    o << "  <rec id='" << i << "'><name>record " << i << "</name><value>"
+      << i % 1000 << "</value></rec>\n";
+  o << "</records>\n";
+  return o.str();
+}
+
+static double seconds_since(chrono::steady_clock::time_point start)
+{
+  return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+  unsigned long n = argc > 1 ? strtoul(argv[1], nullptr, 10) : 300000;
+  unsigned long edits = argc > 2 ? strtoul(argv[2], nullptr, 10) : 20;
+  try {
+    Library lib;
+    auto pc = relaxng::new_mem_parser_ctxt(rng);
+    auto schema = relaxng::parse(pc);
+    doc::Ptr d = read_memory(generate(n));
+    vector<xmlNode*> values;
+    for (auto rec = first_element_child(doc::get_root_element(d)); rec;
+        rec = next_element_sibling(rec))
+      values.push_back(last_element_child(rec));
+
+    util::Revalidator r(schema, d);
+    auto start = chrono::steady_clock::now();
+    for (unsigned long i = 0; i < edits; ++i) {
+      util::set_content(values[(i * 7919) % n], to_string(i));
+      auto v = relaxng::new_valid_ctxt(schema);
+      relaxng::validate_doc(v, d);
+    }
+    double full = seconds_since(start) / edits;
+
+    if (!r.validate())
+      throw runtime_error("invalid");
+    start = chrono::steady_clock::now();
+    for (unsigned long i = 0; i < edits; ++i) {
+      util::set_content(values[(i * 7919) % n], to_string(i));
+      if (!r.validate())
+        throw runtime_error("invalid");
+    }
+    double incremental = seconds_since(start) / edits;
+    cout << "complete:    " << full * 1000 << " ms/edit\n"
+         << "incremental: " << incremental * 1000 << " ms/edit\n";
+  } catch (const std::exception &e) {
+    cerr << "Error: " << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,99 @@
+// Compares XSD validation of a DOM (read_file() + validate_doc()) with
+// streaming validation (schema::validate_file()).
+//
+// Usage:
+//
+//     bench_schema_stream generate FILE RECORDS
+//     bench_schema_stream dom FILE
+//     bench_schema_stream stream FILE
+//
+// The peak RSS is reported per mode, thus, each mode is executed
+// in its own process.
+
+#include <xxxml/xxxml.hh>
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+using namespace std;
+using namespace xxxml;
+
+static const char xsd[] =
+R"(<?xml version='1.0' encoding='UTF-8'?>
+<xs:schema xmlns:xs='http://www.w3.org/2001/XMLSchema'>
+  <xs:element name='records'>
+    <xs:complexType>
+      <xs:sequence>
+        <xs:element name='rec' maxOccurs='unbounded'>
+          <xs:complexType>
+            <xs:sequence>
+              <xs:element name='name' type='xs:string'/>
+              <xs:element name='value' type='xs:int'/>
+            </xs:sequence>
+            <xs:attribute name='id' type='xs:unsignedLong' use='required'/>
+          </xs:complexType>
+        </xs:element>
+      </xs:sequence>
+    </xs:complexType>
+  </xs:element>
+</xs:schema>
+)";
+
+static void generate(const char *filename, unsigned long n)
+{
+  ofstream f(filename);
+  f << "<?xml version='1.0' encoding='UTF-8'?>\n<records>\n";
+  for (unsigned long i = 0; i < n; ++i)
+    f << "  <rec id='" << i << "'><name>record " << i << "</name><value>"
+      << i % 1000 << "</value></rec>\n";
+  f << "</records>\n";
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 3) {
+    cerr << "call: " << argv[0] << " generate FILE RECORDS|dom FILE|stream FILE\n";
+    return 2;
+  }
+  try {
+    Library lib;
+    if (!strcmp(argv[1], "generate")) {
+      generate(argv[2], argc > 3 ? strtoul(argv[3], nullptr, 10) : 1000000);
+      return 0;
+    }
+    auto pc = schema::new_mem_parser_ctxt(xsd);
+    auto s = schema::parse(pc);
+    auto v = schema::new_valid_ctxt(s);
+
+    auto start = chrono::steady_clock::now();
+    if (!strcmp(argv[1], "dom")) {
+      doc::Ptr d = read_file(argv[2]);
+      schema::validate_doc(v, d);
+    } else if (!strcmp(argv[1], "stream")) {
+      schema::validate_file(v, argv[2]);
+    } else {
+      throw runtime_error("unknown mode: " + string(argv[1]));
+    }
+    chrono::duration<double> d = chrono::steady_clock::now() - start;
+
+    struct stat st;
+    if (stat(argv[2], &st))
+      throw runtime_error("stat failed");
+    struct rusage u;
+    getrusage(RUSAGE_SELF, &u);
+    cout << argv[1] << ": valid, " << d.count() << " s, "
+      << st.st_size / 1024.0 / 1024.0 / d.count() << " MiB/s, max RSS "
+      << u.ru_maxrss / 1024 << " MiB\n";
+  } catch (const std::exception &e) {
+    cerr << "error: " << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,74 @@
+// Measures writing the same record skeleton with tmpl::write(),
+// compared to the equivalent text_writer calls.
+//
+// Usage:
+//
+//     bench_template RECORDS
+
+#include <xxxml/template.hh>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include <stdlib.h>
+
+using namespace std;
+using namespace xxxml;
+namespace tmpl = xxxml::util::tmpl;
+
+using Rec = tmpl::Element<XXXML_STR("rec"),
+      tmpl::Attribute<XXXML_STR("id")>,
+      tmpl::Fixed_Attribute<XXXML_STR("type"), XXXML_STR("transfer")>,
+      tmpl::Element<XXXML_STR("from"), tmpl::Text>,
+      tmpl::Element<XXXML_STR("to"), tmpl::Text>,
+      tmpl::Element<XXXML_STR("amount"), tmpl::Text> >;
+
+template <typename F>
+static double measure(unsigned long n, size_t &bytes, F f)
+{
+  string s;
+  auto start = chrono::steady_clock::now();
+  {
+    text_writer::Ptr w = new_text_writer(s);
+    text_writer::start_document(w, nullptr, "UTF-8");
+    text_writer::start_element(w, "response");
+    for (unsigned long i = 0; i < n; ++i)
+      f(w, i);
+    text_writer::end_document(w);
+  }
+  bytes = s.size();
+  return chrono::duration<double>(
+      chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+  unsigned long n = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000000;
+  try {
+    Library lib;
+    string from("account 1234"), to("account <5678>");
+    size_t a = 0, b = 0;
+    double base = measure(n, a, [&](text_writer::Ptr &w, unsigned long i) {
+        text_writer::start_element(w, "rec");
+        text_writer::write_attribute(w, "id", to_string(i).c_str());
+        text_writer::write_attribute(w, "type", "transfer");
+        text_writer::write_element(w, "from", from.c_str());
+        text_writer::write_element(w, "to", to.c_str());
+        text_writer::write_element(w, "amount", "12.50");
+        text_writer::end_element(w);
+        });
+    cout << "text_writer: " << n / base << " records/s\n";
+    double t = measure(n, b, [&](text_writer::Ptr &w, unsigned long i) {
+        tmpl::write<Rec>(w, i, from, to, "12.50");
+        });
+    cout << "tmpl::write: " << n / t << " records/s, speedup "
+      << base / t << '\n';
+    if (a != b)
+      throw runtime_error("outputs differ");
+  } catch (const std::exception &e) {
+    cerr << "Error: " << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
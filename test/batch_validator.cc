@@ -0,0 +1,118 @@
+#include <boost/test/unit_test.hpp>
+
+#include <xxxml/batch_validator.hh>
+
+#include "temp_file.hh"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(libxxxml)
+
+  BOOST_AUTO_TEST_SUITE(batch_validator_)
+
+    using namespace xxxml;
+
+    static const char xsd_s[] =
+      "<xs:schema xmlns:xs='http://www.w3.org/2001/XMLSchema'>"
+      "<xs:element name='root'><xs:complexType><xs:sequence>"
+      "<xs:element name='a' type='xs:int' maxOccurs='unbounded'/>"
+      "</xs:sequence></xs:complexType></xs:element></xs:schema>";
+
+    static const char rng_s[] =
+      "<element name='root' xmlns='http://relaxng.org/ns/structure/1.0'"
+      " datatypeLibrary='http://www.w3.org/2001/XMLSchema-datatypes'>"
+      "<oneOrMore><element name='a'><data type='int'/></element></oneOrMore>"
+      "</element>";
+
+    // every 3rd one is invalid with i errors, every 7th one isn't
+    // well-formed
+    static vector<string> inputs(unsigned n)
+    {
+      vector<string> r;
+      for (unsigned i = 0; i < n; ++i) {
+        string s("<root>");
+        s += "<a>" + to_string(i) + "</a>";
+        if (i % 3 == 0)
+          for (unsigned j = 0; j < i; ++j)
+            s += "<a>x</a>";
+        if (i % 7 != 6)
+          s += "</root>";
+        r.push_back(s);
+      }
+      return r;
+    }
+
+    static void check(const vector<util::Batch_Result> &rs, size_t max_errors,
+        bool with_broken)
+    {
+      for (unsigned i = 0; i < rs.size(); ++i) {
+        bool broken = with_broken && i % 7 == 6;
+        bool invalid = i % 3 == 0 && i;
+        BOOST_CHECK_EQUAL(rs[i].valid, !broken && !invalid);
+        BOOST_CHECK(rs[i].errors.size() <= max_errors);
+        if (invalid && !broken)
+          BOOST_CHECK_EQUAL(rs[i].errors.size(), min<size_t>(i, max_errors));
+      }
+    }
+
+    BOOST_AUTO_TEST_CASE(docs)
+    {
+      vector<doc::Ptr> docs;
+      auto ss = inputs(50);
+      for (unsigned i = 0; i < ss.size(); ++i)
+        docs.push_back(read_memory(i % 7 == 6 ? ss[i] + "</root>" : ss[i]));
+      for (unsigned threads : { 1u, 4u }) {
+        auto pc = schema::new_mem_parser_ctxt(xsd_s);
+        util::Batch_Validator b(schema::parse(pc), threads, 4);
+        BOOST_CHECK_EQUAL(b.threads(), threads);
+        auto rs = b.validate(docs);
+        BOOST_REQUIRE_EQUAL(rs.size(), docs.size());
+        check(rs, 4, false);
+        BOOST_CHECK(b.validator().idle_contexts() <= threads);
+      }
+    }
+
+    BOOST_AUTO_TEST_CASE(ranges)
+    {
+      auto ss = inputs(50);
+      vector<util::Batch_Validator::Range> rs;
+      for (auto &s : ss)
+        rs.emplace_back(s.data(), s.data() + s.size());
+      auto pc = schema::new_mem_parser_ctxt(xsd_s);
+      util::Batch_Validator x(schema::parse(pc), 3, 5);
+      check(x.validate(rs), 5, true);
+      auto qc = relaxng::new_mem_parser_ctxt(rng_s);
+      util::Batch_Validator y(relaxng::parse(qc), 3, 100);
+      auto r = y.validate(rs);
+      for (unsigned i = 0; i < r.size(); ++i)
+        BOOST_CHECK_EQUAL(r[i].valid, i % 7 != 6 && (i % 3 || !i));
+      BOOST_CHECK(x.validate(vector<util::Batch_Validator::Range>()).empty());
+    }
+
+    BOOST_AUTO_TEST_CASE(files)
+    {
+      auto ss = inputs(20);
+      vector<unique_ptr<test::Temp_File> > fs;
+      vector<string> names;
+      for (auto &s : ss) {
+        fs.emplace_back(new test::Temp_File("batch_validator", s));
+        names.push_back(fs.back()->name);
+      }
+      names.push_back("does/not/exist.xml");
+      auto pc = schema::new_mem_parser_ctxt(xsd_s);
+      util::Batch_Validator b(schema::parse(pc), 2, 3);
+      auto rs = b.validate_files(names);
+      BOOST_REQUIRE_EQUAL(rs.size(), names.size());
+      BOOST_CHECK(!rs.back().valid);
+      BOOST_CHECK_EQUAL(rs.back().errors.size(), 1u);
+      rs.pop_back();
+      check(rs, 3, true);
+    }
+
+  BOOST_AUTO_TEST_SUITE_END() // batch_validator_
+
+BOOST_AUTO_TEST_SUITE_END() // libxxxml
@@ -0,0 +1,236 @@
+#include <boost/test/unit_test.hpp>
+
+#include <xxxml/bind.hh>
+
+#include <limits>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(libxxxml)
+
+  BOOST_AUTO_TEST_SUITE(bind_)
+
+    using namespace xxxml;
+    namespace bind = xxxml::util::bind;
+
+    struct Rec {
+      long id {0};
+      unsigned short code {0};
+      string name;
+      double amount {0};
+      string currency;
+      bool active {false};
+      vector<string> tags;
+      vector<int> values;
+      string created;
+    };
+
+    static const bind::Binding<Rec> &binding()
+    {
+      static const bind::Binding<Rec> b("rec", {
+          bind::attribute("id", &Rec::id),
+          bind::attribute("code", &Rec::code),
+          bind::element("name", &Rec::name),
+          bind::element("amount", &Rec::amount),
+          bind::attribute("amount/currency", &Rec::currency),
+          bind::element("active", &Rec::active),
+          bind::element("tags/tag", &Rec::tags),
+          bind::element("meta/values/v", &Rec::values),
+          bind::attribute("meta/created", &Rec::created) });
+      return b;
+    }
+
+    static Rec example()
+    {
+      Rec r;
+      r.id = -42;
+      r.code = 7;
+      r.name = "x & <y> \"gr\xc3\xbc\xc3\x9f\"";
+      r.amount = 0.1;
+      r.currency = "\"EUR\"\n";
+      r.active = true;
+      r.tags = { "a", "b" };
+      r.values = { 1, -2, 3 };
+      r.created = "2016";
+      return r;
+    }
+
+    static bool equal(const Rec &a, const Rec &b)
+    {
+      return a.id == b.id && a.code == b.code && a.name == b.name
+        && a.amount == b.amount && a.currency == b.currency
+        && a.active == b.active && a.tags == b.tags
+        && a.values == b.values && a.created == b.created;
+    }
+
+    BOOST_AUTO_TEST_CASE(write)
+    {
+      string s;
+      {
+        auto w = new_text_writer(s);
+        text_writer::start_document(w, nullptr, "UTF-8");
+        text_writer::start_element(w, "records");
+        binding().write(w, example());
+        binding().write(w, Rec());
+        text_writer::end_document(w);
+      }
+      BOOST_CHECK_EQUAL(s, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+          "<records>"
+          "<rec id=\"-42\" code=\"7\">"
+          "<name>x &amp; &lt;y&gt; &quot;gr\xc3\xbc\xc3\x9f&quot;</name>"
+          "<amount currency=\"&quot;EUR&quot;&#10;\">0.1</amount>"
+          "<active>true</active>"
+          "<tags><tag>a</tag><tag>b</tag></tags>"
+          "<meta created=\"2016\"><values><v>1</v><v>-2</v><v>3</v>"
+          "</values></meta>"
+          "</rec>"
+          "<rec id=\"0\" code=\"0\"><name></name>"
+          "<amount currency=\"\">0</amount><active>false</active>"
+          "<tags></tags><meta created=\"\"><values></values></meta></rec>"
+          "</records>\n");
+    }
+
+    BOOST_AUTO_TEST_CASE(roundtrip)
+    {
+      string s("<records>");
+      vector<Rec> rs;
+      for (int i = 0; i < 100; ++i) {
+        Rec r = example();
+        r.id = i;
+        r.amount = i / 3.0;
+        r.tags.resize(i % 4, "t");
+        binding().append(s, r);
+        rs.push_back(r);
+      }
+      s += "</records>";
+      auto reader = text_reader::for_memory(s);
+      Rec r;
+      size_t n = 0;
+      while (binding().next(reader, r)) {
+        BOOST_REQUIRE(n < rs.size());
+        BOOST_CHECK(equal(r, rs[n]));
+        ++n;
+      }
+      BOOST_CHECK_EQUAL(n, rs.size());
+    }
+
+    BOOST_AUTO_TEST_CASE(read)
+    {
+      auto reader = text_reader::for_memory(
+          "<response xmlns:p='urn:p'>"
+          "<header><rec id='1'><name>nested</name></rec></header>"
+          "<p:rec xmlns='urn:x' id=' 12 ' p:code='3'>"
+          "  <unknown><name>skipped</name><tags><tag>no</tag></tags></unknown>"
+          "  <name>a<!-- comment -->b<![CDATA[<c>]]>&amp;d</name>"
+          "  <amount currency='EUR'> 1.5e3 </amount>"
+          "  <active>1</active>"
+          "  <tags><tag>x</tag><tag/><other/><tag>y<b>z</b></tag></tags>"
+          "  <meta><values><v>1</v></values><values><v>2</v></values></meta>"
+          "</p:rec>"
+          "<rec><name>second</name></rec>"
+          "</response>");
+      Rec r;
+      BOOST_REQUIRE(binding().next(reader, r));
+      BOOST_CHECK_EQUAL(r.id, 1);
+      BOOST_CHECK_EQUAL(r.name, "nested");
+      BOOST_REQUIRE(binding().next(reader, r));
+      BOOST_CHECK_EQUAL(r.id, 12);
+      BOOST_CHECK_EQUAL(r.code, 3);
+      BOOST_CHECK_EQUAL(r.name, "ab<c>&d");
+      BOOST_CHECK_EQUAL(r.amount, 1500);
+      BOOST_CHECK_EQUAL(r.currency, "EUR");
+      BOOST_CHECK(r.active);
+      BOOST_CHECK((r.tags == vector<string>{ "x", "", "y" }));
+      BOOST_CHECK((r.values == vector<int>{ 1, 2 }));
+      // reset
+      BOOST_REQUIRE(binding().next(reader, r));
+      BOOST_CHECK_EQUAL(r.id, 0);
+      BOOST_CHECK_EQUAL(r.name, "second");
+      BOOST_CHECK(r.tags.empty());
+      BOOST_CHECK(!r.active);
+      BOOST_CHECK(!binding().next(reader, r));
+    }
+
+    BOOST_AUTO_TEST_CASE(convert)
+    {
+      struct Num {
+        signed char c {0};
+        unsigned u {0};
+        long long ll {0};
+        float f {0};
+        double d {0};
+      };
+      bind::Binding<Num> b("n", {
+          bind::attribute("c", &Num::c),
+          bind::attribute("u", &Num::u),
+          bind::attribute("ll", &Num::ll),
+          bind::attribute("f", &Num::f),
+          bind::attribute("d", &Num::d) });
+      Num n;
+      n.c = -128;
+      n.u = numeric_limits<unsigned>::max();
+      n.ll = numeric_limits<long long>::min();
+      n.f = 0.1f;
+      n.d = -numeric_limits<double>::infinity();
+      string s;
+      b.append(s, n);
+      BOOST_CHECK_EQUAL(s, "<n c=\"-128\" u=\"4294967295\""
+          " ll=\"-9223372036854775808\" f=\"0.1\" d=\"-INF\"/>");
+      auto reader = text_reader::for_memory(s);
+      Num m;
+      BOOST_REQUIRE(b.next(reader, m));
+      BOOST_CHECK_EQUAL(int(m.c), -128);
+      BOOST_CHECK_EQUAL(m.u, n.u);
+      BOOST_CHECK_EQUAL(m.ll, n.ll);
+      BOOST_CHECK_EQUAL(m.f, n.f);
+      BOOST_CHECK_EQUAL(m.d, n.d);
+
+      for (const char *x : { "<n c='128'/>", "<n c='1x'/>", "<n u='-1'/>",
+          "<n u=''/>", "<n ll='99999999999999999999'/>", "<n d='0x10'/>",
+          "<n d='1 2'/>", "<n f='inf'/>" }) {
+        auto r = text_reader::for_memory(x);
+        BOOST_CHECK_THROW(b.next(r, m), xxxml::Runtime_Error);
+      }
+    }
+
+    BOOST_AUTO_TEST_CASE(errors)
+    {
+      // the reader doesn't copy the input
+      string long_value("<rec><amount>" + string(200, '1')
+          + "</amount></rec>");
+      auto r = text_reader::for_memory(long_value);
+      Rec x;
+      BOOST_CHECK_THROW(binding().next(r, x), xxxml::Runtime_Error);
+      // surrounding whitespace isn't limited
+      string spaced("<rec><amount>" + string(200, ' ') + "1<!-- c -->5"
+          + string(200, '\n') + "</amount></rec>");
+      auto p = text_reader::for_memory(spaced);
+      BOOST_REQUIRE(binding().next(p, x));
+      BOOST_CHECK_EQUAL(x.amount, 15);
+      auto o = text_reader::for_memory("<rec><amount>1 <!-- c --> 5</amount>"
+          "</rec>");
+      BOOST_CHECK_THROW(binding().next(o, x), xxxml::Runtime_Error);
+      auto q = text_reader::for_memory("<rec><active>yes</active></rec>");
+      BOOST_CHECK_THROW(binding().next(q, x), xxxml::Runtime_Error);
+
+      using B = bind::Binding<Rec>;
+      BOOST_CHECK_THROW(B("a b", {}), xxxml::Logic_Error);
+      BOOST_CHECK_THROW(B("r", { bind::element("a//b", &Rec::name) }),
+          xxxml::Logic_Error);
+      BOOST_CHECK_THROW(B("r", { bind::element("a", &Rec::name),
+            bind::element("a", &Rec::currency) }), xxxml::Logic_Error);
+      BOOST_CHECK_THROW(B("r", { bind::element("a", &Rec::name),
+            bind::element("a/b", &Rec::currency) }), xxxml::Logic_Error);
+      BOOST_CHECK_THROW(B("r", { bind::element("a/b", &Rec::name),
+            bind::element("a", &Rec::currency) }), xxxml::Logic_Error);
+      BOOST_CHECK_THROW(B("r", { bind::attribute("x", &Rec::name),
+            bind::attribute("x", &Rec::currency) }), xxxml::Logic_Error);
+      BOOST_CHECK_THROW(B("r", { bind::element("t", &Rec::tags),
+            bind::attribute("t/x", &Rec::currency) }), xxxml::Logic_Error);
+    }
+
+  BOOST_AUTO_TEST_SUITE_END() // bind_
+
+BOOST_AUTO_TEST_SUITE_END() // libxxxml
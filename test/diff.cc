@@ -0,0 +1,152 @@
+#include <boost/test/unit_test.hpp>
+
+#include <xxxml/diff.hh>
+
+#include <algorithm>
+#include <sstream>
+#include <array>
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(libxxxml)
+
+  BOOST_AUTO_TEST_SUITE(diff_)
+
+    using namespace xxxml;
+    namespace diff = xxxml::util::diff;
+    namespace hash = xxxml::util::hash;
+
+    static hash::Value root_hash(const doc::Ptr &d)
+    {
+      return hash::subtree(doc::get_root_element(d));
+    }
+
+    static diff::Script check_roundtrip(const char *a_s, const char *b_s)
+    {
+      doc::Ptr a = read_memory(a_s);
+      doc::Ptr b = read_memory(b_s);
+      diff::Script s = diff::compute(a, b);
+      diff::apply(a, s);
+      BOOST_CHECK_EQUAL(root_hash(a), root_hash(b));
+      // via the XML representation
+      doc::Ptr c = read_memory(a_s);
+      diff::apply(c, diff::from_doc(diff::to_doc(s)));
+      BOOST_CHECK_EQUAL(root_hash(c), root_hash(b));
+      return s;
+    }
+
+    BOOST_AUTO_TEST_CASE(equal)
+    {
+      auto s = check_roundtrip("<r><a x='1'>Hello</a></r>",
+          "<r><a x='1'>Hello</a></r>");
+      BOOST_CHECK(s.empty());
+    }
+
+    BOOST_AUTO_TEST_CASE(text)
+    {
+      auto s = check_roundtrip("<r><a>Hello</a><b>World</b></r>",
+          "<r><a>Hello</a><b>W&amp;rld</b></r>");
+      BOOST_REQUIRE_EQUAL(s.size(), 1u);
+      BOOST_CHECK(s[0].op == diff::Op::SET_CONTENT);
+      const array<size_t, 2> path = { 1, 0 };
+      BOOST_CHECK_EQUAL_COLLECTIONS(s[0].path.begin(), s[0].path.end(),
+          path.begin(), path.end());
+      BOOST_CHECK_EQUAL(s[0].value, "W&rld");
+    }
+
+    BOOST_AUTO_TEST_CASE(attributes)
+    {
+      auto s = check_roundtrip(
+          "<r xmlns:p='urn:p'><a x='1' y='2' p:z='3'/></r>",
+          "<r xmlns:p='urn:p'><a y='2' x='4' p:z='5' n='6'/></r>");
+      BOOST_CHECK_EQUAL(s.size(), 3u);
+      s = check_roundtrip("<r><a x='1' y='2'/></r>", "<r><a y='2'/></r>");
+      BOOST_REQUIRE_EQUAL(s.size(), 1u);
+      BOOST_CHECK(s[0].op == diff::Op::REMOVE_ATTRIBUTE);
+    }
+
+    BOOST_AUTO_TEST_CASE(insert_delete)
+    {
+      check_roundtrip("<r><a/><b/><c/></r>", "<r><a/><x>1</x><c/></r>");
+      check_roundtrip("<r><a/><b/><c/></r>", "<r><c/><b/><a/></r>");
+      check_roundtrip("<r><a/>text<b/></r>", "<r>text<b/><a/>more</r>");
+      check_roundtrip("<r/>", "<r><a><b/></a><!-- c --><?pi x?></r>");
+      check_roundtrip("<r><a><b/></a><!-- c --><?pi x?></r>", "<r/>");
+      auto s = check_roundtrip("<r><a/><b/><c/></r>", "<r><a/><c/></r>");
+      BOOST_REQUIRE_EQUAL(s.size(), 1u);
+      BOOST_CHECK(s[0].op == diff::Op::DELETE);
+    }
+
+    BOOST_AUTO_TEST_CASE(namespaces)
+    {
+      check_roundtrip("<r xmlns='urn:d' xmlns:p='urn:p'><p:a/></r>",
+          "<r xmlns='urn:d' xmlns:p='urn:p'><p:a><p:b>x</p:b><c/></p:a></r>");
+      check_roundtrip("<r xmlns:p='urn:p'><p:a/></r>",
+          "<r xmlns:p='urn:p'><a/></r>");
+    }
+
+    BOOST_AUTO_TEST_CASE(entity_references)
+    {
+      // without XML_PARSE_NOENT, i.e. the references are kept
+      const string dtd = "<!DOCTYPE r [<!ENTITY e 'Hello'>"
+        "<!ENTITY f 'World'>]>";
+      auto s = check_roundtrip((dtd + "<r><a>&e;</a><b/></r>").c_str(),
+          (dtd + "<r><a>&f;</a><b>&e;</b><c>x&f;</c></r>").c_str());
+      auto i = find_if(s.begin(), s.end(), [](const diff::Edit &e) {
+          return e.type == XML_ENTITY_REF_NODE; });
+      BOOST_REQUIRE(i != s.end());
+      BOOST_CHECK(i->op == diff::Op::INSERT);
+      BOOST_CHECK(i->name == "f" || i->name == "e");
+
+      // the patched reference gets the replacement text of the DTD
+      doc::Ptr a = read_memory(dtd + "<r><a>&e;</a></r>");
+      doc::Ptr b = read_memory(dtd + "<r><a>&f;</a></r>");
+      diff::apply(a, diff::compute(a, b));
+      const xmlNode *x = doc::get_root_element(a)->children->children;
+      BOOST_REQUIRE_EQUAL(x->type, XML_ENTITY_REF_NODE);
+      BOOST_CHECK_EQUAL(content(x), "World");
+    }
+
+    BOOST_AUTO_TEST_CASE(root)
+    {
+      auto s = check_roundtrip("<r><a/></r>", "<s><a/></s>");
+      BOOST_REQUIRE_EQUAL(s.size(), 1u);
+      BOOST_CHECK(s[0].op == diff::Op::REPLACE);
+    }
+
+    BOOST_AUTO_TEST_CASE(large)
+    {
+      ostringstream a, b;
+      a << "<root>\n";
+      b << "<root>\n";
+      for (unsigned i = 0; i < 2000; ++i) {
+        a << "  <rec id='" << i << "'><v>" << i << "</v></rec>\n";
+        if (i == 700)
+          b << "  <rec id='" << i << "'><v>changed</v></rec>\n";
+        else if (i == 900)
+          ;
+        else
+          b << "  <rec id='" << i << "'><v>" << i << "</v></rec>\n";
+        if (i == 1500)
+          b << "  <new/>\n";
+      }
+      a << "</root>\n";
+      b << "</root>\n";
+      auto s = check_roundtrip(a.str().c_str(), b.str().c_str());
+      // text change, deleting a record plus its whitespace,
+      // inserting an element plus its whitespace
+      BOOST_CHECK_EQUAL(s.size(), 5u);
+    }
+
+    BOOST_AUTO_TEST_CASE(mismatch)
+    {
+      doc::Ptr a = read_memory("<r><a/></r>");
+      diff::Script s(1);
+      s[0].op = diff::Op::DELETE;
+      s[0].path = { 3 };
+      BOOST_CHECK_THROW(diff::apply(a, s), xxxml::Runtime_Error);
+    }
+
+  BOOST_AUTO_TEST_SUITE_END() // diff_
+
+BOOST_AUTO_TEST_SUITE_END() // libxxxml
@@ -0,0 +1,153 @@
+#include <boost/test/unit_test.hpp>
+
+#include <xxxml/dispatch.hh>
+
+#include <string>
+#include <vector>
+
+#include <string.h>
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(libxxxml)
+
+  BOOST_AUTO_TEST_SUITE(dispatch_)
+
+    using namespace xxxml;
+    namespace dispatch = xxxml::util::dispatch;
+
+    using Names = dispatch::Table<XXXML_STR("rec"), XXXML_STR("name"),
+          XXXML_STR("amount"), XXXML_STR("currency"), XXXML_STR("tags"),
+          XXXML_STR("tag"), XXXML_STR("a"), XXXML_STR("b")>;
+
+    static_assert(Names::index<XXXML_STR("rec")>() == 0, "index");
+    static_assert(Names::index<XXXML_STR("b")>() == 7, "index");
+    static_assert(Names::size == 8, "size");
+    static_assert(Names::mask + 1 >= 16, "at least two slots per name");
+
+    static const char *const names[] = { "rec", "name", "amount",
+      "currency", "tags", "tag", "a", "b" };
+    static const char *const unknown[] = { "", "re", "recs", "Rec", "c",
+      "tagx", "ta", "amoun", "namespace" };
+
+    // the elements of a document
+    static const char doc[] = "<rec><name>x</name><unknown/><amount/>"
+      "<tags><tag/><tag/></tags><a><b/><c/></a><currency/></rec>";
+    static int expected(const char *name)
+    {
+      for (size_t i = 0; i < sizeof names / sizeof names[0]; ++i)
+        if (!strcmp(names[i], name))
+          return i;
+      return -1;
+    }
+
+    BOOST_AUTO_TEST_CASE(table)
+    {
+      for (size_t i = 0; i < Names::size; ++i) {
+        BOOST_CHECK_EQUAL(Names::find(names[i]), int(i));
+        string s(names[i]);
+        BOOST_CHECK_EQUAL(Names::find(s), int(i));
+        BOOST_CHECK_EQUAL(Names::names[i], names[i]);
+      }
+      for (const char *x : unknown) {
+        BOOST_CHECK_EQUAL(Names::find(x), -1);
+        BOOST_CHECK_EQUAL(Names::find(x, x + strlen(x)), -1);
+      }
+      // a prefix of a longer range
+      const char s[] = "amountx";
+      BOOST_CHECK_EQUAL(Names::find(s, s + 6), 2);
+
+      switch (Names::find("tag")) {
+        case Names::index<XXXML_STR("tags")>(): BOOST_CHECK(false); break;
+        case Names::index<XXXML_STR("tag")>(): break;
+        default: BOOST_CHECK(false);
+      }
+
+      using Empty = dispatch::Table<>;
+      BOOST_CHECK_EQUAL(Empty::find("x"), -1);
+      BOOST_CHECK_EQUAL(Empty::find(""), -1);
+    }
+
+    using Many = dispatch::Table<
+      XXXML_STR("e0"), XXXML_STR("e1"), XXXML_STR("e2"), XXXML_STR("e3"),
+      XXXML_STR("e4"), XXXML_STR("e5"), XXXML_STR("e6"), XXXML_STR("e7"),
+      XXXML_STR("e8"), XXXML_STR("e9"), XXXML_STR("e10"), XXXML_STR("e11"),
+      XXXML_STR("e12"), XXXML_STR("e13"), XXXML_STR("e14"),
+      XXXML_STR("e15"), XXXML_STR("e16"), XXXML_STR("e17"),
+      XXXML_STR("e18"), XXXML_STR("e19"), XXXML_STR("e20"),
+      XXXML_STR("e21"), XXXML_STR("e22"), XXXML_STR("e23"),
+      XXXML_STR("e24"), XXXML_STR("e25"), XXXML_STR("e26"),
+      XXXML_STR("e27"), XXXML_STR("e28"), XXXML_STR("e29"),
+      XXXML_STR("e30"), XXXML_STR("e31")>;
+
+    BOOST_AUTO_TEST_CASE(many)
+    {
+      vector<string> v;
+      for (unsigned i = 0; i < 32; ++i) {
+        string s = "e" + to_string(i);
+        BOOST_CHECK_EQUAL(Many::find(s.c_str()), int(i));
+        v.push_back(s);
+      }
+      BOOST_CHECK_EQUAL(Many::find("e32"), -1);
+      dispatch::Name_Table t(v);
+      for (unsigned i = 0; i < 32; ++i)
+        BOOST_CHECK_EQUAL(t.find(v[i]), int(i));
+      BOOST_CHECK_EQUAL(t.find("e32"), -1);
+    }
+
+    BOOST_AUTO_TEST_CASE(name_table)
+    {
+      dispatch::Name_Table t(vector<string>(names, names
+            + sizeof names / sizeof names[0]));
+      BOOST_CHECK_EQUAL(t.size(), 8u);
+      for (size_t i = 0; i < t.size(); ++i) {
+        BOOST_CHECK_EQUAL(t.find(names[i]), int(i));
+        BOOST_CHECK_EQUAL(t.name(i), names[i]);
+      }
+      for (const char *x : unknown)
+        BOOST_CHECK_EQUAL(t.find(x), -1);
+      dispatch::Name_Table e;
+      BOOST_CHECK_EQUAL(e.find("rec"), -1);
+      BOOST_CHECK_THROW(dispatch::Name_Table({ "a", "b", "a" }),
+          xxxml::Logic_Error);
+    }
+
+    BOOST_AUTO_TEST_CASE(interned)
+    {
+      auto r = text_reader::for_memory(doc);
+      dispatch::Interned in(r, Names::names, Names::size);
+      BOOST_CHECK_EQUAL(in.size(), Names::size);
+      size_t n = 0;
+      while (text_reader::read(r)) {
+        if (text_reader::node_type(r) != XML_READER_TYPE_ELEMENT)
+          continue;
+        const char *name = text_reader::const_local_name(r);
+        BOOST_CHECK_EQUAL(in.find(name), expected(name));
+        BOOST_CHECK_EQUAL(Names::find(name), expected(name));
+        ++n;
+      }
+      BOOST_CHECK_EQUAL(n, 11u);
+      // not interned
+      string s("rec");
+      BOOST_CHECK_EQUAL(in.find(s.c_str()), -1);
+    }
+
+    BOOST_AUTO_TEST_CASE(interned_dict)
+    {
+      auto d = dict::create();
+      dispatch::Interned in(d, Names::names, Names::size);
+      for (size_t i = 0; i < Names::size; ++i)
+        BOOST_CHECK_EQUAL(in.find(reinterpret_cast<const char*>(
+                dict::lookup(d, names[i]))), int(i));
+      BOOST_CHECK_EQUAL(in.find(reinterpret_cast<const char*>(
+              dict::lookup(d, "c"))), -1);
+      BOOST_CHECK_EQUAL(in.find(names[0]), -1);
+      BOOST_CHECK_THROW(dispatch::Interned(d.get(),
+            vector<string>{ "a", "a" }), xxxml::Logic_Error);
+      dispatch::Interned e(d.get(), vector<string>());
+      BOOST_CHECK_EQUAL(e.find(names[0]), -1);
+    }
+
+  BOOST_AUTO_TEST_SUITE_END() // dispatch_
+
+BOOST_AUTO_TEST_SUITE_END() // libxxxml
@@ -0,0 +1,166 @@
+#include <boost/test/unit_test.hpp>
+
+#include <xxxml/entity_cache.hh>
+
+#include "temp_file.hh"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <limits.h>
+#include <stdlib.h>
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(libxxxml)
+
+  BOOST_AUTO_TEST_SUITE(entity_cache_)
+
+    using namespace xxxml;
+
+    // installs the loader for the duration of a test
+    struct Installed {
+      xmlExternalEntityLoader old;
+      Installed()
+        : old(set_external_entity_loader(util::Entity_Cache::loader))
+      {
+        util::Entity_Cache::instance().clear();
+        util::Entity_Cache::instance().set_disk_fallback(true);
+      }
+      ~Installed()
+      {
+        set_external_entity_loader(old);
+        util::Entity_Cache::instance().clear();
+      }
+    };
+
+    static const char importing_xsd[] =
+      "<xs:schema xmlns:xs='http://www.w3.org/2001/XMLSchema'"
+      "    xmlns:t='urn:t'>"
+      "<xs:import namespace='urn:t'"
+      "    schemaLocation='http://example.org/t.xsd'/>"
+      "<xs:element name='root' type='t:value'/></xs:schema>";
+
+    BOOST_FIXTURE_TEST_CASE(seeded, Installed)
+    {
+      auto &cache = util::Entity_Cache::instance();
+      cache.add("http://example.org/t.xsd",
+          "<xs:schema xmlns:xs='http://www.w3.org/2001/XMLSchema'"
+          "    targetNamespace='urn:t'>"
+          "<xs:simpleType name='value'><xs:restriction base='xs:int'/>"
+          "</xs:simpleType></xs:schema>");
+      for (unsigned i = 0; i < 2; ++i) {
+        schema::Parser_Ctxt_Ptr pc = schema::new_mem_parser_ctxt(importing_xsd);
+        schema::Ptr s = schema::parse(pc);
+        schema::Valid_Ctxt_Ptr v = schema::new_valid_ctxt(s);
+        BOOST_CHECK_NO_THROW(schema::validate_doc(v,
+              read_memory("<root>23</root>")));
+        BOOST_CHECK_THROW(schema::validate_doc(v,
+              read_memory("<root>x</root>")), Validate_Error);
+      }
+      BOOST_CHECK_EQUAL(cache.hits(), 2u);
+      BOOST_CHECK_EQUAL(cache.misses(), 0u);
+    }
+
+    BOOST_FIXTURE_TEST_CASE(no_network, Installed)
+    {
+      schema::Parser_Ctxt_Ptr pc = schema::new_mem_parser_ctxt(importing_xsd);
+      // the unresolved import leaves t:value undefined
+      BOOST_CHECK_THROW(schema::parse(pc), Parse_Error);
+      BOOST_CHECK_EQUAL(util::Entity_Cache::instance().misses(), 1u);
+    }
+
+    BOOST_FIXTURE_TEST_CASE(disk, Installed)
+    {
+      auto &cache = util::Entity_Cache::instance();
+      test::Temp_File t("entity_cache", "Hello");
+      char buf[PATH_MAX];
+      BOOST_REQUIRE(realpath(t.name, buf));
+      string doc_s = string("<!DOCTYPE r [<!ENTITY e SYSTEM 'file://") + buf
+        + "'>]><r>&e;</r>";
+      for (unsigned i = 0; i < 2; ++i) {
+        doc::Ptr d = read_memory(doc_s, nullptr, nullptr, XML_PARSE_NOENT);
+        BOOST_CHECK_EQUAL(content(doc::get_root_element(d)->children),
+            "Hello");
+      }
+      // the second one was served from memory
+      BOOST_CHECK_EQUAL(cache.hits(), 1u);
+      BOOST_CHECK_EQUAL(cache.misses(), 1u);
+      BOOST_CHECK_EQUAL(cache.size(), 1u);
+
+      // the file changes, i.e. it's read again
+      t.write("Hello, World");
+      {
+        doc::Ptr d = read_memory(doc_s, nullptr, nullptr, XML_PARSE_NOENT);
+        BOOST_CHECK_EQUAL(content(doc::get_root_element(d)->children),
+            "Hello, World");
+      }
+      BOOST_CHECK_EQUAL(cache.misses(), 2u);
+      BOOST_CHECK_EQUAL(cache.size(), 1u);
+
+      cache.clear();
+      cache.set_disk_fallback(false);
+      cache.add(buf, "World");
+      doc::Ptr d = read_memory(doc_s, nullptr, nullptr, XML_PARSE_NOENT);
+      BOOST_CHECK_EQUAL(content(doc::get_root_element(d)->children),
+          "World");
+    }
+
+    BOOST_FIXTURE_TEST_CASE(compressed, Installed)
+    {
+      auto &cache = util::Entity_Cache::instance();
+      test::Temp_File t("entity_cache");
+      {
+        doc::Ptr d = read_memory("<r>Hello</r>");
+        // i.e. gzip
+        xmlSetDocCompressMode(d.get(), 9);
+        BOOST_REQUIRE(xmlSaveFile(t.name, d.get()) > 0);
+      }
+      for (unsigned i = 0; i < 2; ++i) {
+        doc::Ptr d = read_file(t.name);
+        BOOST_CHECK_EQUAL(content(doc::get_root_element(d)->children),
+            "Hello");
+      }
+      BOOST_CHECK_EQUAL(cache.size(), 0u);
+    }
+
+    BOOST_FIXTURE_TEST_CASE(max_size, Installed)
+    {
+      auto &cache = util::Entity_Cache::instance();
+      cache.add("urn:seeded", "<r>seeded</r>");
+      cache.set_max_size(20);
+      vector<unique_ptr<test::Temp_File> > fs;
+      vector<string> names;
+      for (unsigned i = 0; i < 3; ++i) {
+        fs.emplace_back(new test::Temp_File("entity_cache",
+              "<r>" + to_string(i) + "</r>"));
+        names.push_back(fs.back()->name);
+      }
+      // 8 bytes each, i.e. at most two are cached
+      for (auto &name : names)
+        read_file(name);
+      BOOST_CHECK_EQUAL(cache.size(), 3u);
+      // the least recently used one was evicted
+      read_file(names[1]);
+      BOOST_CHECK_EQUAL(cache.hits(), 1u);
+      read_file(names[0]);
+      BOOST_CHECK_EQUAL(cache.hits(), 1u);
+      read_file(names[1]);
+      BOOST_CHECK_EQUAL(cache.hits(), 2u);
+
+      // larger than max_size
+      fs[2]->write("<r>" + string(100, 'x') + "</r>");
+      cache.clear();
+      read_file(names[2]);
+      BOOST_CHECK_EQUAL(cache.size(), 0u);
+
+      cache.set_max_size(0);
+      cache.add("urn:seeded", "<r>seeded</r>");
+      BOOST_CHECK_EQUAL(cache.size(), 1u);
+      cache.set_max_size(16 * 1024 * 1024);
+    }
+
+  BOOST_AUTO_TEST_SUITE_END() // entity_cache_
+
+BOOST_AUTO_TEST_SUITE_END() // libxxxml
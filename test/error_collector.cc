@@ -0,0 +1,198 @@
+#include <boost/test/unit_test.hpp>
+
+#include <xxxml/error_collector.hh>
+#include <xxxml/validator.hh>
+
+#include "temp_file.hh"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(libxxxml)
+
+  BOOST_AUTO_TEST_SUITE(error_collector_)
+
+    using namespace xxxml;
+
+    static const char xsd_s[] =
+      "<xs:schema xmlns:xs='http://www.w3.org/2001/XMLSchema'>"
+      "<xs:element name='root'><xs:complexType><xs:sequence>"
+      "<xs:element name='a' type='xs:int' maxOccurs='unbounded'/>"
+      "</xs:sequence></xs:complexType></xs:element></xs:schema>";
+    static const char rng_s[] =
+      "<element name='root' xmlns='http://relaxng.org/ns/structure/1.0'"
+      "    datatypeLibrary='http://www.w3.org/2001/XMLSchema-datatypes'>"
+      "<oneOrMore><element name='a'><data type='int'/></element></oneOrMore>"
+      "</element>";
+
+    // n records, one per line, every k-th is invalid
+    static string flood(unsigned n, unsigned k)
+    {
+      ostringstream o;
+      o << "<root>\n";
+      for (unsigned i = 0; i < n; ++i)
+        if (k && i % k == 0)
+          o << "<a>x</a>\n";
+        else
+          o << "<a>" << i << "</a>\n";
+      o << "</root>\n";
+      return o.str();
+    }
+
+    static unique_ptr<util::Validator> xsd_validator()
+    {
+      schema::Parser_Ctxt_Ptr pc = schema::new_mem_parser_ctxt(xsd_s);
+      return unique_ptr<util::Validator>(
+          new util::Validator(schema::parse(pc)));
+    }
+    static unique_ptr<util::Validator> rng_validator()
+    {
+      relaxng::Parser_Ctxt_Ptr pc = relaxng::new_mem_parser_ctxt(rng_s);
+      return unique_ptr<util::Validator>(
+          new util::Validator(relaxng::parse(pc)));
+    }
+
+    BOOST_AUTO_TEST_CASE(ring)
+    {
+      schema::Parser_Ctxt_Ptr pc = schema::new_mem_parser_ctxt(xsd_s);
+      schema::Ptr s = schema::parse(pc);
+      schema::Valid_Ctxt_Ptr v = schema::new_valid_ctxt(s);
+      util::Error_Collector c(4);
+      c.attach(v);
+      doc::Ptr d = read_memory(flood(10, 1));
+      BOOST_CHECK_THROW(schema::validate_doc(v, d), Validate_Error);
+      BOOST_CHECK_EQUAL(c.errors(), 10u);
+      BOOST_REQUIRE_EQUAL(c.size(), 4u);
+      // the latest ones
+      for (unsigned i = 0; i < 4; ++i) {
+        BOOST_CHECK_EQUAL(c[i].line, int(8 + i));
+        BOOST_CHECK(c[i].node);
+        BOOST_CHECK_EQUAL(c[i].code, c[0].code);
+        BOOST_CHECK_EQUAL(c[i].message, c[0].message);
+      }
+      BOOST_CHECK(string(c[0].message).find("'x'") != string::npos);
+      BOOST_CHECK(!c.limit_reached());
+      c.clear();
+      BOOST_CHECK_EQUAL(c.size(), 0u);
+      BOOST_CHECK_EQUAL(c.errors(), 0u);
+    }
+
+    BOOST_AUTO_TEST_CASE(truncated)
+    {
+      schema::Parser_Ctxt_Ptr pc = schema::new_mem_parser_ctxt(xsd_s);
+      schema::Ptr s = schema::parse(pc);
+      schema::Valid_Ctxt_Ptr v = schema::new_valid_ctxt(s);
+      util::Error_Collector c(2);
+      c.attach(v);
+      string value(2 * util::Error_Collector::MESSAGE_SIZE, 'x');
+      doc::Ptr d = read_memory("<root><a>" + value + "</a></root>");
+      BOOST_CHECK_THROW(schema::validate_doc(v, d), Validate_Error);
+      BOOST_REQUIRE_EQUAL(c.size(), 1u);
+      BOOST_CHECK_EQUAL(strlen(c[0].message),
+          util::Error_Collector::MESSAGE_SIZE - 1);
+      BOOST_CHECK(string(c[0].message).find("xxx") != string::npos);
+    }
+
+    BOOST_AUTO_TEST_CASE(silent)
+    {
+      auto v = xsd_validator();
+      util::Error_Collector c(8, 8, util::Error_Collector::Mode::SILENT);
+      BOOST_CHECK(!v->validate(read_memory(flood(4, 2)), c));
+      BOOST_REQUIRE_EQUAL(c.size(), 2u);
+      BOOST_CHECK(!c[0].message);
+      BOOST_CHECK(c[0].code);
+      BOOST_CHECK_EQUAL(c[1].line, 4);
+    }
+
+    BOOST_AUTO_TEST_CASE(cutoff)
+    {
+      unique_ptr<util::Validator> vs[] = { xsd_validator(), rng_validator() };
+      for (auto &v : vs) {
+        unsigned n = v->kind() == util::Validator::Kind::XSD ? 1 : 3;
+        doc::Ptr d = read_memory(flood(100, 10));
+        util::Error_Collector c(8, 3);
+        BOOST_CHECK(!v->validate(d, c));
+        BOOST_CHECK_EQUAL(c.errors(), 3u);
+        BOOST_CHECK(c.limit_reached());
+        util::Error_Collector e;
+        BOOST_CHECK(v->validate(read_memory(flood(100, 0)), e));
+        BOOST_CHECK(!v->validate(d, e));
+        // RelaxNG reports 3 errors per invalid element
+        BOOST_CHECK_EQUAL(e.errors(), n * 10u);
+      }
+    }
+
+    BOOST_AUTO_TEST_CASE(file)
+    {
+      test::Temp_File t("error_collector");
+      unique_ptr<util::Validator> vs[] = { xsd_validator(), rng_validator() };
+      for (auto &v : vs) {
+        unsigned n = v->kind() == util::Validator::Kind::XSD ? 1 : 3;
+        // larger than a chunk
+        t.write(flood(20000, 1000));
+        util::Error_Collector c(8, 2);
+        BOOST_CHECK(!v->validate_file(t.name, c));
+        BOOST_CHECK_EQUAL(c.errors(), 2u);
+        if (v->kind() == util::Validator::Kind::XSD)
+          BOOST_CHECK_EQUAL(c[1].line, 1002);
+
+        util::Error_Collector e;
+        BOOST_CHECK(!v->validate_file(t.name, e));
+        BOOST_CHECK_EQUAL(e.errors(), n * 20u);
+
+        t.write(flood(20000, 0));
+        util::Error_Collector f;
+        BOOST_CHECK(v->validate_file(t.name, f));
+        BOOST_CHECK_EQUAL(f.errors(), 0u);
+
+        t.write("<root><a>1</a>");
+        util::Error_Collector g;
+        BOOST_CHECK(!v->validate_file(t.name, g));
+        BOOST_CHECK(g.errors());
+      }
+    }
+
+    static void gzip_write(const char *filename, const string &s)
+    {
+      gzFile f = gzopen(filename, "wb");
+      BOOST_REQUIRE(f);
+      BOOST_REQUIRE_EQUAL(gzwrite(f, s.data(), s.size()), int(s.size()));
+      BOOST_REQUIRE_EQUAL(gzclose(f), Z_OK);
+    }
+
+    BOOST_AUTO_TEST_CASE(compressed)
+    {
+      test::Temp_File t("error_collector");
+      unique_ptr<util::Validator> vs[] = { xsd_validator(), rng_validator() };
+      for (auto &v : vs) {
+        unsigned n = v->kind() == util::Validator::Kind::XSD ? 1 : 3;
+        gzip_write(t.name, flood(20000, 1000));
+        util::Error_Collector e;
+        BOOST_CHECK(!v->validate_file(t.name, e));
+        BOOST_CHECK_EQUAL(e.errors(), n * 20u);
+        // same input as the other overload
+        vector<util::Validation_Error> es;
+        BOOST_CHECK(!v->validate_file(t.name, es, 1000));
+        BOOST_CHECK_EQUAL(es.size(), n * 20u);
+
+        gzip_write(t.name, flood(20000, 0));
+        util::Error_Collector f;
+        BOOST_CHECK(v->validate_file(t.name, f));
+        BOOST_CHECK_EQUAL(f.errors(), 0u);
+
+        // truncated
+        string z = test::slurp(t.name);
+        t.write(z.substr(0, z.size() / 2));
+        util::Error_Collector g;
+        BOOST_CHECK(!v->validate_file(t.name, g));
+      }
+    }
+
+  BOOST_AUTO_TEST_SUITE_END() // error_collector_
+
+BOOST_AUTO_TEST_SUITE_END() // libxxxml
@@ -0,0 +1,55 @@
+#include <boost/test/unit_test.hpp>
+
+#include <xxxml/escape.hh>
+
+#include <string>
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(libxxxml)
+
+  BOOST_AUTO_TEST_SUITE(escape_)
+
+    using namespace xxxml::detail;
+
+    BOOST_AUTO_TEST_CASE(scanners_)
+    {
+      auto &ss = scanners();
+      BOOST_REQUIRE(!ss.empty());
+      BOOST_CHECK_EQUAL(ss.back().name, "scalar");
+      BOOST_TEST_MESSAGE("escape scanner: " << ss.front().name);
+    }
+
+    BOOST_AUTO_TEST_CASE(agree)
+    {
+      const char cs[] = "<>&\"\r\n\t\x80\xc3\xff x'\x7f";
+      for (auto &scanner : scanners()) {
+        for (size_t n : { 0u, 1u, 15u, 16u, 17u, 31u, 32u, 33u, 100u }) {
+          for (size_t pos = 0; pos < n; ++pos) {
+            for (const char *c = cs; *c; ++c) {
+              string s(n, 'a');
+              s[pos] = *c;
+              const char *b = s.data(), *e = b + n;
+              for (auto m : { Escape::TEXT, Escape::ATTRIBUTE }) {
+                auto r = scanner.scan(b, e, m);
+                bool text = *c == '<' || *c == '>' || *c == '&'
+                  || *c == '"' || *c == '\r';
+                bool attribute = text || *c == '\n' || *c == '\t'
+                  || (*c & 0x80);
+                bool hit = m == Escape::TEXT ? text : attribute;
+                BOOST_CHECK_EQUAL(r - b, hit ? pos : n);
+              }
+            }
+          }
+          // the range end is respected
+          string s(n, 'a');
+          s += '<';
+          BOOST_CHECK(scanner.scan(s.data(), s.data() + n, Escape::TEXT)
+              == s.data() + n);
+        }
+      }
+    }
+
+  BOOST_AUTO_TEST_SUITE_END() // escape_
+
+BOOST_AUTO_TEST_SUITE_END() // libxxxml
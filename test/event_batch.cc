@@ -0,0 +1,113 @@
+#include <boost/test/unit_test.hpp>
+
+#include <xxxml/event_batch.hh>
+
+#include <sstream>
+#include <array>
+#include <string>
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(libxxxml)
+
+  BOOST_AUTO_TEST_SUITE(event_batch_)
+
+    using namespace xxxml;
+
+    BOOST_AUTO_TEST_CASE(basic)
+    {
+      auto reader = text_reader::for_memory(
+          "<root xmlns:p='urn:p'><foo>Hello</foo>"
+          "<bar id='1' p:x='23'>World</bar><p:e/></root>");
+      util::Event_Batch b;
+      size_t n = b.read(reader, 100);
+      BOOST_REQUIRE_EQUAL(n, 9u);
+      BOOST_CHECK_EQUAL(b.size(), n);
+      const array<int, 9> types = {
+        XML_READER_TYPE_ELEMENT, XML_READER_TYPE_ELEMENT, XML_READER_TYPE_TEXT,
+        XML_READER_TYPE_END_ELEMENT, XML_READER_TYPE_ELEMENT,
+        XML_READER_TYPE_TEXT, XML_READER_TYPE_END_ELEMENT,
+        XML_READER_TYPE_ELEMENT, XML_READER_TYPE_END_ELEMENT };
+      BOOST_CHECK_EQUAL_COLLECTIONS(b.type.begin(), b.type.end(),
+          types.begin(), types.end());
+      const array<unsigned, 9> depths = { 0, 1, 2, 1, 1, 2, 1, 1, 0 };
+      BOOST_CHECK_EQUAL_COLLECTIONS(b.depth.begin(), b.depth.end(),
+          depths.begin(), depths.end());
+
+      BOOST_CHECK_EQUAL(b.name[1], "foo");
+      BOOST_CHECK(!b.namespace_uri[1]);
+      BOOST_CHECK(!b.value[1]);
+      BOOST_CHECK_EQUAL(string(b.value[2], b.value_size[2]), "Hello");
+      BOOST_CHECK_EQUAL(string(b.value[5], b.value_size[5]), "World");
+
+      // interned, i.e. comparable by pointer
+      BOOST_CHECK(b.name[4] == util::Event_Batch::interned(reader, "bar"));
+      BOOST_CHECK(b.name[1] == b.name[3]);
+      BOOST_CHECK_EQUAL(b.name[7], "e");
+      BOOST_CHECK_EQUAL(b.namespace_uri[7], "urn:p");
+      BOOST_CHECK(b.is_empty[7]);
+      BOOST_CHECK(!b.is_empty[1]);
+
+      BOOST_REQUIRE_EQUAL(b.attr_begin.size(), n + 1);
+      BOOST_CHECK_EQUAL(b.attr_begin[4], 0u);
+      BOOST_CHECK_EQUAL(b.attr_begin[5], 2u);
+      BOOST_CHECK_EQUAL(b.attr_begin[n], 2u);
+      BOOST_CHECK_EQUAL(b.attr_name[0], "id");
+      BOOST_CHECK(!b.attr_namespace_uri[0]);
+      BOOST_CHECK_EQUAL(string(b.attr_value[0], b.attr_value_size[0]), "1");
+      BOOST_CHECK_EQUAL(b.attr_name[1], "x");
+      BOOST_CHECK_EQUAL(b.attr_namespace_uri[1], "urn:p");
+      BOOST_CHECK(b.attr_namespace_uri[1]
+          == util::Event_Batch::interned(reader, "urn:p"));
+      BOOST_CHECK_EQUAL(b.attr_value[1], "23");
+
+      BOOST_CHECK_EQUAL(b.read(reader, 100), 0u);
+      BOOST_CHECK(b.empty());
+    }
+
+    BOOST_AUTO_TEST_CASE(values_survive_reading)
+    {
+      ostringstream o;
+      o << "<root>";
+      for (unsigned i = 0; i < 1000; ++i)
+        o << "<v a='x&amp;" << i << "'>" << i << "</v>";
+      o << "</root>";
+      string xml(o.str());
+      auto reader = text_reader::for_memory(xml);
+      util::Event_Batch b;
+      unsigned i = 0, k = 0;
+      while (size_t n = b.read(reader, 64)) {
+        BOOST_CHECK(n <= 64);
+        // checked after the whole batch is read, i.e. the
+        // reader already freed most of the nodes
+        for (size_t j = 0; j < n; ++j) {
+          if (b.type[j] == XML_READER_TYPE_TEXT) {
+            BOOST_CHECK_EQUAL(b.value[j], to_string(i));
+            ++i;
+          } else if (b.type[j] == XML_READER_TYPE_ELEMENT && b.depth[j]) {
+            BOOST_REQUIRE_EQUAL(b.attr_begin[j + 1] - b.attr_begin[j], 1u);
+            BOOST_CHECK_EQUAL(b.attr_value[b.attr_begin[j]],
+                "x&" + to_string(k));
+            ++k;
+          }
+        }
+      }
+      BOOST_CHECK_EQUAL(i, 1000u);
+      BOOST_CHECK_EQUAL(k, 1000u);
+    }
+
+    BOOST_AUTO_TEST_CASE(empty_values)
+    {
+      auto reader = text_reader::for_memory("<root a=''><!----></root>");
+      util::Event_Batch b;
+      BOOST_REQUIRE_EQUAL(b.read(reader, 10), 3u);
+      BOOST_CHECK_EQUAL(b.type[1], XML_READER_TYPE_COMMENT);
+      BOOST_REQUIRE(b.value[1]);
+      BOOST_CHECK_EQUAL(b.value_size[1], 0u);
+      BOOST_REQUIRE(b.attr_value[0]);
+      BOOST_CHECK_EQUAL(b.attr_value_size[0], 0u);
+    }
+
+  BOOST_AUTO_TEST_SUITE_END() // event_batch_
+
+BOOST_AUTO_TEST_SUITE_END() // libxxxml
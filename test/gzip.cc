@@ -0,0 +1,287 @@
+#include <boost/test/unit_test.hpp>
+
+#include <xxxml/gzip.hh>
+#include <xxxml/util.hh>
+
+#include "temp_file.hh"
+
+#include <sstream>
+#include <string>
+
+#include <string.h>
+#include <unistd.h>
+
+#include <zlib.h>
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(libxxxml)
+
+  BOOST_AUTO_TEST_SUITE(gzip_)
+
+    using namespace xxxml;
+    namespace gzip = xxxml::util::gzip;
+
+    using test::Temp_File;
+    using test::slurp;
+
+    // decompresses all members
+    static string gunzip(const char *filename, size_t *members = nullptr)
+    {
+      string in = slurp(filename);
+      string r;
+      z_stream z;
+      memset(&z, 0, sizeof z);
+      BOOST_REQUIRE_EQUAL(inflateInit2(&z, 15 + 16), Z_OK);
+      z.next_in = reinterpret_cast<Bytef*>(&in[0]);
+      z.avail_in = in.size();
+      size_t n = 0;
+      char buf[4096];
+      while (z.avail_in) {
+        z.next_out = reinterpret_cast<Bytef*>(buf);
+        z.avail_out = sizeof buf;
+        int x = inflate(&z, Z_NO_FLUSH);
+        BOOST_REQUIRE(x == Z_OK || x == Z_STREAM_END);
+        r.append(buf, sizeof buf - z.avail_out);
+        if (x == Z_STREAM_END) {
+          ++n;
+          inflateReset(&z);
+        }
+      }
+      inflateEnd(&z);
+      if (members)
+        *members = n;
+      return r;
+    }
+
+    static void write_records(text_writer::Ptr &w, unsigned n)
+    {
+      text_writer::start_document(w);
+      text_writer::start_element(w, "root");
+      for (unsigned i = 0; i < n; ++i) {
+        text_writer::start_element(w, "rec");
+        text_writer::write_attribute(w, "id", to_string(i).c_str());
+        text_writer::write_element(w, "v", "Hello & World");
+        text_writer::end_element(w);
+      }
+      text_writer::end_document(w);
+    }
+
+    BOOST_AUTO_TEST_CASE(writer)
+    {
+      string ref;
+      {
+        auto w = new_text_writer(ref);
+        write_records(w, 1000);
+        text_writer::flush(w);
+      }
+      for (size_t block_size : { 1, 7, 4096, 1024 * 1024 }) {
+        string first;
+        for (unsigned threads : { 1u, 2u, 4u }) {
+          Temp_File f;
+          gzip::Sink sink(f.fd, 6, threads, block_size);
+          auto w = sink.new_text_writer();
+          write_records(w, 1000);
+          sink.finish(w);
+          size_t members = 0;
+          BOOST_CHECK(gunzip(f.name, &members) == ref);
+          BOOST_CHECK_EQUAL(members, 1u);
+          // the last one is possibly empty
+          BOOST_CHECK_EQUAL(sink.blocks(), ref.size() / block_size + 1);
+          // independent of the number of threads
+          if (first.empty())
+            first = slurp(f.name);
+          else
+            BOOST_CHECK(slurp(f.name) == first);
+        }
+      }
+    }
+
+    BOOST_AUTO_TEST_CASE(save)
+    {
+      ostringstream o;
+      o << "<?xml version='1.0' encoding='ISO-8859-1'?><root>";
+      for (unsigned i = 0; i < 500; ++i)
+        o << "<rec id='" << i << "'><v>gr\xfc\xdf</v></rec>";
+      o << "</root>";
+      doc::Ptr d = read_memory(o.str());
+      for (bool format : { true, false }) {
+        Temp_File ref, f;
+        save_format_file_enc(ref.name, d, "UTF-8", format);
+        gzip::save_format_file_enc(f.name, d, "UTF-8", format, 9, 3);
+        BOOST_CHECK(gunzip(f.name) == slurp(ref.name));
+        save_format_file_enc(ref.name, d, nullptr, format);
+        gzip::save_format_file_enc(string(f.name), d, nullptr, format, 1);
+        BOOST_CHECK(gunzip(f.name) == slurp(ref.name));
+      }
+      // libxml2 reads them
+      if (xmlHasFeature(XML_WITH_ZLIB)) {
+        Temp_File f;
+        {
+          gzip::Sink sink(f.name, 6, 2, 1000);
+          sink.save(d);
+          sink.finish();
+          BOOST_CHECK(sink.blocks() > 10);
+        }
+        doc::Ptr e = read_file(f.name);
+        auto a = doc::dump_format_memory(d);
+        auto b = doc::dump_format_memory(e);
+        BOOST_CHECK(string(a.first.get(), a.second)
+            == string(b.first.get(), b.second));
+      }
+    }
+
+    BOOST_AUTO_TEST_CASE(dump)
+    {
+      doc::Ptr d = read_memory("<root xmlns:p='urn:p'><p:a x='1'><b>Hello</b>"
+          "<c/></p:a><d/></root>");
+      const xmlNode *a = first_element_child(doc::get_root_element(d));
+      auto ref = util::dump(d, a);
+      Temp_File f;
+      gzip::Sink sink(f.fd, 6, 2, 8);
+      sink.dump(d, a);
+      sink.finish();
+      BOOST_CHECK(gunzip(f.name) == string(ref.first.first, ref.first.second));
+    }
+
+    BOOST_AUTO_TEST_CASE(writer_filename)
+    {
+      Temp_File f;
+      string ref;
+      {
+        auto w = new_text_writer(ref);
+        write_records(w, 100);
+        text_writer::flush(w);
+      }
+      {
+        auto w = gzip::new_text_writer_filename(f.name, 6, 2);
+        write_records(w, 100);
+      }
+      BOOST_CHECK(gunzip(f.name) == ref);
+    }
+
+    BOOST_AUTO_TEST_CASE(empty)
+    {
+      for (unsigned threads : { 1u, 2u }) {
+        Temp_File f;
+        gzip::Sink sink(f.fd, 6, threads);
+        sink.finish();
+        size_t members = 0;
+        BOOST_CHECK(gunzip(f.name, &members).empty());
+        BOOST_CHECK_EQUAL(members, 1u);
+        const char s[] = "x";
+        BOOST_CHECK_THROW(sink.write(s, s + 1), xxxml::Logic_Error);
+      }
+    }
+
+    BOOST_AUTO_TEST_CASE(errors)
+    {
+      BOOST_CHECK_THROW(gzip::Sink(1, 42), xxxml::Runtime_Error);
+      BOOST_CHECK_THROW(gzip::Sink("no/such/dir/x.gz"), xxxml::Runtime_Error);
+      for (unsigned threads : { 1u, 2u }) {
+        gzip::Sink sink(-1, 6, threads, 16);
+        string s(100, 'x');
+        BOOST_CHECK_THROW({
+            sink.write(s.data(), s.data() + s.size());
+            sink.finish();
+          }, xxxml::Runtime_Error);
+      }
+    }
+
+    static string dump_str(const doc::Ptr &d)
+    {
+      auto m = doc::dump_format_memory(d);
+      return string(m.first.get(), m.second);
+    }
+
+    static string records(unsigned n)
+    {
+      ostringstream o;
+      o << "<root>";
+      for (unsigned i = 0; i < n; ++i)
+        o << "<rec id='" << i << "'><v>Hello World " << i << "</v></rec>";
+      o << "</root>";
+      return o.str();
+    }
+
+    // with two members
+    static void write_gzip(int fd, const string &s)
+    {
+      size_t k = s.size() / 3;
+      {
+        gzip::Sink sink(fd, 6, 2, 1000);
+        sink.write(s.data(), s.data() + k);
+      }
+      gzip::Sink sink(fd, 1, 1);
+      sink.write(s.data() + k, s.data() + s.size());
+    }
+
+    BOOST_AUTO_TEST_CASE(source)
+    {
+      string s = records(2000);
+      string ref = dump_str(read_memory(s));
+      Temp_File f;
+      write_gzip(f.fd, s);
+      BOOST_CHECK(dump_str(gzip::read_file(f.name)) == ref);
+      for (size_t chunk_size : { 1, 7, 4096, 1024 * 1024 })
+        for (unsigned chunks : { 1u, 2u, 4u }) {
+          gzip::Source source(f.name, chunk_size, chunks);
+          BOOST_CHECK(dump_str(read_io(source)) == ref);
+        }
+    }
+
+    BOOST_AUTO_TEST_CASE(source_reader)
+    {
+      Temp_File f;
+      write_gzip(f.fd, records(2000));
+      auto count = [](text_reader::Ptr &r) {
+        unsigned n = 0;
+        while (text_reader::read(r))
+          if (text_reader::node_type(r) == XML_READER_TYPE_ELEMENT
+              && !strcmp(text_reader::const_local_name(r), "rec"))
+            ++n;
+        return n;
+      };
+      auto r = gzip::reader_for_file(f.name);
+      BOOST_CHECK_EQUAL(count(r), 2000u);
+      gzip::Source source(string(f.name), 100, 2);
+      auto q = text_reader::for_io(source);
+      BOOST_CHECK_EQUAL(count(q), 2000u);
+    }
+
+    BOOST_AUTO_TEST_CASE(source_plain)
+    {
+      string s = records(100);
+      Temp_File f;
+      BOOST_REQUIRE_EQUAL(::write(f.fd, s.data(), s.size()),
+          ssize_t(s.size()));
+      BOOST_CHECK(dump_str(gzip::read_file(f.name))
+          == dump_str(read_memory(s)));
+    }
+
+    BOOST_AUTO_TEST_CASE(source_errors)
+    {
+      Temp_File f;
+      write_gzip(f.fd, records(2000));
+      string z = slurp(f.name);
+      Temp_File g;
+      BOOST_REQUIRE_EQUAL(::write(g.fd, z.data(), z.size() / 2),
+          ssize_t(z.size() / 2));
+      BOOST_CHECK_THROW(gzip::read_file(g.name), xxxml::Runtime_Error);
+      z[z.size() / 2] ^= 0xff;
+      z[z.size() / 2 + 1] ^= 0xff;
+      Temp_File h;
+      BOOST_REQUIRE_EQUAL(::write(h.fd, z.data(), z.size()),
+          ssize_t(z.size()));
+      BOOST_CHECK_THROW(gzip::read_file(h.name), xxxml::Runtime_Error);
+      BOOST_CHECK_THROW(gzip::Source("no/such/file.gz"),
+          xxxml::Runtime_Error);
+      // stops the helper thread that waits for a free chunk
+      gzip::Source source(f.name, 16, 2);
+      char buf[10];
+      BOOST_CHECK_EQUAL(source.read(buf, sizeof buf), 10);
+    }
+
+  BOOST_AUTO_TEST_SUITE_END() // gzip_
+
+BOOST_AUTO_TEST_SUITE_END() // libxxxml
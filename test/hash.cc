@@ -0,0 +1,88 @@
+#include <boost/test/unit_test.hpp>
+
+#include <xxxml/hash.hh>
+
+#include <sstream>
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(libxxxml)
+
+  BOOST_AUTO_TEST_SUITE(hash_)
+
+    using namespace xxxml;
+    namespace hash = xxxml::util::hash;
+
+    BOOST_AUTO_TEST_CASE(equal_subtrees)
+    {
+      doc::Ptr d = read_memory("<root><a x='1' y='2'><b>Hello</b></a>"
+          "<a y='2' x='1'><b>Hello</b></a><a x='1' y='2'><b>World</b></a>"
+          "</root>");
+      const xmlNode *a = first_element_child(doc::get_root_element(d));
+      const xmlNode *b = next_element_sibling(a);
+      const xmlNode *c = next_element_sibling(b);
+      // attribute order doesn't matter
+      BOOST_CHECK_EQUAL(hash::subtree(a), hash::subtree(b));
+      BOOST_CHECK_NE(hash::subtree(a), hash::subtree(c));
+      BOOST_CHECK_EQUAL(hash::subtree(a->children), hash::subtree(b->children));
+    }
+
+    BOOST_AUTO_TEST_CASE(across_documents)
+    {
+      doc::Ptr d = read_memory("<root xmlns:p='urn:x'><p:a>1</p:a>"
+          "<b k='v'>2<!-- c --></b></root>");
+      // different prefix, same namespace
+      doc::Ptr e = read_memory("<root xmlns:q='urn:x'><q:a>1</q:a>"
+          "<b k='v'>2<!-- c --></b></root>");
+      doc::Ptr f = read_memory("<root xmlns:p='urn:y'><p:a>1</p:a>"
+          "<b k='v'>2<!-- c --></b></root>");
+      doc::Ptr g = read_memory("<root xmlns:p='urn:x'><p:a>1</p:a>"
+          "<b k='v'>2<!-- d --></b></root>");
+      auto h = hash::subtree(doc::get_root_element(d));
+      BOOST_CHECK_EQUAL(h, hash::subtree(doc::get_root_element(e)));
+      BOOST_CHECK_NE(h, hash::subtree(doc::get_root_element(f)));
+      BOOST_CHECK_NE(h, hash::subtree(doc::get_root_element(g)));
+    }
+
+    BOOST_AUTO_TEST_CASE(no_shifting)
+    {
+      doc::Ptr d = read_memory("<r><a>xy</a><a/></r>");
+      doc::Ptr e = read_memory("<r><a>x</a><a>y</a></r>");
+      doc::Ptr f = read_memory("<r><a><a/></a></r>");
+      doc::Ptr g = read_memory("<r><a/><a/></r>");
+      auto h = hash::subtree(doc::get_root_element(d));
+      BOOST_CHECK_NE(h, hash::subtree(doc::get_root_element(e)));
+      BOOST_CHECK_NE(hash::subtree(doc::get_root_element(f)),
+          hash::subtree(doc::get_root_element(g)));
+    }
+
+    BOOST_AUTO_TEST_CASE(map)
+    {
+      doc::Ptr d = read_memory("<root><a><b>Hello</b></a><c/></root>");
+      auto m = hash::subtrees(d);
+      BOOST_CHECK_EQUAL(m.size(), 4u);
+      const xmlNode *root = doc::get_root_element(d);
+      BOOST_CHECK_EQUAL(m[root], hash::subtree(root));
+      const xmlNode *b = first_element_child(first_element_child(root));
+      BOOST_CHECK_EQUAL(m[b], hash::subtree(b));
+    }
+
+    BOOST_AUTO_TEST_CASE(parallel)
+    {
+      ostringstream o;
+      o << "<root>";
+      for (unsigned i = 0; i < 100; ++i)
+        o << "<rec id='" << i << "'><a>" << i % 7 << "</a>\n"
+          << "<b><c>x</c></b></rec>";
+      o << "</root>";
+      doc::Ptr d = read_memory(o.str());
+      auto m = hash::subtrees(d);
+      for (unsigned threads : { 2u, 3u, 16u, 200u }) {
+        auto n = hash::subtrees(d, threads);
+        BOOST_CHECK(m == n);
+      }
+    }
+
+  BOOST_AUTO_TEST_SUITE_END() // hash_
+
+BOOST_AUTO_TEST_SUITE_END() // libxxxml
@@ -0,0 +1,208 @@
+#include <boost/test/unit_test.hpp>
+
+#include <xxxml/io.hh>
+
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <stdexcept>
+
+#include <string.h>
+#include <unistd.h>
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(libxxxml)
+
+  BOOST_AUTO_TEST_SUITE(io_)
+
+    using namespace xxxml;
+
+    // hands out the input in small pieces, like a pipe
+    class Chunk_Source {
+      public:
+        Chunk_Source(const char *s, size_t chunk) : s_(s), chunk_(chunk) {}
+        ssize_t read(char *buf, size_t n)
+        {
+          ++calls;
+          size_t k = std::min(std::min(n, chunk_), strlen(s_));
+          memcpy(buf, s_, k);
+          s_ += k;
+          return k;
+        }
+        unsigned calls {0};
+      private:
+        const char *s_;
+        size_t chunk_;
+    };
+
+    static string text(const doc::Ptr &d, const char *expr)
+    {
+      auto c = xpath::new_context(d);
+      auto o = xpath::eval(expr, c);
+      return xpath::cast_node_set_to_string(o).get();
+    }
+
+    BOOST_AUTO_TEST_CASE(class_source)
+    {
+      Chunk_Source s("<root><a>Hello</a><b>World</b></root>", 3);
+      doc::Ptr d = read_io(s);
+      BOOST_CHECK_EQUAL(text(d, "/root/b"), "World");
+      BOOST_CHECK(s.calls > 10);
+    }
+
+    BOOST_AUTO_TEST_CASE(callable_source)
+    {
+      const char *input = "<root><a>Hello</a></root>";
+      auto f = [&input](char *buf, size_t n) -> ssize_t {
+        size_t k = std::min(n, strlen(input));
+        memcpy(buf, input, k);
+        input += k;
+        return k;
+      };
+      doc::Ptr d = read_io(f);
+      BOOST_CHECK_EQUAL(text(d, "/root/a"), "Hello");
+
+      input = "<root><a>World</a></root>";
+      auto pc = new_parser_ctxt();
+      d = ctxt_read_io(pc, f);
+      BOOST_CHECK_EQUAL(text(d, "/root/a"), "World");
+    }
+
+    BOOST_AUTO_TEST_CASE(errors)
+    {
+      auto fail = [](char *, size_t) -> ssize_t { return -1; };
+      BOOST_CHECK_THROW(read_io(fail), Parse_Error);
+      // exceptions are rethrown
+      auto thrower = [](char *, size_t) -> ssize_t {
+        throw std::range_error("decompression failed"); };
+      BOOST_CHECK_THROW(read_io(thrower), std::range_error);
+
+      auto reader = text_reader::for_io(thrower);
+      BOOST_CHECK_THROW(text_reader::read(reader), Runtime_Error);
+    }
+
+    BOOST_AUTO_TEST_CASE(reader)
+    {
+      Chunk_Source s("<root><a>Hello</a><b>World</b></root>", 5);
+      auto reader = text_reader::for_io(s);
+      unsigned i = 0;
+      while (text_reader::read(reader))
+        ++i;
+      BOOST_CHECK_EQUAL(i, 8u);
+
+      Chunk_Source t("<x><y/></x>", 2);
+      text_reader::reset_io(reader, t);
+      i = 0;
+      while (text_reader::read(reader))
+        ++i;
+      BOOST_CHECK_EQUAL(i, 3u);
+    }
+
+    BOOST_AUTO_TEST_CASE(schema_)
+    {
+      const char xsd[] =
+        "<xs:schema xmlns:xs='http://www.w3.org/2001/XMLSchema'>"
+        "<xs:element name='root' type='xs:int'/></xs:schema>";
+      auto pc = schema::new_mem_parser_ctxt(xsd);
+      auto schema = schema::parse(pc);
+      auto v = schema::new_valid_ctxt(schema);
+      Chunk_Source s("<root>23</root>", 2);
+      BOOST_CHECK_NO_THROW(schema::validate_io(v, s));
+      Chunk_Source t("<root>x</root>", 2);
+      BOOST_CHECK_THROW(schema::validate_io(v, t), Validate_Error);
+      auto thrower = [](char *, size_t) -> ssize_t {
+        throw std::range_error("connection reset"); };
+      BOOST_CHECK_THROW(schema::validate_io(v, thrower), std::range_error);
+    }
+
+    BOOST_AUTO_TEST_CASE(pipe_)
+    {
+      int fds[2];
+      BOOST_REQUIRE_EQUAL(pipe(fds), 0);
+      thread t([&fds]{
+          string s("<root>");
+          for (unsigned i = 0; i < 10000; ++i)
+            s += "<rec>" + to_string(i) + "</rec>";
+          s += "</root>";
+          const char *p = s.data();
+          size_t n = s.size();
+          while (n) {
+            ssize_t r = write(fds[1], p, n);
+            if (r <= 0)
+              break;
+            p += r;
+            n -= r;
+          }
+          close(fds[1]);
+          });
+      util::Fd_Source s(fds[0]);
+      auto reader = text_reader::for_io(s);
+      unsigned recs = 0;
+      while (text_reader::read(reader))
+        if (text_reader::node_type(reader) == XML_READER_TYPE_ELEMENT
+            && !strcmp(text_reader::const_name(reader), "rec"))
+          ++recs;
+      t.join();
+      close(fds[0]);
+      BOOST_CHECK_EQUAL(recs, 10000u);
+    }
+
+    static void write_doc(text_writer::Ptr &w, unsigned n)
+    {
+      text_writer::start_document(w);
+      text_writer::start_element(w, "root");
+      for (unsigned i = 0; i < n; ++i)
+        text_writer::write_element(w, "rec", to_string(i).c_str());
+      text_writer::end_element(w);
+      text_writer::end_document(w);
+    }
+
+    BOOST_AUTO_TEST_CASE(fd_sink)
+    {
+      string ref;
+      {
+        auto w = new_text_writer(ref);
+        write_doc(w, 10000);
+        text_writer::flush(w);
+      }
+      for (size_t buffer_size : { 16u, 4096u, 64u * 1024u, 1024u * 1024u }) {
+        int fds[2];
+        BOOST_REQUIRE_EQUAL(pipe(fds), 0);
+        string s;
+        thread t([&fds, &s]{
+            char buf[4096];
+            ssize_t r;
+            while ((r = read(fds[0], buf, sizeof buf)) > 0)
+              s.append(buf, r);
+            });
+        size_t writes = 0;
+        {
+          util::Fd_Sink sink(fds[1], buffer_size);
+          auto w = sink.new_text_writer();
+          write_doc(w, 10000);
+          sink.flush(w);
+          writes = sink.writes();
+        }
+        close(fds[1]);
+        t.join();
+        close(fds[0]);
+        BOOST_CHECK(s == ref);
+        if (buffer_size > ref.size())
+          BOOST_CHECK_EQUAL(writes, 1u);
+      }
+    }
+
+    BOOST_AUTO_TEST_CASE(fd_sink_error)
+    {
+      util::Fd_Sink sink(-1, 16);
+      const char s[] = "<root><a>Hello</a></root>";
+      sink.write(s, s + 3);
+      BOOST_CHECK_THROW(sink.write(s, s + sizeof s - 1), xxxml::Runtime_Error);
+      sink.write(s, s + 3);
+      BOOST_CHECK_THROW(sink.flush(), xxxml::Runtime_Error);
+    }
+
+  BOOST_AUTO_TEST_SUITE_END() // io_
+
+BOOST_AUTO_TEST_SUITE_END() // libxxxml
@@ -0,0 +1,114 @@
+#include <boost/test/unit_test.hpp>
+
+#include <xxxml/parallel_save.hh>
+
+#include <libxml/globals.h>
+
+#include "temp_file.hh"
+
+#include <sstream>
+#include <string>
+
+#include <unistd.h>
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(libxxxml)
+
+  BOOST_AUTO_TEST_SUITE(parallel_save_)
+
+    using namespace xxxml;
+    namespace parallel = xxxml::util::parallel;
+
+    using test::Temp_File;
+    using test::slurp;
+
+    static string reference(const doc::Ptr &d, const char *encoding,
+        bool format)
+    {
+      Temp_File f("parallel_save");
+      save_format_file_enc(f.name, d, encoding, format);
+      return slurp(f.name);
+    }
+
+    static void check(const doc::Ptr &d)
+    {
+      Temp_File f("parallel_save");
+      for (const char *encoding : { (const char*)nullptr, "UTF-8",
+          "ISO-8859-1", "UTF-16" })
+        for (bool format : { true, false }) {
+          string ref = reference(d, encoding, format);
+          for (unsigned threads : { 1u, 2u, 3u, 8u }) {
+            parallel::save_format_file_enc(f.name, d, encoding, format,
+                threads);
+            BOOST_CHECK(slurp(f.name) == ref);
+            BOOST_REQUIRE_EQUAL(ftruncate(f.fd, 0), 0);
+            BOOST_REQUIRE_EQUAL(lseek(f.fd, 0, SEEK_SET), 0);
+            parallel::save_format_fd(f.fd, d, encoding, format, threads);
+            BOOST_CHECK(slurp(f.name) == ref);
+            if (!encoding) {
+              auto m = doc::dump_format_memory(d, format);
+              BOOST_CHECK(parallel::dump_format_memory(d, format, threads)
+                  == string(m.first.get(), m.second));
+            }
+          }
+        }
+    }
+
+    static string records(unsigned n, const char *text)
+    {
+      ostringstream o;
+      o << "<root xmlns='urn:d' xmlns:p='urn:p' a='1'>";
+      for (unsigned i = 0; i < n; ++i)
+        o << "<p:rec id='" << i << "' xml:lang='en'><name>" << text
+          << "</name><v a=\"x&amp;&#10;\"><w/><!-- c --></v></p:rec>";
+      o << "</root>";
+      return o.str();
+    }
+
+    BOOST_AUTO_TEST_CASE(elements)
+    {
+      check(read_memory(records(100, "Hello &lt; World")));
+    }
+
+    BOOST_AUTO_TEST_CASE(blanks)
+    {
+      // whitespace text nodes disable the formatting
+      check(read_memory("<root>\n  <a>1</a>\n  <b><c/></b>\n</root>"));
+      check(read_memory("<root><a>1</a>text<b><c/></b><![CDATA[x]]></root>"));
+    }
+
+    BOOST_AUTO_TEST_CASE(non_ascii)
+    {
+      // without encoding, libxml2 escapes non-ASCII text content
+      check(read_memory(records(50, "gr\xc3\xbc\xc3\x9f &#13; &#xe9;")));
+      check(read_memory("<?xml version='1.0' encoding='ISO-8859-1'?>"
+            "<root a='\xe9'><a>\xe9</a><b>x</b></root>"));
+    }
+
+    BOOST_AUTO_TEST_CASE(prolog)
+    {
+      check(read_memory("<?xml version='1.0' standalone='yes'?>\n"
+            "<!-- head --><?pi x?>"
+            "<root><a/><!-- c --><?p y?><b/></root><!-- tail -->"));
+      check(read_memory("<!DOCTYPE root [ <!ENTITY e 'ent'> ]>"
+            "<root><a>&e;</a><b/></root>"));
+    }
+
+    BOOST_AUTO_TEST_CASE(small)
+    {
+      check(read_memory("<root/>"));
+      check(read_memory("<root><a/></root>"));
+    }
+
+    BOOST_AUTO_TEST_CASE(indent_string)
+    {
+      const char *old = xmlTreeIndentString;
+      xmlTreeIndentString = "\t";
+      check(read_memory("<root><a><b><c/></b></a><d/></root>"));
+      xmlTreeIndentString = old;
+    }
+
+  BOOST_AUTO_TEST_SUITE_END() // parallel_save_
+
+BOOST_AUTO_TEST_SUITE_END() // libxxxml
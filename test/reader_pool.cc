@@ -0,0 +1,129 @@
+#include <boost/test/unit_test.hpp>
+
+#include <xxxml/reader_pool.hh>
+
+#include <algorithm>
+#include <string>
+#include <thread>
+
+#include <string.h>
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(libxxxml)
+
+  BOOST_AUTO_TEST_SUITE(reader_pool_)
+
+    using namespace xxxml;
+
+    static unsigned count(text_reader::Ptr &reader)
+    {
+      unsigned i = 0;
+      while (text_reader::read(reader))
+        ++i;
+      return i;
+    }
+
+    BOOST_AUTO_TEST_CASE(reset)
+    {
+      auto reader = text_reader::for_memory("<root><a>1</a></root>");
+      BOOST_CHECK_EQUAL(count(reader), 5u);
+      string s("<root><a>1</a><b/></root>");
+      text_reader::reset_memory(reader, s);
+      BOOST_CHECK_EQUAL(count(reader), 6u);
+      text_reader::reset_memory(reader, "<x/>");
+      BOOST_CHECK_EQUAL(count(reader), 1u);
+    }
+
+    BOOST_AUTO_TEST_CASE(reuse)
+    {
+      util::Reader_Pool pool(2);
+      xmlTextReader *p = nullptr;
+      {
+        auto lease = pool.for_memory("<root><a/></root>");
+        p = lease.reader().get();
+        BOOST_CHECK_EQUAL(count(lease.reader()), 3u);
+      }
+      BOOST_CHECK_EQUAL(pool.idle(), 1u);
+      for (unsigned i = 0; i < 3; ++i) {
+        string s("<root><a>" + to_string(i) + "</a></root>");
+        auto lease = pool.for_memory(s);
+        BOOST_CHECK_EQUAL(lease.reader().get(), p);
+        BOOST_CHECK_EQUAL(pool.idle(), 0u);
+        BOOST_CHECK_EQUAL(count(lease.reader()), 5u);
+      }
+      {
+        // more leases than capacity
+        auto a = pool.for_memory("<a/>");
+        auto b = pool.for_memory("<b/>");
+        auto c = pool.for_memory("<c/>");
+        BOOST_CHECK(a.reader().get() != b.reader().get());
+        auto d = std::move(c);
+        BOOST_CHECK(!c.reader());
+        BOOST_CHECK_EQUAL(count(d.reader()), 1u);
+      }
+      BOOST_CHECK_EQUAL(pool.idle(), 2u);
+    }
+
+    BOOST_AUTO_TEST_CASE(settings)
+    {
+      const char schema_s[] =
+        "<element name='root' xmlns='http://relaxng.org/ns/structure/1.0'>"
+        "<element name='a'><text/></element></element>";
+      auto pc = relaxng::new_mem_parser_ctxt(schema_s);
+      auto schema = relaxng::parse(pc);
+
+      util::Reader_Pool pool;
+      pool.set_relaxng_schema(&schema);
+      pool.set_parser_prop(XML_PARSER_SUBST_ENTITIES, 1);
+      for (unsigned i = 0; i < 3; ++i) {
+        {
+          auto lease = pool.for_memory("<root><a>x</a></root>");
+          BOOST_CHECK_EQUAL(xmlTextReaderGetParserProp(lease.reader().get(),
+                XML_PARSER_SUBST_ENTITIES), 1);
+          count(lease.reader());
+          BOOST_CHECK(text_reader::is_valid(lease.reader()));
+        }
+        {
+          auto lease = pool.for_memory("<root><b/></root>");
+          count(lease.reader());
+          BOOST_CHECK(!text_reader::is_valid(lease.reader()));
+        }
+      }
+      BOOST_CHECK_EQUAL(pool.idle(), 1u);
+    }
+
+    BOOST_AUTO_TEST_CASE(io)
+    {
+      util::Reader_Pool pool;
+      for (unsigned i = 0; i < 3; ++i) {
+        const char *input = "<root><a>1</a></root>";
+        auto f = [&input](char *buf, size_t n) -> ssize_t {
+          size_t k = std::min(n, strlen(input));
+          memcpy(buf, input, k);
+          input += k;
+          return k;
+        };
+        auto lease = pool.for_io(f);
+        BOOST_CHECK_EQUAL(count(lease.reader()), 5u);
+      }
+      BOOST_CHECK_EQUAL(pool.idle(), 1u);
+    }
+
+    BOOST_AUTO_TEST_CASE(local)
+    {
+      util::Reader_Pool *a = &util::Reader_Pool::local();
+      util::Reader_Pool *b = nullptr;
+      thread t([&b]{
+          b = &util::Reader_Pool::local();
+          auto lease = b->for_memory("<root/>");
+          count(lease.reader());
+          });
+      t.join();
+      BOOST_CHECK(a != b);
+      BOOST_CHECK_EQUAL(a, &util::Reader_Pool::local());
+    }
+
+  BOOST_AUTO_TEST_SUITE_END() // reader_pool_
+
+BOOST_AUTO_TEST_SUITE_END() // libxxxml
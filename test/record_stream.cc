@@ -0,0 +1,120 @@
+#include <boost/test/unit_test.hpp>
+
+#include <xxxml/record_stream.hh>
+
+#include <sstream>
+#include <vector>
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(libxxxml)
+
+  BOOST_AUTO_TEST_SUITE(record_stream_)
+
+    using namespace xxxml;
+
+    static string text(const char *expr, const xmlNode *node,
+        xpath::Context_Ptr &c)
+    {
+      auto o = xpath::node_eval(expr, node, c);
+      return xpath::cast_node_set_to_string(o).get();
+    }
+
+    BOOST_AUTO_TEST_CASE(name)
+    {
+      auto reader = text_reader::for_memory(
+          "<root><head>x</head>"
+          "<rec id='1'><v>Hello</v></rec>\n"
+          "<rec id='2'><v>World</v></rec>\n"
+          "<other><rec id='3'><v>nested</v><rec id='4'/></rec></other>"
+          "</root>");
+      util::Record_Stream s(reader, "rec");
+      vector<string> vs;
+      while (xmlNode *rec = s.next()) {
+        BOOST_CHECK(rec->children);
+        vs.push_back(text("./v", rec, s.context()));
+      }
+      const vector<string> ref = { "Hello", "World", "nested" };
+      BOOST_CHECK_EQUAL_COLLECTIONS(vs.begin(), vs.end(), ref.begin(), ref.end());
+      BOOST_CHECK_EQUAL(s.count(), 3u);
+      BOOST_CHECK(!s.next());
+    }
+
+    BOOST_AUTO_TEST_CASE(adjacent)
+    {
+      // no whitespace between the records, i.e. the reader is
+      // positioned on the next record after skipping the current one
+      auto reader = text_reader::for_memory(
+          "<root><rec>1</rec><rec>2</rec><rec/></root>");
+      util::Record_Stream s(reader, "rec");
+      string t;
+      while (xmlNode *rec = s.next())
+        t += text(".", rec, s.context()) + ";";
+      BOOST_CHECK_EQUAL(t, "1;2;;");
+    }
+
+    BOOST_AUTO_TEST_CASE(namespace_)
+    {
+      auto reader = text_reader::for_memory(
+          "<root xmlns:p='urn:p'><rec>1</rec><p:rec>2</p:rec></root>");
+      util::Record_Stream s(reader, "rec", "urn:p");
+      xmlNode *rec = s.next();
+      BOOST_REQUIRE(rec);
+      BOOST_CHECK_EQUAL(reinterpret_cast<const char*>(rec->children->content),
+          "2");
+      BOOST_CHECK(!s.next());
+
+      auto r2 = text_reader::for_memory(
+          "<root xmlns:p='urn:p'><p:rec>1</p:rec><rec>2</rec></root>");
+      // empty URI: no namespace
+      util::Record_Stream t(r2, "rec", "");
+      rec = t.next();
+      BOOST_REQUIRE(rec);
+      BOOST_CHECK_EQUAL(reinterpret_cast<const char*>(rec->children->content),
+          "2");
+      BOOST_CHECK(!t.next());
+    }
+
+    BOOST_AUTO_TEST_CASE(pattern_)
+    {
+      auto reader = text_reader::for_memory(
+          "<root><rec>1</rec><a><rec>2</rec></a><b><rec>3</rec></b></root>");
+      util::Record_Stream s(reader, pattern::compile("/root/b/rec | /root/rec"));
+      string t;
+      while (xmlNode *rec = s.next())
+        t += text(".", rec, s.context());
+      BOOST_CHECK_EQUAL(t, "13");
+    }
+
+    BOOST_AUTO_TEST_CASE(context_before_first)
+    {
+      auto reader = text_reader::for_memory("<root/>");
+      util::Record_Stream s(reader, "rec");
+      BOOST_CHECK_THROW(s.context(), Runtime_Error);
+      BOOST_CHECK(!s.next());
+    }
+
+    BOOST_AUTO_TEST_CASE(many)
+    {
+      ostringstream o;
+      o << "<root>\n";
+      for (unsigned i = 0; i < 10000; ++i)
+        o << "  <rec id='" << i << "'><v>" << i << "</v></rec>\n";
+      o << "</root>\n";
+      string xml(o.str());
+      auto reader = text_reader::for_memory(xml);
+      util::Record_Stream s(reader, "rec");
+      unsigned long sum = 0;
+      while (xmlNode *rec = s.next()) {
+        auto o = xpath::node_eval("number(@id)", rec, s.context());
+        sum += o->floatval;
+        // already processed records are freed by the reader
+        BOOST_CHECK(!rec->prev || !rec->prev->prev);
+      }
+      BOOST_CHECK_EQUAL(s.count(), 10000u);
+      BOOST_CHECK_EQUAL(sum, 10000ul * 9999 / 2);
+    }
+
+  BOOST_AUTO_TEST_SUITE_END() // record_stream_
+
+BOOST_AUTO_TEST_SUITE_END() // libxxxml
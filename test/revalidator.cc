@@ -0,0 +1,222 @@
+#include <boost/test/unit_test.hpp>
+
+#include <xxxml/revalidator.hh>
+
+#include <memory>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(libxxxml)
+
+  BOOST_AUTO_TEST_SUITE(revalidator_)
+
+    using namespace xxxml;
+
+    static const char rng_s[] =
+      "<element name='root' xmlns='http://relaxng.org/ns/structure/1.0'"
+      "    datatypeLibrary='http://www.w3.org/2001/XMLSchema-datatypes'>"
+      "<zeroOrMore><element name='rec'>"
+      "  <attribute name='id'><data type='int'/></attribute>"
+      "  <element name='v'><data type='int'/></element>"
+      "  <optional><element name='note'><text/></element></optional>"
+      "</element></zeroOrMore>"
+      "</element>";
+
+    static string records(unsigned n)
+    {
+      ostringstream o;
+      o << "<root>\n";
+      for (unsigned i = 0; i < n; ++i)
+        o << "  <rec id='" << i << "'><v>" << i << "</v></rec>\n";
+      o << "</root>\n";
+      return o.str();
+    }
+
+    static bool validate_completely(relaxng::Ptr &schema, doc::Ptr &doc)
+    {
+      relaxng::Valid_Ctxt_Ptr c = relaxng::new_valid_ctxt(schema);
+      util::Error_Collector errors;
+      errors.attach(c);
+      return !xmlRelaxNGValidateDoc(c.get(), doc.get());
+    }
+
+    static xmlNode *v_of(doc::Ptr &doc, unsigned i)
+    {
+      util::Node_Set s(doc, "/root/rec[" + to_string(i) + "]/v");
+      BOOST_REQUIRE(s.begin() != s.end());
+      return *s.begin();
+    }
+
+    BOOST_AUTO_TEST_CASE(change_log)
+    {
+      doc::Ptr d = read_memory("<r><a><b/></a><c/></r>");
+      xmlNode *a = first_element_child(doc::get_root_element(d));
+      xmlNode *b = first_element_child(a);
+      util::Change_Log log(d);
+      util::set_content(b, "x");
+      util::set_attribute(d, "/r/c", "k", "v");
+      BOOST_CHECK_EQUAL(log.nodes().size(), 2u);
+      // covers b
+      util::set_attribute(d, "/r/a", "k", "v");
+      BOOST_REQUIRE_EQUAL(log.nodes().size(), 2u);
+      BOOST_CHECK_EQUAL(log.nodes()[1], a);
+      util::remove(d, "/r/a");
+      BOOST_REQUIRE_EQUAL(log.nodes().size(), 1u);
+      BOOST_CHECK_EQUAL(log.nodes()[0], doc::get_root_element(d));
+      BOOST_CHECK(!log.document_changed());
+      {
+        // all logs of the document record
+        util::Change_Log other(d);
+        util::set_content(doc::get_root_element(d), "y");
+        BOOST_CHECK_EQUAL(other.nodes().size(), 1u);
+      }
+      BOOST_CHECK_EQUAL(log.nodes().size(), 1u);
+      util::insert(d, nullptr, "<s/>", "<s/>" + 4, 1);
+      BOOST_CHECK(log.document_changed());
+      BOOST_CHECK(log.nodes().empty());
+      log.clear();
+      BOOST_CHECK(!log.document_changed());
+    }
+
+    BOOST_AUTO_TEST_CASE(documents)
+    {
+      doc::Ptr d = read_memory("<r><a/><b/></r>");
+      doc::Ptr e = read_memory("<r><a/><b/></r>");
+      xmlNode *a = first_element_child(doc::get_root_element(d));
+      unique_ptr<util::Change_Log> x(new util::Change_Log(d));
+      unique_ptr<util::Change_Log> y(new util::Change_Log(e));
+      util::set_content(a, "x");
+      util::set_attribute(e, "/r/b", "k", "v");
+      BOOST_REQUIRE_EQUAL(x->nodes().size(), 1u);
+      BOOST_CHECK_EQUAL(x->nodes()[0], a);
+      BOOST_REQUIRE_EQUAL(y->nodes().size(), 1u);
+      BOOST_CHECK_EQUAL(y->nodes()[0]->doc, e.get());
+      // touch() ignores nodes of other documents
+      y->touch(a);
+      BOOST_CHECK_EQUAL(y->nodes().size(), 1u);
+      // destroyed in construction order
+      x.reset();
+      util::remove(d, "/r/a");
+      util::set_content(last_element_child(doc::get_root_element(e)), "y");
+      BOOST_CHECK_EQUAL(y->nodes().size(), 1u);
+      y.reset();
+      util::remove(e, "/r/a");
+
+      relaxng::Parser_Ctxt_Ptr pc = relaxng::new_mem_parser_ctxt(rng_s);
+      relaxng::Ptr schema = relaxng::parse(pc);
+      doc::Ptr f = read_memory(records(10));
+      doc::Ptr g = read_memory(records(10));
+      util::Revalidator r(schema, f);
+      util::Revalidator s(schema, g);
+      BOOST_CHECK(r.validate());
+      BOOST_CHECK(s.validate());
+      util::set_content(v_of(f, 3), "x");
+      BOOST_CHECK(s.validate());
+      BOOST_CHECK_EQUAL(s.full_validations(), 1u);
+      BOOST_CHECK_EQUAL(s.subtree_validations(), 0u);
+      BOOST_CHECK(!r.validate());
+      BOOST_CHECK_EQUAL(r.full_validations(), 1u);
+      BOOST_CHECK_EQUAL(r.subtree_validations(), 1u);
+    }
+
+    BOOST_AUTO_TEST_CASE(subtrees)
+    {
+      relaxng::Parser_Ctxt_Ptr pc = relaxng::new_mem_parser_ctxt(rng_s);
+      relaxng::Ptr schema = relaxng::parse(pc);
+      doc::Ptr d = read_memory(records(200));
+      util::Revalidator r(schema, d);
+      BOOST_CHECK(r.validate());
+      BOOST_CHECK_EQUAL(r.full_validations(), 1u);
+
+      util::set_content(v_of(d, 150), "42");
+      BOOST_CHECK(r.validate());
+      BOOST_CHECK_EQUAL(r.full_validations(), 1u);
+      BOOST_CHECK_EQUAL(r.subtree_validations(), 1u);
+      // nothing changed
+      BOOST_CHECK(r.validate());
+      BOOST_CHECK_EQUAL(r.subtree_validations(), 1u);
+
+      xmlNode *v = v_of(d, 20);
+      util::set_content(v, "x");
+      util::Error_Collector errors;
+      BOOST_CHECK(!r.validate(errors));
+      BOOST_REQUIRE(errors.size());
+      BOOST_CHECK_EQUAL(errors[0].node, v);
+      BOOST_CHECK_EQUAL(r.full_validations(), 1u);
+      // the document wasn't valid before
+      util::set_content(v, "20");
+      BOOST_CHECK(r.validate());
+      BOOST_CHECK_EQUAL(r.full_validations(), 2u);
+
+      util::set_attribute(d, "/root/rec[3]", "id", "abc");
+      BOOST_CHECK(!r.validate());
+      util::set_attribute(d, "/root/rec[3]", "id", "3");
+      BOOST_CHECK(r.validate());
+
+      util::add(d, "/root/rec[7]", "note", "hello");
+      BOOST_CHECK(r.validate());
+      util::add(d, "/root/rec[7]", "+note", "again");
+      BOOST_CHECK(!r.validate());
+      util::remove(d, "/root/rec[7]/note[2]");
+      BOOST_CHECK(r.validate());
+      util::remove(d, "/root/rec[8]/v");
+      BOOST_CHECK(!r.validate());
+      util::remove(d, "/root/rec[8]");
+      BOOST_CHECK(r.validate());
+
+      string rec("<rec id='1000'><v>1</v></rec>");
+      util::insert(d, "/root/rec[100]", rec.data(), rec.data() + rec.size(),
+          2);
+      BOOST_CHECK(r.validate());
+      string bad("<rec><v>1</v></rec>");
+      util::insert(d, "/root/rec[100]", bad.data(), bad.data() + bad.size(),
+          -2);
+      BOOST_CHECK(!r.validate());
+      BOOST_CHECK_EQUAL(r.validate(), validate_completely(schema, d));
+    }
+
+    BOOST_AUTO_TEST_CASE(same_as_complete)
+    {
+      relaxng::Parser_Ctxt_Ptr pc = relaxng::new_mem_parser_ctxt(rng_s);
+      relaxng::Ptr schema = relaxng::parse(pc);
+      doc::Ptr d = read_memory(records(50));
+      util::Revalidator r(schema, d);
+      BOOST_CHECK(r.validate());
+      const char *values[] = { "1", "x", "-3", "", "4" };
+      for (unsigned i = 0; i < 40; ++i) {
+        util::set_content(v_of(d, 1 + (i * 7) % 50), values[i % 5]);
+        if (i % 3 == 0)
+          util::set_attribute(d, "/root/rec[" + to_string(1 + i % 50) + "]",
+              "id", values[(i + 1) % 5]);
+        BOOST_CHECK_EQUAL(r.validate(), validate_completely(schema, d));
+      }
+    }
+
+    BOOST_AUTO_TEST_CASE(fallback)
+    {
+      relaxng::Parser_Ctxt_Ptr pc = relaxng::new_mem_parser_ctxt(rng_s);
+      relaxng::Ptr schema = relaxng::parse(pc);
+      doc::Ptr d = read_memory(records(10));
+      util::Revalidator r(schema, d, 2);
+      BOOST_CHECK(r.validate());
+      for (unsigned i = 1; i <= 3; ++i)
+        util::set_content(v_of(d, i), "1");
+      BOOST_CHECK(r.validate());
+      BOOST_CHECK_EQUAL(r.full_validations(), 2u);
+
+      // IDs are document-wide
+      doc::Ptr e = read_memory("<root><rec xml:id='a' id='1'><v>1</v></rec>"
+          "</root>");
+      util::Revalidator s(schema, e);
+      s.validate();
+      util::set_content(v_of(e, 1), "2");
+      s.validate();
+      BOOST_CHECK_EQUAL(s.full_validations(), 2u);
+      BOOST_CHECK_EQUAL(s.subtree_validations(), 0u);
+    }
+
+  BOOST_AUTO_TEST_SUITE_END() // revalidator_
+
+BOOST_AUTO_TEST_SUITE_END() // libxxxml
@@ -0,0 +1,289 @@
+#include <boost/test/unit_test.hpp>
+
+#include <xxxml/schema_cache.hh>
+#include <xxxml/entity_cache.hh>
+
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(libxxxml)
+
+  BOOST_AUTO_TEST_SUITE(schema_cache_)
+
+    using namespace xxxml;
+
+    struct Temp_Dir {
+      string name;
+      vector<string> files;
+      Temp_Dir()
+      {
+        char buf[] = "schema_cache_XXXXXX";
+        BOOST_REQUIRE(mkdtemp(buf));
+        name = buf;
+      }
+      ~Temp_Dir()
+      {
+        for (auto &f : files)
+          unlink(f.c_str());
+        rmdir(name.c_str());
+      }
+      // mtime_offset: distinct modification times, independent of the
+      // file system's timestamp granularity
+      string write(const string &filename, const string &content,
+          long mtime_offset = 0)
+      {
+        string path = name + '/' + filename;
+        {
+          ofstream f(path);
+          f << content;
+        }
+        if (mtime_offset) {
+          struct timeval tv[2];
+          gettimeofday(&tv[0], nullptr);
+          tv[0].tv_sec += mtime_offset;
+          tv[1] = tv[0];
+          utimes(path.c_str(), tv);
+        }
+        files.push_back(path);
+        return path;
+      }
+    };
+
+    static const char xsd_root[] =
+      "<xs:schema xmlns:xs='http://www.w3.org/2001/XMLSchema'>"
+      "<xs:include schemaLocation='types.xsd'/>"
+      "<xs:element name='root' type='value'/></xs:schema>";
+    static string xsd_types(const char *type)
+    {
+      return string("<xs:schema xmlns:xs='http://www.w3.org/2001/XMLSchema'>"
+          "<xs:simpleType name='value'><xs:restriction base='xs:")
+        + type + "'/></xs:simpleType></xs:schema>";
+    }
+
+    BOOST_AUTO_TEST_CASE(xsd)
+    {
+      Temp_Dir dir;
+      string root = dir.write("root.xsd", xsd_root);
+      dir.write("types.xsd", xsd_types("int"));
+      util::Schema_Cache cache;
+      cache.set_check_interval(chrono::milliseconds(0));
+
+      auto v = cache.xsd(root);
+      doc::Ptr d = read_memory("<root>abc</root>");
+      BOOST_CHECK(!v->validate(d));
+      // also via a different, but equivalent path
+      BOOST_CHECK_EQUAL(cache.xsd(dir.name + "/./root.xsd"), v);
+      BOOST_CHECK_EQUAL(cache.compilations(), 1u);
+
+      // touched, but same content
+      dir.write("types.xsd", xsd_types("int"), 10);
+      BOOST_CHECK_EQUAL(cache.xsd(root), v);
+      BOOST_CHECK_EQUAL(cache.compilations(), 1u);
+
+      // an included file changes
+      dir.write("types.xsd", xsd_types("string"), 20);
+      auto w = cache.xsd(root);
+      BOOST_CHECK(w != v);
+      BOOST_CHECK(w->validate(d));
+      // the old version is still usable
+      BOOST_CHECK(!v->validate(d));
+      BOOST_CHECK_EQUAL(cache.compilations(), 2u);
+      BOOST_CHECK_EQUAL(cache.xsd(root), w);
+
+      // a broken update keeps the old version
+      dir.write("types.xsd", "<xs:schema", 30);
+      BOOST_CHECK_EQUAL(cache.xsd(root), w);
+      BOOST_CHECK_EQUAL(cache.compilations(), 3u);
+      // isn't retried
+      BOOST_CHECK_EQUAL(cache.xsd(root), w);
+      BOOST_CHECK_EQUAL(cache.compilations(), 3u);
+      dir.write("types.xsd", xsd_types("string"), 40);
+      auto x = cache.xsd(root);
+      BOOST_CHECK(x != w);
+      BOOST_CHECK(x->validate(d));
+      BOOST_CHECK_EQUAL(cache.compilations(), 4u);
+      BOOST_CHECK_EQUAL(cache.size(), 1u);
+    }
+
+    BOOST_AUTO_TEST_CASE(failure)
+    {
+      Temp_Dir dir;
+      string root = dir.write("root.xsd", xsd_root);
+      dir.write("types.xsd", "<xs:schema");
+      util::Schema_Cache cache;
+      cache.set_check_interval(chrono::milliseconds(0));
+      BOOST_CHECK_THROW(cache.xsd(root), Runtime_Error);
+      BOOST_CHECK_THROW(cache.xsd(root), Runtime_Error);
+      BOOST_CHECK_EQUAL(cache.compilations(), 1u);
+      dir.write("types.xsd", xsd_types("int"), 10);
+      auto v = cache.xsd(root);
+      BOOST_CHECK(v->validate(read_memory("<root>1</root>")));
+      BOOST_CHECK_EQUAL(cache.compilations(), 2u);
+    }
+
+    BOOST_AUTO_TEST_CASE(missing_import)
+    {
+      Temp_Dir dir;
+      // libxml2 just warns about the missing schema
+      string root = dir.write("root.xsd",
+          "<xs:schema xmlns:xs='http://www.w3.org/2001/XMLSchema'>"
+          "<xs:import namespace='urn:x' schemaLocation='x.xsd'/>"
+          "<xs:element name='root' type='xs:int'/></xs:schema>");
+      util::Schema_Cache cache;
+      cache.set_check_interval(chrono::milliseconds(0));
+      auto v = cache.xsd(root);
+      BOOST_CHECK(v->validate(read_memory("<root>1</root>")));
+      BOOST_CHECK_EQUAL(cache.xsd(root), v);
+      BOOST_CHECK_EQUAL(cache.compilations(), 1u);
+      // appears
+      dir.write("x.xsd", "<xs:schema xmlns:xs='http://www.w3.org/2001/XMLSchema'"
+          " targetNamespace='urn:x'/>");
+      BOOST_CHECK(cache.xsd(root) != v);
+      BOOST_CHECK_EQUAL(cache.compilations(), 2u);
+    }
+
+    BOOST_AUTO_TEST_CASE(relaxng)
+    {
+      Temp_Dir dir;
+      string root = dir.write("root.rng",
+          "<grammar xmlns='http://relaxng.org/ns/structure/1.0'>"
+          "<include href='inc.rng'/>"
+          "<start><element name='root'><ref name='v'/></element></start>"
+          "</grammar>");
+      dir.write("inc.rng",
+          "<grammar xmlns='http://relaxng.org/ns/structure/1.0'>"
+          "<define name='v'><element name='a'><empty/></element></define>"
+          "</grammar>");
+      util::Schema_Cache cache;
+      cache.set_check_interval(chrono::milliseconds(0));
+      auto v = cache.relaxng(root);
+      BOOST_CHECK(v->kind() == util::Validator::Kind::RELAXNG);
+      doc::Ptr d = read_memory("<root><b/></root>");
+      BOOST_CHECK(!v->validate(d));
+      dir.write("inc.rng",
+          "<grammar xmlns='http://relaxng.org/ns/structure/1.0'>"
+          "<define name='v'><element name='b'><empty/></element></define>"
+          "</grammar>", 10);
+      auto w = cache.relaxng(root);
+      BOOST_CHECK(w->validate(d));
+
+      // with a check interval, changes are picked up later
+      cache.set_check_interval(chrono::hours(1));
+      dir.write("inc.rng", "<broken", 20);
+      BOOST_CHECK_EQUAL(cache.relaxng(root), w);
+    }
+
+    BOOST_AUTO_TEST_CASE(check_interval)
+    {
+      Temp_Dir dir;
+      string root = dir.write("root.xsd", xsd_root);
+      dir.write("types.xsd", xsd_types("int"));
+      util::Schema_Cache cache;
+      auto v = cache.xsd(root);
+      dir.write("types.xsd", xsd_types("string"), 10);
+      // by default, not checked on each lookup
+      BOOST_CHECK_EQUAL(cache.xsd(root), v);
+      BOOST_CHECK_EQUAL(cache.compilations(), 1u);
+    }
+
+    // blocks the loading of types.xsd until released
+    static mutex block_mutex;
+    static condition_variable block_cv;
+    static bool block_entered;
+    static bool block_released;
+    static xmlExternalEntityLoader block_old;
+    static xmlParserInputPtr blocking_loader(const char *url, const char *id,
+        xmlParserCtxtPtr ctxt)
+    {
+      if (url && strstr(url, "types.xsd")) {
+        unique_lock<mutex> lock(block_mutex);
+        block_entered = true;
+        block_cv.notify_all();
+        block_cv.wait(lock, []{ return block_released; });
+      }
+      return block_old(url, id, ctxt);
+    }
+
+    BOOST_AUTO_TEST_CASE(recompiling)
+    {
+      Temp_Dir dir;
+      string root = dir.write("root.xsd", xsd_root);
+      dir.write("types.xsd", xsd_types("int"));
+      util::Schema_Cache cache;
+      cache.set_check_interval(chrono::milliseconds(0));
+      auto v = cache.xsd(root);
+      dir.write("types.xsd", xsd_types("string"), 10);
+
+      block_entered = false;
+      block_released = false;
+      block_old = set_external_entity_loader(blocking_loader);
+      shared_ptr<util::Validator> w;
+      thread t([&w, &cache, &root]{ w = cache.xsd(root); });
+      {
+        unique_lock<mutex> lock(block_mutex);
+        block_cv.wait(lock, []{ return block_entered; });
+      }
+      // doesn't wait for the recompilation
+      BOOST_CHECK_EQUAL(cache.xsd(root), v);
+      {
+        lock_guard<mutex> lock(block_mutex);
+        block_released = true;
+        block_cv.notify_all();
+      }
+      t.join();
+      set_external_entity_loader(block_old);
+      BOOST_CHECK(w != v);
+      BOOST_CHECK_EQUAL(cache.xsd(root), w);
+      BOOST_CHECK_EQUAL(cache.compilations(), 2u);
+    }
+
+    BOOST_AUTO_TEST_CASE(entity_cache)
+    {
+      Temp_Dir dir;
+      string root = dir.write("root.xsd", xsd_root);
+      dir.write("types.xsd", xsd_types("int"));
+      auto old = set_external_entity_loader(util::Entity_Cache::loader);
+      util::Entity_Cache::instance().clear();
+      util::Schema_Cache cache;
+      cache.set_check_interval(chrono::milliseconds(0));
+      doc::Ptr d = read_memory("<root>abc</root>");
+      BOOST_CHECK(!cache.xsd(root)->validate(d));
+      // the loader serves the changed include, too
+      dir.write("types.xsd", xsd_types("string"), 10);
+      BOOST_CHECK(cache.xsd(root)->validate(d));
+      BOOST_CHECK_EQUAL(cache.compilations(), 2u);
+      set_external_entity_loader(old);
+      util::Entity_Cache::instance().clear();
+    }
+
+    BOOST_AUTO_TEST_CASE(concurrent)
+    {
+      Temp_Dir dir;
+      string root = dir.write("root.xsd", xsd_root);
+      dir.write("types.xsd", xsd_types("int"));
+      util::Schema_Cache &cache = util::Schema_Cache::instance();
+      vector<shared_ptr<util::Validator>> vs(4);
+      vector<thread> ts;
+      for (unsigned i = 0; i < vs.size(); ++i)
+        ts.emplace_back([&vs, &cache, &root, i]{ vs[i] = cache.xsd(root); });
+      for (auto &t : ts)
+        t.join();
+      for (auto &v : vs)
+        BOOST_CHECK_EQUAL(v, vs[0]);
+      cache.clear();
+    }
+
+  BOOST_AUTO_TEST_SUITE_END() // schema_cache_
+
+BOOST_AUTO_TEST_SUITE_END() // libxxxml
@@ -0,0 +1,63 @@
+#ifndef XXXML_TEST_TEMP_FILE_HH
+#define XXXML_TEST_TEMP_FILE_HH
+
+#include <boost/test/unit_test.hpp>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace xxxml {
+
+  namespace test {
+
+    // an empty file in the working directory, it's removed on
+    // destruction
+    struct Temp_File {
+      char name[64];
+      int fd;
+      explicit Temp_File(const char *prefix = "xxxml")
+      {
+        snprintf(name, sizeof name, "%.40s_XXXXXX", prefix);
+        fd = mkstemp(name);
+        BOOST_REQUIRE(fd != -1);
+      }
+      Temp_File(const char *prefix, const std::string &content)
+        : Temp_File(prefix)
+      {
+        write(content);
+      }
+      ~Temp_File()
+      {
+        close(fd);
+        unlink(name);
+      }
+      Temp_File(const Temp_File &) = delete;
+      Temp_File &operator=(const Temp_File &) = delete;
+
+      // replaces the content
+      void write(const std::string &content) const
+      {
+        std::ofstream f(name, std::ios::binary);
+        f << content;
+        BOOST_REQUIRE(f.flush());
+      }
+    };
+
+    inline std::string slurp(const char *filename)
+    {
+      std::ifstream f(filename, std::ios::binary);
+      std::ostringstream o;
+      o << f.rdbuf();
+      return o.str();
+    }
+
+  }
+
+}
+
+#endif
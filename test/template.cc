@@ -0,0 +1,91 @@
+#include <boost/test/unit_test.hpp>
+
+#include <xxxml/template.hh>
+
+#include <limits>
+#include <string>
+#include <type_traits>
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(libxxxml)
+
+  BOOST_AUTO_TEST_SUITE(template_)
+
+    using namespace xxxml;
+    namespace tmpl = xxxml::util::tmpl;
+
+    static_assert(is_same<XXXML_STR("id"), tmpl::Str<'i', 'd'> >::value,
+        "XXXML_STR");
+
+    using Rec = tmpl::Element<XXXML_STR("rec"),
+          tmpl::Attribute<XXXML_STR("id")>,
+          tmpl::Fixed_Attribute<XXXML_STR("v"), XXXML_STR("1")>,
+          tmpl::Element<XXXML_STR("name"), tmpl::Text>,
+          tmpl::Element<XXXML_STR("empty")>,
+          tmpl::Element<XXXML_STR("p:amount"), tmpl::Fixed_Text<
+            XXXML_STR("EUR ")>, tmpl::Text> >;
+
+    // compares with the text writer functions
+    BOOST_AUTO_TEST_CASE(mixed)
+    {
+      vector<string> xs = { "", "Hello", "a<b>&c\"d'e", "\r\n\tx",
+        "\xc3\xa9t\xc3\xa9", string(100, 'x') + "&" };
+      string s, t;
+      text_writer::Ptr w = new_text_writer(s);
+      text_writer::Ptr x = new_text_writer(t);
+      text_writer::start_document(w, nullptr, "UTF-8");
+      text_writer::start_document(x, nullptr, "UTF-8");
+      text_writer::start_element(w, "root");
+      text_writer::start_element(x, "root");
+      text_writer::write_attribute(w, "a", "b");
+      text_writer::write_attribute(x, "a", "b");
+      for (auto &v : xs) {
+        tmpl::write<Rec>(w, v, v, v);
+        text_writer::start_element(x, "rec");
+        text_writer::write_attribute(x, "id", v.c_str());
+        text_writer::write_attribute(x, "v", "1");
+        text_writer::write_element(x, "name", v.c_str());
+        text_writer::write_element(x, "empty", nullptr);
+        text_writer::write_element(x, "p:amount", ("EUR " + v).c_str());
+        text_writer::end_element(x);
+        text_writer::write_element(w, "after", "1");
+        text_writer::write_element(x, "after", "1");
+      }
+      text_writer::end_document(w);
+      text_writer::end_document(x);
+      BOOST_CHECK_EQUAL(s, t);
+    }
+
+    BOOST_AUTO_TEST_CASE(values)
+    {
+      using E = tmpl::Element<XXXML_STR("e"), tmpl::Attribute<XXXML_STR("a")>,
+            tmpl::Text>;
+      string s;
+      tmpl::append<E>(s, 0, -42);
+      tmpl::append<E>(s, numeric_limits<long long>::min(),
+          numeric_limits<unsigned long long>::max());
+      const char r[] = "x&y";
+      tmpl::append<E>(s, make_pair(r, r + 1), string("y"));
+      BOOST_CHECK_EQUAL(s, "<e a=\"0\">-42</e>"
+          "<e a=\"-9223372036854775808\">18446744073709551615</e>"
+          "<e a=\"x\">y</e>");
+      BOOST_CHECK_THROW(tmpl::append<E>(s, (const char*)nullptr, "x"),
+          xxxml::Runtime_Error);
+    }
+
+    BOOST_AUTO_TEST_CASE(static_only)
+    {
+      using E = tmpl::Element<XXXML_STR("a"),
+            tmpl::Fixed_Attribute<XXXML_STR("x"), XXXML_STR("")>,
+            tmpl::Element<XXXML_STR("b")>, tmpl::Element<XXXML_STR("c")> >;
+      string s;
+      text_writer::Ptr w = new_text_writer(s);
+      tmpl::write<E>(w);
+      text_writer::flush(w);
+      BOOST_CHECK_EQUAL(s, "<a x=\"\"><b/><c/></a>");
+    }
+
+  BOOST_AUTO_TEST_SUITE_END() // template_
+
+BOOST_AUTO_TEST_SUITE_END() // libxxxml
@@ -6,6 +6,10 @@
 
 #include <sstream>
 #include <iostream>
+#include <array>
+#include <vector>
+
+#include <unistd.h>
 
 using namespace std;
 
@@ -33,6 +37,82 @@ BOOST_AUTO_TEST_SUITE(libxxxml)
       BOOST_CHECK_EQUAL(xxxml::name(p.back()), "xyz");
     }
 
+    BOOST_AUTO_TEST_CASE(path_range)
+    {
+      doc::Ptr d = read_memory("<root><foo><foo>Hello</foo></foo><bar><a><b><c><xyz>World</xyz></c></b></a></bar></root>");
+      const xmlNode *node = xxxml::util::Node_Set(d, "//xyz").begin()[0];
+      std::array<const xmlNode*, 6> a;
+      BOOST_CHECK_EQUAL(xxxml::util::path(node, a.data(), a.data() + 3), 6u);
+      BOOST_REQUIRE_EQUAL(xxxml::util::path(node, a.data(), a.data() + a.size()), 6u);
+      BOOST_CHECK_EQUAL(xxxml::name(a.front()), "root");
+      BOOST_CHECK_EQUAL(xxxml::name(a[1]), "bar");
+      BOOST_CHECK_EQUAL(xxxml::name(a.back()), "xyz");
+
+      vector<const xmlNode*> v;
+      xxxml::util::path(node, v);
+      BOOST_CHECK_EQUAL_COLLECTIONS(v.begin(), v.end(), a.begin(), a.end());
+      xxxml::util::path(a[2], v);
+      BOOST_CHECK_EQUAL(v.size(), 3u);
+    }
+
+    BOOST_AUTO_TEST_CASE(format_path_)
+    {
+      doc::Ptr d = read_memory("<root xmlns:x='urn:x'><a/><b/><b><c/></b>"
+          "<a/><b><c/><x:c/></b></root>");
+      Node_Set ns(d, "//*[local-name()='c']");
+      vector<string> v;
+      for (auto node : ns) {
+        string s;
+        format_path(node, s);
+        v.push_back(s);
+      }
+      const array<const char*, 3> refs = {
+        "/root/b[2]/c", "/root/b[3]/c", "/root/b[3]/x:c" };
+      BOOST_CHECK_EQUAL_COLLECTIONS(v.begin(), v.end(),
+          refs.begin(), refs.end());
+
+      char buf[8];
+      BOOST_CHECK_EQUAL(format_path(ns.begin()[0], buf, buf + sizeof buf), 12u);
+      BOOST_CHECK_EQUAL(buf, "/root/b");
+    }
+
+    BOOST_AUTO_TEST_CASE(path_formatter)
+    {
+      doc::Ptr d = read_memory("<root><a/><b/><b><c/></b>"
+          "<a><c/><c/></a><b><c/><d/></b></root>");
+      ostringstream o, p;
+      Path_Formatter f;
+      string s;
+      for (DF_Traverser t(d); !t.eot(); t.advance()) {
+        f.format(*t, s);
+        o << s << ' ';
+        format_path(*t, s);
+        p << s << ' ';
+      }
+      BOOST_CHECK_EQUAL(o.str(), p.str());
+      BOOST_CHECK_EQUAL(o.str(), "/root /root/a[1] /root/b[1] /root/b[2] "
+          "/root/b[2]/c /root/a[2] /root/a[2]/c[1] /root/a[2]/c[2] "
+          "/root/b[3] /root/b[3]/c /root/b[3]/d ");
+
+      // random access works as well, just not as cheap
+      f.format(d.get()->children->children->next, s);
+      BOOST_CHECK_EQUAL(s, "/root/b[1]");
+
+      // many distinct names, same local names in different namespaces
+      ostringstream x;
+      x << "<root xmlns:x='urn:x'>";
+      for (unsigned i = 0; i < 300; ++i)
+        x << "<e" << i % 100 << "/><x:e" << i % 7 << "/>";
+      x << "</root>";
+      doc::Ptr e = read_memory(x.str());
+      string t;
+      for (DF_Traverser i(e); !i.eot(); i.advance()) {
+        f.format(*i, s);
+        format_path(*i, t);
+        BOOST_CHECK_EQUAL(s, t);
+      }
+    }
+
     BOOST_AUTO_TEST_CASE(remove_)
     {
       doc::Ptr d = read_memory("<root><foo><foo>Hello</foo></foo><bar>World</bar></root>");
@@ -302,6 +382,61 @@ BOOST_AUTO_TEST_SUITE(libxxxml)
       BOOST_CHECK_EQUAL(s,  "<bar><a>Wo</a><b>rld</b></bar>");
     }
 
+    BOOST_AUTO_TEST_CASE(serializer)
+    {
+      doc::Ptr d = read_memory("<root><foo a='1'>Hello</foo>"
+          "<bar><a>Wo</a><b>rld &amp; more</b></bar></root>");
+      const xmlNode* root = doc::get_root_element(d);
+      Serializer s;
+      for (bool format : { false, true }) {
+        auto r = s.dump(d, format);
+        auto ref = doc::dump_format_memory(d, format);
+        BOOST_CHECK_EQUAL(string(r.first, r.second),
+            string(ref.first.get(), ref.second));
+      }
+      auto r = s.dump(d, xxxml::last_element_child(root), false);
+      BOOST_CHECK_EQUAL(string(r.first, r.second),
+          "<bar><a>Wo</a><b>rld &amp; more</b></bar>");
+      const void *p = r.first;
+      s.dump(d, first_element_child(root), false);
+      s.append(",", ",");
+      s.append(",", "," + 1);
+      s.append(d, xxxml::last_element_child(root), false);
+      r = s.content();
+      BOOST_CHECK_EQUAL(string(r.first, r.second), "<foo a=\"1\">Hello</foo>,"
+          "<bar><a>Wo</a><b>rld &amp; more</b></bar>");
+      // buffer is re-used
+      BOOST_CHECK(p == r.first);
+    }
+
+    BOOST_AUTO_TEST_CASE(serializer_write)
+    {
+      doc::Ptr d = read_memory("<root><foo>Hello</foo></root>");
+      Serializer s;
+      s.append(d, doc::get_root_element(d), false);
+      int fds[2];
+      BOOST_REQUIRE(pipe(fds) == 0);
+      const char head[] = "29\n";
+      s.write(fds[1], head, head + sizeof head - 1);
+      BOOST_CHECK_EQUAL(s.size(), 0u);
+      close(fds[1]);
+      char buf[64];
+      ssize_t n = read(fds[0], buf, sizeof buf);
+      close(fds[0]);
+      BOOST_REQUIRE(n > 0);
+      BOOST_CHECK_EQUAL(string(buf, n), "29\n<root><foo>Hello</foo></root>");
+    }
+
+    BOOST_AUTO_TEST_CASE(estimate_size_)
+    {
+      doc::Ptr d = read_memory("<root><foo a='1'>Hello</foo>"
+          "<bar><a>Wo</a><b>rld</b></bar></root>");
+      const xmlNode* root = doc::get_root_element(d);
+      Serializer s;
+      auto r = s.dump(d, root, false);
+      BOOST_CHECK_EQUAL(estimate_size(root), size_t(r.second - r.first));
+    }
+
     BOOST_AUTO_TEST_SUITE(df_traverser_)
 
       BOOST_AUTO_TEST_CASE(basic)
@@ -0,0 +1,143 @@
+#include <boost/test/unit_test.hpp>
+
+#include <xxxml/validator.hh>
+
+#include "temp_file.hh"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(libxxxml)
+
+  BOOST_AUTO_TEST_SUITE(validator_)
+
+    using namespace xxxml;
+
+    static const char xsd_s[] =
+      "<xs:schema xmlns:xs='http://www.w3.org/2001/XMLSchema'>"
+      "<xs:element name='root'><xs:complexType><xs:sequence>"
+      "<xs:element name='a' type='xs:int' maxOccurs='unbounded'/>"
+      "</xs:sequence></xs:complexType></xs:element></xs:schema>";
+
+    static const char rng_s[] =
+      "<element name='root' xmlns='http://relaxng.org/ns/structure/1.0'"
+      " datatypeLibrary='http://www.w3.org/2001/XMLSchema-datatypes'>"
+      "<oneOrMore><element name='a'><data type='int'/></element></oneOrMore>"
+      "</element>";
+
+    static unique_ptr<util::Validator> xsd_validator()
+    {
+      auto pc = schema::new_mem_parser_ctxt(xsd_s);
+      return unique_ptr<util::Validator>(
+          new util::Validator(schema::parse(pc)));
+    }
+    static unique_ptr<util::Validator> rng_validator()
+    {
+      auto pc = relaxng::new_mem_parser_ctxt(rng_s);
+      return unique_ptr<util::Validator>(
+          new util::Validator(relaxng::parse(pc)));
+    }
+
+    using test::Temp_File;
+
+    BOOST_AUTO_TEST_CASE(errors)
+    {
+      for (auto kind : { util::Validator::Kind::XSD,
+          util::Validator::Kind::RELAXNG }) {
+        auto p = kind == util::Validator::Kind::XSD
+          ? xsd_validator() : rng_validator();
+        util::Validator &v = *p;
+        BOOST_CHECK(v.kind() == kind);
+
+        doc::Ptr good = read_memory("<root><a>1</a><a>2</a></root>");
+        BOOST_CHECK(v.validate(good));
+        doc::Ptr bad = read_memory("<root>\n<a>x</a>\n<a>y</a></root>");
+        vector<util::Validation_Error> es;
+        BOOST_CHECK(!v.validate(bad, es));
+        BOOST_REQUIRE(!es.empty());
+        BOOST_CHECK_EQUAL(es[0].line, 2);
+        BOOST_REQUIRE(es[0].node);
+        BOOST_CHECK_EQUAL(reinterpret_cast<const char*>(es[0].node->name), "a");
+        BOOST_CHECK(!es[0].message.empty());
+        BOOST_CHECK(es[0].message.back() != '\n');
+
+        es.clear();
+        BOOST_CHECK(!v.validate(bad, es, 1));
+        BOOST_CHECK_EQUAL(es.size(), 1u);
+        // the context was re-used
+        BOOST_CHECK_EQUAL(v.idle_contexts(), 1u);
+      }
+    }
+
+    BOOST_AUTO_TEST_CASE(file)
+    {
+      Temp_File good("validator", "<root><a>1</a></root>");
+      Temp_File bad("validator", "<root><a>x</a></root>");
+      Temp_File broken("validator", "<root><a>1</a></rot>");
+      for (auto v : { xsd_validator, rng_validator }) {
+        auto p = v();
+        util::Validator &x = *p;
+        BOOST_CHECK(x.validate_file(good.name));
+        // with a pooled context
+        BOOST_CHECK(x.validate_file(good.name));
+        vector<util::Validation_Error> es;
+        BOOST_CHECK(!x.validate_file(bad.name, es));
+        BOOST_CHECK(!es.empty());
+        BOOST_CHECK(!x.validate_file(broken.name));
+        BOOST_CHECK(x.validate_file(good.name));
+        BOOST_CHECK_THROW(x.validate_file("does/not/exist.xml"), Runtime_Error);
+      }
+    }
+
+    BOOST_AUTO_TEST_CASE(memory)
+    {
+      const string good("<root><a>1</a></root>");
+      const string bad("<root><a>x</a></root>");
+      const string broken("<root><a>1</a></rot>");
+      for (auto v : { xsd_validator, rng_validator }) {
+        auto p = v();
+        util::Validator &x = *p;
+        BOOST_CHECK(x.validate_memory(good.data(), good.data() + good.size()));
+        vector<util::Validation_Error> es;
+        BOOST_CHECK(!x.validate_memory(bad.data(), bad.data() + bad.size(),
+              es));
+        BOOST_CHECK_EQUAL(es.size(), p->kind() == util::Validator::Kind::XSD
+            ? 1u : 3u);
+        BOOST_CHECK(!x.validate_memory(broken.data(),
+              broken.data() + broken.size()));
+      }
+    }
+
+    BOOST_AUTO_TEST_CASE(concurrent)
+    {
+      doc::Ptr good = read_memory("<root><a>1</a><a>2</a></root>");
+      doc::Ptr bad = read_memory("<root><a>x</a></root>");
+      for (auto v : { xsd_validator, rng_validator }) {
+        auto p = v();
+        util::Validator &x = *p;
+        atomic<unsigned> wrong(0);
+        vector<thread> ts;
+        for (unsigned i = 0; i < 4; ++i)
+          ts.emplace_back([&]{
+              for (unsigned j = 0; j < 200; ++j) {
+                vector<util::Validation_Error> es;
+                if (!x.validate(good) || x.validate(bad, es) || es.empty())
+                  ++wrong;
+              }
+              });
+        for (auto &t : ts)
+          t.join();
+        BOOST_CHECK_EQUAL(wrong, 0u);
+        BOOST_CHECK(x.idle_contexts() >= 1u);
+        BOOST_CHECK(x.idle_contexts() <= 4u);
+      }
+    }
+
+  BOOST_AUTO_TEST_SUITE_END() // validator_
+
+BOOST_AUTO_TEST_SUITE_END() // libxxxml
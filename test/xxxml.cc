@@ -8,6 +8,10 @@
 
 #include <xxxml/xxxml.hh>
 
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
 /* libxml2 Examples - Executable Documentation
  
    2015, Georg Sauthoff <mail@georg.so>
@@ -41,6 +45,19 @@ R"(<?xml version='1.0' encoding='UTF-8'?>
 
 </grammar>
 )";
+const char xsd_schema_s[] =
+R"(<?xml version='1.0' encoding='UTF-8'?>
+<xs:schema xmlns:xs='http://www.w3.org/2001/XMLSchema'
+  elementFormDefault='qualified'>
+  <xs:element name='root' type='root'/>
+  <xs:complexType name='root'>
+    <xs:sequence>
+      <xs:element name='foo' type='xs:string'/>
+      <xs:element name='bar' type='xs:string' maxOccurs='unbounded'/>
+    </xs:sequence>
+  </xs:complexType>
+</xs:schema>
+)";
 const char rng_records_s[] =
 R"(<?xml version='1.0' encoding='UTF-8'?>
 <grammar datatypeLibrary='http://www.w3.org/2001/XMLSchema-datatypes'
@@ -544,6 +561,46 @@ BOOST_AUTO_TEST_SUITE(libxxxml)
     }
 
     // }}}
+    BOOST_AUTO_TEST_CASE(ranges)
+    {
+      // columns of a buffer, i.e. not NUL-terminated
+      const char buffer[] = "rec\xc3\xa9s &amp; <x>\"\nid23";
+      const char *a = buffer, *b = a + 5, *c = b + 14, *d = c + 4;
+      doc::Ptr e = new_doc();
+      doc::Ptr f = new_doc();
+      xmlNode *root = new_doc_node(e, "root");
+      doc::set_root_element(e, root);
+      new_child(root, "a", string(a, b));
+      new_child(root, "b", string(b, c));
+      xmlNode *x = new_doc_node(e, "c", string(b, c));
+      add_child(root, new_doc_text(e, string(a, b)));
+      add_child(root, x);
+      new_prop(x, "v", string(b, c).c_str());
+      set_prop(root, "xml:id", string(c, d).c_str());
+      set_prop(root, "xml:id", string(a, b).c_str());
+      set_prop(root, "w", string(c, d));
+
+      root = new_doc_node(f, "root");
+      doc::set_root_element(f, root);
+      new_child(root, "a", a, b);
+      new_child(root, "b", b, c);
+      x = new_doc_node(f, "c", b, c);
+      add_child(root, new_doc_text(f, a, b));
+      add_child(root, x);
+      new_prop(x, "v", b, c);
+      set_prop(root, "xml:id", c, d);
+      set_prop(root, "xml:id", a, b);
+      set_prop(root, "w", c, d);
+
+      auto s = doc::dump_format_memory(e);
+      auto t = doc::dump_format_memory(f);
+      BOOST_CHECK_EQUAL(string(s.first.get(), s.second),
+          string(t.first.get(), t.second));
+      BOOST_CHECK(xmlGetID(f.get(), reinterpret_cast<const xmlChar*>(
+              "rec\xc3\xa9")));
+      BOOST_CHECK(!xmlGetID(f.get(), reinterpret_cast<const xmlChar*>("id")));
+    }
+
   BOOST_AUTO_TEST_SUITE_END() // from_scratch
 
   BOOST_AUTO_TEST_SUITE(xpath_)
@@ -737,6 +794,74 @@ R"(<?xml version='1.0' encoding='UTF-8'?>
       BOOST_CHECK_THROW(schema::validate_doc(v, d), xxxml::Validate_Error);
     }
 
+    BOOST_AUTO_TEST_CASE(stream)
+    {
+      schema::Parser_Ctxt_Ptr pc = schema::new_mem_parser_ctxt(xsd_schema_s);
+      schema::Ptr schema = schema::parse(pc);
+      schema::Valid_Ctxt_Ptr v = schema::new_valid_ctxt(schema);
+
+      // no tree is built
+      BOOST_CHECK_NO_THROW(schema::validate_memory(v,
+          "<root><foo>Hello</foo><bar>World</bar><bar>!</bar></root>"));
+      BOOST_CHECK_THROW(schema::validate_memory(v,
+          "<root><bar>World</bar></root>"), xxxml::Validate_Error);
+      // not well-formed
+      BOOST_CHECK_THROW(schema::validate_memory(v,
+          "<root><foo>Hello</foo><bar>World</baz></root>"),
+          xxxml::Validate_Error);
+      // the context can be re-used
+      string s("<root><foo/><bar/></root>");
+      BOOST_CHECK_NO_THROW(schema::validate_memory(v, s));
+
+      char filename[] = "xsd_stream_XXXXXX";
+      int fd = mkstemp(filename);
+      BOOST_REQUIRE(fd != -1);
+      FILE *f = fdopen(fd, "w");
+      fputs("<root><foo>Hello</foo><bar>World</bar></root>", f);
+      fclose(f);
+      BOOST_CHECK_NO_THROW(schema::validate_file(v, filename));
+      unlink(filename);
+      BOOST_CHECK_THROW(schema::validate_file(v, filename), xxxml::Runtime_Error);
+    }
+
+    struct Counter {
+      unsigned elements {0};
+    };
+    static void count_start(void *ctx, const xmlChar *, const xmlChar *,
+        const xmlChar *, int, const xmlChar **, int, int, const xmlChar **)
+    {
+      ++static_cast<Counter*>(ctx)->elements;
+    }
+
+    BOOST_AUTO_TEST_CASE(sax_plug_)
+    {
+      schema::Parser_Ctxt_Ptr pc = schema::new_mem_parser_ctxt(xsd_schema_s);
+      schema::Ptr schema = schema::parse(pc);
+      schema::Valid_Ctxt_Ptr v = schema::new_valid_ctxt(schema);
+
+      const pair<const char*, bool> inputs[] = {
+        { "<root><foo/><bar/><bar/></root>", true  },
+        { "<root><foo/><foo/><bar/></root>", false }
+      };
+      for (auto &p : inputs) {
+        const char *input = p.first;
+        xmlSAXHandler handler;
+        memset(&handler, 0, sizeof handler);
+        // the plug requires a SAX2 handler
+        handler.initialized = XML_SAX2_MAGIC;
+        handler.startElementNs = count_start;
+        xmlSAXHandler *sax = &handler;
+        Counter counter;
+        void *user_data = &counter;
+        {
+          schema::SAX_Plug_Ptr plug = schema::sax_plug(v, &sax, &user_data);
+          xmlSAXUserParseMemory(sax, user_data, input, strlen(input));
+        }
+        BOOST_CHECK_EQUAL(counter.elements, 4u);
+        BOOST_CHECK_EQUAL(schema::is_valid(v), p.second);
+      }
+    }
+
     // }}}
   BOOST_AUTO_TEST_SUITE_END() // schema_
 
@@ -1024,6 +1149,66 @@ R"(<?xml version='1.0' encoding='UTF-8'?>
           valid_refs.begin(), valid_refs.end());
     }
 
+    BOOST_AUTO_TEST_CASE(expand_next)
+    {
+      using namespace text_reader;
+      Ptr reader = for_memory(
+          "<root><a><b>Hello</b></a><c>World</c></root>");
+      read(reader);
+      read(reader);
+      BOOST_CHECK_EQUAL(const_local_name(reader), "a");
+      xmlNode *a = expand(reader);
+      BOOST_CHECK_EQUAL(reinterpret_cast<const char*>(a->name), "a");
+      BOOST_CHECK_EQUAL(reinterpret_cast<const char*>(a->children->name), "b");
+      BOOST_CHECK_EQUAL(current_node(reader), a);
+      // skips the subtree
+      BOOST_CHECK(next(reader));
+      BOOST_CHECK_EQUAL(node_type(reader), XML_READER_TYPE_ELEMENT);
+      BOOST_CHECK_EQUAL(const_local_name(reader), "c");
+      BOOST_CHECK(next(reader));
+      BOOST_CHECK_EQUAL(node_type(reader), XML_READER_TYPE_END_ELEMENT);
+      BOOST_CHECK_EQUAL(const_local_name(reader), "root");
+      BOOST_CHECK(!next(reader));
+    }
+
+    BOOST_AUTO_TEST_CASE(current_doc_)
+    {
+      using namespace text_reader;
+      doc::Ptr d(nullptr, xmlFreeDoc);
+      {
+        Ptr reader = for_memory("<root><a>Hello</a><b>World</b></root>");
+        read(reader);
+        read(reader);
+        expand(reader);
+        d = current_doc(reader);
+      }
+      // the document isn't freed with the reader
+      auto c = xpath::new_context(d);
+      auto o = xpath::eval("/root/a", c);
+      BOOST_CHECK_EQUAL(xpath::cast_node_set_to_string(o).get(), "Hello");
+    }
+
+    BOOST_AUTO_TEST_CASE(xsd)
+    {
+      using namespace text_reader;
+      schema::Parser_Ctxt_Ptr pc = schema::new_mem_parser_ctxt(xsd_schema_s);
+      schema::Ptr schema = schema::parse(pc);
+
+      Ptr reader = for_memory(
+          "<root><foo>Hello</foo><bar>World</bar></root>");
+      schema_set_schema(reader, schema);
+      while (read(reader))
+        ;
+      BOOST_CHECK(is_valid(reader));
+
+      schema::Valid_Ctxt_Ptr v = schema::new_valid_ctxt(schema);
+      Ptr r2 = for_memory("<root><bar>World</bar></root>");
+      schema_validate_ctxt(r2, v);
+      while (read(r2))
+        ;
+      BOOST_CHECK(!is_valid(r2));
+    }
+
     // XXX add XML_PARSER_SUBST_ENTITIES case
 
   //}}}
@@ -1139,6 +1324,173 @@ R"(<?xml version='1.0' encoding='UTF-8'?>
       //cout << s << '\n';
     }
 
+    BOOST_AUTO_TEST_CASE(growable_buffer)
+    {
+      string s;
+      vector<char> v;
+      Ptr w = new_text_writer(s);
+      Ptr x = new_text_writer(v);
+      for (Ptr *p : { &w, &x }) {
+        start_document(*p);
+        start_element(*p, "root");
+        write_element(*p, "a", "Hello & World");
+        end_element(*p);
+        end_document(*p);
+      }
+      BOOST_CHECK_EQUAL(s, "<?xml version=\"1.0\"?>\n"
+          "<root><a>Hello &amp; World</a></root>\n");
+      BOOST_CHECK(string(v.begin(), v.end()) == s);
+
+      // the buffer is re-used for the next document
+      string t(s);
+      const char *p = s.data();
+      size_t capacity = s.capacity();
+      s.clear();
+      start_document(w);
+      start_element(w, "root");
+      write_element(w, "a", "Hello & World");
+      end_element(w);
+      end_document(w);
+      BOOST_CHECK_EQUAL(s, t);
+      BOOST_CHECK(s.data() == p);
+      BOOST_CHECK_EQUAL(s.capacity(), capacity);
+    }
+
+    // compares with libxml2's escaping
+    BOOST_AUTO_TEST_CASE(ranges)
+    {
+      vector<string> xs = { "", "Hello", "a<b>&c\"d'e", "\r\n\tx",
+        "\xc3\xa9t\xc3\xa9", "<\xc3\xa9>\n" };
+      // special characters around the 16/32 byte blocks
+      for (const char *c : { "<", ">", "&", "\"", "\r", "\n", "\t",
+          "\xc3\xa9" })
+        for (size_t pos : { 0u, 15u, 16u, 31u, 32u, 33u, 63u, 70u }) {
+          string u(80, 'x');
+          u.replace(pos, 1, c);
+          xs.push_back(u);
+        }
+      for (const char *encoding : { (const char*)nullptr, "UTF-8" }) {
+        string s, t;
+        Ptr w = new_text_writer(s);
+        Ptr x = new_text_writer(t);
+        start_document(w, nullptr, encoding);
+        start_document(x, nullptr, encoding);
+        start_element(w, "root");
+        start_element(x, "root");
+        auto xml = [](const string &v) {
+          return reinterpret_cast<const xmlChar*>(v.c_str()); };
+        for (auto &v : xs) {
+          // past the end is a different character
+          string u(v);
+          u += '&';
+          const char *begin = u.data(), *end = begin + u.size() - 1;
+          start_element(w, "e");
+          start_element(x, "e");
+          xmlTextWriterWriteAttribute(w.get(), xml("a"), xml(v));
+          write_attribute(x, "a", begin, end);
+          xmlTextWriterWriteAttribute(w.get(), xml("b"), xml(v));
+          write_attribute(x, "b", v.c_str());
+          start_attribute(w, "c");
+          start_attribute(x, "c");
+          xmlTextWriterWriteString(w.get(), xml(v));
+          write_string(x, begin, end);
+          end_attribute(w);
+          end_attribute(x);
+          xmlTextWriterWriteString(w.get(), xml(v));
+          write_string(x, begin, end);
+          xmlTextWriterWriteString(w.get(), xml(v));
+          write_string(x, v.c_str());
+          end_element(w);
+          end_element(x);
+          xmlTextWriterWriteElement(w.get(), xml("f"), xml(v));
+          write_element(x, "f", begin, end);
+          xmlTextWriterWriteElement(w.get(), xml("g"), xml(v));
+          write_element(x, "g", v.c_str());
+        }
+        xmlTextWriterWriteElement(w.get(), xml("h"), nullptr);
+        write_element(x, "h", nullptr);
+        end_document(w);
+        end_document(x);
+        BOOST_CHECK_EQUAL(s, t);
+      }
+    }
+
+    BOOST_AUTO_TEST_CASE(string_state)
+    {
+      string s;
+      Ptr w = new_text_writer(s);
+      start_element(w, "r");
+      BOOST_REQUIRE(xmlTextWriterStartCDATA(w.get()) != -1);
+      write_string(w, "a<b&c");
+      string v("d<e");
+      write_string(w, v.data(), v.data() + v.size());
+      BOOST_REQUIRE(xmlTextWriterEndCDATA(w.get()) != -1);
+      BOOST_REQUIRE(xmlTextWriterStartComment(w.get()) != -1);
+      write_string(w, "f>g");
+      BOOST_REQUIRE(xmlTextWriterEndComment(w.get()) != -1);
+      write_string(w, "h<i");
+      end_element(w);
+      w.reset();
+      BOOST_CHECK_EQUAL(s, "<r><![CDATA[a<b&cd<e]]><!--f>g-->h&lt;i</r>");
+    }
+
+    BOOST_AUTO_TEST_CASE(node)
+    {
+      doc::Ptr d = read_memory("<?xml version='1.0'?>\n"
+          "<!DOCTYPE root [ <!ENTITY e 'ent'> ]>"
+          "<root xmlns='urn:d' xmlns:p='urn:p'>"
+          "<p:a xmlns:q='urn:q' q:x='1&amp;2' y='&#10;&#13;'>"
+          "Hello &lt; World<b/><!-- c --><?pi x?><![CDATA[<c>]]>"
+          "<q:c>&e;</q:c><d xml:lang='en' p:z='3'/></p:a>"
+          "<n xmlns=''><m v='&quot;&lt;&e;'>say \"hi\"</m></n></root>");
+      const xmlNode *root = doc::get_root_element(d);
+      const xmlNode *a = first_element_child(root);
+
+      // the same as dumping a self-contained subtree
+      const xmlNode *c = a->next;
+      string ref;
+      {
+        Output_Buffer_Ptr o = output_buffer_create_mem(ref);
+        node_dump_output(o, d, c, 0, false);
+      }
+      string s;
+      {
+        Ptr w = new_text_writer(s);
+        write_node(w, d, c);
+      }
+      BOOST_CHECK_EQUAL(s, ref);
+
+      // mixed with streamed content
+      s.clear();
+      Ptr w = new_text_writer(s);
+      start_document(w);
+      start_element(w, "response");
+      write_element(w, "status", "ok");
+      write_node(w, d, a);
+      write_node(w, d, root->children->next);
+      end_element(w);
+      end_document(w);
+      BOOST_CHECK_EQUAL(s, "<?xml version=\"1.0\"?>\n"
+          "<response><status>ok</status>"
+          "<p:a xmlns:q=\"urn:q\" xmlns:p=\"urn:p\" q:x=\"1&amp;2\""
+          " y=\"&#10;&#13;\">Hello &lt; World"
+          "<b xmlns=\"urn:d\"/><!-- c --><?pi x?><![CDATA[<c>]]>"
+          "<q:c>&e;</q:c><d xmlns=\"urn:d\" xml:lang=\"en\" p:z=\"3\"/>"
+          "</p:a><n xmlns=\"\"><m v=\"&quot;&lt;&e;\">say \"hi\"</m></n>"
+          "</response>\n");
+
+      // the complete document, re-parsed
+      s.clear();
+      Ptr v = new_text_writer(s);
+      write_node(v, d, reinterpret_cast<const xmlNode*>(d.get()));
+      flush(v);
+      doc::Ptr e = read_memory(s);
+      auto x = doc::dump_format_memory(d);
+      auto y = doc::dump_format_memory(e);
+      BOOST_CHECK_EQUAL(string(x.first.get(), x.second),
+          string(y.first.get(), y.second));
+    }
+
     BOOST_AUTO_TEST_CASE(lets_throw)
     {
       Output_Buffer_Ptr o = alloc_output_buffer();
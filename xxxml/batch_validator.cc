@@ -0,0 +1,94 @@
+#include "batch_validator.hh"
+#include "parallel.hh"
+
+#include <algorithm>
+#include <thread>
+
+using namespace std;
+
+namespace xxxml {
+
+  namespace util {
+
+    static unsigned default_threads(unsigned threads)
+    {
+      if (threads)
+        return threads;
+      return max(thread::hardware_concurrency(), 1u);
+    }
+
+    Batch_Validator::Batch_Validator(schema::Ptr schema, unsigned threads,
+        size_t max_errors)
+      :
+        validator_(std::move(schema)),
+        threads_(default_threads(threads)),
+        max_errors_(max_errors)
+    {
+    }
+    Batch_Validator::Batch_Validator(relaxng::Ptr schema, unsigned threads,
+        size_t max_errors)
+      :
+        validator_(std::move(schema)),
+        threads_(default_threads(threads)),
+        max_errors_(max_errors)
+    {
+    }
+
+    template <typename F>
+      vector<Batch_Result> Batch_Validator::run(size_t n, F f)
+      {
+        vector<Batch_Result> results(n);
+        xxxml::detail::parallel_for(n, threads_,
+            [&results, &f](size_t i, unsigned) {
+            Batch_Result &r = results[i];
+            try {
+              r.valid = f(i, r.errors);
+            } catch (const Runtime_Error &e) {
+              // e.g. a file that can't be opened
+              r.valid = false;
+              Validation_Error v;
+              v.level = XML_ERR_FATAL;
+              v.message = e.what();
+              r.errors.push_back(std::move(v));
+            }
+            });
+        return results;
+      }
+
+    vector<Batch_Result> Batch_Validator::validate(const vector<doc::Ptr> &docs)
+    {
+      return run(docs.size(), [this, &docs](size_t i,
+            vector<Validation_Error> &errors) {
+          return validator_.validate(docs[i], errors, max_errors_);
+          });
+    }
+    vector<Batch_Result> Batch_Validator::validate(const vector<Range> &inputs)
+    {
+      return run(inputs.size(), [this, &inputs](size_t i,
+            vector<Validation_Error> &errors) {
+          return validator_.validate_memory(inputs[i].first, inputs[i].second,
+              errors, max_errors_);
+          });
+    }
+    vector<Batch_Result> Batch_Validator::validate_files(
+        const vector<string> &filenames)
+    {
+      return run(filenames.size(), [this, &filenames](size_t i,
+            vector<Validation_Error> &errors) {
+          return validator_.validate_file(filenames[i].c_str(),
+              errors, max_errors_);
+          });
+    }
+
+    unsigned Batch_Validator::threads() const
+    {
+      return threads_;
+    }
+    Validator &Batch_Validator::validator()
+    {
+      return validator_;
+    }
+
+  }
+
+}
@@ -0,0 +1,69 @@
+#ifndef XXXML_BATCH_VALIDATOR_HH
+#define XXXML_BATCH_VALIDATOR_HH
+
+#include <xxxml/validator.hh>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace xxxml {
+
+  namespace util {
+
+    struct Batch_Result {
+      bool valid {false};
+      // the first max_errors errors, also e.g. when a file can't be read
+      std::vector<Validation_Error> errors;
+    };
+
+    // Validates batches of documents with a pool of worker threads.
+    //
+    // The documents are handed out one by one, thus, a few large ones
+    // don't stall the other workers. Each worker leases one validation
+    // context at a time from the validator, i.e. there are at most as
+    // many contexts as workers and those are re-used across documents
+    // (except for streaming RelaxNG validation, cf. util::Validator).
+    //
+    // Memory ranges and files are validated in a streaming fashion,
+    // i.e. no trees are built.
+    //
+    // Example:
+    //
+    //     util::Batch_Validator b(schema::parse(pc));
+    //     auto rs = b.validate_files(filenames);
+    //     for (size_t i = 0; i < rs.size(); ++i)
+    //       if (!rs[i].valid)
+    //         cerr << filenames[i] << ": " << rs[i].errors.size() << '\n';
+    class Batch_Validator {
+      public:
+        using Range = std::pair<const char*, const char*>;
+
+        // threads == 0: one per core
+        explicit Batch_Validator(schema::Ptr schema, unsigned threads = 0,
+            size_t max_errors = 10);
+        explicit Batch_Validator(relaxng::Ptr schema, unsigned threads = 0,
+            size_t max_errors = 10);
+
+        // results in input order
+        std::vector<Batch_Result> validate(const std::vector<doc::Ptr> &docs);
+        std::vector<Batch_Result> validate(const std::vector<Range> &inputs);
+        std::vector<Batch_Result> validate_files(
+            const std::vector<std::string> &filenames);
+
+        unsigned threads() const;
+        Validator &validator();
+      private:
+        template <typename F>
+          std::vector<Batch_Result> run(size_t n, F f);
+
+        Validator validator_;
+        unsigned threads_;
+        size_t max_errors_;
+    };
+
+  }
+
+}
+
+#endif
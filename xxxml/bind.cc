@@ -0,0 +1,481 @@
+#include "bind.hh"
+#include "dispatch.hh"
+#include "escape.hh"
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace std;
+
+namespace xxxml {
+
+  namespace util {
+
+    namespace bind {
+
+      Output::Output(std::string &out, tmpl::detail::Slot slot)
+        :
+          out_(&out),
+          slot_(slot)
+      {
+      }
+      Output::Output(text_writer::Ptr &writer, tmpl::detail::Slot slot)
+        :
+          writer_(&writer),
+          slot_(slot)
+      {
+      }
+      void Output::append(const char *begin, const char *end)
+      {
+        if (out_) {
+          tmpl::detail::append_escaped(*out_, begin, end, slot_);
+          return;
+        }
+        auto e = slot_ == tmpl::detail::Slot::ATTRIBUTE
+          ? xxxml::detail::Escape::ATTRIBUTE : xxxml::detail::Escape::TEXT;
+        auto r = [this](const char *first, const char *last) {
+          raw(first, last);
+          return true; };
+        auto special = [this](char c) {
+          const char *x = xxxml::detail::escape(c);
+          raw(x, x + strlen(x));
+          return true; };
+        // non-ASCII bytes are copied, as with tmpl
+        for (const char *p = begin; ; ++p) {
+          p = xxxml::detail::escape_runs(p, end, e, r, special);
+          if (p == end)
+            return;
+          raw(*p);
+        }
+      }
+      void Output::append(const char *s)
+      {
+        append(s, s + strlen(s));
+      }
+      void Output::raw(const char *begin, const char *end)
+      {
+        if (out_)
+          out_->append(begin, end);
+        else
+          text_writer::write_raw(*writer_, begin, end);
+      }
+      void Output::raw(const char *s)
+      {
+        raw(s, s + strlen(s));
+      }
+      void Output::raw(const std::string &s)
+      {
+        raw(s.data(), s.data() + s.size());
+      }
+      void Output::raw(char c)
+      {
+        raw(&c, &c + 1);
+      }
+      Output Output::with(tmpl::detail::Slot slot) const
+      {
+        Output o(*this);
+        o.slot_ = slot;
+        return o;
+      }
+
+      namespace detail {
+
+        static bool is_space(char c)
+        {
+          return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+        }
+
+        // the number ends at the first trailing space
+        static void check_end(const char *p, const char *end,
+            const char *begin, const char *what)
+        {
+          if (p == begin)
+            throw Runtime_Error(string("invalid ") + what);
+          for (; p != end; ++p)
+            if (!is_space(*p))
+              throw Runtime_Error(string("invalid ") + what);
+        }
+
+        long long parse_signed(const char *begin, const char *end,
+            long long min, long long max)
+        {
+          while (begin != end && is_space(*begin))
+            ++begin;
+          char *p;
+          errno = 0;
+          long long v = strtoll(begin, &p, 10);
+          check_end(p, end, begin, "integer");
+          if (errno == ERANGE || v < min || v > max)
+            throw Runtime_Error("integer out of range");
+          return v;
+        }
+        unsigned long long parse_unsigned(const char *begin,
+            const char *end, unsigned long long max)
+        {
+          while (begin != end && is_space(*begin))
+            ++begin;
+          // strtoull() accepts negative numbers
+          if (begin != end && *begin == '-')
+            throw Runtime_Error("integer out of range");
+          char *p;
+          errno = 0;
+          unsigned long long v = strtoull(begin, &p, 10);
+          check_end(p, end, begin, "integer");
+          if (errno == ERANGE || v > max)
+            throw Runtime_Error("integer out of range");
+          return v;
+        }
+        double parse_double(const char *begin, const char *end)
+        {
+          while (begin != end && is_space(*begin))
+            ++begin;
+          size_t n = end - begin;
+          while (n && is_space(begin[n - 1]))
+            --n;
+          // strtod() also accepts e.g. inf, nan(...) and hex numbers
+          if ((n == 3 && !memcmp(begin, "INF", 3))
+              || (n == 4 && !memcmp(begin, "+INF", 4)))
+            return HUGE_VAL;
+          if (n == 4 && !memcmp(begin, "-INF", 4))
+            return -HUGE_VAL;
+          if (n == 3 && !memcmp(begin, "NaN", 3))
+            return NAN;
+          for (const char *p = begin; p != begin + n; ++p)
+            if (!((*p >= '0' && *p <= '9') || *p == '.' || *p == '-'
+                  || *p == '+' || *p == 'e' || *p == 'E'))
+              throw Runtime_Error("invalid number");
+          char *p;
+          double v = strtod(begin, &p);
+          check_end(p, end, begin, "number");
+          return v;
+        }
+        bool parse_bool(const char *begin, const char *end)
+        {
+          while (begin != end && is_space(*begin))
+            ++begin;
+          while (begin != end && is_space(end[-1]))
+            --end;
+          size_t n = end - begin;
+          if ((n == 4 && !memcmp(begin, "true", 4))
+              || (n == 1 && *begin == '1'))
+            return true;
+          if ((n == 5 && !memcmp(begin, "false", 5))
+              || (n == 1 && *begin == '0'))
+            return false;
+          throw Runtime_Error("invalid boolean");
+        }
+
+        void format_double(double v, bool single, Output &o)
+        {
+          if (isnan(v)) {
+            o.append("NaN");
+            return;
+          }
+          if (isinf(v)) {
+            o.append(v < 0 ? "-INF" : "INF");
+            return;
+          }
+          char buf[32];
+          snprintf(buf, sizeof buf, "%.*g", single ? 6 : 15, v);
+          if (single ? strtof(buf, nullptr) != float(v)
+              : strtod(buf, nullptr) != v)
+            snprintf(buf, sizeof buf, "%.*g", single ? 9 : 17, v);
+          o.append(buf);
+        }
+
+        using dispatch::Name_Table;
+
+        struct Tree::Node {
+          string name;
+          // element fields/child elements in order of appearance
+          vector<size_t> children;
+          vector<string> child_names;
+          Name_Table child_table;
+          // indices into fields_
+          vector<size_t> attributes;
+          vector<string> attribute_names;
+          Name_Table attribute_table;
+          const Field *field {nullptr};
+          // pre-rendered markup, i.e. "<name", " attr=\"" and "</name>"
+          string start_tag;
+          vector<string> attribute_starts;
+          string end_tag;
+        };
+
+        static bool valid_name(const string &s)
+        {
+          return !s.empty() && s.find_first_of(" <>&\"'=/\t\r\n")
+            == string::npos;
+        }
+
+        static vector<string> split(const string &path)
+        {
+          vector<string> r;
+          size_t i = 0;
+          for (;;) {
+            size_t j = path.find('/', i);
+            r.push_back(path.substr(i, j - i));
+            if (!valid_name(r.back()))
+              throw Logic_Error("invalid binding path: " + path);
+            if (j == string::npos)
+              return r;
+            i = j + 1;
+          }
+        }
+
+        Tree::Tree(const char *name, std::vector<Field> fields)
+          :
+            name_(name),
+            fields_(std::move(fields))
+        {
+          if (!valid_name(name_))
+            throw Logic_Error("invalid record name: " + name_);
+          nodes_.emplace_back(new Node());
+          nodes_[0]->name = name_;
+          for (auto &f : fields_) {
+            auto names = split(f.path);
+            string last = names.back();
+            if (f.attribute)
+              names.pop_back();
+            size_t n = 0;
+            for (auto &x : names) {
+              if (nodes_[n]->field)
+                throw Logic_Error("element is bound to a field: "
+                    + f.path);
+              n = add(n, x);
+            }
+            Node &node = *nodes_[n];
+            if (f.attribute) {
+              for (auto &x : node.attribute_names)
+                if (x == last)
+                  throw Logic_Error("attribute is bound twice: " + f.path);
+              node.attributes.push_back(&f - fields_.data());
+              node.attribute_names.push_back(last);
+            } else {
+              if (node.field || !node.children.empty())
+                throw Logic_Error("element is bound twice: " + f.path);
+              node.field = &f;
+            }
+          }
+          for (auto &node : nodes_) {
+            if (node->field && node->field->accessor->repeated()
+                && !node->attributes.empty())
+              throw Logic_Error("attributes of repeated elements aren't"
+                  " supported: " + node->field->path);
+            node->child_table = Name_Table(node->child_names);
+            node->attribute_table = Name_Table(node->attribute_names);
+            node->start_tag = "<" + node->name;
+            for (auto &x : node->attribute_names)
+              node->attribute_starts.push_back(" " + x + "=\"");
+            node->end_tag = "</" + node->name + ">";
+          }
+        }
+        Tree::~Tree() =default;
+
+        size_t Tree::add(size_t parent, const string &name)
+        {
+          Node &p = *nodes_[parent];
+          for (size_t i = 0; i < p.child_names.size(); ++i)
+            if (p.child_names[i] == name)
+              return p.children[i];
+          nodes_.emplace_back(new Node());
+          nodes_.back()->name = name;
+          // p is still valid since the nodes are stored by pointer
+          p.children.push_back(nodes_.size() - 1);
+          p.child_names.push_back(name);
+          return nodes_.size() - 1;
+        }
+
+        const char *Tree::name() const
+        {
+          return name_.c_str();
+        }
+
+        bool Tree::next(text_reader::Ptr &reader, void *s) const
+        {
+          for (;;) {
+            if (!text_reader::read(reader))
+              return false;
+            if (text_reader::node_type(reader) == XML_READER_TYPE_ELEMENT
+                && !strcmp(text_reader::const_local_name(reader),
+                  name_.c_str()))
+              break;
+          }
+          for (auto &f : fields_)
+            f.accessor->reset(s);
+          read_node(reader, 0, s);
+          return true;
+        }
+
+        void Tree::parse(const Field &f, void *s, const char *begin,
+            const char *end) const
+        {
+          try {
+            f.accessor->parse(s, begin, end);
+          } catch (const Runtime_Error &e) {
+            throw Runtime_Error(name_ + "/" + f.path + ": " + e.what());
+          }
+        }
+
+        void Tree::read_node(text_reader::Ptr &reader, size_t n,
+            void *s) const
+        {
+          const Node &node = *nodes_[n];
+          if (!node.attributes.empty()
+              && text_reader::has_attributes(reader)) {
+            for (bool ok = text_reader::move_to_first_attribute(reader); ok;
+                ok = text_reader::move_to_next_attribute(reader)) {
+              if (text_reader::is_namespace_decl(reader))
+                continue;
+              int i = node.attribute_table.find(
+                  text_reader::const_local_name(reader));
+              if (i == -1)
+                continue;
+              const char *v = text_reader::const_value(reader);
+              parse(fields_[node.attributes[i]], s, v, v + strlen(v));
+            }
+            text_reader::move_to_element(reader);
+          }
+          if (node.field) {
+            node.field->accessor->start(s);
+            read_text(reader, *node.field, s);
+            return;
+          }
+          if (text_reader::is_empty_element(reader))
+            return;
+          for (bool ok = text_reader::read(reader); ok; ) {
+            int t = text_reader::node_type(reader);
+            if (t == XML_READER_TYPE_END_ELEMENT)
+              return;
+            if (t != XML_READER_TYPE_ELEMENT) {
+              ok = text_reader::read(reader);
+              continue;
+            }
+            int i = node.child_table.find(
+                text_reader::const_local_name(reader));
+            if (i == -1) {
+              // skips the subtree
+              ok = text_reader::next(reader);
+              continue;
+            }
+            read_node(reader, node.children[i], s);
+            ok = text_reader::read(reader);
+          }
+          throw Runtime_Error("unexpected end of input in " + name_);
+        }
+
+        void Tree::read_text(text_reader::Ptr &reader, const Field &f,
+            void *s) const
+        {
+          bool chunked = f.accessor->chunked();
+          // enough for numbers, incl. some whitespace
+          char buf[128];
+          size_t k = 0;
+          // i.e. whitespace after a buffered part
+          bool space = false;
+          if (!text_reader::is_empty_element(reader)) {
+            bool ok = text_reader::read(reader);
+            for (; ok; ) {
+              int t = text_reader::node_type(reader);
+              if (t == XML_READER_TYPE_END_ELEMENT)
+                break;
+              if (t == XML_READER_TYPE_ELEMENT) {
+                // mixed content
+                ok = text_reader::next(reader);
+                continue;
+              }
+              if (t == XML_READER_TYPE_TEXT || t == XML_READER_TYPE_CDATA
+                  || t == XML_READER_TYPE_SIGNIFICANT_WHITESPACE
+                  || t == XML_READER_TYPE_WHITESPACE) {
+                const char *v = text_reader::const_value(reader);
+                size_t n = strlen(v);
+                if (chunked) {
+                  parse(f, s, v, v + n);
+                } else {
+                  // surrounding whitespace doesn't count against the
+                  // buffer, inner whitespace is kept as one space
+                  const char *e = v + n;
+                  if (k && v != e && is_space(*v))
+                    space = true;
+                  while (v != e && is_space(*v))
+                    ++v;
+                  bool trailing = false;
+                  while (v != e && is_space(e[-1])) {
+                    trailing = true;
+                    --e;
+                  }
+                  if (v != e) {
+                    n = e - v + (space ? 1 : 0);
+                    if (k + n >= sizeof buf)
+                      throw Runtime_Error(name_ + "/" + f.path
+                          + ": value too long");
+                    if (space)
+                      buf[k++] = ' ';
+                    memcpy(buf + k, v, e - v);
+                    k += e - v;
+                    space = trailing;
+                  }
+                }
+              }
+              ok = text_reader::read(reader);
+            }
+            if (!ok)
+              throw Runtime_Error("unexpected end of input in " + name_);
+          }
+          if (!chunked) {
+            buf[k] = 0;
+            parse(f, s, buf, buf + k);
+          }
+        }
+
+        void Tree::append(Output &out, const void *s) const
+        {
+          append_node(out, 0, s);
+        }
+
+        void Tree::append_node(Output &out, size_t n, const void *s) const
+        {
+          const Node &node = *nodes_[n];
+          if (node.field && node.field->accessor->repeated()) {
+            size_t k = node.field->accessor->size(s);
+            Output o = out.with(tmpl::detail::Slot::TEXT);
+            for (size_t i = 0; i < k; ++i) {
+              out.raw(node.start_tag);
+              out.raw('>');
+              node.field->accessor->format(s, i, o);
+              out.raw(node.end_tag);
+            }
+            return;
+          }
+          out.raw(node.start_tag);
+          Output a = out.with(tmpl::detail::Slot::ATTRIBUTE);
+          for (size_t i = 0; i < node.attributes.size(); ++i) {
+            out.raw(node.attribute_starts[i]);
+            fields_[node.attributes[i]].accessor->format(s, 0, a);
+            out.raw('"');
+          }
+          if (node.field) {
+            out.raw('>');
+            Output o = out.with(tmpl::detail::Slot::TEXT);
+            node.field->accessor->format(s, 0, o);
+          } else if (node.children.empty()) {
+            out.raw("/>");
+            return;
+          } else {
+            out.raw('>');
+            for (size_t c : node.children)
+              append_node(out, c, s);
+          }
+          out.raw(node.end_tag);
+        }
+
+      }
+
+    }
+
+  }
+
+}
@@ -0,0 +1,387 @@
+#ifndef XXXML_BIND_HH
+#define XXXML_BIND_HH
+
+#include <xxxml/xxxml.hh>
+#include <xxxml/template.hh>
+
+#include <initializer_list>
+#include <limits>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Declarative mapping between structs and XML records, i.e. without
+// hand-written reader loops and writer call sequences.
+//
+// A Binding describes the record element and where each field is
+// stored, by a path relative to the record element. Deserialization
+// streams over a text reader and converts the values directly from
+// the reader's buffers into the fields, i.e. without a DOM. The
+// element and attribute names are dispatched with perfect hash
+// tables (cf. dispatch::Name_Table). Unbound elements are skipped,
+// i.e. also their subtrees.
+//
+// Serialization writes the markup and the escaped values of a record
+// directly through the writer (via xmlTextWriterWriteRawLen(), as
+// text_writer::write_raw() does), i.e. without an intermediate string,
+// and it can be mixed with the text_writer functions.
+//
+// Names are matched by local name, namespaces are ignored.
+//
+// Example:
+//
+//     struct Rec {
+//       long id;
+//       std::string name;
+//       double amount;
+//       std::string currency;
+//       std::vector<std::string> tags;
+//     };
+//     namespace bind = xxxml::util::bind;
+//     const bind::Binding<Rec> b("rec", {
+//         bind::attribute("id", &Rec::id),
+//         bind::element("name", &Rec::name),
+//         bind::element("amount", &Rec::amount),
+//         bind::attribute("amount/currency", &Rec::currency),
+//         bind::element("tags/tag", &Rec::tags) });
+//
+//     // <rec id="1"><name>x</name><amount currency="EUR">1.5</amount>
+//     //   <tags><tag>a</tag><tag>b</tag></tags></rec>
+//     Rec r;
+//     auto reader = text_reader::for_file("in.xml");
+//     while (b.next(reader, r)) {
+//       ...
+//     }
+//     b.write(writer, r);
+namespace xxxml {
+
+  namespace util {
+
+    namespace bind {
+
+      // Appends to a string or writes to a text writer. append()
+      // escapes the value for its context, raw() doesn't.
+      class Output {
+        public:
+          Output(std::string &out, tmpl::detail::Slot slot);
+          Output(text_writer::Ptr &writer, tmpl::detail::Slot slot);
+          void append(const char *begin, const char *end);
+          void append(const char *s);
+          void raw(const char *begin, const char *end);
+          void raw(const char *s);
+          void raw(const std::string &s);
+          void raw(char c);
+          // the same target, for another context
+          Output with(tmpl::detail::Slot slot) const;
+        private:
+          std::string *out_ {nullptr};
+          text_writer::Ptr *writer_ {nullptr};
+          tmpl::detail::Slot slot_;
+      };
+
+      namespace detail {
+
+        long long parse_signed(const char *begin, const char *end,
+            long long min, long long max);
+        unsigned long long parse_unsigned(const char *begin,
+            const char *end, unsigned long long max);
+        double parse_double(const char *begin, const char *end);
+        bool parse_bool(const char *begin, const char *end);
+        // shortest of 15/17 (6/9 for float) significant digits that
+        // round-trips, NaN and infinity as in xs:double
+        void format_double(double v, bool single, Output &o);
+
+      }
+
+      // Converts between a field type and its text. Specialize it for
+      // further types.
+      //
+      // parse() gets the value including surrounding whitespace and
+      // NUL-terminated - except for chunked types, where parse() is
+      // called (without terminator) for each piece of the text content,
+      // e.g. when it's interrupted by a comment or CDATA section
+      template <typename T, typename = void> struct Converter;
+
+      template <typename T> struct Converter<T, typename std::enable_if<
+        std::is_integral<T>::value && !std::is_same<T, bool>::value>::type> {
+        static const bool chunked = false;
+        static void parse(const char *begin, const char *end, T &v)
+        {
+          if (std::is_signed<T>::value)
+            v = T(detail::parse_signed(begin, end,
+                  (long long)std::numeric_limits<T>::min(),
+                  (long long)std::numeric_limits<T>::max()));
+          else
+            v = T(detail::parse_unsigned(begin, end,
+                  std::numeric_limits<T>::max()));
+        }
+        static void format(const T &v, Output &o)
+        {
+          tmpl::Value x(v);
+          o.append(x.begin(), x.end());
+        }
+      };
+      template <typename T> struct Converter<T, typename std::enable_if<
+        std::is_floating_point<T>::value>::type> {
+        static const bool chunked = false;
+        static void parse(const char *begin, const char *end, T &v)
+        {
+          v = T(detail::parse_double(begin, end));
+        }
+        static void format(const T &v, Output &o)
+        {
+          detail::format_double(v, std::is_same<T, float>::value, o);
+        }
+      };
+      // xs:boolean, i.e. true, false, 1 or 0
+      template <> struct Converter<bool> {
+        static const bool chunked = false;
+        static void parse(const char *begin, const char *end, bool &v)
+        {
+          v = detail::parse_bool(begin, end);
+        }
+        static void format(const bool &v, Output &o)
+        {
+          o.append(v ? "true" : "false");
+        }
+      };
+      template <> struct Converter<std::string> {
+        static const bool chunked = true;
+        static void parse(const char *begin, const char *end,
+            std::string &v)
+        {
+          v.append(begin, end);
+        }
+        static void format(const std::string &v, Output &o)
+        {
+          o.append(v.data(), v.data() + v.size());
+        }
+      };
+
+      namespace detail {
+
+        // type erased access to a field of a struct
+        struct Accessor {
+          virtual ~Accessor() = default;
+          // before a record is read
+          virtual void reset(void *s) const = 0;
+          // an occurrence starts, i.e. repeated fields add an item
+          virtual void start(void *s) const = 0;
+          virtual bool chunked() const = 0;
+          virtual void parse(void *s, const char *begin,
+              const char *end) const = 0;
+          virtual bool repeated() const = 0;
+          virtual size_t size(const void *s) const = 0;
+          virtual void format(const void *s, size_t i,
+              Output &o) const = 0;
+        };
+
+        template <typename S, typename T> class Member : public Accessor {
+          public:
+            explicit Member(T S::*m) : m_(m) {}
+            void reset(void *s) const override
+            {
+              clear(static_cast<S*>(s)->*m_);
+            }
+            void start(void *s) const override
+            {
+              if (Converter<T>::chunked)
+                clear(static_cast<S*>(s)->*m_);
+            }
+            bool chunked() const override
+            {
+              return Converter<T>::chunked;
+            }
+            void parse(void *s, const char *begin,
+                const char *end) const override
+            {
+              Converter<T>::parse(begin, end, static_cast<S*>(s)->*m_);
+            }
+            bool repeated() const override
+            {
+              return false;
+            }
+            size_t size(const void *) const override
+            {
+              return 1;
+            }
+            void format(const void *s, size_t, Output &o) const override
+            {
+              Converter<T>::format(static_cast<const S*>(s)->*m_, o);
+            }
+          private:
+            T S::*m_;
+
+            // keeps the capacity of strings
+            static void clear(std::string &v) { v.clear(); }
+            template <typename U> static void clear(U &v) { v = U(); }
+        };
+
+        template <typename S, typename T> class Repeated : public Accessor {
+          public:
+            explicit Repeated(std::vector<T> S::*m) : m_(m) {}
+            void reset(void *s) const override
+            {
+              (static_cast<S*>(s)->*m_).clear();
+            }
+            void start(void *s) const override
+            {
+              (static_cast<S*>(s)->*m_).emplace_back();
+            }
+            bool chunked() const override
+            {
+              return Converter<T>::chunked;
+            }
+            void parse(void *s, const char *begin,
+                const char *end) const override
+            {
+              Converter<T>::parse(begin, end,
+                  (static_cast<S*>(s)->*m_).back());
+            }
+            bool repeated() const override
+            {
+              return true;
+            }
+            size_t size(const void *s) const override
+            {
+              return (static_cast<const S*>(s)->*m_).size();
+            }
+            void format(const void *s, size_t i, Output &o) const override
+            {
+              Converter<T>::format((static_cast<const S*>(s)->*m_)[i], o);
+            }
+          private:
+            std::vector<T> S::*m_;
+        };
+
+        struct Field {
+          std::string path;
+          bool attribute;
+          std::shared_ptr<const Accessor> accessor;
+        };
+
+        // the untyped part of a Binding
+        class Tree {
+          public:
+            Tree(const char *name, std::vector<Field> fields);
+            ~Tree();
+            Tree(const Tree &) = delete;
+            Tree &operator=(const Tree &) = delete;
+
+            bool next(text_reader::Ptr &reader, void *s) const;
+            void append(Output &out, const void *s) const;
+            const char *name() const;
+          private:
+            struct Node;
+
+            std::string name_;
+            std::vector<Field> fields_;
+            std::vector<std::unique_ptr<Node> > nodes_;
+
+            size_t add(size_t parent, const std::string &name);
+            void read_node(text_reader::Ptr &reader, size_t n,
+                void *s) const;
+            void read_text(text_reader::Ptr &reader, const Field &f,
+                void *s) const;
+            void parse(const Field &f, void *s, const char *begin,
+                const char *end) const;
+            void append_node(Output &out, size_t n,
+                const void *s) const;
+        };
+
+      }
+
+      template <typename S> struct Field {
+        detail::Field field;
+      };
+
+      // path: the element names, separated by '/', of the element
+      // that contains the value - relative to the record element
+      template <typename S, typename T>
+        Field<S> element(const char *path, T S::*m)
+        {
+          return Field<S> { detail::Field { path, false,
+            std::make_shared<detail::Member<S, T> >(m) } };
+        }
+      // a repeated element, e.g. "tags/tag"
+      template <typename S, typename T>
+        Field<S> element(const char *path, std::vector<T> S::*m)
+        {
+          return Field<S> { detail::Field { path, false,
+            std::make_shared<detail::Repeated<S, T> >(m) } };
+        }
+      // path: the attribute name, optionally prefixed with the path
+      // of its element, e.g. "amount/currency"
+      template <typename S, typename T>
+        Field<S> attribute(const char *path, T S::*m)
+        {
+          return Field<S> { detail::Field { path, true,
+            std::make_shared<detail::Member<S, T> >(m) } };
+        }
+
+      // Serialization writes the fields grouped by element, in the
+      // order of their first mention, and the attributes of an element
+      // in declaration order.
+      //
+      // Throws Logic_Error on invalid names or conflicting paths,
+      // e.g. an element that is bound to a field and contains bound
+      // elements, too.
+      template <typename S> class Binding {
+        public:
+          // name: of the record element
+          Binding(const char *name, std::initializer_list<Field<S> > fields)
+            : tree_(name, unpack(fields))
+          {
+          }
+
+          // Reads up to the next record element, resets all fields and
+          // deserializes the record. Returns false at the end of the
+          // input. Afterwards, the reader is positioned at the end of
+          // the record.
+          //
+          // Fields of elements/attributes that are missing keep their
+          // default value, repeated fields are cleared. Conversion
+          // errors throw Runtime_Error - as do values of non-string
+          // fields that are longer than 127 bytes, not counting
+          // surrounding whitespace.
+          bool next(text_reader::Ptr &reader, S &s) const
+          {
+            return tree_.next(reader, &s);
+          }
+          void write(text_writer::Ptr &writer, const S &s) const
+          {
+            Output o(writer, tmpl::detail::Slot::NONE);
+            tree_.append(o, &s);
+          }
+          // appends the serialized record
+          void append(std::string &out, const S &s) const
+          {
+            Output o(out, tmpl::detail::Slot::NONE);
+            tree_.append(o, &s);
+          }
+          const char *name() const
+          {
+            return tree_.name();
+          }
+        private:
+          detail::Tree tree_;
+
+          static std::vector<detail::Field> unpack(
+              std::initializer_list<Field<S> > fields)
+          {
+            std::vector<detail::Field> r;
+            r.reserve(fields.size());
+            for (auto &f : fields)
+              r.push_back(f.field);
+            return r;
+          }
+      };
+
+    }
+
+  }
+
+}
+
+#endif
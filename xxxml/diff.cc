@@ -0,0 +1,602 @@
+#include "diff.hh"
+
+#include <xxxml/util.hh>
+
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace std;
+
+namespace xxxml {
+
+  namespace util {
+
+    namespace diff {
+
+      static bool equal(const xmlChar *a, const xmlChar *b)
+      {
+        if (a == b)
+          return true;
+        if (!a || !b)
+          return false;
+        return !xmlStrcmp(a, b);
+      }
+      static const xmlChar *ns_href(const xmlNs *ns)
+      {
+        return ns ? ns->href : nullptr;
+      }
+      static string str(const xmlChar *s)
+      {
+        return s ? string(reinterpret_cast<const char*>(s)) : string();
+      }
+      static string attr_value(const xmlAttr *a)
+      {
+        string r;
+        for (auto t = a->children; t; t = t->next)
+          if (t->content)
+            r += reinterpret_cast<const char*>(t->content);
+        return r;
+      }
+
+      // i.e. whether the node can be edited in place
+      static bool similar(const xmlNode *a, const xmlNode *b)
+      {
+        if (a->type != b->type)
+          return false;
+        switch (a->type) {
+          case XML_ELEMENT_NODE:
+            return equal(a->name, b->name)
+              && equal(ns_href(a->ns), ns_href(b->ns));
+          case XML_TEXT_NODE:
+          case XML_CDATA_SECTION_NODE:
+          case XML_COMMENT_NODE:
+            return true;
+          default:
+            return false;
+        }
+      }
+
+      // DP table size limit for the LCS - larger child lists
+      // are aligned greedily
+      static const size_t LCS_LIMIT = size_t(1) << 22;
+
+      // returns the index pairs of the longest common subsequence
+      static vector<pair<size_t, size_t>> lcs(const hash::Value *a, size_t n,
+          const hash::Value *b, size_t m)
+      {
+        vector<pair<size_t, size_t>> r;
+        if (!n || !m)
+          return r;
+        if (n * m > LCS_LIMIT) {
+          // greedy: match each a with the next equal b
+          size_t j = 0;
+          for (size_t i = 0; i < n && j < m; ++i) {
+            auto k = find(b + j, b + m, a[i]);
+            if (k != b + m) {
+              r.emplace_back(i, k - b);
+              j = k - b + 1;
+            }
+          }
+          return r;
+        }
+        // t[i][j]: LCS length of a[i..n) and b[j..m)
+        vector<uint32_t> t((n + 1) * (m + 1));
+        auto at = [&t, m](size_t i, size_t j) -> uint32_t& {
+          return t[i * (m + 1) + j]; };
+        for (size_t i = n; i-- > 0; )
+          for (size_t j = m; j-- > 0; )
+            at(i, j) = a[i] == b[j] ? at(i + 1, j + 1) + 1
+              : max(at(i + 1, j), at(i, j + 1));
+        for (size_t i = 0, j = 0; i < n && j < m; ) {
+          if (a[i] == b[j]) {
+            r.emplace_back(i, j);
+            ++i;
+            ++j;
+          } else if (at(i + 1, j) >= at(i, j + 1)) {
+            ++i;
+          } else {
+            ++j;
+          }
+        }
+        return r;
+      }
+
+      namespace {
+
+        class Differ {
+          private:
+            const hash::Map &ha_;
+            const hash::Map &hb_;
+            Script &script_;
+            vector<size_t> path_;
+            Serializer serializer_;
+
+            static hash::Value lookup(const hash::Map &m, const xmlNode *x)
+            {
+              if (x->type == XML_ELEMENT_NODE) {
+                auto i = m.find(x);
+                if (i != m.end())
+                  return i->second;
+              }
+              return hash::subtree(x);
+            }
+
+            void emit(Op op, const xmlNode *b)
+            {
+              Edit e;
+              e.op = op;
+              e.path = path_;
+              e.type = b->type;
+              switch (b->type) {
+                case XML_ELEMENT_NODE:
+                  {
+                    // the copy gets all the namespace declarations it
+                    // needs, thus, it can be parsed on its own
+                    doc::Ptr t = new_doc();
+                    Node_Ptr c = doc::copy_node(const_cast<xmlNode*>(b), t, 1);
+                    doc::set_root_element(t, c.get());
+                    c.release();
+                    auto r = serializer_.dump(t, doc::get_root_element(t),
+                        false);
+                    e.value.assign(r.first, r.second);
+                  }
+                  break;
+                case XML_PI_NODE:
+                  e.name = str(b->name);
+                  e.value = str(b->content);
+                  break;
+                case XML_ENTITY_REF_NODE:
+                  // the replacement text comes from the target's DTD
+                  e.name = str(b->name);
+                  break;
+                case XML_TEXT_NODE:
+                case XML_CDATA_SECTION_NODE:
+                case XML_COMMENT_NODE:
+                  e.value = str(b->content);
+                  break;
+                default:
+                  throw Logic_Error("diff: unsupported node type");
+              }
+              script_.push_back(std::move(e));
+            }
+            void remove(size_t cur)
+            {
+              Edit e;
+              e.op = Op::DELETE;
+              e.path = path_;
+              if (cur != size_t(-1))
+                e.path.push_back(cur);
+              script_.push_back(std::move(e));
+            }
+            void emit_attribute(Op op, const xmlAttr *a)
+            {
+              Edit e;
+              e.op = op;
+              e.path = path_;
+              e.name = str(a->name);
+              if (a->ns) {
+                e.ns_href = str(a->ns->href);
+                e.ns_prefix = str(a->ns->prefix);
+              }
+              if (op == Op::SET_ATTRIBUTE)
+                e.value = attr_value(a);
+              script_.push_back(std::move(e));
+            }
+
+            void attributes(const xmlNode *a, const xmlNode *b)
+            {
+              for (auto x = a->properties; x; x = x->next) {
+                auto y = b->properties;
+                for (; y; y = y->next)
+                  if (equal(x->name, y->name)
+                      && equal(ns_href(x->ns), ns_href(y->ns)))
+                    break;
+                if (!y)
+                  emit_attribute(Op::REMOVE_ATTRIBUTE, x);
+              }
+              for (auto y = b->properties; y; y = y->next) {
+                auto x = a->properties;
+                for (; x; x = x->next)
+                  if (equal(x->name, y->name)
+                      && equal(ns_href(x->ns), ns_href(y->ns)))
+                    break;
+                if (!x || attr_value(x) != attr_value(y))
+                  emit_attribute(Op::SET_ATTRIBUTE, y);
+              }
+            }
+
+            void children(const xmlNode *a, const xmlNode *b)
+            {
+              vector<const xmlNode*> as, bs;
+              vector<hash::Value> ah, bh;
+              for (auto x = a->children; x; x = x->next) {
+                as.push_back(x);
+                ah.push_back(lookup(ha_, x));
+              }
+              for (auto x = b->children; x; x = x->next) {
+                bs.push_back(x);
+                bh.push_back(lookup(hb_, x));
+              }
+              size_t n = as.size(), m = bs.size();
+              size_t p = 0;
+              while (p < n && p < m && ah[p] == bh[p])
+                ++p;
+              size_t q = 0;
+              while (q < n - p && q < m - p
+                  && ah[n - 1 - q] == bh[m - 1 - q])
+                ++q;
+              auto matches = lcs(ah.data() + p, n - p - q,
+                  bh.data() + p, m - p - q);
+              matches.emplace_back(n - p - q, m - p - q);
+
+              // index into the child list as it is while the script
+              // is applied
+              size_t cur = p;
+              size_t i = p, j = p;
+              for (auto &k : matches) {
+                size_t ie = p + k.first, je = p + k.second;
+                gap(as, i, ie, bs, j, je, cur);
+                i = ie + 1;
+                j = je + 1;
+                ++cur;
+              }
+            }
+
+            void gap(const vector<const xmlNode*> &as, size_t i, size_t ie,
+                const vector<const xmlNode*> &bs, size_t j, size_t je,
+                size_t &cur)
+            {
+              while (i < ie && j < je) {
+                if (similar(as[i], bs[j])) {
+                  path_.push_back(cur);
+                  node(as[i], bs[j]);
+                  path_.pop_back();
+                  ++i;
+                  ++j;
+                  ++cur;
+                } else if (any_of(bs.begin() + j + 1, bs.begin() + je,
+                      [&as, i](const xmlNode *x) { return similar(as[i], x); })) {
+                  path_.push_back(cur);
+                  emit(Op::INSERT, bs[j]);
+                  path_.pop_back();
+                  ++j;
+                  ++cur;
+                } else {
+                  remove(cur);
+                  ++i;
+                }
+              }
+              for (; i < ie; ++i)
+                remove(cur);
+              for (; j < je; ++j) {
+                path_.push_back(cur);
+                emit(Op::INSERT, bs[j]);
+                path_.pop_back();
+                ++cur;
+              }
+            }
+
+          public:
+            Differ(const hash::Map &ha, const hash::Map &hb, Script &script)
+              : ha_(ha), hb_(hb), script_(script)
+            {
+            }
+
+            // a and b are similar, path_ points to a
+            void node(const xmlNode *a, const xmlNode *b)
+            {
+              if (lookup(ha_, a) == lookup(hb_, b))
+                return;
+              switch (a->type) {
+                case XML_ELEMENT_NODE:
+                  attributes(a, b);
+                  children(a, b);
+                  break;
+                case XML_TEXT_NODE:
+                case XML_CDATA_SECTION_NODE:
+                case XML_COMMENT_NODE:
+                  {
+                    Edit e;
+                    e.op = Op::SET_CONTENT;
+                    e.path = path_;
+                    e.value = str(b->content);
+                    script_.push_back(std::move(e));
+                  }
+                  break;
+                default:
+                  emit(Op::REPLACE, b);
+              }
+            }
+            void root(const xmlNode *a, const xmlNode *b)
+            {
+              if (a && b) {
+                if (similar(a, b))
+                  node(a, b);
+                else
+                  emit(Op::REPLACE, b);
+              } else if (a) {
+                remove(size_t(-1));
+              } else if (b) {
+                emit(Op::REPLACE, b);
+              }
+            }
+        };
+
+      }
+
+      Script compute(const doc::Ptr &a, const doc::Ptr &b,
+          const hash::Map &ha, const hash::Map &hb)
+      {
+        Script r;
+        Differ d(ha, hb, r);
+        d.root(xmlDocGetRootElement(a.get()), xmlDocGetRootElement(b.get()));
+        return r;
+      }
+      Script compute(const doc::Ptr &a, const doc::Ptr &b)
+      {
+        return compute(a, b, hash::subtrees(a), hash::subtrees(b));
+      }
+
+      static xmlNode *locate(doc::Ptr &doc, const vector<size_t> &path,
+          size_t n)
+      {
+        xmlNode *x = xmlDocGetRootElement(doc.get());
+        if (!x)
+          throw Runtime_Error("patch: document has no root");
+        for (size_t i = 0; i < n; ++i) {
+          x = x->children;
+          for (size_t k = path[i]; x && k; --k)
+            x = x->next;
+          if (!x)
+            throw Runtime_Error("patch: path doesn't exist");
+        }
+        return x;
+      }
+
+      // The subtree may contain entity references, thus, it's parsed
+      // after the document's internal subset, which declares them.
+      static Node_Ptr create_element(doc::Ptr &doc, const string &s)
+      {
+        const xmlNode *dtd = reinterpret_cast<const xmlNode*>(
+            doc->intSubset);
+        if (!dtd)
+          return create_node(doc, s.data(), s.data() + s.size());
+        Serializer t;
+        t.append(doc, dtd, false);
+        t.append(s.data(), s.data() + s.size());
+        auto r = t.content();
+        return create_node(doc, r.first, r.second);
+      }
+
+      static Node_Ptr create(doc::Ptr &doc, const Edit &e)
+      {
+        const char *begin = e.value.data();
+        const char *end = begin + e.value.size();
+        xmlNode *r = nullptr;
+        switch (e.type) {
+          case XML_ELEMENT_NODE:
+            return create_element(doc, e.value);
+          case XML_TEXT_NODE:
+            r = xmlNewDocTextLen(doc.get(),
+                reinterpret_cast<const xmlChar*>(begin), end - begin);
+            break;
+          case XML_CDATA_SECTION_NODE:
+            r = xmlNewCDataBlock(doc.get(),
+                reinterpret_cast<const xmlChar*>(begin), end - begin);
+            break;
+          case XML_COMMENT_NODE:
+            r = xmlNewDocComment(doc.get(),
+                reinterpret_cast<const xmlChar*>(e.value.c_str()));
+            break;
+          case XML_PI_NODE:
+            r = xmlNewDocPI(doc.get(),
+                reinterpret_cast<const xmlChar*>(e.name.c_str()),
+                reinterpret_cast<const xmlChar*>(e.value.c_str()));
+            break;
+          case XML_ENTITY_REF_NODE:
+            r = xmlNewReference(doc.get(),
+                reinterpret_cast<const xmlChar*>(e.name.c_str()));
+            break;
+          default:
+            throw Runtime_Error("patch: unsupported node type");
+        }
+        if (!r)
+          throw Runtime_Error("patch: could not create node");
+        return Node_Ptr(r, xmlFreeNode);
+      }
+
+      static xmlNs *lookup_ns(xmlNode *node, const Edit &e, bool create)
+      {
+        if (e.ns_href.empty())
+          return nullptr;
+        xmlNs *ns = search_ns_by_href(node, e.ns_href.c_str());
+        if (!ns && create)
+          ns = new_ns(node, e.ns_href.c_str(),
+              e.ns_prefix.empty() ? nullptr : e.ns_prefix.c_str());
+        if (!ns)
+          throw Runtime_Error("patch: namespace not in scope: " + e.ns_href);
+        return ns;
+      }
+
+      // xmlAddPrevSibling() etc. merge adjacent text nodes, but the
+      // paths of the following edits rely on the node being inserted as-is
+      // (a text node may be inserted next to one that is deleted later)
+      static void link(xmlNode *parent, xmlNode *ref, xmlNode *node)
+      {
+        node->parent = parent;
+        if (ref) {
+          node->next = ref;
+          node->prev = ref->prev;
+          if (ref->prev)
+            ref->prev->next = node;
+          else
+            parent->children = node;
+          ref->prev = node;
+        } else {
+          node->next = nullptr;
+          node->prev = parent->last;
+          if (parent->last)
+            parent->last->next = node;
+          else
+            parent->children = node;
+          parent->last = node;
+        }
+      }
+
+      static void apply(doc::Ptr &doc, const Edit &e)
+      {
+        switch (e.op) {
+          case Op::INSERT:
+            {
+              Node_Ptr x = create(doc, e);
+              if (e.path.empty()) {
+                if (has_root(doc))
+                  throw Runtime_Error("patch: document already has a root");
+                insert(doc, nullptr, x.get(), 0);
+              } else {
+                xmlNode *parent = locate(doc, e.path, e.path.size() - 1);
+                xmlNode *ref = parent->children;
+                for (size_t k = e.path.back(); ref && k; --k)
+                  ref = ref->next;
+                if (x->type == XML_ELEMENT_NODE) {
+                  if (ref)
+                    insert(doc, ref, x.get(), -2);
+                  else
+                    insert(doc, parent, x.get(), -1);
+                } else {
+                  link(parent, ref, x.get());
+                }
+              }
+              x.release();
+            }
+            break;
+          case Op::DELETE:
+            unlink_node(locate(doc, e.path, e.path.size()));
+            break;
+          case Op::REPLACE:
+            {
+              Node_Ptr x = create(doc, e);
+              if (e.path.empty() && !has_root(doc)) {
+                doc::set_root_element(doc, x.release());
+              } else {
+                xmlNode *old = locate(doc, e.path, e.path.size());
+                Node_Ptr o(xmlReplaceNode(old, x.get()), xmlFreeNode);
+                x.release();
+              }
+            }
+            break;
+          case Op::SET_ATTRIBUTE:
+            {
+              xmlNode *x = locate(doc, e.path, e.path.size());
+              if (e.ns_href.empty())
+                set_prop(x, e.name, e.value);
+              else
+                set_ns_prop(x, lookup_ns(x, e, true), e.name.c_str(),
+                    e.value.c_str());
+            }
+            break;
+          case Op::REMOVE_ATTRIBUTE:
+            {
+              xmlNode *x = locate(doc, e.path, e.path.size());
+              bool r = e.ns_href.empty() ? unset_prop(x, e.name.c_str())
+                : unset_ns_prop(x, lookup_ns(x, e, false), e.name.c_str());
+              if (!r)
+                throw Runtime_Error("patch: no such attribute: " + e.name);
+            }
+            break;
+          case Op::SET_CONTENT:
+            node_set_content(locate(doc, e.path, e.path.size()), e.value);
+            break;
+        }
+      }
+
+      void apply(doc::Ptr &doc, const Script &script)
+      {
+        for (auto &e : script)
+          apply(doc, e);
+      }
+
+      static const char *const op_names[] = {
+        "insert", "delete", "replace", "set-attribute", "remove-attribute",
+        "set-content"
+      };
+
+      doc::Ptr to_doc(const Script &script)
+      {
+        doc::Ptr d = new_doc();
+        xmlNode *root = new_doc_node(d, "patch");
+        doc::set_root_element(d, root);
+        for (auto &e : script) {
+          xmlNode *x = new_child(root, op_names[size_t(e.op)]);
+          string path;
+          for (auto i : e.path) {
+            if (!path.empty())
+              path += '/';
+            path += to_string(i);
+          }
+          new_prop(x, "path", path);
+          if (e.op == Op::INSERT || e.op == Op::REPLACE)
+            new_prop(x, "type", to_string(int(e.type)));
+          if (!e.name.empty())
+            new_prop(x, "name", e.name);
+          if (!e.ns_href.empty())
+            new_prop(x, "ns", e.ns_href);
+          if (!e.ns_prefix.empty())
+            new_prop(x, "prefix", e.ns_prefix);
+          node_add_content(x, e.value);
+        }
+        return d;
+      }
+
+      static string optional_prop(const xmlNode *x, const char *name)
+      {
+        if (!xmlHasProp(const_cast<xmlNode*>(x),
+              reinterpret_cast<const xmlChar*>(name)))
+          return string();
+        return string(get_prop(x, name).get());
+      }
+
+      Script from_doc(const doc::Ptr &doc)
+      {
+        Script r;
+        const xmlNode *root = doc::get_root_element(doc);
+        if (strcmp(name(root), "patch"))
+          throw Runtime_Error("patch: unexpected root: "
+              + string(name(root)));
+        for (auto x = first_element_child(root); x;
+            x = next_element_sibling(x)) {
+          Edit e;
+          auto op = find_if(begin(op_names), end(op_names),
+              [x](const char *s) { return !strcmp(s, name(x)); });
+          if (op == end(op_names))
+            throw Runtime_Error("patch: unknown operation: "
+                + string(name(x)));
+          e.op = Op(op - begin(op_names));
+          string path = optional_prop(x, "path");
+          for (const char *s = path.c_str(); *s; ) {
+            char *t = nullptr;
+            e.path.push_back(strtoul(s, &t, 10));
+            if (t == s || (*t && *t != '/'))
+              throw Runtime_Error("patch: invalid path: " + path);
+            s = *t ? t + 1 : t;
+          }
+          string type = optional_prop(x, "type");
+          if (!type.empty())
+            e.type = xmlElementType(atoi(type.c_str()));
+          e.name = optional_prop(x, "name");
+          e.ns_href = optional_prop(x, "ns");
+          e.ns_prefix = optional_prop(x, "prefix");
+          for (auto t = x->children; t; t = t->next)
+            if (t->content)
+              e.value += content(t);
+          r.push_back(std::move(e));
+        }
+        return r;
+      }
+
+    }
+
+  }
+
+}
@@ -0,0 +1,90 @@
+#ifndef XXXML_DIFF_HH
+#define XXXML_DIFF_HH
+
+#include <xxxml/xxxml.hh>
+#include <xxxml/hash.hh>
+
+#include <string>
+#include <vector>
+
+namespace xxxml {
+
+  namespace util {
+
+    // Structural diff between two documents that yields an edit script,
+    // and a patch function that replays such a script.
+    //
+    // Subtrees with equal structural hashes (cf. hash.hh) are skipped,
+    // thus, besides computing the hashes, the work is proportional to
+    // the size of the changes.
+    //
+    // Child lists are aligned via the longest common subsequence of the
+    // child hashes (after stripping the common prefix and suffix).
+    // Unaligned children of the same kind (e.g. elements with the same
+    // name) are edited in place, the remaining ones are deleted/inserted.
+    namespace diff {
+
+      enum class Op {
+        INSERT,
+        DELETE,
+        // replaces the node at path with the new node
+        REPLACE,
+        SET_ATTRIBUTE,
+        REMOVE_ATTRIBUTE,
+        // content of a text, CDATA or comment node
+        SET_CONTENT
+      };
+
+      // The path consists of child indices starting at the root element,
+      // counting all child nodes (i.e. also text nodes etc.).
+      // For example, {} denotes the root element and {0, 2} the 3rd child
+      // of the first child of the root.
+      //
+      // A path refers to the document state after all the previous
+      // edits of the script are applied. For INSERT it is the position
+      // the new node ends up at.
+      struct Edit {
+        Op op;
+        std::vector<size_t> path;
+        // INSERT/REPLACE: type of the new node, e.g. XML_ELEMENT_NODE,
+        // XML_TEXT_NODE, XML_COMMENT_NODE, XML_ENTITY_REF_NODE
+        xmlElementType type {XML_ELEMENT_NODE};
+        // attribute, PI or entity name - an entity reference is
+        // resolved against the DTD of the patched document
+        std::string name;
+        std::string ns_href;
+        std::string ns_prefix;
+        // attribute value, text/comment content, PI content or, for
+        // elements, the serialized subtree (including all namespace
+        // declarations it needs)
+        std::string value;
+      };
+      using Script = std::vector<Edit>;
+
+      // Computes the edits that transform `a` into `b`.
+      Script compute(const doc::Ptr &a, const doc::Ptr &b);
+      // Uses the supplied hashes, e.g. of a cached document version.
+      Script compute(const doc::Ptr &a, const doc::Ptr &b,
+          const hash::Map &ha, const hash::Map &hb);
+
+      // throws Runtime_Error if the script doesn't fit the document
+      void apply(doc::Ptr &doc, const Script &script);
+
+      // XML representation of a script, e.g. for shipping it to
+      // other hosts:
+      //
+      //     <patch>
+      //       <set-attribute path='0/3' name='x'>23</set-attribute>
+      //       <insert path='1' type='1'>&lt;a&gt;...&lt;/a&gt;</insert>
+      //       ...
+      //     </patch>
+      doc::Ptr to_doc(const Script &script);
+      Script from_doc(const doc::Ptr &doc);
+
+    }
+
+  }
+
+}
+
+#endif
@@ -0,0 +1,169 @@
+#include "dispatch.hh"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace xxxml {
+
+  namespace util {
+
+    namespace dispatch {
+
+      Name_Table::Name_Table()
+        :
+          slots_(2, -1),
+          mask_(1)
+      {
+      }
+      Name_Table::Name_Table(std::vector<std::string> names)
+        :
+          names_(std::move(names))
+      {
+        vector<string> v(names_);
+        sort(v.begin(), v.end());
+        if (adjacent_find(v.begin(), v.end()) != v.end())
+          throw Logic_Error("duplicate names");
+        size_t n = names_.size();
+        uint32_t m = detail::start_mask(1, n);
+        for (; ; m = m * 2 + 1) {
+          if (m + 1 > detail::MAX_SPREAD * n + 2)
+            throw Logic_Error("no perfect hash found");
+          slots_.assign(m + 1, -1);
+          mask_ = m;
+          for (seed_ = 0; seed_ < detail::SEEDS; ++seed_) {
+            size_t i = 0;
+            for (; i < n; ++i) {
+              auto &x = names_[i];
+              int &s = slots_[detail::hash(seed_, x.data(), x.size()) & m];
+              if (s != -1)
+                break;
+              s = i;
+            }
+            if (i == n)
+              return;
+            fill(slots_.begin(), slots_.end(), -1);
+          }
+        }
+      }
+
+      int Name_Table::find(const char *name) const
+      {
+        size_t n;
+        int i = slots_[detail::hash_str(seed_, name, n) & mask_];
+        return i != -1 && names_[i].size() == n
+          && !memcmp(names_[i].data(), name, n) ? i : -1;
+      }
+      int Name_Table::find(const char *begin, const char *end) const
+      {
+        size_t n = end - begin;
+        int i = slots_[detail::hash_range(seed_, begin, end) & mask_];
+        return i != -1 && names_[i].size() == n
+          && !memcmp(names_[i].data(), begin, n) ? i : -1;
+      }
+      int Name_Table::find(const std::string &name) const
+      {
+        return find(name.data(), name.data() + name.size());
+      }
+
+      size_t Name_Table::size() const
+      {
+        return names_.size();
+      }
+      const std::string &Name_Table::name(size_t i) const
+      {
+        return names_.at(i);
+      }
+
+
+      Interned::Interned(xmlDict *d, const char *const *names, size_t n)
+      {
+        vector<const char*> v;
+        v.reserve(n);
+        for (size_t i = 0; i < n; ++i)
+          v.push_back(reinterpret_cast<const char*>(
+                dict::lookup(d, names[i])));
+        assign(v);
+      }
+      Interned::Interned(dict::Ptr &d, const char *const *names, size_t n)
+        :
+          Interned(d.get(), names, n)
+      {
+      }
+      Interned::Interned(xmlDict *d, const std::vector<std::string> &names)
+      {
+        vector<const char*> v;
+        v.reserve(names.size());
+        for (auto &x : names)
+          v.push_back(reinterpret_cast<const char*>(dict::lookup(d, x)));
+        assign(v);
+      }
+      Interned::Interned(text_reader::Ptr &reader, const char *const *names,
+          size_t n)
+      {
+        vector<const char*> v;
+        v.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+          auto s = xmlTextReaderConstString(reader.get(),
+              reinterpret_cast<const xmlChar*>(names[i]));
+          if (!s)
+            throw Runtime_Error("interning the name failed");
+          v.push_back(reinterpret_cast<const char*>(s));
+        }
+        assign(v);
+      }
+      Interned::Interned(text_reader::Ptr &reader,
+          const std::vector<std::string> &names)
+      {
+        vector<const char*> v;
+        v.reserve(names.size());
+        for (auto &x : names)
+          v.push_back(x.c_str());
+        *this = Interned(reader, v.data(), v.size());
+      }
+
+      void Interned::assign(const std::vector<const char*> &interned)
+      {
+        size_t n = interned.size();
+        vector<const char*> v(interned);
+        sort(v.begin(), v.end());
+        if (adjacent_find(v.begin(), v.end()) != v.end())
+          throw Logic_Error("duplicate names");
+        for (unsigned bits = 1; bits < 32; ++bits) {
+          if ((size_t(1) << bits) < 2 * n)
+            continue;
+          if ((size_t(1) << bits) > detail::MAX_SPREAD * n + 2)
+            break;
+          entries_.assign(size_t(1) << bits, Entry { nullptr, -1 });
+          shift_ = 64 - bits;
+          // odd multipliers, starting with the golden ratio one
+          for (uint64_t m = 0x9e3779b97f4a7c15ull, k = 0; k < detail::SEEDS;
+              ++k, m += 0x632be59bd9b4e01aull) {
+            size_t i = 0;
+            for (; i < n; ++i) {
+              Entry &e = entries_[slot(interned[i], m)];
+              if (e.name)
+                break;
+              e = Entry { interned[i], int(i) };
+            }
+            if (i == n) {
+              multiplier_ = m;
+              size_ = n;
+              return;
+            }
+            fill(entries_.begin(), entries_.end(), Entry { nullptr, -1 });
+          }
+        }
+        throw Logic_Error("no perfect hash found");
+      }
+
+      size_t Interned::size() const
+      {
+        return size_;
+      }
+
+    }
+
+  }
+
+}
@@ -0,0 +1,327 @@
+#ifndef XXXML_DISPATCH_HH
+#define XXXML_DISPATCH_HH
+
+#include <xxxml/xxxml.hh>
+#include <xxxml/template.hh>
+
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Maps element (or attribute) names to handler indices in O(1), i.e.
+// instead of a chain of strcmp() calls on text_reader::const_local_name().
+//
+// - Table: a perfect hash table that is computed at compile time,
+//   i.e. the seed is searched by the compiler such that the names
+//   hash to distinct slots. A lookup hashes the name and compares it
+//   with one candidate.
+// - Name_Table: the same for names that are only known at runtime
+// - Interned: maps the pointers of names interned in a dictionary,
+//   e.g. the names returned by a reader or parser with a shared
+//   dictionary. A lookup is a multiplication and one pointer
+//   comparison.
+//
+// Example:
+//
+//     using Names = util::dispatch::Table<XXXML_STR("rec"),
+//           XXXML_STR("name"), XXXML_STR("amount")>;
+//     while (text_reader::read(r)) {
+//       if (text_reader::node_type(r) != XML_READER_TYPE_ELEMENT)
+//         continue;
+//       switch (Names::find(text_reader::const_local_name(r))) {
+//         case Names::index<XXXML_STR("rec")>(): ...
+//         case Names::index<XXXML_STR("name")>(): ...
+//         ...
+//       }
+//     }
+//
+//     util::dispatch::Interned in(r, Names::names, Names::size);
+//     ...
+//     switch (in.find(text_reader::const_local_name(r))) {
+namespace xxxml {
+
+  namespace util {
+
+    namespace dispatch {
+
+      namespace detail {
+
+        // FNV-1a
+        constexpr uint32_t fnv(uint32_t h, const char *s, size_t n)
+        {
+          return n ? fnv((h ^ uint32_t(static_cast<unsigned char>(*s)))
+              * 16777619u, s + 1, n - 1) : h;
+        }
+        constexpr uint32_t hash(uint32_t seed, const char *s, size_t n)
+        {
+          return fnv(2166136261u ^ seed, s, n)
+            ^ (fnv(2166136261u ^ seed, s, n) >> 15);
+        }
+        // the same, also computes the length
+        inline uint32_t hash_str(uint32_t seed, const char *s, size_t &n)
+        {
+          uint32_t h = 2166136261u ^ seed;
+          const char *p = s;
+          for (; *p; ++p) {
+            h ^= static_cast<unsigned char>(*p);
+            h *= 16777619u;
+          }
+          n = p - s;
+          return h ^ (h >> 15);
+        }
+        inline uint32_t hash_range(uint32_t seed, const char *begin,
+            const char *end)
+        {
+          uint32_t h = 2166136261u ^ seed;
+          for (const char *p = begin; p != end; ++p) {
+            h ^= static_cast<unsigned char>(*p);
+            h *= 16777619u;
+          }
+          return h ^ (h >> 15);
+        }
+
+        // number of seeds tried per table size
+        constexpr uint32_t SEEDS = 64;
+        // up to 32 slots per name
+        constexpr uint32_t MAX_SPREAD = 32;
+
+        template <typename... Ns> struct Slots;
+        template <> struct Slots<> {
+          static constexpr bool none(uint32_t, uint32_t, uint32_t)
+          {
+            return true;
+          }
+          static constexpr bool distinct(uint32_t, uint32_t)
+          {
+            return true;
+          }
+          static constexpr int at(uint32_t, uint32_t, uint32_t, int)
+          {
+            return -1;
+          }
+        };
+        template <typename N, typename... Ns> struct Slots<N, Ns...> {
+          static constexpr uint32_t slot(uint32_t seed, uint32_t mask)
+          {
+            return hash(seed, N::value, N::size) & mask;
+          }
+          // i.e. no name has slot s
+          static constexpr bool none(uint32_t s, uint32_t seed,
+              uint32_t mask)
+          {
+            return slot(seed, mask) != s
+              && Slots<Ns...>::none(s, seed, mask);
+          }
+          static constexpr bool distinct(uint32_t seed, uint32_t mask)
+          {
+            return Slots<Ns...>::none(slot(seed, mask), seed, mask)
+              && Slots<Ns...>::distinct(seed, mask);
+          }
+          // index of the name in slot s, i is the index of N
+          static constexpr int at(uint32_t s, uint32_t seed, uint32_t mask,
+              int i)
+          {
+            return slot(seed, mask) == s ? i
+              : Slots<Ns...>::at(s, seed, mask, i + 1);
+          }
+        };
+
+        template <typename... Ns> struct Search {
+          static constexpr uint32_t seed(uint32_t s, uint32_t mask)
+          {
+            return s == SEEDS || Slots<Ns...>::distinct(s, mask) ? s
+              : seed(s + 1, mask);
+          }
+          // doubles the table size until a seed is found
+          static constexpr uint32_t mask(uint32_t m)
+          {
+            return seed(0, m) != SEEDS
+              || m + 1 >= MAX_SPREAD * sizeof...(Ns) ? m : mask(m * 2 + 1);
+          }
+        };
+        // i.e. at least two slots per name
+        constexpr uint32_t start_mask(uint32_t m, size_t n)
+        {
+          return m + 1 >= 2 * n ? m : start_mask(m * 2 + 1, n);
+        }
+
+        template <typename N, typename... Ns> struct Contains
+          : std::false_type {};
+        template <typename N, typename M, typename... Ns>
+          struct Contains<N, M, Ns...> : std::integral_constant<bool,
+          std::is_same<N, M>::value || Contains<N, Ns...>::value> {};
+        template <typename... Ns> struct Unique : std::true_type {};
+        template <typename N, typename... Ns> struct Unique<N, Ns...>
+          : std::integral_constant<bool, !Contains<N, Ns...>::value
+          && Unique<Ns...>::value> {};
+
+        template <typename N, int I, typename... Ns> struct Index {
+          static_assert(I < 0, "the name isn't part of the table");
+        };
+        template <typename N, int I, typename M, typename... Ns>
+          struct Index<N, I, M, Ns...> : Index<N, I + 1, Ns...> {};
+        template <typename N, int I, typename... Ns>
+          struct Index<N, I, N, Ns...> : std::integral_constant<int, I> {};
+
+        template <size_t... Is> struct Seq {};
+        template <typename A, typename B> struct Cat;
+        template <size_t... As, size_t... Bs>
+          struct Cat<Seq<As...>, Seq<Bs...> > {
+            using type = Seq<As..., (sizeof...(As) + Bs)...>;
+          };
+        template <size_t N> struct Make_Seq {
+          using type = typename Cat<typename Make_Seq<N / 2>::type,
+                typename Make_Seq<N - N / 2>::type>::type;
+        };
+        template <> struct Make_Seq<0> {
+          using type = Seq<>;
+        };
+        template <> struct Make_Seq<1> {
+          using type = Seq<0>;
+        };
+
+        template <uint32_t Seed, uint32_t Mask, typename S, typename... Ns>
+          struct Slot_Table;
+        template <uint32_t Seed, uint32_t Mask, size_t... Is, typename... Ns>
+          struct Slot_Table<Seed, Mask, Seq<Is...>, Ns...> {
+            static constexpr int value[sizeof...(Is)] = {
+              Slots<Ns...>::at(Is, Seed, Mask, 0)... };
+          };
+        template <uint32_t Seed, uint32_t Mask, size_t... Is, typename... Ns>
+          constexpr int Slot_Table<Seed, Mask, Seq<Is...>, Ns...>::value[];
+
+      }
+
+      // Names are tmpl::Str types, e.g. created with XXXML_STR().
+      // The index of a name is its position in the list.
+      template <typename... Names> struct Table {
+        static_assert(detail::Unique<Names...>::value,
+            "the names have to be unique");
+
+        static constexpr size_t size = sizeof...(Names);
+        static constexpr uint32_t mask = detail::Search<Names...>::mask(
+            detail::start_mask(1, sizeof...(Names)));
+        static constexpr uint32_t seed = detail::Search<Names...>::seed(
+            0, mask);
+        static_assert(seed != detail::SEEDS, "no perfect hash found");
+
+        // + 1: no zero-sized arrays
+        static constexpr const char *names[sizeof...(Names) + 1] = {
+          Names::value..., nullptr };
+        static constexpr size_t sizes[sizeof...(Names) + 1] = {
+          Names::size..., 0 };
+        using slots = detail::Slot_Table<seed, mask,
+              typename detail::Make_Seq<mask + 1>::type, Names...>;
+
+        // e.g. for case labels, a name that isn't part of the table
+        // is a compile error
+        template <typename Name> static constexpr int index()
+        {
+          return detail::Index<Name, 0, Names...>::value;
+        }
+
+        // returns -1 for unknown names
+        static int find(const char *name)
+        {
+          size_t n;
+          int i = slots::value[detail::hash_str(seed, name, n) & mask];
+          return i != -1 && sizes[i] == n && !memcmp(names[i], name, n)
+            ? i : -1;
+        }
+        static int find(const char *begin, const char *end)
+        {
+          size_t n = end - begin;
+          int i = slots::value[detail::hash_range(seed, begin, end) & mask];
+          return i != -1 && sizes[i] == n && !memcmp(names[i], begin, n)
+            ? i : -1;
+        }
+        static int find(const std::string &name)
+        {
+          return find(name.data(), name.data() + name.size());
+        }
+      };
+      template <typename... Names> constexpr size_t Table<Names...>::size;
+      template <typename... Names> constexpr uint32_t Table<Names...>::mask;
+      template <typename... Names> constexpr uint32_t Table<Names...>::seed;
+      template <typename... Names>
+        constexpr const char *Table<Names...>::names[];
+      template <typename... Names>
+        constexpr size_t Table<Names...>::sizes[];
+
+      // A perfect hash table for names that are known at runtime,
+      // the seed is searched on construction.
+      class Name_Table {
+        public:
+          Name_Table();
+          // throws Logic_Error on duplicate names
+          explicit Name_Table(std::vector<std::string> names);
+
+          // returns -1 for unknown names
+          int find(const char *name) const;
+          int find(const char *begin, const char *end) const;
+          int find(const std::string &name) const;
+
+          size_t size() const;
+          const std::string &name(size_t i) const;
+        private:
+          std::vector<std::string> names_;
+          // slot -> index
+          std::vector<int> slots_;
+          uint32_t seed_ {0};
+          uint32_t mask_ {0};
+      };
+
+      // Maps names by pointer, i.e. only names that are interned in the
+      // same dictionary are found - other pointers map to -1, even if
+      // the content matches.
+      //
+      // Readers and parsers intern element and attribute names in
+      // their dictionary (cf. XML_PARSE_NODICT), which is shared when
+      // it's reused, e.g. via text_reader::reset_memory().
+      class Interned {
+        public:
+          // interns the names in the dictionary
+          Interned(xmlDict *dict, const char *const *names, size_t n);
+          Interned(dict::Ptr &dict, const char *const *names, size_t n);
+          Interned(xmlDict *dict, const std::vector<std::string> &names);
+          // i.e. in the reader's dictionary
+          Interned(text_reader::Ptr &reader, const char *const *names,
+              size_t n);
+          Interned(text_reader::Ptr &reader,
+              const std::vector<std::string> &names);
+
+          // returns -1 for unknown pointers
+          int find(const char *name) const
+          {
+            const Entry &e = entries_[slot(name, multiplier_)];
+            return e.name == name ? e.index : -1;
+          }
+          size_t size() const;
+        private:
+          struct Entry {
+            const char *name;
+            int index;
+          };
+          std::vector<Entry> entries_;
+          uint64_t multiplier_ {0};
+          unsigned shift_ {63};
+          size_t size_ {0};
+
+          size_t slot(const char *p, uint64_t m) const
+          {
+            return size_t((uint64_t(uintptr_t(p)) * m) >> shift_);
+          }
+          void assign(const std::vector<const char*> &interned);
+      };
+
+    }
+
+  }
+
+}
+
+#endif
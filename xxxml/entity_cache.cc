@@ -0,0 +1,292 @@
+#include "entity_cache.hh"
+
+#include <libxml/parserInternals.h>
+#include <libxml/uri.h>
+
+#include <fstream>
+#include <initializer_list>
+#include <iterator>
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+namespace xxxml {
+
+  namespace util {
+
+    namespace {
+
+      // keeps the content alive while libxml2 reads from it,
+      // i.e. the cache can be cleared concurrently
+      struct Input {
+        shared_ptr<const string> content;
+        size_t pos {0};
+      };
+
+      int input_read(void *ctx, char *buf, int len)
+      {
+        auto in = static_cast<Input*>(ctx);
+        size_t n = min(size_t(len), in->content->size() - in->pos);
+        memcpy(buf, in->content->data() + in->pos, n);
+        in->pos += n;
+        return n;
+      }
+      int input_close(void *ctx)
+      {
+        delete static_cast<Input*>(ctx);
+        return 0;
+      }
+
+      // local path of url, empty if remote
+      string local_path(const char *url)
+      {
+        string r;
+        if (!strncmp(url, "file://", 7)) {
+          Char_Ptr p(xmlURIUnescapeString(url + 7, 0, nullptr), xmlFree);
+          if (p)
+            r = p.get();
+        } else if (!strstr(url, "://")) {
+          r = url;
+        }
+        if (r.empty())
+          return r;
+        char buf[PATH_MAX];
+        if (realpath(r.c_str(), buf))
+          return buf;
+        return r;
+      }
+
+      // i.e. gzip or xz
+      bool is_compressed(const string &path)
+      {
+        ifstream in(path, ios::binary);
+        unsigned char b[6] = {0};
+        in.read(reinterpret_cast<char*>(b), sizeof b);
+        return (b[0] == 0x1f && b[1] == 0x8b)
+          || !memcmp(b, "\xfd" "7zXZ\0", 6);
+      }
+
+      long long mtime_ns(const struct stat &st)
+      {
+        return (long long)st.st_mtim.tv_sec * 1000000000ll
+          + st.st_mtim.tv_nsec;
+      }
+
+      bool read_content(const string &path, string &content)
+      {
+        ifstream in(path, ios::binary);
+        if (!in)
+          return false;
+        content.assign(istreambuf_iterator<char>(in),
+            istreambuf_iterator<char>());
+        return !in.bad();
+      }
+
+    }
+
+    Entity_Cache::Entity_Cache()
+    {
+    }
+
+    Entity_Cache &Entity_Cache::instance()
+    {
+      static Entity_Cache cache;
+      return cache;
+    }
+
+    xmlParserInputPtr Entity_Cache::loader(const char *url, const char *id,
+        xmlParserCtxtPtr ctxt)
+    {
+      return instance().load(url, id, ctxt);
+    }
+
+    void Entity_Cache::add(const std::string &url,
+        const char *begin, const char *end)
+    {
+      add(url, string(begin, end));
+    }
+    void Entity_Cache::add(const std::string &url, std::string content)
+    {
+      auto c = make_shared<const string>(std::move(content));
+      lock_guard<mutex> lock(mutex_);
+      auto i = entries_.find(url);
+      if (i != entries_.end())
+        erase(i);
+      entries_.emplace(url, Entry { std::move(c), false, lru_.end(),
+          0, 0 });
+    }
+
+    void Entity_Cache::set_disk_fallback(bool b)
+    {
+      lock_guard<mutex> lock(mutex_);
+      disk_fallback_ = b;
+    }
+    void Entity_Cache::set_max_size(size_t bytes)
+    {
+      lock_guard<mutex> lock(mutex_);
+      max_size_ = bytes;
+      evict();
+    }
+
+    const Entity_Cache::Entry *Entity_Cache::lookup(const char *key)
+    {
+      if (!key)
+        return nullptr;
+      auto i = entries_.find(key);
+      if (i == entries_.end())
+        return nullptr;
+      if (i->second.cached)
+        lru_.splice(lru_.end(), lru_, i->second.lru);
+      return &i->second;
+    }
+
+    void Entity_Cache::erase(
+        std::unordered_map<std::string, Entry>::iterator i)
+    {
+      if (i->second.cached) {
+        cached_size_ -= i->second.content->size();
+        lru_.erase(i->second.lru);
+      }
+      entries_.erase(i);
+    }
+    void Entity_Cache::evict()
+    {
+      while (cached_size_ > max_size_)
+        erase(entries_.find(lru_.front()));
+    }
+
+    xmlParserInputPtr Entity_Cache::load(const char *url, const char *id,
+        xmlParserCtxtPtr ctxt)
+    {
+      Entry hit;
+      string key;
+      bool disk_fallback;
+      size_t max_size;
+      {
+        lock_guard<mutex> lock(mutex_);
+        for (const char *k : { url, id })
+          if (auto e = lookup(k)) {
+            hit = *e;
+            key = k;
+            break;
+          }
+        disk_fallback = disk_fallback_;
+        max_size = max_size_;
+      }
+      // realpath() is called without holding the lock
+      string path;
+      if (!hit.content && url)
+        path = local_path(url);
+      if (!path.empty()) {
+        lock_guard<mutex> lock(mutex_);
+        if (auto e = lookup(path.c_str())) {
+          hit = *e;
+          key = path;
+        }
+      }
+      // a file read from disk might have changed since
+      struct stat st;
+      if (hit.content && hit.cached) {
+        if (stat(key.c_str(), &st) || hit.mtime_ns != mtime_ns(st)
+            || hit.size != st.st_size) {
+          lock_guard<mutex> lock(mutex_);
+          auto i = entries_.find(key);
+          if (i != entries_.end() && i->second.content == hit.content)
+            erase(i);
+          hit.content.reset();
+          path = key;
+        }
+      }
+      Content content = std::move(hit.content);
+      {
+        lock_guard<mutex> lock(mutex_);
+        if (content)
+          ++hits_;
+        else
+          ++misses_;
+      }
+      if (!content) {
+        if (!disk_fallback || path.empty())
+          return nullptr;
+        if (stat(path.c_str(), &st))
+          return nullptr;
+        // i.e. libxml2 reads and decompresses it as usual
+        if (size_t(st.st_size) > max_size || is_compressed(path))
+          return xmlNewInputFromFile(ctxt, path.c_str());
+        // the file is read without holding the lock
+        string s;
+        if (!read_content(path, s))
+          return nullptr;
+        auto c = make_shared<const string>(std::move(s));
+        lock_guard<mutex> lock(mutex_);
+        // the stamps from before reading, i.e. a concurrent change
+        // is detected on the next hit
+        auto r = entries_.emplace(path, Entry { c, true, lru_.end(),
+            mtime_ns(st), st.st_size });
+        if (r.second) {
+          Entry &e = r.first->second;
+          e.lru = lru_.insert(lru_.end(), path);
+          cached_size_ += c->size();
+          content = e.content;
+          evict();
+        } else {
+          content = r.first->second.content;
+        }
+      }
+
+      Input *in = new Input;
+      in->content = std::move(content);
+      xmlParserInputBufferPtr buf = xmlParserInputBufferCreateIO(
+          input_read, input_close, in, XML_CHAR_ENCODING_NONE);
+      if (!buf) {
+        delete in;
+        return nullptr;
+      }
+      xmlParserInputPtr r = xmlNewIOInputStream(ctxt, buf,
+          XML_CHAR_ENCODING_NONE);
+      if (!r) {
+        xmlFreeParserInputBuffer(buf);
+        return nullptr;
+      }
+      // for resolving relative references inside the resource
+      if (url) {
+        r->filename = reinterpret_cast<char*>(xmlStrdup(
+              reinterpret_cast<const xmlChar*>(url)));
+        if (ctxt && !ctxt->directory)
+          ctxt->directory = xmlParserGetDirectory(url);
+      }
+      return r;
+    }
+
+    size_t Entity_Cache::hits() const
+    {
+      lock_guard<mutex> lock(mutex_);
+      return hits_;
+    }
+    size_t Entity_Cache::misses() const
+    {
+      lock_guard<mutex> lock(mutex_);
+      return misses_;
+    }
+    size_t Entity_Cache::size() const
+    {
+      lock_guard<mutex> lock(mutex_);
+      return entries_.size();
+    }
+    void Entity_Cache::clear()
+    {
+      lock_guard<mutex> lock(mutex_);
+      entries_.clear();
+      lru_.clear();
+      cached_size_ = 0;
+      hits_ = 0;
+      misses_ = 0;
+    }
+
+  }
+
+}
@@ -0,0 +1,101 @@
+#ifndef XXXML_ENTITY_CACHE_HH
+#define XXXML_ENTITY_CACHE_HH
+
+#include <xxxml/xxxml.hh>
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace xxxml {
+
+  namespace util {
+
+    // In-memory cache for external entities, i.e. for everything libxml2
+    // loads via its external entity loader: DTDs, external entities,
+    // XIncludes and the includes/imports of schemas.
+    //
+    // Resources can be pre-seeded (like a catalog that maps URIs or
+    // public IDs to content). Other local files are read from disk
+    // once and then served from memory - as long as their modification
+    // time and size don't change, which is checked on each hit. Remote
+    // resources that aren't seeded are never fetched.
+    //
+    // Note that libxml2 also opens the documents read via read_file()
+    // with the same loader. Thus, the files read from disk are cached
+    // up to max_size bytes, evicting the least recently used ones,
+    // while seeded resources are kept until clear(). Compressed files
+    // and files larger than max_size aren't cached, i.e. libxml2 reads
+    // (and decompresses) them as usual.
+    //
+    // Install it process-wide:
+    //
+    //     xxxml::Library lib(util::Entity_Cache::loader);
+    //     util::Entity_Cache::instance().add("http://example.org/a.xsd",
+    //         a_xsd);
+    //
+    // Thread-safe.
+    class Entity_Cache {
+      public:
+        Entity_Cache();
+        Entity_Cache(const Entity_Cache &) =delete;
+        Entity_Cache &operator=(const Entity_Cache &) =delete;
+
+        // the cache the loader serves from
+        static Entity_Cache &instance();
+        // signature of xmlExternalEntityLoader
+        static xmlParserInputPtr loader(const char *url, const char *id,
+            xmlParserCtxtPtr ctxt);
+
+        // url may also be a public ID or a local path,
+        // replaces existing content
+        void add(const std::string &url, const char *begin, const char *end);
+        void add(const std::string &url, std::string content);
+
+        // default: true, if false, only seeded resources are served
+        void set_disk_fallback(bool b);
+        // of the files read from disk, default: 16 MiB
+        void set_max_size(size_t bytes);
+
+        // a parser input for url (or id), nullptr if not available
+        xmlParserInputPtr load(const char *url, const char *id,
+            xmlParserCtxtPtr ctxt);
+
+        size_t hits() const;
+        size_t misses() const;
+        size_t size() const;
+        void clear();
+      private:
+        using Content = std::shared_ptr<const std::string>;
+        struct Entry {
+          Content content;
+          // i.e. read from disk, thus evictable
+          bool cached;
+          std::list<std::string>::iterator lru;
+          // of the file when it was read, i.e. revalidated on each hit
+          long long mtime_ns;
+          long long size;
+        };
+        // nullptr if there is no entry
+        const Entry *lookup(const char *key);
+        void erase(std::unordered_map<std::string, Entry>::iterator i);
+        void evict();
+
+        mutable std::mutex mutex_;
+        std::unordered_map<std::string, Entry> entries_;
+        // the cached entries, least recently used first
+        std::list<std::string> lru_;
+        size_t cached_size_ {0};
+        size_t max_size_ {16 * 1024 * 1024};
+        bool disk_fallback_ {true};
+        size_t hits_ {0};
+        size_t misses_ {0};
+    };
+
+  }
+
+}
+
+#endif
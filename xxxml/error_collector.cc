@@ -0,0 +1,107 @@
+#include "error_collector.hh"
+
+#include <algorithm>
+
+#include <string.h>
+
+using namespace std;
+
+namespace xxxml {
+
+  namespace util {
+
+    const size_t Error_Collector::MESSAGE_SIZE;
+
+    Error_Collector::Error_Collector(size_t capacity, size_t max_errors,
+        Mode mode)
+      :
+        ring_(capacity ? capacity : 1),
+        max_errors_(max_errors),
+        mode_(mode)
+    {
+      if (mode_ == Mode::MESSAGES)
+        messages_.resize(ring_.size() * MESSAGE_SIZE);
+    }
+
+    void Error_Collector::handler(void *user_data, xmlErrorPtr e)
+    {
+      auto c = static_cast<Error_Collector*>(user_data);
+      if (!c || !e || c->limit_reached())
+        return;
+      if (e->level >= XML_ERR_ERROR)
+        ++c->errors_;
+      else
+        ++c->warnings_;
+      size_t slot = c->recorded_++ % c->ring_.size();
+      Record &r = c->ring_[slot];
+      r.code = e->code;
+      r.level = e->level;
+      r.line = e->line;
+      r.node = nullptr;
+      if (e->node && e->domain != XML_FROM_PARSER)
+        r.node = static_cast<const xmlNode*>(e->node);
+      r.message = nullptr;
+      if (c->mode_ == Mode::MESSAGES && e->message) {
+        size_t n = strlen(e->message);
+        while (n && e->message[n-1] == '\n')
+          --n;
+        if (n >= MESSAGE_SIZE) {
+          n = MESSAGE_SIZE - 1;
+          // i.e. not inside a UTF-8 sequence
+          while (n && (e->message[n] & 0xc0) == 0x80)
+            --n;
+        }
+        char *m = c->messages_.data() + slot * MESSAGE_SIZE;
+        memcpy(m, e->message, n);
+        m[n] = 0;
+        r.message = m;
+      }
+    }
+
+    void Error_Collector::attach(schema::Valid_Ctxt_Ptr &valid_ctxt)
+    {
+      schema::set_valid_structured_errors(valid_ctxt, handler, this);
+    }
+    void Error_Collector::attach(relaxng::Valid_Ctxt_Ptr &valid_ctxt)
+    {
+      relaxng::set_valid_structured_errors(valid_ctxt, handler, this);
+    }
+    void Error_Collector::attach(text_reader::Ptr &reader)
+    {
+      text_reader::set_structured_error_handler(reader, handler, this);
+    }
+
+    size_t Error_Collector::size() const
+    {
+      return min(recorded_, ring_.size());
+    }
+    const Error_Collector::Record &Error_Collector::operator[](size_t i) const
+    {
+      if (recorded_ <= ring_.size())
+        return ring_[i];
+      return ring_[(recorded_ + i) % ring_.size()];
+    }
+
+    size_t Error_Collector::errors() const
+    {
+      return errors_;
+    }
+    size_t Error_Collector::warnings() const
+    {
+      return warnings_;
+    }
+    bool Error_Collector::limit_reached() const
+    {
+      return errors_ >= max_errors_;
+    }
+
+    void Error_Collector::clear()
+    {
+      recorded_ = 0;
+      errors_ = 0;
+      warnings_ = 0;
+    }
+
+  }
+
+}
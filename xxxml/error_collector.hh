@@ -0,0 +1,92 @@
+#ifndef XXXML_ERROR_COLLECTOR_HH
+#define XXXML_ERROR_COLLECTOR_HH
+
+#include <xxxml/xxxml.hh>
+
+#include <limits>
+#include <vector>
+
+namespace xxxml {
+
+  namespace util {
+
+    // Structured error handler that records errors into a preallocated
+    // ring buffer, i.e. there are no allocations per error - each record
+    // has a fixed-size message slot, longer messages are truncated.
+    //
+    // With a cutoff, errors beyond max_errors are ignored and
+    // limit_reached() signals that validation can be aborted (as
+    // util::Validator does when passed a collector).
+    //
+    // In SILENT mode only code, level, line and node are recorded.
+    // Note that libxml2 formats the message before calling any handler,
+    // but with a collector attached nothing is printed to stderr.
+    //
+    // Example:
+    //
+    //     util::Error_Collector c(16, 16);
+    //     c.attach(valid_ctxt);
+    //     ...
+    //     for (size_t i = 0; i < c.size(); ++i)
+    //       cerr << c[i].line << ": " << c[i].message << '\n';
+    //
+    // Not thread-safe, i.e. use one per validation context.
+    class Error_Collector {
+      public:
+        enum class Mode { MESSAGES, SILENT };
+
+        struct Record {
+          // cf. xmlParserErrors
+          int code {0};
+          // cf. xmlErrorLevel
+          int level {0};
+          int line {0};
+          // nullptr when validating a stream
+          const xmlNode *node {nullptr};
+          // without trailing newline, at most MESSAGE_SIZE - 1 bytes,
+          // nullptr in SILENT mode - overwritten with the record
+          const char *message {nullptr};
+        };
+        static const size_t MESSAGE_SIZE = 256;
+
+        // capacity: number of records kept, i.e. the latest ones
+        explicit Error_Collector(size_t capacity = 64,
+            size_t max_errors = std::numeric_limits<size_t>::max(),
+            Mode mode = Mode::MESSAGES);
+        Error_Collector(const Error_Collector &) =delete;
+        Error_Collector &operator=(const Error_Collector &) =delete;
+
+        // xmlStructuredErrorFunc, user_data is the collector
+        static void handler(void *user_data, xmlErrorPtr e);
+
+        void attach(schema::Valid_Ctxt_Ptr &valid_ctxt);
+        void attach(relaxng::Valid_Ctxt_Ptr &valid_ctxt);
+        void attach(text_reader::Ptr &reader);
+
+        // records, oldest first
+        size_t size() const;
+        const Record &operator[](size_t i) const;
+
+        // counts include the records that were overwritten or ignored
+        // after the cutoff
+        size_t errors() const;
+        size_t warnings() const;
+        bool limit_reached() const;
+
+        void clear();
+      private:
+        std::vector<Record> ring_;
+        size_t recorded_ {0};
+        size_t errors_ {0};
+        size_t warnings_ {0};
+        size_t max_errors_;
+        Mode mode_;
+        // MESSAGE_SIZE bytes per record
+        std::vector<char> messages_;
+    };
+
+  }
+
+}
+
+#endif
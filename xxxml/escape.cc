@@ -0,0 +1,161 @@
+#include "escape.hh"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  #define XXXML_X86_SIMD
+  #include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace xxxml {
+
+  namespace detail {
+
+    template <bool ATTRIBUTE>
+      static const char *scan_scalar(const char *begin, const char *end)
+      {
+        for (; begin != end; ++begin) {
+          switch (*begin) {
+            case '<':
+            case '>':
+            case '&':
+            case '"':
+            case '\r':
+              return begin;
+            case '\n':
+            case '\t':
+              if (ATTRIBUTE)
+                return begin;
+              break;
+            default:
+              if (ATTRIBUTE && (*begin & 0x80))
+                return begin;
+          }
+        }
+        return end;
+      }
+    static const char *scan_scalar(const char *begin, const char *end,
+        Escape e)
+    {
+      return e == Escape::TEXT ? scan_scalar<false>(begin, end)
+                               : scan_scalar<true>(begin, end);
+    }
+
+#ifdef XXXML_X86_SIMD
+
+    template <bool ATTRIBUTE>
+      __attribute__((target("sse2")))
+      static const char *scan_sse2(const char *begin, const char *end)
+      {
+        const __m128i lt   = _mm_set1_epi8('<');
+        const __m128i gt   = _mm_set1_epi8('>');
+        const __m128i amp  = _mm_set1_epi8('&');
+        const __m128i quot = _mm_set1_epi8('"');
+        const __m128i cr   = _mm_set1_epi8('\r');
+        const __m128i nl   = _mm_set1_epi8('\n');
+        const __m128i tab  = _mm_set1_epi8('\t');
+        for (; end - begin >= 16; begin += 16) {
+          __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+          __m128i m = _mm_or_si128(
+              _mm_or_si128(_mm_cmpeq_epi8(x, lt), _mm_cmpeq_epi8(x, gt)),
+              _mm_or_si128(_mm_cmpeq_epi8(x, amp), _mm_cmpeq_epi8(x, quot)));
+          m = _mm_or_si128(m, _mm_cmpeq_epi8(x, cr));
+          if (ATTRIBUTE)
+            // the movemask also picks up the high bit of non-ASCII bytes
+            m = _mm_or_si128(_mm_or_si128(m, x),
+                _mm_or_si128(_mm_cmpeq_epi8(x, nl), _mm_cmpeq_epi8(x, tab)));
+          unsigned bits = _mm_movemask_epi8(m);
+          if (bits)
+            return begin + __builtin_ctz(bits);
+        }
+        return scan_scalar<ATTRIBUTE>(begin, end);
+      }
+    static const char *scan_sse2(const char *begin, const char *end,
+        Escape e)
+    {
+      return e == Escape::TEXT ? scan_sse2<false>(begin, end)
+                               : scan_sse2<true>(begin, end);
+    }
+
+    template <bool ATTRIBUTE>
+      __attribute__((target("avx2")))
+      static const char *scan_avx2(const char *begin, const char *end)
+      {
+        const __m256i lt   = _mm256_set1_epi8('<');
+        const __m256i gt   = _mm256_set1_epi8('>');
+        const __m256i amp  = _mm256_set1_epi8('&');
+        const __m256i quot = _mm256_set1_epi8('"');
+        const __m256i cr   = _mm256_set1_epi8('\r');
+        const __m256i nl   = _mm256_set1_epi8('\n');
+        const __m256i tab  = _mm256_set1_epi8('\t');
+        for (; end - begin >= 32; begin += 32) {
+          __m256i x = _mm256_loadu_si256(
+              reinterpret_cast<const __m256i*>(begin));
+          __m256i m = _mm256_or_si256(
+              _mm256_or_si256(_mm256_cmpeq_epi8(x, lt),
+                _mm256_cmpeq_epi8(x, gt)),
+              _mm256_or_si256(_mm256_cmpeq_epi8(x, amp),
+                _mm256_cmpeq_epi8(x, quot)));
+          m = _mm256_or_si256(m, _mm256_cmpeq_epi8(x, cr));
+          if (ATTRIBUTE)
+            m = _mm256_or_si256(_mm256_or_si256(m, x),
+                _mm256_or_si256(_mm256_cmpeq_epi8(x, nl),
+                  _mm256_cmpeq_epi8(x, tab)));
+          unsigned bits = _mm256_movemask_epi8(m);
+          if (bits)
+            return begin + __builtin_ctz(bits);
+        }
+        return scan_sse2<ATTRIBUTE>(begin, end);
+      }
+    static const char *scan_avx2(const char *begin, const char *end,
+        Escape e)
+    {
+      return e == Escape::TEXT ? scan_avx2<false>(begin, end)
+                               : scan_avx2<true>(begin, end);
+    }
+
+#endif // XXXML_X86_SIMD
+
+    static vector<Scanner> detect()
+    {
+      vector<Scanner> r;
+#ifdef XXXML_X86_SIMD
+      __builtin_cpu_init();
+      if (__builtin_cpu_supports("avx2"))
+        r.push_back(Scanner{"avx2", scan_avx2});
+      if (__builtin_cpu_supports("sse2"))
+        r.push_back(Scanner{"sse2", scan_sse2});
+#endif
+      r.push_back(Scanner{"scalar", scan_scalar});
+      return r;
+    }
+
+    const vector<Scanner> &scanners()
+    {
+      static const vector<Scanner> v(detect());
+      return v;
+    }
+
+    const char *scan(const char *begin, const char *end, Escape e)
+    {
+      static const Scan_Fn f = scanners().front().scan;
+      return f(begin, end, e);
+    }
+
+    const char *escape(char c)
+    {
+      switch (c) {
+        case '<': return "&lt;";
+        case '>': return "&gt;";
+        case '&': return "&amp;";
+        case '"': return "&quot;";
+        case '\r': return "&#13;";
+        case '\n': return "&#10;";
+        case '\t': return "&#9;";
+        default: return nullptr;
+      }
+    }
+
+  }
+
+}
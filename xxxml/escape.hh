@@ -0,0 +1,61 @@
+#ifndef XXXML_ESCAPE_HH
+#define XXXML_ESCAPE_HH
+
+#include <vector>
+
+namespace xxxml {
+
+  namespace detail {
+
+    // Searches the characters the text writer has to escape, 16 (SSE2)
+    // or 32 (AVX2) bytes at a time. The implementation is selected at
+    // runtime, with a scalar fallback.
+    //
+    // TEXT: < > & " \r, cf. xmlEncodeSpecialChars()
+    // ATTRIBUTE: additionally \n, \t and non-ASCII bytes, i.e. all the
+    // characters xmlBufAttrSerializeTxtContent() may escape
+    enum class Escape { TEXT, ATTRIBUTE };
+
+    using Scan_Fn = const char *(*)(const char *begin, const char *end,
+        Escape e);
+    struct Scanner {
+      const char *name;
+      Scan_Fn scan;
+    };
+    // usable on this CPU, fastest first, i.e. the last one is scalar
+    const std::vector<Scanner> &scanners();
+
+    // returns end if there is no such character
+    const char *scan(const char *begin, const char *end, Escape e);
+
+    // The character reference for a character scan() stops at, as
+    // xmlEncodeSpecialChars() and xmlBufAttrSerializeTxtContent() escape
+    // ASCII characters, nullptr for others (e.g. non-ASCII bytes).
+    const char *escape(char c);
+
+    // Escapes [begin, end) up to the first non-ASCII byte scan() stops
+    // at (i.e. just with ATTRIBUTE): calls raw(first, last) for the runs
+    // without special characters and special(c) for the others - each
+    // returns false on error. Returns the position of the non-ASCII
+    // byte or end, nullptr on error.
+    template <typename Raw, typename Special>
+      const char *escape_runs(const char *begin, const char *end, Escape e,
+          Raw raw, Special special)
+      {
+        for (const char *base = begin; ; ) {
+          const char *i = scan(base, end, e);
+          if (i != base && !raw(base, i))
+            return nullptr;
+          if (i == end || (*i & 0x80))
+            return i;
+          if (!special(*i))
+            return nullptr;
+          base = i + 1;
+        }
+      }
+
+  }
+
+}
+
+#endif
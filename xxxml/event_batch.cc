@@ -0,0 +1,143 @@
+#include "event_batch.hh"
+
+#include <string.h>
+
+using namespace std;
+
+namespace xxxml {
+
+  namespace util {
+
+    static const size_t NO_VALUE = size_t(-1);
+
+    static const char *cs(const xmlChar *s)
+    {
+      return reinterpret_cast<const char*>(s);
+    }
+
+    Event_Batch::Event_Batch()
+    {
+      attr_begin.push_back(0);
+    }
+
+    size_t Event_Batch::size() const
+    {
+      return type.size();
+    }
+    bool Event_Batch::empty() const
+    {
+      return type.empty();
+    }
+
+    void Event_Batch::clear()
+    {
+      type.clear();
+      depth.clear();
+      name.clear();
+      namespace_uri.clear();
+      value.clear();
+      value_size.clear();
+      is_empty.clear();
+      attr_begin.clear();
+      attr_begin.push_back(0);
+      attr_name.clear();
+      attr_namespace_uri.clear();
+      attr_value.clear();
+      attr_value_size.clear();
+      arena_.clear();
+      value_off_.clear();
+      attr_value_off_.clear();
+    }
+
+    const char *Event_Batch::interned(text_reader::Ptr &reader, const char *s)
+    {
+      const xmlChar *r = xmlTextReaderConstString(reader.get(),
+          reinterpret_cast<const xmlChar*>(s));
+      if (!r)
+        throw Runtime_Error("Could not intern string");
+      return cs(r);
+    }
+
+    // NUL-terminated copy, returns the length
+    size_t Event_Batch::copy(const xmlChar *s)
+    {
+      size_t n = strlen(cs(s));
+      arena_.insert(arena_.end(), s, s + n + 1);
+      return n;
+    }
+
+    void Event_Batch::add_attributes(xmlTextReader *reader)
+    {
+      xmlNode *node = xmlTextReaderCurrentNode(reader);
+      if (!node || node->type != XML_ELEMENT_NODE)
+        return;
+      for (xmlAttr *a = node->properties; a; a = a->next) {
+        attr_name.push_back(cs(a->name));
+        attr_namespace_uri.push_back(a->ns
+            ? cs(xmlTextReaderConstString(reader, a->ns->href)) : nullptr);
+        attr_value_off_.push_back(arena_.size());
+        size_t n = 0;
+        xmlNode *t = a->children;
+        if (t && !t->next && t->type == XML_TEXT_NODE && t->content) {
+          // common case, no entity references
+          n = copy(t->content);
+        } else {
+          xmlChar *s = xmlNodeListGetString(node->doc, t, 1);
+          if (s) {
+            n = copy(s);
+            xmlFree(s);
+          } else {
+            n = copy(reinterpret_cast<const xmlChar*>(""));
+          }
+        }
+        attr_value_size.push_back(n);
+      }
+    }
+
+    void Event_Batch::add(xmlTextReader *reader)
+    {
+      int t = xmlTextReaderNodeType(reader);
+      int d = xmlTextReaderDepth(reader);
+      if (t == -1 || d == -1)
+        throw Runtime_Error("text reader event access failed");
+      type.push_back(t);
+      depth.push_back(d);
+      name.push_back(cs(xmlTextReaderConstLocalName(reader)));
+      namespace_uri.push_back(cs(xmlTextReaderConstNamespaceUri(reader)));
+      const xmlChar *v = xmlTextReaderConstValue(reader);
+      if (v) {
+        value_off_.push_back(arena_.size());
+        value_size.push_back(copy(v));
+      } else {
+        value_off_.push_back(NO_VALUE);
+        value_size.push_back(0);
+      }
+      bool empty_element = false;
+      if (t == XML_READER_TYPE_ELEMENT) {
+        empty_element = xmlTextReaderIsEmptyElement(reader) == 1;
+        add_attributes(reader);
+      }
+      is_empty.push_back(empty_element);
+      attr_begin.push_back(attr_name.size());
+    }
+
+    size_t Event_Batch::read(text_reader::Ptr &reader, size_t n)
+    {
+      clear();
+      for (size_t i = 0; i < n && text_reader::read(reader); ++i)
+        add(reader.get());
+
+      // the arena doesn't grow anymore
+      const char *base = arena_.data();
+      value.reserve(value_off_.size());
+      for (size_t off : value_off_)
+        value.push_back(off == NO_VALUE ? nullptr : base + off);
+      attr_value.reserve(attr_value_off_.size());
+      for (size_t off : attr_value_off_)
+        attr_value.push_back(base + off);
+      return size();
+    }
+
+  }
+
+}
@@ -0,0 +1,89 @@
+#ifndef XXXML_EVENT_BATCH_HH
+#define XXXML_EVENT_BATCH_HH
+
+#include <xxxml/xxxml.hh>
+
+#include <vector>
+
+namespace xxxml {
+
+  namespace util {
+
+    // Caller-owned struct-of-arrays that is filled with up to N text
+    // reader events at a time, i.e. consumer loops can work over
+    // contiguous arrays instead of issuing several calls per node.
+    //
+    // Example:
+    //
+    //     util::Event_Batch b;
+    //     while (size_t n = b.read(reader, 256))
+    //       for (size_t i = 0; i < n; ++i)
+    //         if (b.type[i] == XML_READER_TYPE_ELEMENT && b.name[i] == foo)
+    //           ...
+    //
+    // Names and namespace URIs are interned in the reader's dictionary,
+    // thus, they are valid as long as the reader and can be compared by
+    // pointer (cf. interned() or xmlTextReaderConstString()).
+    //
+    // Values are copied (NUL-terminated) into the batch, since the reader
+    // frees nodes while moving on. They are valid until the next read()
+    // or clear().
+    //
+    // Attributes (without namespace declarations) of element events are
+    // gathered eagerly: event i has the attributes
+    // [attr_begin[i], attr_begin[i+1]) in the attr_* arrays.
+    // Batch memory is re-used between calls.
+    class Event_Batch {
+      public:
+        // XML_READER_TYPE_*
+        std::vector<int> type;
+        std::vector<unsigned> depth;
+        // local name, e.g. "#text" for text nodes
+        std::vector<const char*> name;
+        // nullptr if not in a namespace
+        std::vector<const char*> namespace_uri;
+        // nullptr if the node doesn't have a value
+        std::vector<const char*> value;
+        std::vector<size_t> value_size;
+        // e.g. <foo/>, i.e. there is no END_ELEMENT event
+        std::vector<char> is_empty;
+        // size() + 1 entries
+        std::vector<size_t> attr_begin;
+
+        std::vector<const char*> attr_name;
+        std::vector<const char*> attr_namespace_uri;
+        std::vector<const char*> attr_value;
+        std::vector<size_t> attr_value_size;
+
+        Event_Batch();
+        Event_Batch(const Event_Batch &) =delete;
+        Event_Batch &operator=(const Event_Batch &) =delete;
+
+        // clears the batch and reads up to n events,
+        // returns 0 at the end of the input
+        size_t read(text_reader::Ptr &reader, size_t n);
+
+        // the interned version of s, for pointer comparisons with names
+        static const char *interned(text_reader::Ptr &reader, const char *s);
+
+        size_t size() const;
+        bool empty() const;
+        // keeps the capacity
+        void clear();
+      private:
+        void add(xmlTextReader *reader);
+        void add_attributes(xmlTextReader *reader);
+        size_t copy(const xmlChar *s);
+
+        std::vector<char> arena_;
+        // offsets into the arena, i.e. the value pointers are
+        // computed after the arena has reached its final size
+        std::vector<size_t> value_off_;
+        std::vector<size_t> attr_value_off_;
+    };
+
+  }
+
+}
+
+#endif
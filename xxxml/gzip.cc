@@ -0,0 +1,662 @@
+#include "gzip.hh"
+#include "io.hh"
+
+#include <algorithm>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include <zlib.h>
+
+using namespace std;
+
+namespace xxxml {
+
+  namespace util {
+
+    namespace gzip {
+
+      // deflate's window size
+      static const size_t dict_size = 32 * 1024;
+
+      struct Sink::Block {
+        std::vector<char> in;
+        std::vector<char> dict;
+        std::vector<char> out;
+        unsigned long crc {0};
+        bool last {false};
+        bool done {false};
+        exception_ptr error;
+      };
+
+      struct Sink::Deflater {
+        z_stream z;
+
+        explicit Deflater(int level)
+        {
+          memset(&z, 0, sizeof z);
+          // raw deflate, the gzip header and trailer are written by the sink
+          if (deflateInit2(&z, level, Z_DEFLATED, -15, 8,
+                Z_DEFAULT_STRATEGY) != Z_OK)
+            throw Runtime_Error("Could not initialize deflate with level "
+                + to_string(level));
+        }
+        ~Deflater()
+        {
+          deflateEnd(&z);
+        }
+        Deflater(const Deflater &) = delete;
+        Deflater &operator=(const Deflater &) = delete;
+
+        void compress(Block &b)
+        {
+          if (deflateReset(&z) != Z_OK)
+            throw Runtime_Error("Could not reset deflate");
+          if (!b.dict.empty() && deflateSetDictionary(&z,
+                reinterpret_cast<const Bytef*>(b.dict.data()),
+                b.dict.size()) != Z_OK)
+            throw Runtime_Error("Could not set deflate dictionary");
+          z.next_in = reinterpret_cast<Bytef*>(b.in.data());
+          z.avail_in = b.in.size();
+          int flush = b.last ? Z_FINISH : Z_SYNC_FLUSH;
+          // + 16: for the empty stored block of the sync flush
+          b.out.resize(deflateBound(&z, b.in.size()) + 16);
+          size_t n = 0;
+          for (;;) {
+            z.next_out = reinterpret_cast<Bytef*>(b.out.data() + n);
+            z.avail_out = b.out.size() - n;
+            int r = deflate(&z, flush);
+            if (r == Z_STREAM_ERROR)
+              throw Runtime_Error("Could not deflate");
+            n = b.out.size() - z.avail_out;
+            if (b.last ? r == Z_STREAM_END : z.avail_out != 0)
+              break;
+            b.out.resize(2 * b.out.size());
+          }
+          b.out.resize(n);
+          b.crc = crc32(crc32(0, Z_NULL, 0),
+              reinterpret_cast<const Bytef*>(b.in.data()), b.in.size());
+        }
+      };
+
+      static int open_file(const char *filename)
+      {
+        int fd = ::open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if (fd == -1)
+          throw Runtime_Error("Could not open: " + string(filename)
+              + ": " + strerror(errno));
+        return fd;
+      }
+
+      Sink::Sink(int fd, int level, unsigned threads, size_t block_size)
+        :
+          fd_(fd),
+          level_(level),
+          block_size_(max<size_t>(block_size, 1))
+      {
+        init(threads);
+      }
+      Sink::Sink(const char *filename, int level, unsigned threads,
+          size_t block_size)
+        :
+          fd_(open_file(filename)),
+          owns_fd_(true),
+          level_(level),
+          block_size_(max<size_t>(block_size, 1))
+      {
+        try {
+          init(threads);
+        } catch (...) {
+          ::close(fd_);
+          throw;
+        }
+      }
+      Sink::Sink(const std::string &filename, int level, unsigned threads,
+          size_t block_size)
+        :
+          Sink(filename.c_str(), level, threads, block_size)
+      {
+      }
+      Sink::~Sink()
+      {
+        try {
+          finish();
+        } catch (...) {
+        }
+        stop();
+        if (owns_fd_)
+          ::close(fd_);
+      }
+
+      void Sink::init(unsigned threads)
+      {
+        if (!threads)
+          threads = max(thread::hardware_concurrency(), 1u);
+        for (unsigned k = 0; k < threads; ++k)
+          deflaters_.emplace_back(new Deflater(level_));
+        buffer_.reserve(block_size_);
+        if (threads < 2)
+          return;
+        try {
+          for (auto &d : deflaters_)
+            workers_.emplace_back(&Sink::work, this, ref(*d));
+        } catch (...) {
+          stop();
+          throw;
+        }
+      }
+
+      void Sink::work(Deflater &d)
+      {
+        for (;;) {
+          Block *b = nullptr;
+          {
+            unique_lock<mutex> l(mutex_);
+            todo_cv_.wait(l, [this]{ return stop_ || !todo_.empty(); });
+            if (todo_.empty())
+              return;
+            b = todo_.front();
+            todo_.pop_front();
+          }
+          try {
+            d.compress(*b);
+          } catch (...) {
+            b->error = current_exception();
+          }
+          {
+            lock_guard<mutex> l(mutex_);
+            b->done = true;
+          }
+          done_cv_.notify_one();
+        }
+      }
+
+      void Sink::stop()
+      {
+        {
+          lock_guard<mutex> l(mutex_);
+          stop_ = true;
+        }
+        todo_cv_.notify_all();
+        for (auto &t : workers_)
+          t.join();
+        workers_.clear();
+      }
+
+      static int write_cb(void *ctx, const char *s, int n)
+      {
+        try {
+          static_cast<Sink*>(ctx)->write(s, s + n);
+        } catch (...) {
+          return -1;
+        }
+        return n;
+      }
+
+      Output_Buffer_Ptr Sink::new_output_buffer(
+          xmlCharEncodingHandler *encoder)
+      {
+        return output_buffer_create_io(write_cb, nullptr, this, encoder);
+      }
+      text_writer::Ptr Sink::new_text_writer()
+      {
+        return xxxml::new_text_writer(new_output_buffer());
+      }
+
+      void Sink::write(const char *begin, const char *end)
+      {
+        if (finished_)
+          throw Logic_Error("gzip sink is already finished");
+        while (begin != end) {
+          size_t k = min<size_t>(end - begin, block_size_ - buffer_.size());
+          buffer_.insert(buffer_.end(), begin, begin + k);
+          begin += k;
+          if (buffer_.size() == block_size_)
+            submit();
+        }
+      }
+
+      vector<char> Sink::spare()
+      {
+        vector<char> r;
+        if (!spare_.empty()) {
+          r.swap(spare_.back());
+          spare_.pop_back();
+        }
+        return r;
+      }
+      void Sink::reuse(vector<char> &v)
+      {
+        v.clear();
+        spare_.push_back(std::move(v));
+      }
+
+      void Sink::submit(bool last)
+      {
+        unique_ptr<Block> b(new Block);
+        b->last = last;
+        b->in.swap(buffer_);
+        buffer_ = spare();
+        buffer_.reserve(block_size_);
+        b->out = spare();
+        // the dictionary of the next block
+        b->dict.swap(dict_);
+        dict_ = spare();
+        size_t k = min(b->in.size(), dict_size);
+        size_t j = min(b->dict.size(), dict_size - k);
+        dict_.insert(dict_.end(), b->dict.end() - j, b->dict.end());
+        dict_.insert(dict_.end(), b->in.end() - k, b->in.end());
+
+        if (workers_.empty()) {
+          deflaters_.front()->compress(*b);
+          b->done = true;
+          pending_.push_back(std::move(b));
+          drain(false);
+          return;
+        }
+        {
+          lock_guard<mutex> l(mutex_);
+          todo_.push_back(b.get());
+          pending_.push_back(std::move(b));
+        }
+        todo_cv_.notify_one();
+        // bounds the memory usage when the workers can't keep up
+        drain(pending_.size() > 2 * workers_.size());
+      }
+
+      void Sink::drain(bool wait)
+      {
+        vector<unique_ptr<Block> > ready;
+        {
+          unique_lock<mutex> l(mutex_);
+          if (wait && !pending_.empty())
+            done_cv_.wait(l, [this]{ return pending_.front()->done; });
+          while (!pending_.empty() && pending_.front()->done) {
+            ready.push_back(std::move(pending_.front()));
+            pending_.pop_front();
+          }
+        }
+        write_blocks(ready);
+      }
+
+      // cf. RFC 1952, no file name, no modification time, OS: Unix
+      static const unsigned char header[10] = {
+        0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 3
+      };
+
+      void Sink::write_blocks(vector<unique_ptr<Block> > &bs)
+      {
+        vector<struct iovec> v;
+        v.reserve(bs.size() + 1);
+        if (!header_written_ && !bs.empty())
+          v.push_back(iovec{ const_cast<unsigned char*>(header),
+              sizeof header });
+        exception_ptr error;
+        size_t n = 0;
+        for (auto &b : bs) {
+          if (b->error) {
+            error = b->error;
+            break;
+          }
+          v.push_back(iovec{ b->out.data(), b->out.size() });
+          crc_ = crc32_combine(crc_, b->crc, b->in.size());
+          size_ += b->in.size();
+          ++n;
+        }
+        for (size_t i = 0; i < v.size(); i += IOV_MAX)
+          detail::write_all(fd_, v.data() + i,
+              int(min<size_t>(IOV_MAX, v.size() - i)));
+        header_written_ = header_written_ || !v.empty();
+        blocks_ += n;
+        if (error)
+          rethrow_exception(error);
+        for (auto &b : bs) {
+          reuse(b->in);
+          reuse(b->dict);
+          reuse(b->out);
+        }
+      }
+
+      void Sink::save(const doc::Ptr &doc, const char *encoding,
+          bool format)
+      {
+        if (!encoding)
+          encoding = reinterpret_cast<const char*>(doc->encoding);
+        Save_Ctxt_Ptr s = save_to_io(write_cb, nullptr, this, encoding,
+            (format ? XML_SAVE_FORMAT : 0) | XML_SAVE_AS_XML);
+        save_doc(s, doc);
+        save_flush(s);
+      }
+
+      void Sink::dump(const doc::Ptr &doc, const xmlNode *node)
+      {
+        Output_Buffer_Ptr o = new_output_buffer();
+        node_dump_output(o, doc, node);
+        output_buffer_flush(o);
+      }
+
+      void Sink::finish()
+      {
+        if (finished_)
+          return;
+        finished_ = true;
+        submit(true);
+        while (!pending_.empty())
+          drain(true);
+        unsigned char trailer[8];
+        for (unsigned i = 0; i < 4; ++i) {
+          trailer[i] = crc_ >> (8 * i);
+          trailer[4 + i] = size_ >> (8 * i);
+        }
+        struct iovec v = { trailer, sizeof trailer };
+        detail::write_all(fd_, &v, 1);
+        stop();
+        if (owns_fd_) {
+          owns_fd_ = false;
+          if (::close(fd_) == -1)
+            throw Runtime_Error(string("Could not close gzip output: ")
+                + strerror(errno));
+        }
+      }
+      void Sink::finish(text_writer::Ptr &writer)
+      {
+        text_writer::flush(writer);
+        finish();
+      }
+
+      size_t Sink::blocks() const
+      {
+        return blocks_;
+      }
+
+      void save_format_file_enc(const char *filename,
+          const doc::Ptr &doc, const char *encoding, bool format,
+          int level, unsigned threads)
+      {
+        Sink s(filename, level, threads);
+        s.save(doc, encoding, format);
+        s.finish();
+      }
+      void save_format_file_enc(const std::string &filename,
+          const doc::Ptr &doc, const char *encoding, bool format,
+          int level, unsigned threads)
+      {
+        save_format_file_enc(filename.c_str(), doc, encoding, format,
+            level, threads);
+      }
+
+      static int close_cb(void *ctx)
+      {
+        unique_ptr<Sink> s(static_cast<Sink*>(ctx));
+        try {
+          s->finish();
+        } catch (...) {
+          return -1;
+        }
+        return 0;
+      }
+
+      text_writer::Ptr new_text_writer_filename(const char *filename,
+          int level, unsigned threads)
+      {
+        unique_ptr<Sink> s(new Sink(filename, level, threads));
+        Output_Buffer_Ptr o = output_buffer_create_io(write_cb, close_cb,
+            s.get());
+        s.release();
+        return xxxml::new_text_writer(std::move(o));
+      }
+      text_writer::Ptr new_text_writer_filename(const std::string &filename,
+          int level, unsigned threads)
+      {
+        return new_text_writer_filename(filename.c_str(), level, threads);
+      }
+
+
+      namespace {
+        struct Inflater {
+          z_stream z;
+
+          Inflater()
+          {
+            memset(&z, 0, sizeof z);
+            if (inflateInit2(&z, 15 + 16) != Z_OK)
+              throw Runtime_Error("Could not initialize inflate");
+          }
+          ~Inflater()
+          {
+            inflateEnd(&z);
+          }
+          Inflater(const Inflater &) = delete;
+          Inflater &operator=(const Inflater &) = delete;
+        };
+      }
+
+      Source::Source(int fd, size_t chunk_size, unsigned chunks)
+        :
+          fd_(fd),
+          chunk_size_(max<size_t>(chunk_size, 1)),
+          ring_(max(chunks, 1u)),
+          sizes_(ring_.size())
+      {
+        start();
+      }
+      Source::Source(const char *filename, size_t chunk_size,
+          unsigned chunks)
+        :
+          fd_(::open(filename, O_RDONLY)),
+          owns_fd_(true),
+          chunk_size_(max<size_t>(chunk_size, 1)),
+          ring_(max(chunks, 1u)),
+          sizes_(ring_.size())
+      {
+        if (fd_ == -1)
+          throw Runtime_Error("Could not open: " + string(filename)
+              + ": " + strerror(errno));
+        try {
+          start();
+        } catch (...) {
+          ::close(fd_);
+          throw;
+        }
+      }
+      Source::Source(const std::string &filename, size_t chunk_size,
+          unsigned chunks)
+        :
+          Source(filename.c_str(), chunk_size, chunks)
+      {
+      }
+      Source::~Source()
+      {
+        {
+          lock_guard<mutex> l(mutex_);
+          stop_ = true;
+        }
+        free_cv_.notify_one();
+        thread_.join();
+        if (owns_fd_)
+          ::close(fd_);
+      }
+
+      void Source::start()
+      {
+        for (auto &c : ring_)
+          c.resize(chunk_size_);
+        thread_ = thread(&Source::run, this);
+      }
+
+      void Source::run()
+      {
+        exception_ptr error;
+        try {
+          produce();
+        } catch (...) {
+          error = current_exception();
+        }
+        {
+          lock_guard<mutex> l(mutex_);
+          eof_ = true;
+          error_ = error;
+        }
+        filled_cv_.notify_one();
+      }
+
+      char *Source::acquire()
+      {
+        unique_lock<mutex> l(mutex_);
+        free_cv_.wait(l, [this]{
+            return stop_ || tail_ - head_ < ring_.size(); });
+        if (stop_)
+          return nullptr;
+        return ring_[tail_ % ring_.size()].data();
+      }
+      void Source::publish(size_t n)
+      {
+        {
+          lock_guard<mutex> l(mutex_);
+          sizes_[tail_ % ring_.size()] = n;
+          ++tail_;
+        }
+        filled_cv_.notify_one();
+      }
+
+      void Source::produce()
+      {
+        posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+        util::Fd_Source file(fd_);
+        vector<char> in(max<size_t>(chunk_size_, 64 * 1024));
+        Inflater inflater;
+        z_stream &z = inflater.z;
+        char *out = acquire();
+        size_t n = 0;
+        bool first = true;
+        bool gzip = true;
+        // i.e. at a member boundary
+        bool end = true;
+        // returns the number of bytes inflated into the current chunk
+        auto inflate = [&]() -> size_t {
+          z.next_out = reinterpret_cast<Bytef*>(out + n);
+          z.avail_out = chunk_size_ - n;
+          int x = ::inflate(&z, Z_NO_FLUSH);
+          end = false;
+          if (x == Z_STREAM_END) {
+            // the next member, if any
+            inflateReset(&z);
+            end = true;
+          } else if (x != Z_OK && x != Z_BUF_ERROR)
+            throw Runtime_Error("Could not inflate: "
+                + string(z.msg ? z.msg : "corrupt input"));
+          return chunk_size_ - n - z.avail_out;
+        };
+        auto advance = [&](size_t k) {
+          n += k;
+          if (n == chunk_size_) {
+            publish(n);
+            n = 0;
+            out = acquire();
+          }
+        };
+        while (out) {
+          ssize_t r = file.read(in.data(), in.size());
+          if (r == -1)
+            throw Runtime_Error("Could not read gzip input: "
+                + string(strerror(errno)));
+          if (!r)
+            break;
+          if (first) {
+            first = false;
+            gzip = r > 1 && (unsigned char)in[0] == 0x1f
+              && (unsigned char)in[1] == 0x8b;
+          }
+          z.next_in = reinterpret_cast<Bytef*>(in.data());
+          z.avail_in = r;
+          while (out && z.avail_in) {
+            if (gzip) {
+              advance(inflate());
+            } else {
+              size_t k = min<size_t>(z.avail_in, chunk_size_ - n);
+              memcpy(out + n, z.next_in, k);
+              z.next_in += k;
+              z.avail_in -= k;
+              advance(k);
+            }
+          }
+        }
+        // output that is still pending in the inflate state
+        while (out && gzip && !end) {
+          size_t k = inflate();
+          if (!k && !end)
+            throw Runtime_Error("Truncated gzip input");
+          advance(k);
+        }
+        if (out && n)
+          publish(n);
+      }
+
+      ssize_t Source::read(char *buf, size_t n)
+      {
+        unique_lock<mutex> l(mutex_);
+        filled_cv_.wait(l, [this]{ return eof_ || head_ < tail_; });
+        if (head_ == tail_) {
+          if (error_)
+            rethrow_exception(error_);
+          return 0;
+        }
+        size_t i = head_ % ring_.size();
+        size_t size = sizes_[i];
+        l.unlock();
+        // the helper thread doesn't touch the chunk until it's released
+        size_t k = min(n, size - pos_);
+        memcpy(buf, ring_[i].data() + pos_, k);
+        pos_ += k;
+        if (pos_ == size) {
+          pos_ = 0;
+          l.lock();
+          ++head_;
+          l.unlock();
+          free_cv_.notify_one();
+        }
+        return k;
+      }
+
+      doc::Ptr read_file(const char *filename, const char *encoding,
+          int options)
+      {
+        Source s(filename);
+        return read_io(s, filename, encoding, options);
+      }
+      doc::Ptr read_file(const std::string &filename, const char *encoding,
+          int options)
+      {
+        return read_file(filename.c_str(), encoding, options);
+      }
+
+      static int source_close_cb(void *ctx)
+      {
+        delete static_cast<Source*>(ctx);
+        return 0;
+      }
+
+      text_reader::Ptr reader_for_file(const char *filename,
+          const char *encoding, int options)
+      {
+        unique_ptr<Source> s(new Source(filename));
+        // from here on, libxml2 closes it, also on error
+        Source *p = s.release();
+        return text_reader::for_io(&detail::source_read_cb<Source>,
+            source_close_cb, p, filename, encoding, options);
+      }
+      text_reader::Ptr reader_for_file(const std::string &filename,
+          const char *encoding, int options)
+      {
+        return reader_for_file(filename.c_str(), encoding, options);
+      }
+
+    }
+
+  }
+
+}
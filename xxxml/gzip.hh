@@ -0,0 +1,232 @@
+#ifndef XXXML_GZIP_HH
+#define XXXML_GZIP_HH
+
+#include <xxxml/xxxml.hh>
+#include <xxxml/io.hh>
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/types.h>
+
+namespace xxxml {
+
+  namespace util {
+
+    // Compressed output where the deflating is done by a pool of threads,
+    // like pigz does it.
+    //
+    // The output is split into blocks that are deflated concurrently.
+    // Each block is primed with the last 32 KiB of its predecessor and
+    // ends on a byte boundary (Z_SYNC_FLUSH), thus, the blocks are
+    // simply concatenated into one gzip member, where the CRC is
+    // combined from the ones of the blocks. The compressed blocks are
+    // written in order, while the calling thread keeps serializing.
+    //
+    // In contrast to a multi-member file, the output is readable by
+    // all gzip implementations, e.g. libxml2 2.9 (when built with lzma
+    // support) stops reading after the first member.
+    //
+    // Example:
+    //
+    //     util::gzip::save_format_file_enc("out.xml.gz", d, "UTF-8");
+    //
+    //     util::gzip::Sink sink("out.xml.gz", 9);
+    //     auto w = sink.new_text_writer();
+    //     ...
+    //     sink.finish(w);
+    namespace gzip {
+
+      class Sink {
+        public:
+          // level: zlib's compression level, i.e. 0 to 9
+          // threads = 0: one per core, threads = 1: deflates on the
+          // calling thread
+          // The fd isn't closed.
+          explicit Sink(int fd, int level = 6, unsigned threads = 0,
+              size_t block_size = 128 * 1024);
+          // creates/truncates the file
+          explicit Sink(const char *filename, int level = 6,
+              unsigned threads = 0, size_t block_size = 128 * 1024);
+          explicit Sink(const std::string &filename, int level = 6,
+              unsigned threads = 0, size_t block_size = 128 * 1024);
+          // finishes, ignoring errors
+          ~Sink();
+          Sink(const Sink &) = delete;
+          Sink &operator=(const Sink &) = delete;
+
+          Output_Buffer_Ptr new_output_buffer(
+              xmlCharEncodingHandler *encoder = nullptr);
+          text_writer::Ptr new_text_writer();
+
+          void write(const char *begin, const char *end);
+          // cf. save_format_file_enc()
+          void save(const doc::Ptr &doc, const char *encoding = nullptr,
+              bool format = true);
+          // cf. util::dump()
+          void dump(const doc::Ptr &doc, const xmlNode *node);
+
+          // compresses and writes the remaining blocks and closes
+          // the file, further writes throw
+          void finish();
+          // flushes the writer, then finishes
+          void finish(text_writer::Ptr &writer);
+
+          // number of compressed blocks written, so far
+          size_t blocks() const;
+        private:
+          struct Block;
+          struct Deflater;
+
+          int fd_ {-1};
+          bool owns_fd_ {false};
+          bool finished_ {false};
+          int level_;
+          size_t block_size_;
+          std::vector<char> buffer_;
+          size_t blocks_ {0};
+          // last 32 KiB of the previous block
+          std::vector<char> dict_;
+          bool header_written_ {false};
+          unsigned long crc_ {0};
+          unsigned long long size_ {0};
+
+          // one per thread
+          std::vector<std::unique_ptr<Deflater> > deflaters_;
+
+          std::mutex mutex_;
+          std::condition_variable todo_cv_;
+          std::condition_variable done_cv_;
+          // in output order
+          std::deque<std::unique_ptr<Block> > pending_;
+          std::deque<Block*> todo_;
+          std::vector<std::vector<char> > spare_;
+          bool stop_ {false};
+          std::vector<std::thread> workers_;
+
+          void init(unsigned threads);
+          void submit(bool last = false);
+          // writes the compressed blocks at the front,
+          // waits for the front one if wait is true
+          void drain(bool wait);
+          void work(Deflater &d);
+          void stop();
+          void write_blocks(std::vector<std::unique_ptr<Block> > &bs);
+          void reuse(std::vector<char> &v);
+          std::vector<char> spare();
+      };
+
+      // the output is identical to save_format_file_enc(), after
+      // decompression
+      void save_format_file_enc(const char *filename,
+          const doc::Ptr &doc,
+          const char *encoding = nullptr,
+          bool format = true,
+          int level = 6,
+          unsigned threads = 0);
+      void save_format_file_enc(const std::string &filename,
+          const doc::Ptr &doc,
+          const char *encoding = nullptr,
+          bool format = true,
+          int level = 6,
+          unsigned threads = 0);
+
+      // The writer owns the sink, i.e. the file is finished when the
+      // writer is freed and errors at that point are ignored. Use a
+      // Sink to check those.
+      text_writer::Ptr new_text_writer_filename(const char *filename,
+          int level = 6, unsigned threads = 0);
+      text_writer::Ptr new_text_writer_filename(const std::string &filename,
+          int level = 6, unsigned threads = 0);
+
+
+      // Source (cf. xxxml/io.hh) that reads and inflates gzip input on
+      // a helper thread, i.e. the decompression overlaps with the
+      // parsing. Multi-member files (e.g. concatenated gzip files) are
+      // read completely, other input is passed through unchanged.
+      //
+      // The inflated data is handed over in a ring of chunks chunk_size
+      // bytes each, thus, the memory usage is bounded, independent of
+      // the file size. When the ring is full, the helper thread waits
+      // for the parser.
+      //
+      // Read and decompression errors are rethrown by read().
+      //
+      // Example:
+      //
+      //     doc::Ptr d = util::gzip::read_file("in.xml.gz");
+      //
+      //     util::gzip::Source s("in.xml.gz");
+      //     auto r = text_reader::for_io(s);
+      //     while (text_reader::read(r)) {
+      //       ...
+      //     }
+      class Source {
+        public:
+          // The fd isn't closed.
+          explicit Source(int fd, size_t chunk_size = 256 * 1024,
+              unsigned chunks = 4);
+          explicit Source(const char *filename,
+              size_t chunk_size = 256 * 1024, unsigned chunks = 4);
+          explicit Source(const std::string &filename,
+              size_t chunk_size = 256 * 1024, unsigned chunks = 4);
+          // stops the helper thread, also when the input isn't read
+          // completely
+          ~Source();
+          Source(const Source &) = delete;
+          Source &operator=(const Source &) = delete;
+
+          ssize_t read(char *buf, size_t n);
+        private:
+          int fd_ {-1};
+          bool owns_fd_ {false};
+          size_t chunk_size_;
+          std::vector<std::vector<char> > ring_;
+          std::vector<size_t> sizes_;
+          // number of consumed/filled chunks, the chunks in between
+          // are ready to be read
+          size_t head_ {0};
+          size_t tail_ {0};
+          // in the head chunk
+          size_t pos_ {0};
+          bool eof_ {false};
+          bool stop_ {false};
+          std::exception_ptr error_;
+          std::mutex mutex_;
+          std::condition_variable filled_cv_;
+          std::condition_variable free_cv_;
+          std::thread thread_;
+
+          void start();
+          void run();
+          void produce();
+          // returns nullptr when stopped
+          char *acquire();
+          void publish(size_t n);
+      };
+
+      // i.e. read_io() with a Source
+      doc::Ptr read_file(const char *filename,
+          const char *encoding = nullptr, int options = 0);
+      doc::Ptr read_file(const std::string &filename,
+          const char *encoding = nullptr, int options = 0);
+      // the reader owns the Source, read errors are reported as
+      // reader errors (cf. text_reader::for_io())
+      text_reader::Ptr reader_for_file(const char *filename,
+          const char *encoding = nullptr, int options = 0);
+      text_reader::Ptr reader_for_file(const std::string &filename,
+          const char *encoding = nullptr, int options = 0);
+
+    }
+
+  }
+
+}
+
+#endif
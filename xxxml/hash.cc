@@ -0,0 +1,200 @@
+#include "hash.hh"
+#include "parallel.hh"
+
+#include <vector>
+
+using namespace std;
+
+namespace xxxml {
+
+  namespace util {
+
+    namespace hash {
+
+      // node type tags, such that e.g. an element and a text node
+      // with the same name/content don't collide
+      enum : Value {
+        ELEMENT_TAG   = 0x454c454d454e5401ull,
+        ATTRIBUTE_TAG = 0x4154545249425502ull,
+        TEXT_TAG      = 0x5445585400000003ull,
+        CDATA_TAG     = 0x4344415441000004ull,
+        COMMENT_TAG   = 0x434f4d4d454e5405ull,
+        PI_TAG        = 0x5049000000000006ull,
+        ENTITY_TAG    = 0x454e544954590007ull,
+        OTHER_TAG     = 0x4f54484552000008ull,
+        NULL_STR      = 0x4e554c4c00000009ull
+      };
+
+      // murmur3 finalizer
+      static Value mix(Value h)
+      {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33;
+        return h;
+      }
+      static Value combine(Value h, Value v)
+      {
+        return mix(h ^ (v + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2)));
+      }
+
+      // FNV-1a, can be continued over several pieces
+      static const Value FNV_OFFSET = 0xcbf29ce484222325ull;
+      static Value fnv(Value h, const xmlChar *s)
+      {
+        for (; *s; ++s) {
+          h ^= *s;
+          h *= 0x100000001b3ull;
+        }
+        return h;
+      }
+      static Value str(const xmlChar *s)
+      {
+        if (!s)
+          return NULL_STR;
+        return fnv(FNV_OFFSET, s);
+      }
+      static Value ns_href(const xmlNs *ns)
+      {
+        return str(ns ? ns->href : nullptr);
+      }
+
+      static Value open(const xmlNode *x)
+      {
+        Value h = combine(ELEMENT_TAG, str(x->name));
+        h = combine(h, ns_href(x->ns));
+        // order independent: sum of the mixed attribute hashes
+        Value attrs = 0;
+        for (auto a = x->properties; a; a = a->next) {
+          Value v = FNV_OFFSET;
+          for (auto t = a->children; t; t = t->next)
+            if (t->content)
+              v = fnv(v, t->content);
+          Value k = combine(ATTRIBUTE_TAG, str(a->name));
+          k = combine(k, ns_href(a->ns));
+          attrs += mix(combine(k, v));
+        }
+        return combine(h, attrs);
+      }
+
+      static Value leaf(const xmlNode *x)
+      {
+        switch (x->type) {
+          case XML_TEXT_NODE:
+            return combine(TEXT_TAG, str(x->content));
+          case XML_CDATA_SECTION_NODE:
+            return combine(CDATA_TAG, str(x->content));
+          case XML_COMMENT_NODE:
+            return combine(COMMENT_TAG, str(x->content));
+          case XML_PI_NODE:
+            return combine(combine(PI_TAG, str(x->name)), str(x->content));
+          case XML_ENTITY_REF_NODE:
+            return combine(ENTITY_TAG, str(x->name));
+          default:
+            return combine(OTHER_TAG, Value(x->type));
+        }
+      }
+
+      namespace {
+        struct Frame {
+          const xmlNode *node;
+          Value h;
+        };
+      }
+
+      // iterative, i.e. the depth isn't limited by the call stack
+      static Value subtree(const xmlNode *node, Map *m)
+      {
+        vector<Frame> st;
+        auto x = node;
+        for (;;) {
+          if (x->type == XML_ELEMENT_NODE) {
+            st.push_back(Frame{x, open(x)});
+            if (x->children) {
+              x = x->children;
+              continue;
+            }
+          } else {
+            Value v = leaf(x);
+            if (st.empty())
+              return v;
+            st.back().h = combine(st.back().h, v);
+          }
+          for (;;) {
+            if (x->type == XML_ELEMENT_NODE) {
+              Value v = mix(st.back().h);
+              if (m)
+                (*m)[x] = v;
+              st.pop_back();
+              if (st.empty())
+                return v;
+              st.back().h = combine(st.back().h, v);
+            }
+            if (x->next) {
+              x = x->next;
+              break;
+            }
+            x = x->parent;
+          }
+        }
+      }
+
+      Value subtree(const xmlNode *node)
+      {
+        return subtree(node, nullptr);
+      }
+      Value subtree(const xmlNode *node, Map &m)
+      {
+        return subtree(node, &m);
+      }
+
+      Map subtrees(const doc::Ptr &doc, unsigned threads)
+      {
+        Map r;
+        const xmlNode *root = xmlDocGetRootElement(doc.get());
+        if (!root)
+          return r;
+        vector<const xmlNode*> children;
+        for (auto i = first_element_child(root); i; i = next_element_sibling(i))
+          children.push_back(i);
+        if (threads < 2 || children.size() < 2) {
+          subtree(root, &r);
+          return r;
+        }
+        if (threads > children.size())
+          threads = children.size();
+
+        // the children are handed out one by one, thus, a few large
+        // subtrees don't stall the other threads
+        vector<Value> hashes(children.size());
+        vector<Map> maps(threads);
+        xxxml::detail::parallel_for(children.size(), threads,
+            [&hashes, &maps, &children](size_t i, unsigned k) {
+            hashes[i] = subtree(children[i], &maps[k]);
+            });
+
+        size_t n = 1;
+        for (auto &m : maps)
+          n += m.size();
+        r.reserve(n);
+        for (auto &m : maps)
+          r.insert(m.begin(), m.end());
+
+        Value h = open(root);
+        size_t i = 0;
+        for (auto x = root->children; x; x = x->next)
+          if (x->type == XML_ELEMENT_NODE)
+            h = combine(h, hashes[i++]);
+          else
+            h = combine(h, leaf(x));
+        r[root] = mix(h);
+        return r;
+      }
+
+    }
+
+  }
+
+}
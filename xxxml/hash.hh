@@ -0,0 +1,52 @@
+#ifndef XXXML_HASH_HH
+#define XXXML_HASH_HH
+
+#include <xxxml/xxxml.hh>
+
+#include <stdint.h>
+#include <unordered_map>
+
+namespace xxxml {
+
+  namespace util {
+
+    // Structural (Merkle) hashes of subtrees, e.g. for detecting
+    // which parts of a document changed without serializing it.
+    //
+    // The hash of an element covers:
+    //
+    // - the local name and the namespace URI (not the prefix)
+    // - the attributes (name, namespace URI, value), independent
+    //   of their order
+    // - the hashes of its children in document order, i.e. of child
+    //   elements, text, CDATA sections, comments and PIs
+    //
+    // Namespace declarations themselves are not covered.
+    //
+    // The values are stable, i.e. they don't depend on pointer
+    // values, the process or the platform, thus, they can be stored
+    // and compared to hashes of later document versions.
+    namespace hash {
+
+      using Value = uint64_t;
+      using Map = std::unordered_map<const xmlNode*, Value>;
+
+      Value subtree(const xmlNode *node);
+      // also stores the hash of each element of the subtree
+      Value subtree(const xmlNode *node, Map &m);
+
+      // Hashes all elements of the document.
+      //
+      // With threads > 1, the subtrees of the top-level children
+      // (i.e. the children of the root element) are distributed
+      // over that many threads. Since the document is only read,
+      // this is safe as long as no other thread modifies it.
+      Map subtrees(const doc::Ptr &doc, unsigned threads = 1);
+
+    }
+
+  }
+
+}
+
+#endif
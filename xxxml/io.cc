@@ -0,0 +1,129 @@
+#include "io.hh"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+using namespace std;
+
+namespace xxxml {
+
+  namespace detail {
+
+    void write_all(int fd, struct iovec *v, int n)
+    {
+      while (n) {
+        ssize_t r = ::writev(fd, v, n);
+        if (r == -1) {
+          if (errno == EINTR)
+            continue;
+          throw Runtime_Error("writev failed: " + string(strerror(errno)));
+        }
+        size_t k = r;
+        while (n && k >= v->iov_len) {
+          k -= v->iov_len;
+          ++v;
+          --n;
+        }
+        if (n) {
+          v->iov_base = static_cast<char*>(v->iov_base) + k;
+          v->iov_len -= k;
+        }
+      }
+    }
+
+  }
+
+  namespace util {
+
+    Fd_Source::Fd_Source(int fd)
+      :
+        fd_(fd)
+    {
+    }
+
+    ssize_t Fd_Source::read(char *buf, size_t n)
+    {
+      for (;;) {
+        ssize_t r = ::read(fd_, buf, n);
+        if (r == -1 && errno == EINTR)
+          continue;
+        return r;
+      }
+    }
+
+    Fd_Sink::Fd_Sink(int fd, size_t buffer_size)
+      :
+        fd_(fd),
+        buffer_(buffer_size ? buffer_size : 1)
+    {
+    }
+    Fd_Sink::~Fd_Sink()
+    {
+      try {
+        flush();
+      } catch (...) {
+      }
+    }
+
+    Output_Buffer_Ptr Fd_Sink::new_output_buffer(
+        xmlCharEncodingHandler *encoder)
+    {
+      return output_buffer_create_io(write_cb, nullptr, this, encoder);
+    }
+    text_writer::Ptr Fd_Sink::new_text_writer()
+    {
+      return xxxml::new_text_writer(new_output_buffer());
+    }
+
+    int Fd_Sink::write_cb(void *ctx, const char *s, int n)
+    {
+      try {
+        static_cast<Fd_Sink*>(ctx)->write(s, s + n);
+      } catch (...) {
+        return -1;
+      }
+      return n;
+    }
+
+    void Fd_Sink::write(const char *begin, const char *end)
+    {
+      size_t k = end - begin;
+      if (n_ + k <= buffer_.size()) {
+        memcpy(buffer_.data() + n_, begin, k);
+        n_ += k;
+        return;
+      }
+      struct iovec v[2] = {
+        { buffer_.data(), n_ },
+        { const_cast<char*>(begin), k }
+      };
+      // reset first, such that a failed write isn't repeated
+      n_ = 0;
+      ++writes_;
+      detail::write_all(fd_, v, 2);
+    }
+    void Fd_Sink::flush()
+    {
+      if (!n_)
+        return;
+      struct iovec v = { buffer_.data(), n_ };
+      n_ = 0;
+      ++writes_;
+      detail::write_all(fd_, &v, 1);
+    }
+    void Fd_Sink::flush(text_writer::Ptr &writer)
+    {
+      text_writer::flush(writer);
+      flush();
+    }
+
+    size_t Fd_Sink::writes() const
+    {
+      return writes_;
+    }
+
+  }
+
+}
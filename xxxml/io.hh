@@ -0,0 +1,236 @@
+#ifndef XXXML_IO_HH
+#define XXXML_IO_HH
+
+#include <xxxml/xxxml.hh>
+
+#include <exception>
+#include <vector>
+#include <sys/types.h>
+
+struct iovec;
+
+// Parsing from C++ source objects, e.g. pipes, sockets or in-process
+// decompressors, without staging the input in memory or in a file.
+//
+// A source is either a class with a
+//
+//     ssize_t read(char *buf, size_t n);
+//
+// member or a callable with the same signature. It returns the number
+// of bytes read, 0 at the end of the input and -1 on error.
+// The source isn't owned, i.e. for a text reader it must outlive the
+// reader.
+//
+// Exceptions thrown by a source are rethrown by read_io(),
+// ctxt_read_io() and schema::validate_io(). Since a text reader reads
+// lazily, for_io() readers report them as read errors, instead.
+
+namespace xxxml {
+
+  namespace detail {
+
+    // writev() that retries on EINTR and short writes,
+    // throws Runtime_Error
+    void write_all(int fd, struct iovec *v, int n);
+
+    // xmlOutputWriteCallback that appends to a std::string or
+    // std::vector<char>
+    template <typename Buffer>
+      int append_cb(void *ctx, const char *s, int n)
+      {
+        auto b = static_cast<Buffer*>(ctx);
+        try {
+          b->insert(b->end(), s, s + n);
+        } catch (...) {
+          return -1;
+        }
+        return n;
+      }
+
+    template <typename Source>
+      auto source_read(Source &s, char *buf, size_t n, int)
+      -> decltype(s.read(buf, n))
+      {
+        return s.read(buf, n);
+      }
+    template <typename Source>
+      auto source_read(Source &s, char *buf, size_t n, long)
+      -> decltype(s(buf, n))
+      {
+        return s(buf, n);
+      }
+
+    template <typename Source>
+      int call_source(Source &s, char *buf, int len)
+      {
+        auto r = source_read(s, buf, size_t(len), 0);
+        if (r < 0)
+          return -1;
+        return int(r);
+      }
+
+    template <typename Source>
+      int source_read_cb(void *ctx, char *buf, int len)
+      {
+        try {
+          return call_source(*static_cast<Source*>(ctx), buf, len);
+        } catch (...) {
+          return -1;
+        }
+      }
+
+    template <typename Source>
+      struct Source_Ctx {
+        Source *source;
+        std::exception_ptr error;
+      };
+
+    template <typename Source>
+      int source_ctx_read_cb(void *ctx, char *buf, int len)
+      {
+        auto c = static_cast<Source_Ctx<Source>*>(ctx);
+        try {
+          return call_source(*c->source, buf, len);
+        } catch (...) {
+          c->error = std::current_exception();
+          return -1;
+        }
+      }
+
+    template <typename Source, typename F>
+      auto read_source(Source &source, F f)
+      -> decltype(f(xmlInputReadCallback(), static_cast<void*>(nullptr)))
+      {
+        Source_Ctx<Source> c { &source, nullptr };
+        try {
+          return f(&source_ctx_read_cb<Source>, static_cast<void*>(&c));
+        } catch (...) {
+          if (c.error)
+            std::rethrow_exception(c.error);
+          throw;
+        }
+      }
+
+  }
+
+  template <typename Source>
+    doc::Ptr read_io(Source &source,
+        const char *URL = nullptr, const char *encoding = nullptr,
+        int options = 0)
+    {
+      return detail::read_source(source,
+          [=](xmlInputReadCallback cb, void *ctx) {
+            return read_io(cb, nullptr, ctx, URL, encoding, options); });
+    }
+  template <typename Source>
+    doc::Ptr ctxt_read_io(Parser_Ctxt_Ptr &parser_context, Source &source,
+        const char *URL = nullptr, const char *encoding = nullptr,
+        int options = 0)
+    {
+      return detail::read_source(source,
+          [&](xmlInputReadCallback cb, void *ctx) {
+            return ctxt_read_io(parser_context, cb, nullptr, ctx,
+                URL, encoding, options); });
+    }
+
+  namespace schema {
+
+    // streaming validation, cf. validate_stream()
+    template <typename Source>
+      void validate_io(Valid_Ctxt_Ptr &valid_ctxt, Source &source,
+          xmlCharEncoding enc = XML_CHAR_ENCODING_NONE)
+      {
+        detail::read_source(source,
+            [&](xmlInputReadCallback cb, void *ctx) {
+              validate_stream(valid_ctxt,
+                  parser_input_buffer_create_io(cb, nullptr, ctx),
+                  enc); });
+      }
+
+  }
+
+  namespace text_reader {
+
+    template <typename Source>
+      Ptr for_io(Source &source, const char *url = nullptr,
+          const char *encoding = nullptr, int options = 0)
+      {
+        return for_io(&detail::source_read_cb<Source>, nullptr,
+            static_cast<void*>(&source), url, encoding, options);
+      }
+    template <typename Source>
+      void reset_io(Ptr &reader, Source &source, const char *url = nullptr,
+          const char *encoding = nullptr, int options = 0)
+      {
+        reset_io(reader, &detail::source_read_cb<Source>, nullptr,
+            static_cast<void*>(&source), url, encoding, options);
+      }
+
+  }
+
+  namespace util {
+
+    // Source that reads from a file descriptor (e.g. a pipe or
+    // socket), retries on EINTR. The fd isn't closed.
+    class Fd_Source {
+      public:
+        explicit Fd_Source(int fd);
+        ssize_t read(char *buf, size_t n);
+      private:
+        int fd_;
+    };
+
+    // Sink that writes to a file descriptor (e.g. a socket) in large
+    // blocks: libxml2 hands out its output in chunks of about 4 KiB,
+    // the sink collects them in a buffer of buffer_size bytes. When a
+    // chunk doesn't fit anymore, the buffer and the chunk are written
+    // with one writev(), i.e. without copying the chunk.
+    // The fd isn't closed.
+    //
+    // The sink must outlive the writers and output buffers created
+    // from it. Since libxml2 doesn't pass flushes through, call
+    // flush() at the end of a document, e.g. of an HTTP response.
+    // Write errors are reported as Runtime_Error by the writer
+    // (or by flush()).
+    //
+    // Example:
+    //
+    //     util::Fd_Sink sink(fd);
+    //     auto w = sink.new_text_writer();
+    //     text_writer::start_document(w);
+    //     ...
+    //     text_writer::end_document(w);
+    //     sink.flush(w);
+    class Fd_Sink {
+      public:
+        explicit Fd_Sink(int fd, size_t buffer_size = 64 * 1024);
+        // flushes, ignoring errors
+        ~Fd_Sink();
+        Fd_Sink(const Fd_Sink &) = delete;
+        Fd_Sink &operator=(const Fd_Sink &) = delete;
+
+        Output_Buffer_Ptr new_output_buffer(
+            xmlCharEncodingHandler *encoder = nullptr);
+        text_writer::Ptr new_text_writer();
+
+        void write(const char *begin, const char *end);
+        void flush();
+        // flushes the writer, then the sink
+        void flush(text_writer::Ptr &writer);
+
+        // number of write system calls, so far
+        size_t writes() const;
+      private:
+        int fd_;
+        std::vector<char> buffer_;
+        size_t n_ {0};
+        size_t writes_ {0};
+
+        static int write_cb(void *ctx, const char *s, int n);
+    };
+
+  }
+
+}
+
+#endif
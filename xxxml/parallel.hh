@@ -0,0 +1,56 @@
+#ifndef XXXML_PARALLEL_HH
+#define XXXML_PARALLEL_HH
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <stddef.h>
+#include <thread>
+#include <vector>
+
+namespace xxxml {
+
+  namespace detail {
+
+    // Calls f(i, k) for each i in [0, n) on up to `threads` threads,
+    // where k < threads identifies the calling worker, e.g. for
+    // per-thread state. The calling thread is worker 0.
+    //
+    // The indices are handed out one by one, thus, a few expensive
+    // items don't stall the other threads. After the first exception
+    // no further indices are handed out, and it is rethrown once all
+    // threads are joined.
+    template <typename F>
+      void parallel_for(size_t n, unsigned threads, F f)
+      {
+        if (!n)
+          return;
+        threads = unsigned(std::min(std::max(size_t(threads), size_t(1)),
+              n));
+        std::vector<std::exception_ptr> errors(threads);
+        std::atomic<size_t> next(0);
+        auto work = [&](unsigned k) {
+          try {
+            for (size_t i; (i = next++) < n; )
+              f(i, k);
+          } catch (...) {
+            errors[k] = std::current_exception();
+            next = n;
+          }
+        };
+        std::vector<std::thread> ts;
+        for (unsigned k = 1; k < threads; ++k)
+          ts.emplace_back(work, k);
+        work(0);
+        for (auto &t : ts)
+          t.join();
+        for (auto &e : errors)
+          if (e)
+            std::rethrow_exception(e);
+      }
+
+  }
+
+}
+
+#endif
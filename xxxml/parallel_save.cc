@@ -0,0 +1,382 @@
+#include "parallel_save.hh"
+#include "io.hh"
+#include "parallel.hh"
+
+#include <libxml/globals.h>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+using namespace std;
+
+namespace xxxml {
+
+  namespace util {
+
+    namespace parallel {
+
+      using Buffer = vector<char>;
+      using xxxml::detail::append_cb;
+
+      static bool compatible(const char *encoding)
+      {
+        if (!encoding)
+          return true;
+        switch (xmlParseCharEncoding(encoding)) {
+          case XML_CHAR_ENCODING_UTF8:
+          case XML_CHAR_ENCODING_ASCII:
+          case XML_CHAR_ENCODING_8859_1:
+          case XML_CHAR_ENCODING_8859_2:
+          case XML_CHAR_ENCODING_8859_3:
+          case XML_CHAR_ENCODING_8859_4:
+          case XML_CHAR_ENCODING_8859_5:
+          case XML_CHAR_ENCODING_8859_6:
+          case XML_CHAR_ENCODING_8859_7:
+          case XML_CHAR_ENCODING_8859_8:
+          case XML_CHAR_ENCODING_8859_9:
+            return true;
+          default:
+            return false;
+        }
+      }
+
+      static bool is_xhtml(const xmlDoc *doc)
+      {
+        const xmlDtd *dtd = doc->intSubset;
+        return dtd && xmlIsXHTML(dtd->SystemID, dtd->ExternalID) == 1;
+      }
+
+      // xmlNodeDumpOutputInternal() doesn't format the content of
+      // elements with such children
+      static bool mixed(const xmlNode *node)
+      {
+        for (auto x = node->children; x; x = x->next)
+          if (x->type == XML_TEXT_NODE || x->type == XML_CDATA_SECTION_NODE
+              || x->type == XML_ENTITY_REF_NODE)
+            return true;
+        return false;
+      }
+
+      // Text that xmlEscapeEntities() (used by libxml2 when saving without
+      // encoding) escapes differently than xmlEscapeContent() (used by
+      // xmlNodeDumpOutput()).
+      static bool escapes_differ(const xmlNode *node)
+      {
+        auto x = node;
+        for (;;) {
+          if (x->type == XML_TEXT_NODE && x->content)
+            for (auto s = x->content; *s; ++s)
+              if (*s >= 0x80 || (*s < 0x20 && *s != '\n' && *s != '\t'))
+                return true;
+          if (x->type == XML_ELEMENT_NODE && x->children) {
+            x = x->children;
+            continue;
+          }
+          for (;;) {
+            if (x == node)
+              return false;
+            if (x->next) {
+              x = x->next;
+              break;
+            }
+            x = x->parent;
+          }
+        }
+      }
+
+      // libxml2's serialization settings are thread-local
+      namespace {
+        struct Settings {
+          int indent_tree_output;
+          const char *indent_string;
+          int no_empty_tags;
+
+          Settings()
+            :
+              indent_tree_output(xmlIndentTreeOutput),
+              indent_string(xmlTreeIndentString),
+              no_empty_tags(xmlSaveNoEmptyTags)
+          {
+          }
+          void apply() const
+          {
+            xmlIndentTreeOutput = indent_tree_output;
+            xmlTreeIndentString = indent_string;
+            xmlSaveNoEmptyTags = no_empty_tags;
+          }
+          // cf. xmlSaveCtxtInit()
+          string indent() const
+          {
+            if (!indent_tree_output || !indent_string)
+              return string();
+            size_t n = strlen(indent_string);
+            if (n > 60)
+              return string();
+            return string(indent_string, n);
+          }
+        };
+
+        struct Pieces {
+          Buffer head;
+          vector<Buffer> chunks;
+          Buffer tail;
+        };
+      }
+
+      static int save_options(bool format)
+      {
+        return (format ? XML_SAVE_FORMAT : 0) | XML_SAVE_AS_XML;
+      }
+
+      static int sink_cb(void *ctx, const char *s, int n)
+      {
+        try {
+          static_cast<Fd_Sink*>(ctx)->write(s, s + n);
+        } catch (...) {
+          return -1;
+        }
+        return n;
+      }
+
+      static void sequential(const doc::Ptr &doc, const char *encoding,
+          bool format, xmlOutputWriteCallback cb, void *ctx)
+      {
+        Save_Ctxt_Ptr s = save_to_io(cb, nullptr, ctx, encoding,
+            save_options(format));
+        save_doc(s, doc);
+        save_flush(s);
+      }
+
+      // XML declaration, top-level nodes and the root start and end tags
+      static void frame(const doc::Ptr &doc, const char *encoding,
+          bool format, Pieces &p)
+      {
+        const xmlNode *root = xmlDocGetRootElement(doc.get());
+        doc::Ptr tmp(xmlNewDoc(doc->version), xmlFreeDoc);
+        if (!tmp)
+          throw Runtime_Error("Could not allocate document");
+        tmp->standalone = doc->standalone;
+        // attribute values are escaped depending on it
+        if (doc->encoding)
+          tmp->encoding = xmlStrdup(doc->encoding);
+
+        Buffer *b = &p.head;
+        Save_Ctxt_Ptr s = save_to_io(append_cb<Buffer>, nullptr, b,
+            encoding, save_options(format));
+        save_doc(s, tmp);
+        save_flush(s);
+        for (auto x = doc->children; x; x = x->next) {
+          if (x != root) {
+            save_tree(s, x);
+            save_flush(s);
+            if (x->type != XML_XINCLUDE_START && x->type != XML_XINCLUDE_END)
+              b->push_back('\n');
+            continue;
+          }
+          // a shallow copy with an empty comment as placeholder for
+          // the children
+          xmlNode *r = xmlDocCopyNode(const_cast<xmlNode*>(root),
+              tmp.get(), 2);
+          if (!r)
+            throw Runtime_Error("Could not copy root");
+          xmlDocSetRootElement(tmp.get(), r);
+          add_child(r, xmlNewDocComment(tmp.get(),
+                reinterpret_cast<const xmlChar*>("")));
+          Buffer t;
+          Save_Ctxt_Ptr u = save_to_io(append_cb<Buffer>, nullptr, &t,
+              encoding, save_options(false));
+          save_tree(u, r);
+          save_flush(u);
+          static const char placeholder[] = "<!---->";
+          auto i = search(t.begin(), t.end(), placeholder,
+              placeholder + sizeof placeholder - 1);
+          if (i == t.end())
+            throw Logic_Error("root placeholder not found");
+          b->insert(b->end(), t.begin(), i);
+          b = &p.tail;
+          b->insert(b->end(), i + sizeof placeholder - 1, t.end());
+          b->push_back('\n');
+          s = save_to_io(append_cb<Buffer>, nullptr, b, encoding,
+              save_options(format));
+        }
+      }
+
+      // returns false if the document has to be serialized sequentially
+      static bool serialize(const doc::Ptr &doc, const char *encoding,
+          bool format, unsigned threads, Pieces &p)
+      {
+        const xmlNode *root = xmlDocGetRootElement(doc.get());
+        vector<const xmlNode*> children;
+        if (root)
+          for (auto x = root->children; x; x = x->next)
+            children.push_back(x);
+        if (!threads)
+          threads = thread::hardware_concurrency();
+        if (threads < 2 || children.size() < 2
+            || doc->type != XML_DOCUMENT_NODE || is_xhtml(doc.get())
+            || !compatible(encoding)
+            || any_of(children.begin(), children.end(), [](const xmlNode *x) {
+                return x->type == XML_XINCLUDE_START
+                    || x->type == XML_XINCLUDE_END; }))
+          return false;
+        bool formatted = format && !mixed(root);
+        frame(doc, encoding, format, p);
+        if (formatted)
+          p.head.push_back('\n');
+
+        // the groups are handed out one by one, thus, a few large
+        // subtrees don't stall the other threads
+        size_t group = max<size_t>(1, children.size() / (threads * 16));
+        size_t n = (children.size() + group - 1) / group;
+        if (threads > n)
+          threads = n;
+        p.chunks.resize(n);
+        Settings settings;
+        string indent = settings.indent();
+        atomic<bool> differ(false);
+        xxxml::detail::parallel_for(n, threads, [&](size_t i, unsigned) {
+            if (differ)
+              return;
+            // cheap enough to repeat for each group
+            settings.apply();
+            Buffer &b = p.chunks[i];
+            auto first = children.begin() + i * group;
+            auto last = children.begin() + min(children.size(),
+                (i + 1) * group);
+            if (!formatted) {
+              // the level doesn't matter, thus, with libxml2's
+              // escaping of the complete document
+              Save_Ctxt_Ptr s = save_to_io(append_cb<Buffer>, nullptr, &b,
+                  encoding, save_options(false));
+              for (auto x = first; x != last; ++x)
+                save_tree(s, *x);
+              save_flush(s);
+              return;
+            }
+            if (!encoding && any_of(first, last, escapes_differ)) {
+              differ = true;
+              return;
+            }
+            Output_Buffer_Ptr o = output_buffer_create_mem(b, encoding
+                ? xmlFindCharEncodingHandler(encoding) : nullptr);
+            for (auto x = first; x != last; ++x) {
+              output_buffer_write(o, indent.data(),
+                  indent.data() + indent.size());
+              node_dump_output(o, doc, *x, 1, true, encoding);
+              output_buffer_write(o, "\n", "\n" + 1);
+            }
+            output_buffer_flush(o);
+            });
+        return !differ;
+      }
+
+      static const char *effective(const doc::Ptr &doc, const char *encoding)
+      {
+        if (!encoding)
+          encoding = reinterpret_cast<const char*>(doc->encoding);
+        return encoding;
+      }
+
+      static void write(int fd, Pieces &p)
+      {
+        vector<struct iovec> v;
+        v.reserve(p.chunks.size() + 2);
+        auto add = [&v](Buffer &b) {
+          if (!b.empty())
+            v.push_back(iovec{ b.data(), b.size() });
+        };
+        add(p.head);
+        for (auto &c : p.chunks)
+          add(c);
+        add(p.tail);
+        for (size_t i = 0; i < v.size(); i += IOV_MAX)
+          detail::write_all(fd, v.data() + i,
+              int(min<size_t>(IOV_MAX, v.size() - i)));
+      }
+
+      void save_format_file_enc(const char *filename,
+          const doc::Ptr &doc, const char *encoding, bool format,
+          unsigned threads)
+      {
+        // compression is done by libxml2's file output
+        if (doc->compression > 0) {
+          xxxml::save_format_file_enc(filename, doc, encoding, format);
+          return;
+        }
+        Pieces p;
+        if (!serialize(doc, effective(doc, encoding), format, threads, p)) {
+          xxxml::save_format_file_enc(filename, doc, encoding, format);
+          return;
+        }
+        int fd = ::open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if (fd == -1)
+          throw Runtime_Error("Could not save: " + string(filename)
+              + ": " + strerror(errno));
+        try {
+          write(fd, p);
+        } catch (...) {
+          ::close(fd);
+          throw;
+        }
+        if (::close(fd) == -1)
+          throw Runtime_Error("Could not save: " + string(filename)
+              + ": " + strerror(errno));
+      }
+      void save_format_file_enc(const std::string &filename,
+          const doc::Ptr &doc, const char *encoding, bool format,
+          unsigned threads)
+      {
+        save_format_file_enc(filename.c_str(), doc, encoding, format,
+            threads);
+      }
+
+      void save_format_fd(int fd, const doc::Ptr &doc,
+          const char *encoding, bool format, unsigned threads)
+      {
+        Pieces p;
+        encoding = effective(doc, encoding);
+        if (!serialize(doc, encoding, format, threads, p)) {
+          Fd_Sink sink(fd);
+          sequential(doc, encoding, format, sink_cb, &sink);
+          sink.flush();
+          return;
+        }
+        write(fd, p);
+      }
+
+      std::string dump_format_memory(const doc::Ptr &doc, bool format,
+          unsigned threads)
+      {
+        Pieces p;
+        const char *encoding = effective(doc, nullptr);
+        if (!serialize(doc, encoding, format, threads, p)) {
+          Buffer b;
+          sequential(doc, encoding, format, append_cb<Buffer>, &b);
+          return string(b.begin(), b.end());
+        }
+        size_t n = p.head.size() + p.tail.size();
+        for (auto &c : p.chunks)
+          n += c.size();
+        string r;
+        r.reserve(n);
+        r.append(p.head.begin(), p.head.end());
+        for (auto &c : p.chunks)
+          r.append(c.begin(), c.end());
+        r.append(p.tail.begin(), p.tail.end());
+        return r;
+      }
+
+    }
+
+  }
+
+}
@@ -0,0 +1,75 @@
+#ifndef XXXML_PARALLEL_SAVE_HH
+#define XXXML_PARALLEL_SAVE_HH
+
+#include <xxxml/xxxml.hh>
+
+#include <string>
+
+namespace xxxml {
+
+  namespace util {
+
+    // Serializes large documents with several threads. The output is
+    // identical to save_format_file_enc() (and doc::dump_format_memory())
+    // with the same encoding and format flag.
+    //
+    // The children of the root element are split into groups that are
+    // serialized concurrently into separate buffers, with the indentation
+    // of their level. Since the nodes reference the namespace
+    // declarations of their ancestors, each group is serialized as
+    // within the complete document. The XML declaration, the root start
+    // and end tags and the top-level siblings of the root are serialized
+    // separately, then all the buffers are written in order with
+    // writev().
+    //
+    // Falls back to serializing on the calling thread, if:
+    //
+    // - the encoding isn't ASCII compatible (e.g. UTF-16 adds a BOM
+    //   to each buffer) or isn't built into libxml2, i.e. only UTF-8,
+    //   ASCII and ISO-8859-1 to -9 are serialized in parallel
+    // - the document is an (X)HTML document
+    // - it is formatted and has no encoding, and a text node contains
+    //   non-ASCII characters or control characters (libxml2 escapes
+    //   them in that case, but not when serializing at a given level)
+    // - the root element has less than 2 children or threads < 2
+    //
+    // Files of documents with compression enabled are saved with
+    // save_format_file_enc().
+    //
+    // Example:
+    //
+    //     doc::Ptr d = read_file("big.xml");
+    //     ...
+    //     util::parallel::save_format_file_enc("out.xml", d, "UTF-8");
+    namespace parallel {
+
+      // threads = 0 means std::thread::hardware_concurrency()
+      void save_format_file_enc(const char *filename,
+          const doc::Ptr &doc,
+          const char *encoding = nullptr,
+          bool format = true,
+          unsigned threads = 0);
+      void save_format_file_enc(const std::string &filename,
+          const doc::Ptr &doc,
+          const char *encoding = nullptr,
+          bool format = true,
+          unsigned threads = 0);
+
+      // e.g. to a socket, the fd isn't closed
+      void save_format_fd(int fd,
+          const doc::Ptr &doc,
+          const char *encoding = nullptr,
+          bool format = true,
+          unsigned threads = 0);
+
+      std::string dump_format_memory(const doc::Ptr &doc,
+          bool format = true,
+          unsigned threads = 0);
+
+    }
+
+  }
+
+}
+
+#endif
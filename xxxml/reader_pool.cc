@@ -0,0 +1,149 @@
+#include "reader_pool.hh"
+
+#include <string.h>
+
+using namespace std;
+
+namespace xxxml {
+
+  namespace util {
+
+    Reader_Pool::Lease::Lease(Reader_Pool &pool, text_reader::Ptr reader)
+      :
+        pool_(&pool),
+        reader_(std::move(reader))
+    {
+    }
+    Reader_Pool::Lease::Lease(Lease &&o)
+      :
+        pool_(o.pool_),
+        reader_(std::move(o.reader_))
+    {
+    }
+    Reader_Pool::Lease &Reader_Pool::Lease::operator=(Lease &&o)
+    {
+      put_back();
+      pool_ = o.pool_;
+      reader_ = std::move(o.reader_);
+      return *this;
+    }
+    Reader_Pool::Lease::~Lease()
+    {
+      put_back();
+    }
+    void Reader_Pool::Lease::put_back()
+    {
+      if (reader_)
+        pool_->put_back(std::move(reader_));
+    }
+    text_reader::Ptr &Reader_Pool::Lease::reader()
+    {
+      return reader_;
+    }
+
+
+    Reader_Pool::Reader_Pool(size_t capacity)
+      :
+        capacity_(capacity)
+    {
+      idle_.reserve(capacity_);
+    }
+    Reader_Pool::~Reader_Pool()
+    {
+      for (auto r : idle_)
+        xmlFreeTextReader(r);
+    }
+
+    void Reader_Pool::set_parser_prop(int prop, int value)
+    {
+      for (auto &p : props_)
+        if (p.first == prop) {
+          p.second = value;
+          return;
+        }
+      props_.emplace_back(prop, value);
+    }
+    void Reader_Pool::set_relaxng_schema(relaxng::Ptr *schema)
+    {
+      relaxng_schema_ = schema;
+    }
+
+    Reader_Pool::Lease Reader_Pool::configure(text_reader::Ptr reader)
+    {
+      for (auto &p : props_)
+        text_reader::set_parser_prop(reader, p.first, p.second);
+      if (relaxng_schema_)
+        text_reader::relaxng_set_schema(reader, *relaxng_schema_);
+      return Lease(*this, std::move(reader));
+    }
+
+    void Reader_Pool::put_back(text_reader::Ptr reader)
+    {
+      if (idle_.size() < capacity_) {
+        // frees the last document early and drops any reference
+        // to the caller's memory
+        xmlTextReaderClose(reader.get());
+        idle_.push_back(reader.release());
+      }
+    }
+
+    text_reader::Ptr Reader_Pool::take()
+    {
+      text_reader::Ptr r(nullptr, xmlFreeTextReader);
+      if (!idle_.empty()) {
+        r.reset(idle_.back());
+        idle_.pop_back();
+      }
+      return r;
+    }
+
+    Reader_Pool::Lease Reader_Pool::for_memory(const char *begin,
+        const char *end, const char *url, const char *encoding, int options)
+    {
+      text_reader::Ptr r(take());
+      if (r)
+        text_reader::reset_memory(r, begin, end, url, encoding, options);
+      else
+        r = text_reader::for_memory(begin, end, url, encoding, options);
+      return configure(std::move(r));
+    }
+    Reader_Pool::Lease Reader_Pool::for_memory(const char *s,
+        const char *url, const char *encoding, int options)
+    {
+      return for_memory(s, s + strlen(s), url, encoding, options);
+    }
+    Reader_Pool::Lease Reader_Pool::for_memory(const std::string &s,
+        const char *url, const char *encoding, int options)
+    {
+      return for_memory(s.data(), s.data() + s.size(), url, encoding, options);
+    }
+    Reader_Pool::Lease Reader_Pool::for_file(const char *filename,
+        const char *encoding, int options)
+    {
+      text_reader::Ptr r(take());
+      if (r)
+        text_reader::reset_file(r, filename, encoding, options);
+      else
+        r = text_reader::for_file(filename, encoding, options);
+      return configure(std::move(r));
+    }
+    Reader_Pool::Lease Reader_Pool::for_file(const std::string &filename,
+        const char *encoding, int options)
+    {
+      return for_file(filename.c_str(), encoding, options);
+    }
+
+    size_t Reader_Pool::idle() const
+    {
+      return idle_.size();
+    }
+
+    Reader_Pool &Reader_Pool::local()
+    {
+      thread_local Reader_Pool pool;
+      return pool;
+    }
+
+  }
+
+}
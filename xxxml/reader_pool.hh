@@ -0,0 +1,108 @@
+#ifndef XXXML_READER_POOL_HH
+#define XXXML_READER_POOL_HH
+
+#include <xxxml/xxxml.hh>
+#include <xxxml/io.hh>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace xxxml {
+
+  namespace util {
+
+    // Pool of text readers that are re-used for many (small) documents,
+    // i.e. the parser context, buffers and dictionary of a reader
+    // are allocated only once (cf. text_reader::reset_memory()).
+    //
+    // Since a reset also resets parser properties and validation,
+    // the pool's settings are re-applied to each handed out reader.
+    //
+    // Example:
+    //
+    //     auto lease = util::Reader_Pool::local().for_memory(begin, end);
+    //     while (text_reader::read(lease.reader()))
+    //       ...
+    //
+    // A pool isn't thread-safe, use local() or one pool per thread.
+    class Reader_Pool {
+      public:
+        // Hands out a reader and puts it back into the pool on destruction.
+        // The pool must outlive its leases.
+        class Lease {
+          public:
+            Lease(Reader_Pool &pool, text_reader::Ptr reader);
+            Lease(Lease &&);
+            Lease &operator=(Lease &&);
+            ~Lease();
+
+            text_reader::Ptr &reader();
+          private:
+            void put_back();
+
+            Reader_Pool *pool_;
+            text_reader::Ptr reader_;
+        };
+
+        // at most `capacity` idle readers are kept
+        explicit Reader_Pool(size_t capacity = 4);
+        ~Reader_Pool();
+        Reader_Pool(const Reader_Pool &) =delete;
+        Reader_Pool &operator=(const Reader_Pool &) =delete;
+
+        // re-applied after each reset, cf. text_reader::set_parser_prop()
+        void set_parser_prop(int prop, int value);
+        // Re-attached after each reset, cf. text_reader::relaxng_set_schema().
+        // The schema isn't owned, i.e. it must outlive the pool.
+        // Pass nullptr to disable validation.
+        void set_relaxng_schema(relaxng::Ptr *schema);
+
+        Lease for_memory(const char *begin, const char *end,
+            const char *url = nullptr,
+            const char *encoding = nullptr, int options = 0);
+        Lease for_memory(const char *s,
+            const char *url = nullptr,
+            const char *encoding = nullptr, int options = 0);
+        Lease for_memory(const std::string &s,
+            const char *url = nullptr,
+            const char *encoding = nullptr, int options = 0);
+        Lease for_file(const char *filename, const char *encoding = nullptr,
+            int options = 0);
+        Lease for_file(const std::string &filename,
+            const char *encoding = nullptr, int options = 0);
+
+        // cf. xxxml/io.hh
+        template <typename Source>
+          Lease for_io(Source &source, const char *url = nullptr,
+              const char *encoding = nullptr, int options = 0)
+          {
+            text_reader::Ptr r(take());
+            if (r)
+              text_reader::reset_io(r, source, url, encoding, options);
+            else
+              r = text_reader::for_io(source, url, encoding, options);
+            return configure(std::move(r));
+          }
+
+        size_t idle() const;
+
+        // the pool of the calling thread (with default settings)
+        static Reader_Pool &local();
+      private:
+        // returns an empty Ptr if there is no idle reader
+        text_reader::Ptr take();
+        Lease configure(text_reader::Ptr reader);
+        void put_back(text_reader::Ptr reader);
+
+        size_t capacity_;
+        std::vector<xmlTextReader*> idle_;
+        std::vector<std::pair<int, int> > props_;
+        relaxng::Ptr *relaxng_schema_ {nullptr};
+    };
+
+  }
+
+}
+
+#endif
@@ -0,0 +1,81 @@
+#include "record_stream.hh"
+
+#include <string.h>
+
+using namespace std;
+
+namespace xxxml {
+
+  namespace util {
+
+    Record_Stream::Record_Stream(text_reader::Ptr &reader, const char *name,
+        const char *namespace_uri)
+      :
+        reader_(reader),
+        name_(name),
+        namespace_uri_(namespace_uri ? namespace_uri : ""),
+        has_namespace_(namespace_uri),
+        pattern_(nullptr, xmlFreePattern),
+        context_(nullptr, xmlXPathFreeContext)
+    {
+    }
+    Record_Stream::Record_Stream(text_reader::Ptr &reader,
+        pattern::Ptr pattern)
+      :
+        reader_(reader),
+        pattern_(std::move(pattern)),
+        context_(nullptr, xmlXPathFreeContext)
+    {
+    }
+
+    bool Record_Stream::matches()
+    {
+      if (text_reader::node_type(reader_) != XML_READER_TYPE_ELEMENT)
+        return false;
+      if (pattern_)
+        return pattern::match(pattern_, text_reader::current_node(reader_));
+      if (strcmp(text_reader::const_local_name(reader_), name_.c_str()))
+        return false;
+      if (!has_namespace_)
+        return true;
+      const char *uri = text_reader::const_namespace_uri(reader_);
+      return uri ? namespace_uri_ == uri : namespace_uri_.empty();
+    }
+
+    xmlNode *Record_Stream::next()
+    {
+      bool ok;
+      if (current_) {
+        current_ = nullptr;
+        // skipping the already expanded subtree lets the reader free it
+        ok = text_reader::next(reader_);
+      } else {
+        ok = text_reader::read(reader_);
+      }
+      for (; ok; ok = text_reader::read(reader_)) {
+        if (matches()) {
+          current_ = text_reader::expand(reader_);
+          if (!context_)
+            context_ = xpath::new_context(current_->doc);
+          ++count_;
+          return current_;
+        }
+      }
+      return nullptr;
+    }
+
+    xpath::Context_Ptr &Record_Stream::context()
+    {
+      if (!context_)
+        throw Runtime_Error("no record read yet");
+      return context_;
+    }
+
+    size_t Record_Stream::count() const
+    {
+      return count_;
+    }
+
+  }
+
+}
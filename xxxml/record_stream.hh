@@ -0,0 +1,69 @@
+#ifndef XXXML_RECORD_STREAM_HH
+#define XXXML_RECORD_STREAM_HH
+
+#include <xxxml/xxxml.hh>
+
+#include <string>
+
+namespace xxxml {
+
+  namespace util {
+
+    // Streams over a document with a text reader and expands each
+    // matching element (a record) into a transient subtree, i.e.
+    // the subtree can be queried like a DOM (e.g. with
+    // xpath::node_eval()) while the memory usage stays bounded by the
+    // record size - independent of the input size.
+    //
+    // Example:
+    //
+    //     auto reader = text_reader::for_file("huge.xml");
+    //     util::Record_Stream s(reader, "rec");
+    //     while (xmlNode *rec = s.next()) {
+    //       auto o = xpath::node_eval("./id", rec, s.context());
+    //       ...
+    //     }
+    //
+    // The subtree of a record is freed by the reader when moving on, thus,
+    // pointers into it are only valid until the next call of next().
+    // Matching elements inside a record aren't reported, separately.
+    class Record_Stream {
+      public:
+        // matches elements by local name and - if not nullptr -
+        // namespace URI
+        Record_Stream(text_reader::Ptr &reader, const char *name,
+            const char *namespace_uri = nullptr);
+        // matches elements with a pattern, cf. pattern::compile()
+        Record_Stream(text_reader::Ptr &reader, pattern::Ptr pattern);
+        Record_Stream(const Record_Stream &) =delete;
+        Record_Stream &operator=(const Record_Stream &) =delete;
+
+        // returns nullptr at the end of the input
+        xmlNode *next();
+
+        // context on the reader's document, e.g. for registering namespaces
+        // and evaluating expressions relative to a record (cf.
+        // xpath::node_eval()) - only available after the first record
+        // was returned
+        xpath::Context_Ptr &context();
+
+        // number of records returned so far
+        size_t count() const;
+      private:
+        bool matches();
+
+        text_reader::Ptr &reader_;
+        std::string name_;
+        std::string namespace_uri_;
+        bool has_namespace_ {false};
+        pattern::Ptr pattern_;
+        xmlNode *current_ {nullptr};
+        size_t count_ {0};
+        xpath::Context_Ptr context_;
+    };
+
+  }
+
+}
+
+#endif
@@ -0,0 +1,134 @@
+#include "revalidator.hh"
+
+#include <xxxml/validator.hh>
+
+using namespace std;
+
+namespace xxxml {
+
+  namespace util {
+
+    static void ignore_error(void *, xmlErrorPtr)
+    {
+    }
+
+    // Pushes a node shallowly, i.e. just to advance the state of its
+    // parent - errors about its missing content are ignored.
+    static bool push_shallow(relaxng::Valid_Ctxt_Ptr &c, xmlDoc *d,
+        xmlNode *x)
+    {
+      if (x->type == XML_ELEMENT_NODE) {
+        int r = xmlRelaxNGValidatePushElement(c.get(), d, x);
+        if (r == -1)
+          return false;
+        if (r == 1)
+          xmlRelaxNGValidatePopElement(c.get(), d, x);
+      } else if (x->type == XML_TEXT_NODE
+          || x->type == XML_CDATA_SECTION_NODE) {
+        if (xmlRelaxNGValidatePushCData(c.get(), x->content,
+              xmlStrlen(x->content)) != 1)
+          return false;
+      }
+      return true;
+    }
+
+    Revalidator::Revalidator(relaxng::Ptr &schema, const doc::Ptr &doc,
+        size_t max_subtrees)
+      :
+        schema_(schema),
+        doc_(doc),
+        max_subtrees_(max_subtrees),
+        log_(doc)
+    {
+    }
+
+    bool Revalidator::validate()
+    {
+      Error_Collector errors(1, 1, Error_Collector::Mode::SILENT);
+      return validate(errors);
+    }
+
+    bool Revalidator::validate(Error_Collector &errors)
+    {
+      const xmlDoc *d = doc_.get();
+      auto &nodes = log_.nodes();
+      bool full = !valid_ || log_.document_changed() || d->ids || d->refs
+        || nodes.size() > max_subtrees_;
+      bool valid = true;
+      if (!full) {
+        for (auto node : nodes) {
+          int r = validate_subtree(node, errors);
+          if (r == -1) {
+            full = true;
+            break;
+          }
+          valid = valid && r;
+        }
+      }
+      if (full)
+        valid = validate_doc(errors);
+      log_.clear();
+      valid_ = valid;
+      return valid;
+    }
+
+    bool Revalidator::validate_doc(Error_Collector &errors)
+    {
+      ++full_validations_;
+      relaxng::Valid_Ctxt_Ptr c = relaxng::new_valid_ctxt(schema_);
+      errors.attach(c);
+      int r = xmlRelaxNGValidateDoc(c.get(), const_cast<xmlDoc*>(doc_.get()));
+      if (r < 0)
+        throw Logic_Error("internal validation error");
+      return !r;
+    }
+
+    // returns -1 if the subtree can't be validated in isolation
+    int Revalidator::validate_subtree(xmlNode *node, Error_Collector &errors)
+    {
+      ++subtree_validations_;
+      xmlDoc *d = const_cast<xmlDoc*>(doc_.get());
+      // push contexts can't be reused
+      relaxng::Valid_Ctxt_Ptr c = relaxng::new_valid_ctxt(schema_);
+      relaxng::set_valid_structured_errors(c, ignore_error, nullptr);
+      vector<const xmlNode*> ancestors;
+      path(node, ancestors);
+      for (auto a : ancestors) {
+        xmlNode *x = const_cast<xmlNode*>(a);
+        if (x->parent && x->parent->type == XML_ELEMENT_NODE)
+          for (auto s = x->parent->children; s != x; s = s->next)
+            if (!push_shallow(c, d, s))
+              return -1;
+        if (x == node)
+          break;
+        int r = xmlRelaxNGValidatePushElement(c.get(), d, x);
+        if (r == -1)
+          return -1;
+        if (r == 0) {
+          // the content model of the ancestor requires its
+          // complete subtree
+          errors.attach(c);
+          return xmlRelaxNGValidateFullElement(c.get(), d, x) == 1;
+        }
+      }
+      errors.attach(c);
+      return detail::rng_push_subtree(c.get(), d, node, &errors) == 1;
+    }
+
+    Change_Log &Revalidator::changes()
+    {
+      return log_;
+    }
+
+    size_t Revalidator::full_validations() const
+    {
+      return full_validations_;
+    }
+    size_t Revalidator::subtree_validations() const
+    {
+      return subtree_validations_;
+    }
+
+  }
+
+}
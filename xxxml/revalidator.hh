@@ -0,0 +1,73 @@
+#ifndef XXXML_REVALIDATOR_HH
+#define XXXML_REVALIDATOR_HH
+
+#include <xxxml/xxxml.hh>
+#include <xxxml/util.hh>
+#include <xxxml/error_collector.hh>
+
+namespace xxxml {
+
+  namespace util {
+
+    // Keeps a document validated against a RelaxNG schema while it is
+    // edited: after the first complete validation, validate() just
+    // revalidates the subtrees that were modified via the util helpers
+    // (set_content(), set_attribute(), add(), insert(), remove(), ...),
+    // as recorded by the revalidator's Change_Log of the document.
+    //
+    // A subtree is validated in the context of its position: its ancestors
+    // and their preceding siblings are pushed shallowly (cf.
+    // relaxng::validate_push_element()), then the subtree is pushed
+    // completely. Thus, the costs are proportional to the size of the
+    // modified subtrees plus the number of preceding siblings along
+    // their paths.
+    //
+    // Falls back to validating the complete document when
+    //
+    // - it wasn't valid before (or wasn't validated, yet),
+    // - the root element was replaced,
+    // - the document contains IDs or IDREFs, since those are
+    //   document-wide constraints,
+    // - more than max_subtrees subtrees were modified.
+    //
+    // Example:
+    //
+    //     util::Revalidator r(schema, doc);
+    //     r.validate();
+    //     util::set_content(node, "23");
+    //     r.validate(); // just node's subtree
+    class Revalidator {
+      public:
+        // schema and doc must outlive the revalidator
+        Revalidator(relaxng::Ptr &schema, const doc::Ptr &doc,
+            size_t max_subtrees = 64);
+        Revalidator(const Revalidator &) =delete;
+        Revalidator &operator=(const Revalidator &) =delete;
+
+        bool validate();
+        // the error limit of the collector only applies to subtrees
+        bool validate(Error_Collector &errors);
+
+        // e.g. for recording modifications by other means
+        Change_Log &changes();
+
+        size_t full_validations() const;
+        size_t subtree_validations() const;
+      private:
+        bool validate_doc(Error_Collector &errors);
+        int validate_subtree(xmlNode *node, Error_Collector &errors);
+
+        relaxng::Ptr &schema_;
+        const doc::Ptr &doc_;
+        size_t max_subtrees_;
+        Change_Log log_;
+        bool valid_ {false};
+        size_t full_validations_ {0};
+        size_t subtree_validations_ {0};
+    };
+
+  }
+
+}
+
+#endif
@@ -0,0 +1,318 @@
+#include "schema_cache.hh"
+
+#include <libxml/uri.h>
+
+#include <condition_variable>
+#include <exception>
+#include <fstream>
+#include <set>
+#include <vector>
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+namespace xxxml {
+
+  namespace util {
+
+    namespace {
+
+      struct File {
+        string path;
+        long long mtime_ns {0};
+        long long size {0};
+        uint64_t hash {0};
+      };
+
+      string canonical(const string &filename)
+      {
+        char buf[PATH_MAX];
+        if (!realpath(filename.c_str(), buf))
+          throw Runtime_Error("Could not resolve schema path: " + filename);
+        return buf;
+      }
+
+      bool stat_file(File &f)
+      {
+        struct stat st;
+        if (stat(f.path.c_str(), &st))
+          return false;
+        f.mtime_ns = (long long)st.st_mtim.tv_sec * 1000000000ll
+          + st.st_mtim.tv_nsec;
+        f.size = st.st_size;
+        return true;
+      }
+
+      // FNV-1a
+      uint64_t hash_file(const string &path)
+      {
+        ifstream in(path, ios::binary);
+        if (!in)
+          throw Runtime_Error("Could not read schema file: " + path);
+        uint64_t h = 0xcbf29ce484222325ull;
+        char buf[64 * 1024];
+        while (in) {
+          in.read(buf, sizeof buf);
+          for (streamsize i = 0, n = in.gcount(); i < n; ++i) {
+            h ^= (unsigned char) buf[i];
+            h *= 0x100000001b3ull;
+          }
+        }
+        return h;
+      }
+
+      const char XSD_NS[] = "http://www.w3.org/2001/XMLSchema";
+      const char RNG_NS[] = "http://relaxng.org/ns/structure/1.0";
+
+      // schemaLocation/href of include, import etc. elements
+      const char *reference(const xmlNode *x)
+      {
+        if (!x->ns)
+          return nullptr;
+        const char *name = reinterpret_cast<const char*>(x->name);
+        const char *ns = reinterpret_cast<const char*>(x->ns->href);
+        const char *attr = nullptr;
+        if (!strcmp(ns, XSD_NS)) {
+          if (!strcmp(name, "include") || !strcmp(name, "import")
+              || !strcmp(name, "redefine") || !strcmp(name, "override"))
+            attr = "schemaLocation";
+        } else if (!strcmp(ns, RNG_NS)) {
+          if (!strcmp(name, "include") || !strcmp(name, "externalRef"))
+            attr = "href";
+        }
+        if (!attr)
+          return nullptr;
+        xmlAttr *a = xmlHasProp(const_cast<xmlNode*>(x),
+            reinterpret_cast<const xmlChar*>(attr));
+        if (!a || !a->children || !a->children->content)
+          return nullptr;
+        return reinterpret_cast<const char*>(a->children->content);
+      }
+
+      // Collects the local files a schema consists of - in contrast to
+      // hooking into the schema parser this doesn't depend on global
+      // state (cf. xmlSetExternalEntityLoader()).
+      //
+      // Missing files are tracked, too (with a size of -1), since e.g.
+      // libxml2 ignores an import whose schemaLocation doesn't exist.
+      void collect_files(const string &path, set<string> &seen,
+          vector<File> &files)
+      {
+        if (!seen.insert(path).second)
+          return;
+        File f;
+        f.path = path;
+        if (!stat_file(f)) {
+          f.size = -1;
+          files.push_back(f);
+          return;
+        }
+        f.hash = hash_file(path);
+        files.push_back(f);
+
+        doc::Ptr d = read_file(path, nullptr, XML_PARSE_NONET);
+        const xmlNode *root = xmlDocGetRootElement(d.get());
+        if (!root)
+          return;
+        vector<string> refs;
+        for (const xmlNode *x = root; x; ) {
+          if (x->type == XML_ELEMENT_NODE) {
+            if (const char *r = reference(x)) {
+              Char_Ptr uri(reinterpret_cast<char*>(xmlBuildURI(
+                      reinterpret_cast<const xmlChar*>(r), d->URL)), xmlFree);
+              if (uri) {
+                string u(uri.get());
+                if (!u.compare(0, 7, "file://"))
+                  u.erase(0, 7);
+                // remote schemas can't be tracked
+                if (u.find("://") == string::npos)
+                  refs.push_back(u);
+              }
+            }
+            if (x->children) {
+              x = x->children;
+              continue;
+            }
+          }
+          while (x != root && !x->next)
+            x = x->parent;
+          if (x == root)
+            break;
+          x = x->next;
+        }
+        for (auto &r : refs) {
+          char buf[PATH_MAX];
+          collect_files(realpath(r.c_str(), buf) ? buf : r, seen, files);
+        }
+      }
+
+    }
+
+    struct Schema_Cache::Entry {
+      mutex m;
+      shared_ptr<Validator> validator;
+      // of the last compilation, if it failed
+      exception_ptr error;
+      vector<File> files;
+      chrono::steady_clock::time_point checked;
+      // i.e. by another thread, without holding m
+      bool compiling {false};
+      condition_variable compiled;
+    };
+
+    // true if a file's content changed, updates the stamps otherwise
+    static bool changed(vector<File> &files)
+    {
+      for (auto &f : files) {
+        File g;
+        g.path = f.path;
+        if (!stat_file(g)) {
+          if (f.size == -1)
+            continue;
+          return true;
+        }
+        if (f.size == -1)
+          return true;
+        if (g.mtime_ns == f.mtime_ns && g.size == f.size)
+          continue;
+        if (g.size != f.size || hash_file(f.path) != f.hash)
+          return true;
+        // e.g. just touched
+        f.mtime_ns = g.mtime_ns;
+      }
+      return false;
+    }
+
+    static shared_ptr<Validator> compile(const string &path,
+        Validator::Kind kind)
+    {
+      if (kind == Validator::Kind::XSD) {
+        auto pc = schema::new_parser_ctxt(path);
+        return make_shared<Validator>(schema::parse(pc));
+      } else {
+        auto pc = relaxng::new_parser_ctxt(path);
+        return make_shared<Validator>(relaxng::parse(pc));
+      }
+    }
+
+    Schema_Cache::Schema_Cache()
+    {
+    }
+
+    Schema_Cache &Schema_Cache::instance()
+    {
+      static Schema_Cache cache;
+      return cache;
+    }
+
+    shared_ptr<Validator> Schema_Cache::xsd(const std::string &filename)
+    {
+      return get(filename, Validator::Kind::XSD);
+    }
+    shared_ptr<Validator> Schema_Cache::relaxng(const std::string &filename)
+    {
+      return get(filename, Validator::Kind::RELAXNG);
+    }
+
+    shared_ptr<Validator> Schema_Cache::get(const std::string &filename,
+        Validator::Kind kind)
+    {
+      string path = canonical(filename);
+      shared_ptr<Entry> e;
+      chrono::milliseconds interval;
+      {
+        lock_guard<mutex> lock(mutex_);
+        auto &p = entries_[make_pair(path, kind)];
+        if (!p)
+          p = make_shared<Entry>();
+        e = p;
+        interval = check_interval_;
+      }
+
+      unique_lock<mutex> lock(e->m);
+      auto now = chrono::steady_clock::now();
+      for (;;) {
+        if (e->compiling) {
+          // the current version is served during a recompilation
+          if (e->validator)
+            return e->validator;
+          e->compiled.wait(lock);
+          continue;
+        }
+        now = chrono::steady_clock::now();
+        if ((e->validator || e->error)
+            && (now - e->checked < interval || !changed(e->files))) {
+          if (now - e->checked >= interval)
+            e->checked = now;
+          if (e->validator)
+            return e->validator;
+          rethrow_exception(e->error);
+        }
+        break;
+      }
+      e->compiling = true;
+      lock.unlock();
+      {
+        lock_guard<mutex> lock(mutex_);
+        ++compilations_;
+      }
+      // files are collected before compiling, i.e. a change during
+      // the compilation is detected on the next lookup
+      vector<File> files;
+      set<string> seen;
+      shared_ptr<Validator> v;
+      exception_ptr error;
+      try {
+        collect_files(path, seen, files);
+        v = compile(path, kind);
+      } catch (...) {
+        error = current_exception();
+      }
+      lock.lock();
+      e->compiling = false;
+      // on failure, too, i.e. it's retried when one of the files
+      // changes again
+      e->files = std::move(files);
+      e->checked = now;
+      if (v) {
+        e->validator = v;
+        e->error = nullptr;
+      } else if (!e->validator) {
+        e->error = error;
+      }
+      e->compiled.notify_all();
+      if (e->validator)
+        return e->validator;
+      rethrow_exception(error);
+    }
+
+    void Schema_Cache::set_check_interval(std::chrono::milliseconds interval)
+    {
+      lock_guard<mutex> lock(mutex_);
+      check_interval_ = interval;
+    }
+
+    size_t Schema_Cache::compilations() const
+    {
+      lock_guard<mutex> lock(mutex_);
+      return compilations_;
+    }
+    size_t Schema_Cache::size() const
+    {
+      lock_guard<mutex> lock(mutex_);
+      return entries_.size();
+    }
+    void Schema_Cache::clear()
+    {
+      lock_guard<mutex> lock(mutex_);
+      entries_.clear();
+    }
+
+  }
+
+}
@@ -0,0 +1,75 @@
+#ifndef XXXML_SCHEMA_CACHE_HH
+#define XXXML_SCHEMA_CACHE_HH
+
+#include <xxxml/validator.hh>
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace xxxml {
+
+  namespace util {
+
+    // Cache of compiled schemas (XSD or RelaxNG), keyed by the canonical
+    // path of the root schema file.
+    //
+    // The files a schema consists of (i.e. the root file and all files it
+    // includes/imports) are tracked by modification time and size. When
+    // one changes, its content hash is compared and - if different - the
+    // schema is recompiled on the next lookup (lazily).
+    //
+    // A recompiled schema replaces the old one atomically: the old
+    // Validator stays alive as long as in-flight users hold it. During
+    // a recompilation, concurrent lookups get the old one.
+    //
+    // Example:
+    //
+    //     auto v = util::Schema_Cache::instance().xsd("conf/api.xsd");
+    //     v->validate(doc);
+    //
+    // Thread-safe. Concurrent lookups of a schema that isn't compiled,
+    // yet, wait for one compilation.
+    class Schema_Cache {
+      public:
+        Schema_Cache();
+        Schema_Cache(const Schema_Cache &) =delete;
+        Schema_Cache &operator=(const Schema_Cache &) =delete;
+
+        // process-wide cache
+        static Schema_Cache &instance();
+
+        // Throws Runtime_Error if a file can't be read and Parse_Error if
+        // the schema doesn't compile - unless there is a previously
+        // compiled version, which is returned, then. A failed
+        // compilation isn't retried until one of the files changes.
+        std::shared_ptr<Validator> xsd(const std::string &filename);
+        std::shared_ptr<Validator> relaxng(const std::string &filename);
+
+        // The files aren't checked for changes more often than that,
+        // default: 1 s, zero checks on each lookup
+        void set_check_interval(std::chrono::milliseconds interval);
+
+        // number of compilations so far, including failed ones
+        size_t compilations() const;
+        size_t size() const;
+        void clear();
+      private:
+        struct Entry;
+        std::shared_ptr<Validator> get(const std::string &filename,
+            Validator::Kind kind);
+
+        mutable std::mutex mutex_;
+        std::map<std::pair<std::string, Validator::Kind>,
+          std::shared_ptr<Entry> > entries_;
+        std::chrono::milliseconds check_interval_ {1000};
+        size_t compilations_ {0};
+    };
+
+  }
+
+}
+
+#endif
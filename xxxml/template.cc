@@ -0,0 +1,68 @@
+#include "template.hh"
+#include "escape.hh"
+
+using namespace std;
+
+namespace xxxml {
+
+  namespace util {
+
+    namespace tmpl {
+
+      namespace detail {
+
+        void append_escaped(string &out, const char *begin,
+            const char *end, Slot slot)
+        {
+          auto e = slot == Slot::TEXT ? xxxml::detail::Escape::TEXT
+                                      : xxxml::detail::Escape::ATTRIBUTE;
+          auto raw = [&out](const char *first, const char *last) {
+            out.append(first, last);
+            return true; };
+          auto special = [&out](char c) {
+            out += xxxml::detail::escape(c);
+            return true; };
+          // non-ASCII bytes are copied, i.e. the output is UTF-8
+          for (const char *p = begin; ; ++p) {
+            p = xxxml::detail::escape_runs(p, end, e, raw, special);
+            if (p == end)
+              return;
+            out += *p;
+          }
+        }
+
+        void append(std::string &out, const Segment *segments, size_t n,
+            const Value *values)
+        {
+          for (auto s = segments; s != segments + n; ++s) {
+            if (s->slot == Slot::NONE) {
+              out.append(s->data, s->size);
+              continue;
+            }
+            const Value &v = *values++;
+            if (!v.begin())
+              throw Runtime_Error("template value is null");
+            append_escaped(out, v.begin(), v.end(), s->slot);
+          }
+        }
+
+        void write(text_writer::Ptr &writer, const Segment *segments,
+            size_t n, const Value *values)
+        {
+          static thread_local string buffer;
+          buffer.clear();
+          append(buffer, segments, n, values);
+          int r = xmlTextWriterWriteRawLen(writer.get(),
+              reinterpret_cast<const xmlChar*>(buffer.data()),
+              buffer.size());
+          if (r == -1)
+            throw Runtime_Error("error writing template");
+        }
+
+      }
+
+    }
+
+  }
+
+}
@@ -0,0 +1,355 @@
+#ifndef XXXML_TEMPLATE_HH
+#define XXXML_TEMPLATE_HH
+
+#include <xxxml/xxxml.hh>
+
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include <stddef.h>
+#include <string.h>
+
+// Compile-time XML templates: element and attribute names are part of
+// the template type, thus, all the static markup between the value
+// slots is rendered into constant strings by the compiler. At runtime
+// only the values are escaped and copied.
+//
+// A template is written with one xmlTextWriterWriteRawLen() call,
+// i.e. it can be mixed with the text_writer functions, e.g. an open
+// start tag is closed before. The written elements are complete,
+// thus, the writer's element stack isn't affected.
+//
+// Names are created with XXXML_STR() (up to 64 characters) or are
+// spelled out, e.g. tmpl::Str<'i', 'd'>.
+//
+// Example:
+//
+//     using namespace xxxml::util;
+//     using Rec = tmpl::Element<XXXML_STR("rec"),
+//           tmpl::Attribute<XXXML_STR("id")>,
+//           tmpl::Fixed_Attribute<XXXML_STR("v"), XXXML_STR("1")>,
+//           tmpl::Element<XXXML_STR("name"), tmpl::Text>,
+//           tmpl::Element<XXXML_STR("amount"), tmpl::Text> >;
+//     // <rec id="42" v="1"><name>x &amp; y</name><amount>1.5</amount></rec>
+//     text_writer::start_element(w, "response");
+//     tmpl::write<Rec>(w, 42, "x & y", "1.5");
+//     text_writer::end_element(w);
+
+namespace xxxml {
+
+  namespace util {
+
+    namespace tmpl {
+
+      template <char... Cs> struct Str {
+        static constexpr char value[sizeof...(Cs) + 1] = { Cs..., 0 };
+        static constexpr size_t size = sizeof...(Cs);
+      };
+      template <char... Cs> constexpr char Str<Cs...>::value[];
+      template <char... Cs> constexpr size_t Str<Cs...>::size;
+
+      // <Name>...</Name>, the attributes have to come first,
+      // without children the element is written as <Name/>
+      template <typename Name, typename... Items> struct Element {};
+      // the value is a runtime argument
+      template <typename Name> struct Attribute {};
+      template <typename Name, typename Value> struct Fixed_Attribute {};
+      // escaped text content, a runtime argument
+      struct Text {};
+      // static text content
+      template <typename S> struct Fixed_Text {};
+
+      // A runtime value: a string, a [begin, end) range or an integer.
+      // Integers are formatted without allocation.
+      class Value {
+        public:
+          Value(const char *s)
+            : begin_(s), end_(s ? s + strlen(s) : s) {}
+          Value(const std::string &s)
+            : begin_(s.data()), end_(s.data() + s.size()) {}
+          Value(const std::pair<const char*, const char*> &r)
+            : begin_(r.first), end_(r.second) {}
+          template <typename T, typename = typename std::enable_if<
+            std::is_integral<T>::value
+            && !std::is_same<T, bool>::value>::type>
+            Value(T v)
+            {
+              // w/o pointers into the object, thus, it's copyable
+              bool neg = v < 0;
+              do {
+                T d = v % 10;
+                buffer_[sizeof buffer_ - ++n_] = '0' + (d < 0 ? -d : d);
+                v /= 10;
+              } while (v);
+              if (neg)
+                buffer_[sizeof buffer_ - ++n_] = '-';
+            }
+          const char *begin() const
+          {
+            return n_ ? buffer_ + sizeof buffer_ - n_ : begin_;
+          }
+          const char *end() const
+          {
+            return n_ ? buffer_ + sizeof buffer_ : end_;
+          }
+        private:
+          const char *begin_ {nullptr};
+          const char *end_ {nullptr};
+          char buffer_[24];
+          unsigned char n_ {0};
+      };
+
+      namespace detail {
+
+        enum class Slot { NONE, TEXT, ATTRIBUTE };
+
+        // a static string (slot == NONE) or a value slot
+        struct Segment {
+          const char *data;
+          size_t size;
+          Slot slot;
+        };
+
+        // escapes like the text writer, except UTF-8 that is copied
+        // as is, also in attribute values
+        void append_escaped(std::string &out, const char *begin,
+            const char *end, Slot slot);
+        void append(std::string &out, const Segment *segments, size_t n,
+            const Value *values);
+        void write(text_writer::Ptr &writer, const Segment *segments,
+            size_t n, const Value *values);
+
+        template <typename... Ts> struct List {};
+        template <Slot S> struct Hole {};
+
+        template <typename A, typename B> struct Concat;
+        template <typename... As, typename... Bs>
+          struct Concat<List<As...>, List<Bs...> > {
+            using type = List<As..., Bs...>;
+          };
+        template <typename... Ls> struct Join;
+        template <> struct Join<> {
+          using type = List<>;
+        };
+        template <typename L, typename... Ls> struct Join<L, Ls...> {
+          using type = typename Concat<L, typename Join<Ls...>::type>::type;
+        };
+
+        template <bool... Bs> struct All : std::true_type {};
+        template <bool... Bs> struct All<false, Bs...> : std::false_type {};
+        template <bool... Bs> struct All<true, Bs...> : All<Bs...> {};
+
+        template <typename S> struct Valid_Name;
+        template <char... Cs> struct Valid_Name<Str<Cs...> > : All<
+          (sizeof...(Cs) > 0), (Cs != ' ' && Cs != '<' && Cs != '>'
+              && Cs != '&' && Cs != '"' && Cs != '\'' && Cs != '='
+              && Cs != '/' && Cs != '\t' && Cs != '\n')...> {};
+        // i.e. it doesn't need escaping
+        template <typename S> struct Valid_Value;
+        template <char... Cs> struct Valid_Value<Str<Cs...> > : All<
+          (Cs != '<' && Cs != '>' && Cs != '&' && Cs != '"' && Cs != '\r'
+           && Cs != '\n' && Cs != '\t')...> {};
+
+        template <typename T> struct Is_Attribute : std::false_type {};
+        template <typename N> struct Is_Attribute<Attribute<N> >
+          : std::true_type {};
+        template <typename N, typename V>
+          struct Is_Attribute<Fixed_Attribute<N, V> > : std::true_type {};
+
+        // the items with/without attributes
+        template <bool Attr, typename... Items> struct Filter;
+        template <bool Attr> struct Filter<Attr> {
+          using type = List<>;
+        };
+        template <bool Attr, typename I, typename... Items>
+          struct Filter<Attr, I, Items...> {
+            using rest = typename Filter<Attr, Items...>::type;
+            using type = typename std::conditional<
+              Is_Attribute<I>::value == Attr,
+              typename Concat<List<I>, rest>::type, rest>::type;
+          };
+
+        template <typename L> struct Size;
+        template <typename... Ts> struct Size<List<Ts...> >
+          : std::integral_constant<size_t, sizeof...(Ts)> {};
+
+        template <typename... Items> struct Attributes_First;
+        template <> struct Attributes_First<> : std::true_type {};
+        template <typename I, typename... Items>
+          struct Attributes_First<I, Items...> : std::integral_constant<bool,
+          Is_Attribute<I>::value ? Attributes_First<Items...>::value
+          : Size<typename Filter<true, Items...>::type>::value == 0> {};
+
+        template <typename T> struct Render;
+        template <typename L> struct Render_All;
+        template <typename... Ts> struct Render_All<List<Ts...> > {
+          using type = typename Join<typename Render<Ts>::type...>::type;
+        };
+
+        template <char... Ns, typename... Items>
+          struct Render<Element<Str<Ns...>, Items...> > {
+            static_assert(Valid_Name<Str<Ns...> >::value,
+                "invalid element name");
+            using attributes = typename Filter<true, Items...>::type;
+            using children = typename Filter<false, Items...>::type;
+            static_assert(Attributes_First<Items...>::value,
+                "attributes have to come first");
+            using type = typename Join<
+              List<Str<'<', Ns...> >,
+              typename Render_All<attributes>::type,
+              typename std::conditional<Size<children>::value == 0,
+                List<Str<'/', '>'> >,
+                typename Join<
+                  List<Str<'>'> >,
+                  typename Render_All<children>::type,
+                  List<Str<'<', '/', Ns..., '>'> >
+                >::type
+              >::type
+            >::type;
+          };
+        template <char... Ns> struct Render<Attribute<Str<Ns...> > > {
+          static_assert(Valid_Name<Str<Ns...> >::value,
+              "invalid attribute name");
+          using type = List<Str<' ', Ns..., '=', '"'>, Hole<Slot::ATTRIBUTE>,
+                Str<'"'> >;
+        };
+        template <char... Ns, char... Vs>
+          struct Render<Fixed_Attribute<Str<Ns...>, Str<Vs...> > > {
+            static_assert(Valid_Name<Str<Ns...> >::value,
+                "invalid attribute name");
+            static_assert(Valid_Value<Str<Vs...> >::value,
+                "the attribute value needs escaping");
+            using type = List<Str<' ', Ns..., '=', '"', Vs..., '"'> >;
+          };
+        template <> struct Render<Text> {
+          using type = List<Hole<Slot::TEXT> >;
+        };
+        template <char... Cs> struct Render<Fixed_Text<Str<Cs...> > > {
+          static_assert(Valid_Value<Str<Cs...> >::value,
+              "the text needs escaping");
+          using type = List<Str<Cs...> >;
+        };
+
+        // merges adjacent strings
+        template <typename L> struct Merge;
+        template <> struct Merge<List<> > {
+          using type = List<>;
+        };
+        template <typename T> struct Merge<List<T> > {
+          using type = List<T>;
+        };
+        template <char... As, char... Bs, typename... Ts>
+          struct Merge<List<Str<As...>, Str<Bs...>, Ts...> > {
+            using type = typename Merge<List<Str<As..., Bs...>, Ts...> >::type;
+          };
+        template <typename A, typename B, typename... Ts>
+          struct Merge<List<A, B, Ts...> > {
+            using type = typename Concat<List<A>,
+                  typename Merge<List<B, Ts...> >::type>::type;
+          };
+
+        template <typename T> struct Seg;
+        template <char... Cs> struct Seg<Str<Cs...> > {
+          static constexpr Segment value()
+          {
+            return Segment { Str<Cs...>::value, sizeof...(Cs), Slot::NONE };
+          }
+          static constexpr size_t slots = 0;
+        };
+        template <Slot S> struct Seg<Hole<S> > {
+          static constexpr Segment value()
+          {
+            return Segment { nullptr, 0, S };
+          }
+          static constexpr size_t slots = 1;
+        };
+
+        template <size_t... Ns> struct Sum;
+        template <> struct Sum<> : std::integral_constant<size_t, 0> {};
+        template <size_t N, size_t... Ns> struct Sum<N, Ns...>
+          : std::integral_constant<size_t, N + Sum<Ns...>::value> {};
+
+        template <typename L> struct Table;
+        template <typename... Ts> struct Table<List<Ts...> > {
+          static constexpr Segment segments[sizeof...(Ts)] = {
+            Seg<Ts>::value()... };
+          static constexpr size_t size = sizeof...(Ts);
+          static constexpr size_t slots = Sum<Seg<Ts>::slots...>::value;
+        };
+        template <typename... Ts>
+          constexpr Segment Table<List<Ts...> >::segments[];
+
+        template <typename T> struct Compiled {
+          using type = Table<typename Merge<
+            typename Render<T>::type>::type>;
+        };
+
+        // padded to a maximum length, trailing zeros are removed
+        template <typename S, char... Cs> struct Trim;
+        template <char... As> struct Trim<Str<As...> > {
+          using type = Str<As...>;
+        };
+        template <char... As, char... Cs> struct Trim<Str<As...>, 0, Cs...> {
+          using type = Str<As...>;
+        };
+        template <char... As, char C, char... Cs>
+          struct Trim<Str<As...>, C, Cs...> {
+            using type = typename Trim<Str<As..., C>, Cs...>::type;
+          };
+        template <size_t N> constexpr char at(const char (&s)[N], size_t i)
+        {
+          return i < N ? s[i] : 0;
+        }
+
+      }
+
+      // The number of values has to match the value slots of T,
+      // in document order.
+      template <typename T, typename... Values>
+        void write(text_writer::Ptr &writer, const Values &... values)
+        {
+          using C = typename detail::Compiled<T>::type;
+          static_assert(C::slots == sizeof...(Values),
+              "the number of values doesn't match the template");
+          // + 1: no zero-sized arrays
+          const Value vs[sizeof...(Values) + 1] = { Value(values)...,
+            Value("") };
+          detail::write(writer, C::segments, C::size, vs);
+        }
+      // appends the rendered template, e.g. to a buffer that is
+      // written with text_writer::write_raw() later
+      template <typename T, typename... Values>
+        void append(std::string &out, const Values &... values)
+        {
+          using C = typename detail::Compiled<T>::type;
+          static_assert(C::slots == sizeof...(Values),
+              "the number of values doesn't match the template");
+          const Value vs[sizeof...(Values) + 1] = { Value(values)...,
+            Value("") };
+          detail::append(out, C::segments, C::size, vs);
+        }
+
+    }
+
+  }
+
+}
+
+#define XXXML_TMPL_AT4(s, i) \
+  ::xxxml::util::tmpl::detail::at(s, i), \
+  ::xxxml::util::tmpl::detail::at(s, i + 1), \
+  ::xxxml::util::tmpl::detail::at(s, i + 2), \
+  ::xxxml::util::tmpl::detail::at(s, i + 3)
+#define XXXML_TMPL_AT16(s, i) \
+  XXXML_TMPL_AT4(s, i), XXXML_TMPL_AT4(s, i + 4), \
+  XXXML_TMPL_AT4(s, i + 8), XXXML_TMPL_AT4(s, i + 12)
+
+// a tmpl::Str<...> type from a string literal
+#define XXXML_STR(s) \
+  ::xxxml::util::tmpl::detail::Trim< ::xxxml::util::tmpl::Str<>, \
+    XXXML_TMPL_AT16(s, 0), XXXML_TMPL_AT16(s, 16), \
+    XXXML_TMPL_AT16(s, 32), XXXML_TMPL_AT16(s, 48), \
+    (sizeof(s) <= 65 ? 0 : throw "XXXML_STR: literal too long")>::type
+
+#endif
@@ -1,7 +1,13 @@
 #include "util.hh"
+#include "io.hh"
 
+#include <algorithm>
+#include <atomic>
 #include <deque>
+#include <mutex>
+#include <unordered_map>
 #include <string.h>
+#include <sys/uio.h>
 
 #if defined(__GNUC__)
 // unfortunately, even with gcc 4.9, the regex implementation is not complete,
@@ -113,6 +119,121 @@ namespace xxxml {
       return o_.get()->nodesetval->nodeTab + o_.get()->nodesetval->nodeNr;
     }
 
+    // the active logs by document
+    static mutex change_logs_mutex;
+    static unordered_multimap<const xmlDoc*, Change_Log*> change_logs;
+    // i.e. the helpers don't lock the mutex while there are no logs
+    static atomic<size_t> change_logs_size {0};
+
+    Change_Log::Change_Log(const xmlDoc *doc)
+      :
+        doc_(doc)
+    {
+      lock_guard<mutex> lock(change_logs_mutex);
+      change_logs.emplace(doc_, this);
+      ++change_logs_size;
+    }
+    Change_Log::Change_Log(const doc::Ptr &doc)
+      :
+        Change_Log(doc.get())
+    {
+    }
+    Change_Log::~Change_Log()
+    {
+      lock_guard<mutex> lock(change_logs_mutex);
+      auto r = change_logs.equal_range(doc_);
+      for (auto i = r.first; i != r.second; ++i)
+        if (i->second == this) {
+          change_logs.erase(i);
+          --change_logs_size;
+          break;
+        }
+    }
+    const std::vector<xmlNode*> &Change_Log::nodes() const
+    {
+      return nodes_;
+    }
+    bool Change_Log::document_changed() const
+    {
+      return document_changed_;
+    }
+    void Change_Log::clear()
+    {
+      nodes_.clear();
+      document_changed_ = false;
+    }
+
+    static bool is_document(const xmlNode *x)
+    {
+      return x->type == XML_DOCUMENT_NODE || x->type == XML_HTML_DOCUMENT_NODE;
+    }
+    static bool is_ancestor_or_self(const xmlNode *a, const xmlNode *x)
+    {
+      for (; x; x = x->parent)
+        if (x == a)
+          return true;
+      return false;
+    }
+
+    void Change_Log::touch(xmlNode *node)
+    {
+      if (!node || node->doc != doc_)
+        return;
+      // text nodes, attributes etc.
+      while (node && node->type != XML_ELEMENT_NODE && !is_document(node))
+        node = node->parent;
+      if (!node)
+        return;
+      if (is_document(node)) {
+        document_changed_ = true;
+        nodes_.clear();
+        return;
+      }
+      if (document_changed_)
+        return;
+      // e.g. a node inside an already unlinked subtree
+      const xmlNode *top = node;
+      while (top->parent)
+        top = top->parent;
+      if (!is_document(top))
+        return;
+      for (auto x : nodes_)
+        if (is_ancestor_or_self(x, node))
+          return;
+      nodes_.erase(std::remove_if(nodes_.begin(), nodes_.end(),
+            [node](const xmlNode *x) { return is_ancestor_or_self(node, x); }),
+          nodes_.end());
+      nodes_.push_back(node);
+    }
+    void Change_Log::unlinking(xmlNode *node)
+    {
+      if (node->doc != doc_)
+        return;
+      nodes_.erase(std::remove_if(nodes_.begin(), nodes_.end(),
+            [node](const xmlNode *x) { return is_ancestor_or_self(node, x); }),
+          nodes_.end());
+      touch(node->parent);
+    }
+
+    static void touched(xmlNode *node)
+    {
+      if (!node || !change_logs_size)
+        return;
+      lock_guard<mutex> lock(change_logs_mutex);
+      auto r = change_logs.equal_range(node->doc);
+      for (auto i = r.first; i != r.second; ++i)
+        i->second->touch(node);
+    }
+    static void unlinking(xmlNode *node)
+    {
+      if (!change_logs_size)
+        return;
+      lock_guard<mutex> lock(change_logs_mutex);
+      auto r = change_logs.equal_range(node->doc);
+      for (auto i = r.first; i != r.second; ++i)
+        i->second->unlinking(node);
+    }
+
     void remove(doc::Ptr &doc, const std::string &xpath)
     {
       // making sure that removed_nodes is destroyed after the
@@ -121,8 +242,10 @@ namespace xxxml {
       deque<Node_Ptr> removed_nodes;
       {
         Node_Set node_set(doc, xpath);
-        for (auto node : node_set)
+        for (auto node : node_set) {
+          unlinking(node);
           removed_nodes.push_back(unlink_node(node));
+        }
       }
     }
 
@@ -135,6 +258,7 @@ namespace xxxml {
       for (auto node : node_set) {
         if (first_element_child(node))
           continue; // ignore constructed tags
+        touched(node);
         string s;
         {
           xmlNode *child = node->children;
@@ -160,6 +284,7 @@ namespace xxxml {
     }
     void set_content(xmlNode *node, const std::string &value)
     {
+      touched(node);
       for (xmlNode *i = node->children; i; ) {
         xmlNode *t = i;
         i = i->next;
@@ -177,6 +302,7 @@ namespace xxxml {
     void add(xmlNode *node,
         std::string path, const std::string &value, bool replace_value)
     {
+      touched(node);
       if (path.empty() || path == ".") {
         add_content(node, value, replace_value);
       } else {
@@ -226,17 +352,21 @@ namespace xxxml {
         const std::string &name, const std::string &value)
     {
       Node_Set node_set(doc, xpath);
-      for (auto node : node_set)
+      for (auto node : node_set) {
+        touched(node);
         set_prop(node, name, value);
+      }
     }
 
     void insert(doc::Ptr &doc, xmlNode *node, xmlNode *new_node,
         int position)
     {
       if (!node) {
+        touched(reinterpret_cast<xmlNode*>(doc.get()));
         doc::set_root_element(doc, new_node);
         return;
       }
+      touched(position == 1 || position == -1 ? node : node->parent);
 
       enum { FIRST_CHILD = 1, LAST_CHILD = -1, BEFORE_NODE = -2, AFTER_NODE = 2};
       switch (position) {
@@ -352,6 +482,254 @@ namespace xxxml {
       return path_prime(node);
     }
 
+    size_t path(const xmlNode *node, const xmlNode **begin,
+        const xmlNode **end)
+    {
+      size_t n = 0;
+      for (auto x = node; x && x->type == XML_ELEMENT_NODE; x = x->parent)
+        ++n;
+      if (n > size_t(end - begin))
+        return n;
+      auto i = begin + n;
+      for (auto x = node; x && x->type == XML_ELEMENT_NODE; x = x->parent)
+        *--i = x;
+      return n;
+    }
+    void path(const xmlNode *node, std::vector<const xmlNode*> &v)
+    {
+      v.clear();
+      for (auto x = node; x && x->type == XML_ELEMENT_NODE; x = x->parent)
+        v.push_back(x);
+      std::reverse(v.begin(), v.end());
+    }
+
+    // compares local name and namespace href, i.e. like the XPath
+    // node test does
+    static bool same_name(const xmlNode *a, const xmlNode *b)
+    {
+      // names are usually from the same dictionary
+      if (a->name != b->name && strcmp(name(a), name(b)))
+        return false;
+      const xmlChar *x = a->ns ? a->ns->href : nullptr;
+      const xmlChar *y = b->ns ? b->ns->href : nullptr;
+      if (x == y)
+        return true;
+      if (!x || !y)
+        return false;
+      return !xmlStrcmp(x, y);
+    }
+
+    namespace {
+
+      // snprintf() like output sink
+      class Path_Sink {
+        private:
+          char *p_;
+          char *end_;
+          size_t n_ {0};
+        public:
+          Path_Sink(char *begin, char *end) : p_(begin), end_(end) {}
+          void put(const char *s, size_t len)
+          {
+            n_ += len;
+            if (p_ == end_)
+              return;
+            size_t k = std::min(len, size_t(end_ - p_) - 1);
+            memcpy(p_, s, k);
+            p_ += k;
+          }
+          void put(const char *s)
+          {
+            put(s, strlen(s));
+          }
+          void put(size_t pos)
+          {
+            char a[24];
+            char *e = a + sizeof a;
+            char *i = e;
+            do {
+              *--i = '0' + pos % 10;
+              pos /= 10;
+            } while (pos);
+            put(i, e - i);
+          }
+          size_t finish()
+          {
+            if (p_ != end_)
+              *p_ = 0;
+            return n_;
+          }
+      };
+
+      void put_step(Path_Sink &sink, const xmlNode *node, size_t pos,
+          bool indexed)
+      {
+        sink.put("/", 1);
+        if (node->ns && node->ns->prefix) {
+          sink.put(reinterpret_cast<const char*>(node->ns->prefix));
+          sink.put(":", 1);
+        }
+        sink.put(name(node));
+        if (indexed) {
+          sink.put("[", 1);
+          sink.put(pos);
+          sink.put("]", 1);
+        }
+      }
+
+      void to_string(const xmlNode *node, std::string &s,
+          size_t (*f)(const xmlNode*, char*, char*, void*), void *self)
+      {
+        // one byte is reserved for the terminating NUL
+        s.resize(s.capacity());
+        size_t n = f(node, &s[0], &s[0] + s.size(), self);
+        if (n >= s.size()) {
+          s.resize(n + 1);
+          f(node, &s[0], &s[0] + s.size(), self);
+        }
+        s.resize(n);
+      }
+
+    }
+
+    size_t format_path(const xmlNode *node, char *begin, char *end)
+    {
+      Path_Sink sink(begin, end);
+      // the path is written root first, thus, the ancestors are
+      // visited from the root on each step - paths are usually short
+      size_t depth = 0;
+      for (auto x = node; x && x->type == XML_ELEMENT_NODE; x = x->parent)
+        ++depth;
+      for (size_t d = depth; d; --d) {
+        auto x = node;
+        for (size_t i = 1; i < d; ++i)
+          x = x->parent;
+        size_t pos = 1;
+        for (auto i = previous_element_sibling(x); i;
+            i = previous_element_sibling(i))
+          if (same_name(i, x))
+            ++pos;
+        bool indexed = pos > 1;
+        for (auto i = next_element_sibling(x); !indexed && i;
+            i = next_element_sibling(i))
+          indexed = same_name(i, x);
+        put_step(sink, x, pos, indexed);
+      }
+      return sink.finish();
+    }
+    void format_path(const xmlNode *node, std::string &s)
+    {
+      to_string(node, s,
+          [](const xmlNode *n, char *b, char *e, void*) {
+            return format_path(n, b, e); }, nullptr);
+    }
+
+    static size_t hash_name(const xmlNode *node)
+    {
+      // FNV-1a
+      size_t h = 2166136261u;
+      for (auto i = node->name; *i; ++i)
+        h = (h ^ *i) * 16777619u;
+      if (node->ns && node->ns->href)
+        for (auto i = node->ns->href; *i; ++i)
+          h = (h ^ *i) * 16777619u;
+      return h;
+    }
+
+    // returns the slot of the node's name, i.e. 0 if it isn't present
+    size_t &Path_Formatter::slot(Level &l, const xmlNode *node)
+    {
+      size_t mask = l.slots.size() - 1;
+      for (size_t i = hash_name(node) & mask; ; i = (i + 1) & mask) {
+        size_t &s = l.slots[i];
+        if (!s || same_name(l.names[s - 1].first, node))
+          return s;
+      }
+    }
+
+    size_t Path_Formatter::position(const xmlNode *node, size_t level,
+        bool &indexed)
+    {
+      if (levels_.size() <= level)
+        levels_.resize(level + 1);
+      Level &l = levels_[level];
+      if (l.parent != node->parent) {
+        l.parent = node->parent;
+        l.names.clear();
+        size_t n = 0;
+        for (auto i = first_element_child(node->parent); i;
+            i = next_element_sibling(i))
+          ++n;
+        // at most half full
+        size_t m = 2;
+        while (m < 2 * n)
+          m *= 2;
+        l.slots.assign(m, 0);
+        for (auto i = first_element_child(node->parent); i;
+            i = next_element_sibling(i)) {
+          size_t &s = slot(l, i);
+          if (!s) {
+            l.names.emplace_back();
+            l.names.back().first = i;
+            s = l.names.size();
+          }
+          ++l.names[s - 1].count;
+        }
+      }
+      size_t s = slot(l, node);
+      if (!s)
+        throw Logic_Error("Path_Formatter: stale cache - call clear()");
+      Name_Entry *e = &l.names[s - 1];
+      indexed = e->count > 1;
+      if (!indexed)
+        return 1;
+      if (e->last == node)
+        return e->last_pos;
+      // in document order, the walk stops at the previously
+      // visited same-named sibling
+      size_t pos = 1;
+      for (auto i = previous_element_sibling(node); i;
+          i = previous_element_sibling(i)) {
+        if (i == e->last) {
+          pos += e->last_pos;
+          break;
+        }
+        if (same_name(i, node))
+          ++pos;
+      }
+      e->last = node;
+      e->last_pos = pos;
+      return pos;
+    }
+    size_t Path_Formatter::format(const xmlNode *node, char *begin, char *end)
+    {
+      Path_Sink sink(begin, end);
+      path(node, path_);
+      for (size_t d = 0; d < path_.size(); ++d) {
+        auto x = path_[d];
+        size_t pos = 1;
+        bool indexed = false;
+        if (x->parent)
+          pos = position(x, d, indexed);
+        put_step(sink, x, pos, indexed);
+      }
+      return sink.finish();
+    }
+    void Path_Formatter::format(const xmlNode *node, std::string &s)
+    {
+      to_string(node, s,
+          [](const xmlNode *n, char *b, char *e, void *self) {
+            return static_cast<Path_Formatter*>(self)->format(n, b, e); },
+          this);
+    }
+    void Path_Formatter::clear()
+    {
+      for (auto &l : levels_) {
+        l.parent = nullptr;
+        l.names.clear();
+      }
+    }
+
     std::pair<std::pair<const char*, const char*>, Output_Buffer_Ptr>
       dump(const doc::Ptr &doc, const xmlNode *node)
       {
@@ -365,6 +743,133 @@ namespace xxxml {
             std::move(b));
       }
 
+    size_t estimate_size(const xmlNode *node)
+    {
+      size_t n = 0;
+      auto x = node;
+      for (;;) {
+        switch (x->type) {
+          case XML_ELEMENT_NODE:
+            {
+              size_t k = xmlStrlen(x->name);
+              if (x->ns && x->ns->prefix)
+                k += xmlStrlen(x->ns->prefix) + 1;
+              // <x></x>
+              n += 2 * k + 5;
+              for (auto a = x->properties; a; a = a->next) {
+                // ` a="v"`
+                n += xmlStrlen(a->name) + 4;
+                if (a->ns && a->ns->prefix)
+                  n += xmlStrlen(a->ns->prefix) + 1;
+                for (auto t = a->children; t; t = t->next)
+                  n += xmlStrlen(t->content);
+              }
+              for (auto d = x->nsDef; d; d = d->next)
+                n += xmlStrlen(d->prefix) + xmlStrlen(d->href) + 10;
+            }
+            break;
+          case XML_TEXT_NODE:
+            n += xmlStrlen(x->content);
+            break;
+          case XML_CDATA_SECTION_NODE:
+            n += xmlStrlen(x->content) + 12;
+            break;
+          case XML_COMMENT_NODE:
+            n += xmlStrlen(x->content) + 7;
+            break;
+          case XML_PI_NODE:
+            n += xmlStrlen(x->name) + xmlStrlen(x->content) + 5;
+            break;
+          default:
+            break;
+        }
+        if (x->type == XML_ELEMENT_NODE && x->children) {
+          x = x->children;
+          continue;
+        }
+        while (x != node && !x->next)
+          x = x->parent;
+        if (x == node)
+          break;
+        x = x->next;
+      }
+      return n;
+    }
+
+    Serializer::Serializer()
+      : out_(output_buffer_create_io(
+            xxxml::detail::append_cb<vector<char> >, nullptr, &buffer_))
+    {
+    }
+    Serializer::Range Serializer::dump(const doc::Ptr &doc,
+        const xmlNode *node, bool format)
+    {
+      clear();
+      append(doc, node, format);
+      return content();
+    }
+    Serializer::Range Serializer::dump(const doc::Ptr &doc, bool format)
+    {
+      clear();
+      append(doc, format);
+      return content();
+    }
+    void Serializer::append(const doc::Ptr &doc, const xmlNode *node,
+        bool format)
+    {
+      if (!format)
+        buffer_.reserve(buffer_.size() + estimate_size(node));
+      node_dump_output(out_, doc, node, 0, format);
+      output_buffer_flush(out_);
+    }
+    void Serializer::append(const doc::Ptr &doc, bool format)
+    {
+      if (!format && has_root(doc))
+        buffer_.reserve(buffer_.size()
+            + estimate_size(doc::get_root_element(doc)) + 64);
+      // xmlSaveDoc() also writes the XML declaration and honors
+      // the document encoding, and - in contrast to
+      // xmlDocDumpFormatMemory() - doesn't copy the complete output
+      // into a new allocation
+      Save_Ctxt_Ptr s = save_to_io(xxxml::detail::append_cb<vector<char> >,
+          nullptr, &buffer_, nullptr, format ? XML_SAVE_FORMAT : 0);
+      save_doc(s, doc);
+      save_flush(s);
+    }
+    void Serializer::append(const char *begin, const char *end)
+    {
+      buffer_.insert(buffer_.end(), begin, end);
+    }
+    Serializer::Range Serializer::content() const
+    {
+      return Range(buffer_.data(), buffer_.data() + buffer_.size());
+    }
+    size_t Serializer::size() const
+    {
+      return buffer_.size();
+    }
+    void Serializer::clear()
+    {
+      buffer_.clear();
+    }
+    void Serializer::write(int fd)
+    {
+      write(fd, nullptr, nullptr);
+    }
+    void Serializer::write(int fd, const char *head_begin,
+        const char *head_end)
+    {
+      struct iovec v[2] = {
+        { const_cast<char*>(head_begin), size_t(head_end - head_begin) },
+        { buffer_.data(), buffer_.size() }
+      };
+      if (head_begin == head_end)
+        detail::write_all(fd, v + 1, 1);
+      else
+        detail::write_all(fd, v, 2);
+      clear();
+    }
+
   } // util
 
 
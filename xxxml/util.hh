@@ -5,6 +5,7 @@
 
 #include <string>
 #include <deque>
+#include <vector>
 
 namespace xxxml {
 
@@ -27,6 +28,63 @@ namespace xxxml {
     std::deque<const xmlNode*> path(const xmlNode *node);
     std::deque<xmlNode*> path(xmlNode *node);
 
+    // Allocation-free variants of path():
+    //
+    // The first one stores the element ancestors (root first) into
+    // [begin, end) and returns the depth. If the range is too small
+    // nothing is stored, i.e. as with snprintf(), the result has to be
+    // checked against end-begin.
+    //
+    // The second one clears the vector first, thus, a re-used vector
+    // doesn't allocate anymore once it has grown to the maximum depth.
+    size_t path(const xmlNode *node, const xmlNode **begin,
+        const xmlNode **end);
+    void path(const xmlNode *node, std::vector<const xmlNode*> &v);
+
+    // Writes a location path like `/root/b[3]/c` into [begin, end).
+    //
+    // A one-based position index is only added when an element has
+    // siblings with the same name (cf. xmlGetNodePath()).
+    // The output is always NUL-terminated (unless begin == end) and
+    // truncated if necessary. Returns the length of the complete path
+    // (excluding the NUL), i.e. the same convention as snprintf().
+    size_t format_path(const xmlNode *node, char *begin, char *end);
+    void format_path(const xmlNode *node, std::string &s);
+
+    // Same output as format_path(), but the sibling positions are
+    // cached between calls. Thus, when it is called for the nodes of
+    // a traversal (e.g. via DF_Traverser) computing the indices doesn't
+    // cost O(siblings) for each node. After warm up, the formatter
+    // doesn't allocate.
+    //
+    // The cache is only valid as long as the document isn't modified,
+    // i.e. call clear() after modifying it.
+    class Path_Formatter {
+      public:
+        size_t format(const xmlNode *node, char *begin, char *end);
+        void format(const xmlNode *node, std::string &s);
+        void clear();
+      private:
+        struct Name_Entry {
+          const xmlNode *first {nullptr};
+          size_t count {0};
+          const xmlNode *last {nullptr};
+          size_t last_pos {0};
+        };
+        struct Level {
+          const xmlNode *parent {nullptr};
+          std::vector<Name_Entry> names;
+          // open addressing hash table of indices into names (+1),
+          // keyed by local name and namespace URI
+          std::vector<size_t> slots;
+        };
+        std::vector<Level> levels_;
+        std::vector<const xmlNode*> path_;
+
+        static size_t &slot(Level &l, const xmlNode *node);
+        size_t position(const xmlNode *node, size_t level, bool &indexed);
+    };
+
     class Node_Set {
       private:
         xpath::Context_Ptr c_;
@@ -40,6 +98,41 @@ namespace xxxml {
         iterator end();
     };
 
+    // Records the elements whose subtrees the mutating helpers below
+    // (set_content(), add(), set_attribute(), insert(), remove(),
+    // replace()) modify - e.g. for revalidating just those subtrees
+    // (cf. util::Revalidator).
+    //
+    // A log is active while it exists and records the modifications of
+    // its document, i.e. logs of different documents are independent.
+    // All logs of a document record its modifications.
+    class Change_Log {
+      public:
+        // doc must outlive the log
+        explicit Change_Log(const xmlDoc *doc);
+        explicit Change_Log(const doc::Ptr &doc);
+        ~Change_Log();
+        Change_Log(const Change_Log &) =delete;
+        Change_Log &operator=(const Change_Log &) =delete;
+
+        // modified elements, none is a descendant of another
+        const std::vector<xmlNode*> &nodes() const;
+        // e.g. the root element was replaced
+        bool document_changed() const;
+        void clear();
+
+        // For other modifications:
+        // touch() a node whose content, attributes or children change,
+        // call unlinking() before unlinking (and possibly freeing) a node,
+        // such that no dangling pointers are recorded.
+        void touch(xmlNode *node);
+        void unlinking(xmlNode *node);
+      private:
+        const xmlDoc *doc_;
+        std::vector<xmlNode*> nodes_;
+        bool document_changed_ {false};
+    };
+
     void remove(doc::Ptr &doc, const std::string &xpath);
     void replace(doc::Ptr &doc, const std::string &xpath,
         const std::string &regex, const std::string &subst);
@@ -78,6 +171,49 @@ namespace xxxml {
 
     std::pair<std::pair<const char*, const char*>, Output_Buffer_Ptr>
       dump(const doc::Ptr &doc, const xmlNode *node);
+
+    // Estimates the size of the unformatted serialization of a subtree,
+    // e.g. for reserving buffer space up-front. Character escaping
+    // may make the actual output a bit larger.
+    size_t estimate_size(const xmlNode *node);
+
+    // Serializes subtrees/documents into a buffer that is re-used
+    // between calls, i.e. after warm-up, dump() doesn't allocate
+    // (in contrast to dump() and doc::dump_format_memory()).
+    //
+    // A returned range is valid until the next modifying call.
+    class Serializer {
+      public:
+        using Range = std::pair<const char*, const char*>;
+
+        Serializer();
+        Serializer(const Serializer &) =delete;
+        Serializer &operator=(const Serializer &) =delete;
+
+        // clear(), then append()
+        Range dump(const doc::Ptr &doc, const xmlNode *node,
+            bool format = true);
+        Range dump(const doc::Ptr &doc, bool format = true);
+
+        void append(const doc::Ptr &doc, const xmlNode *node,
+            bool format = true);
+        void append(const doc::Ptr &doc, bool format = true);
+        void append(const char *begin, const char *end);
+
+        Range content() const;
+        size_t size() const;
+        // keeps the capacity
+        void clear();
+
+        // writes the content and clears the buffer
+        void write(int fd);
+        // the header (e.g. a length prefix or HTTP header) is written
+        // in front of the content, with one writev() call
+        void write(int fd, const char *head_begin, const char *head_end);
+      private:
+        std::vector<char> buffer_;
+        Output_Buffer_Ptr out_;
+    };
   }
 
 
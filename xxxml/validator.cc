@@ -0,0 +1,437 @@
+#include "validator.hh"
+
+#include <libxml/SAX2.h>
+
+#include <algorithm>
+
+#include <string.h>
+
+using namespace std;
+
+namespace xxxml {
+
+  namespace util {
+
+    namespace {
+
+      struct Collector {
+        vector<Validation_Error> *errors {nullptr};
+        size_t max {0};
+        size_t n {0};
+      };
+
+      void collect(void *user_data, xmlErrorPtr e)
+      {
+        auto c = static_cast<Collector*>(user_data);
+        if (!c->errors || c->n >= c->max || !e)
+          return;
+        Validation_Error r;
+        r.code = e->code;
+        r.level = e->level;
+        r.line = e->line;
+        if (e->node && e->domain != XML_FROM_PARSER)
+          r.node = static_cast<const xmlNode*>(e->node);
+        if (e->message) {
+          size_t n = strlen(e->message);
+          while (n && e->message[n-1] == '\n')
+            --n;
+          r.message.assign(e->message, n);
+        }
+        c->errors->push_back(std::move(r));
+        ++c->n;
+      }
+
+      void free_ctxt(xmlSchemaValidCtxt *c)
+      {
+        xmlSchemaFreeValidCtxt(c);
+      }
+      void free_ctxt(xmlRelaxNGValidCtxt *c)
+      {
+        xmlRelaxNGFreeValidCtxt(c);
+      }
+      void set_errors(xmlSchemaValidCtxt *c, Collector *collector)
+      {
+        xmlSchemaSetValidStructuredErrors(c, collect, collector);
+      }
+      void set_errors(xmlRelaxNGValidCtxt *c, Collector *collector)
+      {
+        xmlRelaxNGSetValidStructuredErrors(c, collect, collector);
+      }
+      void set_errors(xmlSchemaValidCtxt *c, Error_Collector *collector)
+      {
+        xmlSchemaSetValidStructuredErrors(c, Error_Collector::handler,
+            collector);
+      }
+      void set_errors(xmlRelaxNGValidCtxt *c, Error_Collector *collector)
+      {
+        xmlRelaxNGSetValidStructuredErrors(c, Error_Collector::handler,
+            collector);
+      }
+
+      // the parser reports to the thread-local structured handler,
+      // since the plugged SAX handler doesn't set one
+      class Parser_Errors {
+        public:
+          Parser_Errors(Error_Collector *errors)
+            :
+              old_(xmlStructuredError),
+              old_ctx_(xmlStructuredErrorContext)
+          {
+            xmlSetStructuredErrorFunc(errors, Error_Collector::handler);
+          }
+          ~Parser_Errors()
+          {
+            xmlSetStructuredErrorFunc(old_ctx_, old_);
+          }
+        private:
+          xmlStructuredErrorFunc old_;
+          void *old_ctx_;
+      };
+
+      int locate(void *ctx, const char **file, unsigned long *line)
+      {
+        auto pc = static_cast<xmlParserCtxt*>(ctx);
+        if (file)
+          *file = nullptr;
+        if (line)
+          *line = xmlSAX2GetLineNumber(pc);
+        return 0;
+      }
+
+      // Like xmlSchemaValidateStream(), but the file is pushed in chunks
+      // to a SAX parser, thus, it can stop early. The file is opened
+      // like for the other inputs, i.e. it may be compressed.
+      // Returns -1 if aborted.
+      int xsd_push(xmlSchemaValidCtxt *c, const char *filename,
+          Error_Collector &errors)
+      {
+        Input_Buffer_Ptr in = parser_input_buffer_create_filename(filename);
+        xmlSAXHandler handler;
+        memset(&handler, 0, sizeof handler);
+        handler.initialized = XML_SAX2_MAGIC;
+        xmlSAXHandler *sax = &handler;
+        void *user_data = nullptr;
+        schema::SAX_Plug_Ptr plug(xmlSchemaSAXPlug(c, &sax, &user_data),
+            xmlSchemaSAXUnplug);
+        if (!plug)
+          throw Runtime_Error("Could not plug schema validation");
+        Parser_Ctxt_Ptr pc(xmlCreatePushParserCtxt(sax, user_data,
+              nullptr, 0, filename), xmlFreeParserCtxt);
+        if (!pc)
+          throw Runtime_Error("Could not create push parser context");
+        Parser_Errors parser_errors(&errors);
+        xmlSchemaValidateSetLocator(c, locate, pc.get());
+        char buf[64 * 1024];
+        bool aborted = false;
+        bool read_error = false;
+        for (;;) {
+          if ((aborted = errors.limit_reached()))
+            break;
+          // the raw bytes, the parser detects the encoding
+          int n = in->readcallback(in->context, buf, sizeof buf);
+          // e.g. corrupt compressed data, i.e. the document is incomplete
+          read_error = n < 0;
+          bool last = n <= 0;
+          if (xmlParseChunk(pc.get(), buf, max(n, 0), last) || last)
+            break;
+        }
+        xmlSchemaValidateSetLocator(c, nullptr, nullptr);
+        if (aborted || errors.limit_reached())
+          return -1;
+        return !read_error && pc->wellFormed && xmlSchemaIsValid(c) == 1;
+      }
+
+    }
+
+    namespace detail {
+
+      // NB: afterwards, the context can't be reused, since the push
+      // state isn't reset - not even after a complete document.
+      int rng_push_subtree(xmlRelaxNGValidCtxt *c, xmlDoc *d,
+          xmlNode *elem, const Error_Collector *errors)
+      {
+        bool valid = true;
+        xmlNode *x = elem;
+        for (;;) {
+          if (errors && errors->limit_reached())
+            return -1;
+          if (x->type == XML_ELEMENT_NODE) {
+            int r = xmlRelaxNGValidatePushElement(c, d, x);
+            if (r == 0) {
+              // the content model requires the complete subtree
+              if (xmlRelaxNGValidateFullElement(c, d, x) != 1)
+                valid = false;
+            } else {
+              if (r != 1)
+                valid = false;
+              if (x->children) {
+                x = x->children;
+                continue;
+              }
+              if (xmlRelaxNGValidatePopElement(c, d, x) != 1)
+                valid = false;
+            }
+          } else if (x->type == XML_TEXT_NODE
+              || x->type == XML_CDATA_SECTION_NODE) {
+            if (xmlRelaxNGValidatePushCData(c, x->content,
+                  xmlStrlen(x->content)) != 1)
+              valid = false;
+          }
+          for (;;) {
+            if (x == elem)
+              return errors && errors->limit_reached() ? -1 : valid;
+            if (x->next) {
+              x = x->next;
+              break;
+            }
+            x = x->parent;
+            if (xmlRelaxNGValidatePopElement(c, d, x) != 1)
+              valid = false;
+          }
+        }
+      }
+
+    }
+
+    // Leases a context from the pool and puts it back on destruction,
+    // unless it is discarded, e.g. since it is in an unknown state.
+    template <typename T>
+      class Validator::Lease {
+        public:
+          Lease(Validator &v, vector<T*> &idle)
+            :
+              v_(v),
+              idle_(idle)
+          {
+            {
+              lock_guard<mutex> lock(v_.mutex_);
+              if (!idle_.empty()) {
+                ctxt_ = idle_.back();
+                idle_.pop_back();
+              }
+            }
+            if (!ctxt_)
+              ctxt_ = v_.new_ctxt(static_cast<T*>(nullptr));
+          }
+          ~Lease()
+          {
+            if (!ctxt_)
+              return;
+            set_errors(ctxt_, static_cast<Collector*>(nullptr));
+            lock_guard<mutex> lock(v_.mutex_);
+            idle_.push_back(ctxt_);
+          }
+          Lease(const Lease &) =delete;
+          Lease &operator=(const Lease &) =delete;
+
+          T *get()
+          {
+            return ctxt_;
+          }
+          void discard()
+          {
+            free_ctxt(ctxt_);
+            ctxt_ = nullptr;
+          }
+        private:
+          Validator &v_;
+          vector<T*> &idle_;
+          T *ctxt_ {nullptr};
+      };
+
+    Validator::Validator(schema::Ptr schema)
+      :
+        xsd_(std::move(schema)),
+        rng_(nullptr, xmlRelaxNGFree)
+    {
+      if (!xsd_)
+        throw Logic_Error("no schema");
+    }
+    Validator::Validator(relaxng::Ptr schema)
+      :
+        xsd_(nullptr, xmlSchemaFree),
+        rng_(std::move(schema))
+    {
+      if (!rng_)
+        throw Logic_Error("no schema");
+    }
+    Validator::~Validator()
+    {
+      for (auto c : xsd_idle_)
+        free_ctxt(c);
+      for (auto c : rng_idle_)
+        free_ctxt(c);
+    }
+
+    Validator::Kind Validator::kind() const
+    {
+      return xsd_ ? Kind::XSD : Kind::RELAXNG;
+    }
+
+    xmlSchemaValidCtxt *Validator::new_ctxt(xmlSchemaValidCtxt*)
+    {
+      return schema::new_valid_ctxt(xsd_).release();
+    }
+    xmlRelaxNGValidCtxt *Validator::new_ctxt(xmlRelaxNGValidCtxt*)
+    {
+      return relaxng::new_valid_ctxt(rng_).release();
+    }
+
+    bool Validator::validate(const doc::Ptr &doc)
+    {
+      vector<Validation_Error> errors;
+      return validate(doc, errors, 0);
+    }
+    bool Validator::validate(const doc::Ptr &doc,
+        vector<Validation_Error> &errors, size_t max_errors)
+    {
+      Collector collector;
+      collector.errors = &errors;
+      collector.max = max_errors;
+      xmlDoc *d = const_cast<xmlDoc*>(doc.get());
+      int r;
+      if (xsd_) {
+        Lease<xmlSchemaValidCtxt> c(*this, xsd_idle_);
+        set_errors(c.get(), &collector);
+        r = xmlSchemaValidateDoc(c.get(), d);
+      } else {
+        Lease<xmlRelaxNGValidCtxt> c(*this, rng_idle_);
+        set_errors(c.get(), &collector);
+        r = xmlRelaxNGValidateDoc(c.get(), d);
+      }
+      if (r < 0)
+        throw Logic_Error("internal validation error");
+      return !r;
+    }
+
+    bool Validator::validate_file(const char *filename)
+    {
+      vector<Validation_Error> errors;
+      return validate_file(filename, errors, 0);
+    }
+    bool Validator::validate_file(const char *filename,
+        vector<Validation_Error> &errors, size_t max_errors)
+    {
+      if (xsd_)
+        return validate_stream(parser_input_buffer_create_filename(filename),
+            errors, max_errors);
+      return validate_reader(text_reader::for_file(filename),
+          errors, max_errors);
+    }
+
+    bool Validator::validate_memory(const char *begin, const char *end)
+    {
+      vector<Validation_Error> errors;
+      return validate_memory(begin, end, errors, 0);
+    }
+    bool Validator::validate_memory(const char *begin, const char *end,
+        vector<Validation_Error> &errors, size_t max_errors)
+    {
+      if (xsd_)
+        return validate_stream(parser_input_buffer_create_mem(begin, end),
+            errors, max_errors);
+      return validate_reader(
+          text_reader::for_memory(begin, end, nullptr, nullptr, 0),
+          errors, max_errors);
+    }
+
+    bool Validator::validate_stream(Input_Buffer_Ptr input,
+        vector<Validation_Error> &errors, size_t max_errors)
+    {
+      Collector collector;
+      collector.errors = &errors;
+      collector.max = max_errors;
+      Lease<xmlSchemaValidCtxt> c(*this, xsd_idle_);
+      set_errors(c.get(), &collector);
+      // the input is freed with the internal parser context,
+      // -1 is also returned on input that isn't well-formed
+      return !xmlSchemaValidateStream(c.get(), input.release(),
+          XML_CHAR_ENCODING_NONE, nullptr, nullptr);
+    }
+
+    bool Validator::validate_reader(text_reader::Ptr reader,
+        vector<Validation_Error> &errors, size_t max_errors)
+    {
+      Collector collector;
+      collector.errors = &errors;
+      collector.max = max_errors;
+      text_reader::set_structured_error_handler(reader, collect, &collector);
+      Lease<xmlRelaxNGValidCtxt> c(*this, rng_idle_);
+      set_errors(c.get(), &collector);
+      if (xmlTextReaderRelaxNGValidateCtxt(reader.get(), c.get(), 0) == -1)
+        throw Runtime_Error("Could not enable rng context validation");
+      bool valid = false;
+      try {
+        while (text_reader::read(reader))
+          ;
+        valid = text_reader::is_valid(reader);
+      } catch (const Runtime_Error &) {
+        // not well-formed
+      }
+      xmlTextReaderRelaxNGValidateCtxt(reader.get(), nullptr, 0);
+      // the reader uses the push interface, i.e. the context
+      // can't be reused (cf. detail::rng_push_subtree())
+      c.discard();
+      return valid;
+    }
+
+    bool Validator::validate(const doc::Ptr &doc, Error_Collector &errors)
+    {
+      xmlDoc *d = const_cast<xmlDoc*>(doc.get());
+      if (xsd_) {
+        Lease<xmlSchemaValidCtxt> c(*this, xsd_idle_);
+        set_errors(c.get(), &errors);
+        int r = xmlSchemaValidateDoc(c.get(), d);
+        if (r < 0)
+          throw Logic_Error("internal validation error");
+        return !r && !errors.limit_reached();
+      }
+      Lease<xmlRelaxNGValidCtxt> c(*this, rng_idle_);
+      set_errors(c.get(), &errors);
+      // like xmlRelaxNGValidateDoc(), but it can stop early
+      xmlNode *root = xmlDocGetRootElement(d);
+      int r = root ? detail::rng_push_subtree(c.get(), d, root, &errors) : 0;
+      c.discard();
+      return r == 1;
+    }
+
+    bool Validator::validate_file(const char *filename,
+        Error_Collector &errors)
+    {
+      if (xsd_) {
+        Lease<xmlSchemaValidCtxt> c(*this, xsd_idle_);
+        set_errors(c.get(), &errors);
+        int r = xsd_push(c.get(), filename, errors);
+        if (r == -1) {
+          c.discard();
+          return false;
+        }
+        return r;
+      }
+      text_reader::Ptr reader = text_reader::for_file(filename);
+      errors.attach(reader);
+      Lease<xmlRelaxNGValidCtxt> c(*this, rng_idle_);
+      set_errors(c.get(), &errors);
+      if (xmlTextReaderRelaxNGValidateCtxt(reader.get(), c.get(), 0) == -1)
+        throw Runtime_Error("Could not enable rng context validation");
+      bool valid = false;
+      try {
+        while (!errors.limit_reached() && text_reader::read(reader))
+          ;
+        valid = !errors.limit_reached() && text_reader::is_valid(reader);
+      } catch (const Runtime_Error &) {
+      }
+      xmlTextReaderRelaxNGValidateCtxt(reader.get(), nullptr, 0);
+      c.discard();
+      return valid;
+    }
+
+    size_t Validator::idle_contexts() const
+    {
+      lock_guard<mutex> lock(mutex_);
+      return xsd_idle_.size() + rng_idle_.size();
+    }
+
+  }
+
+}
@@ -0,0 +1,112 @@
+#ifndef XXXML_VALIDATOR_HH
+#define XXXML_VALIDATOR_HH
+
+#include <xxxml/xxxml.hh>
+#include <xxxml/error_collector.hh>
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace xxxml {
+
+  namespace util {
+
+    struct Validation_Error {
+      // cf. xmlParserErrors
+      int code {0};
+      // cf. xmlErrorLevel
+      int level {0};
+      int line {0};
+      // the node in the validated document, nullptr when validating
+      // a stream
+      const xmlNode *node {nullptr};
+      // without trailing newline
+      std::string message;
+    };
+
+    namespace detail {
+
+      // Validates the subtree of elem element by element via the RelaxNG
+      // push interface, i.e. in the current push state of the context.
+      // Returns 1 if valid, 0 if invalid and -1 if the limit of errors
+      // (if not nullptr) is reached.
+      int rng_push_subtree(xmlRelaxNGValidCtxt *c, xmlDoc *doc,
+          xmlNode *elem, const Error_Collector *errors);
+
+    }
+
+    // Owns a compiled XSD or RelaxNG schema and validates documents
+    // from several threads concurrently.
+    //
+    // A compiled schema is immutable, thus, it can be shared. Validation
+    // contexts can't, thus, each validate() call leases one from a pool,
+    // i.e. the contexts are only created for the first concurrent calls.
+    // Except for RelaxNG streaming/collector validation: libxml2 doesn't
+    // reset the push state of a RelaxNG context, thus, those are used
+    // once.
+    //
+    // Errors are captured via the structured error callbacks, i.e. nothing
+    // is printed to stderr.
+    class Validator {
+      public:
+        enum class Kind { XSD, RELAXNG };
+
+        explicit Validator(schema::Ptr schema);
+        explicit Validator(relaxng::Ptr schema);
+        ~Validator();
+        Validator(const Validator &) =delete;
+        Validator &operator=(const Validator &) =delete;
+
+        Kind kind() const;
+
+        // Thread-safe. Returns true if the document is valid, the first
+        // max_errors errors are appended to errors.
+        // Throws Logic_Error on internal errors.
+        bool validate(const doc::Ptr &doc);
+        bool validate(const doc::Ptr &doc,
+            std::vector<Validation_Error> &errors, size_t max_errors = 100);
+
+        // Thread-safe streaming validation, i.e. no tree is built.
+        // Input that isn't well-formed is reported as invalid.
+        bool validate_file(const char *filename);
+        bool validate_file(const char *filename,
+            std::vector<Validation_Error> &errors, size_t max_errors = 100);
+
+        // Thread-safe streaming validation of a memory range
+        bool validate_memory(const char *begin, const char *end);
+        bool validate_memory(const char *begin, const char *end,
+            std::vector<Validation_Error> &errors, size_t max_errors = 100);
+
+        // Records the errors into the collector and stops as soon as
+        // its error limit is reached - in that case false is returned.
+        // XSD document validation can't be interrupted, though, only
+        // the recording stops.
+        bool validate(const doc::Ptr &doc, Error_Collector &errors);
+        bool validate_file(const char *filename, Error_Collector &errors);
+
+        // number of pooled contexts that aren't leased right now
+        size_t idle_contexts() const;
+      private:
+        template <typename T> class Lease;
+
+        bool validate_stream(Input_Buffer_Ptr input,
+            std::vector<Validation_Error> &errors, size_t max_errors);
+        bool validate_reader(text_reader::Ptr reader,
+            std::vector<Validation_Error> &errors, size_t max_errors);
+
+        xmlSchemaValidCtxt *new_ctxt(xmlSchemaValidCtxt*);
+        xmlRelaxNGValidCtxt *new_ctxt(xmlRelaxNGValidCtxt*);
+
+        schema::Ptr xsd_;
+        relaxng::Ptr rng_;
+        mutable std::mutex mutex_;
+        std::vector<xmlSchemaValidCtxt*> xsd_idle_;
+        std::vector<xmlRelaxNGValidCtxt*> rng_idle_;
+    };
+
+  }
+
+}
+
+#endif
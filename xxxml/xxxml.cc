@@ -1,10 +1,13 @@
 #include "xxxml.hh"
+#include "escape.hh"
+#include "io.hh"
 
 #include <string.h>
 #include <sstream>
 
 #include <libxml/xpathInternals.h>
 #include <libxml/xmlschemastypes.h>
+#include <libxml/parserInternals.h>
 
 
 using namespace std;
@@ -28,14 +31,30 @@ namespace xxxml {
     // LIBXML_TEST_VERSION already calls:
     //xmlInitParser();
   }
+  Library::Library(xmlExternalEntityLoader loader)
+    :
+      Library()
+  {
+    old_loader_ = set_external_entity_loader(loader);
+  }
   // optional, makes leak detectors happy
   Library::~Library()
   {
+    if (old_loader_)
+      xmlSetExternalEntityLoader(old_loader_);
     xmlCleanupParser();
     xmlSchemaCleanupTypes();
   }
   bool Library::initialized_ = false;
 
+  xmlExternalEntityLoader set_external_entity_loader(
+      xmlExternalEntityLoader loader)
+  {
+    xmlExternalEntityLoader r = xmlGetExternalEntityLoader();
+    xmlSetExternalEntityLoader(loader);
+    return r;
+  }
+
   namespace xpath {
 
 
@@ -91,6 +110,15 @@ namespace xxxml {
       return r;
     }
 
+    Context_Ptr new_context(const xmlDoc *doc)
+    {
+      Context_Ptr r(xmlXPathNewContext(const_cast<xmlDoc*>(doc)),
+          xmlXPathFreeContext);
+      if (!r)
+        throw Runtime_Error("Could not create xpath context");
+      return r;
+    }
+
     void register_ns(Context_Ptr &context, const char *prefix, const char *ns)
     {
       int r = xmlXPathRegisterNs(context.get(),
@@ -239,6 +267,54 @@ namespace xxxml {
         throw Validate_Error("XML document is invalid");
     }
 
+    void validate_stream(Valid_Ctxt_Ptr &valid_ctxt, Input_Buffer_Ptr input,
+        xmlCharEncoding enc, xmlSAXHandler *sax, void *user_data)
+    {
+      // the input is freed with the internal parser context
+      int r = xmlSchemaValidateStream(valid_ctxt.get(), input.release(), enc,
+          sax, user_data);
+      // in contrast to validate_doc(), -1 is also returned when the
+      // parser gives up, e.g. on input that isn't well-formed
+      if (r)
+        throw Validate_Error("XML stream is invalid");
+    }
+    void validate_memory(Valid_Ctxt_Ptr &valid_ctxt,
+        const char *begin, const char *end)
+    {
+      validate_stream(valid_ctxt, parser_input_buffer_create_mem(begin, end));
+    }
+    void validate_memory(Valid_Ctxt_Ptr &valid_ctxt, const char *s)
+    {
+      validate_memory(valid_ctxt, s, s + strlen(s));
+    }
+    void validate_memory(Valid_Ctxt_Ptr &valid_ctxt, const std::string &s)
+    {
+      validate_memory(valid_ctxt, s.data(), s.data() + s.size());
+    }
+    void validate_file(Valid_Ctxt_Ptr &valid_ctxt, const char *filename)
+    {
+      validate_stream(valid_ctxt,
+          parser_input_buffer_create_filename(filename));
+    }
+    void validate_file(Valid_Ctxt_Ptr &valid_ctxt, const std::string &filename)
+    {
+      validate_file(valid_ctxt, filename.c_str());
+    }
+
+    SAX_Plug_Ptr sax_plug(Valid_Ctxt_Ptr &valid_ctxt, xmlSAXHandler **sax,
+        void **user_data)
+    {
+      SAX_Plug_Ptr r(xmlSchemaSAXPlug(valid_ctxt.get(), sax, user_data),
+          xmlSchemaSAXUnplug);
+      if (!r)
+        throw Runtime_Error("Could not plug schema validation into SAX handler");
+      return r;
+    }
+    bool is_valid(Valid_Ctxt_Ptr &valid_ctxt)
+    {
+      return xmlSchemaIsValid(valid_ctxt.get()) == 1;
+    }
+
     void set_valid_structured_errors(Valid_Ctxt_Ptr &v, xmlStructuredErrorFunc f,
         void *user_ptr)
     {
@@ -428,6 +504,29 @@ namespace xxxml {
     return ctxt_read_file(parser_context, filename.c_str(), encoding, options);
   }
 
+  doc::Ptr ctxt_read_io(Parser_Ctxt_Ptr &parser_context,
+      xmlInputReadCallback ioread, xmlInputCloseCallback ioclose, void *ioctx,
+      const char *URL, const char *encoding,
+      int options)
+  {
+    doc::Ptr r(xmlCtxtReadIO(parser_context.get(), ioread, ioclose, ioctx,
+          URL, encoding, options), xmlFreeDoc);
+    if (!r)
+      throw Parse_Error("Could not parse XML from IO with ctxt");
+    return r;
+  }
+  doc::Ptr read_io(
+      xmlInputReadCallback ioread, xmlInputCloseCallback ioclose, void *ioctx,
+      const char *URL, const char *encoding,
+      int options)
+  {
+    doc::Ptr r(xmlReadIO(ioread, ioclose, ioctx, URL, encoding, options),
+        xmlFreeDoc);
+    if (!r)
+      throw Parse_Error("Could not parse XML from IO");
+    return r;
+  }
+
   doc::Ptr read_memory(
       const char *begin, const char *end,
       const char *URL, const char *encoding,
@@ -749,6 +848,15 @@ namespace xxxml {
   {
     return new_doc_node(doc, name.c_str(), content.c_str());
   }
+  // like xmlNewDocNode(), the content is parsed for entity references
+  xmlNode *new_doc_node(doc::Ptr &doc, const char *name,
+      const char *begin, const char *end)
+  {
+    xmlNode *r = new_doc_node(doc, name);
+    xmlNodeSetContentLen(r, reinterpret_cast<const xmlChar*>(begin),
+        end-begin);
+    return r;
+  }
 
   xmlNode *new_doc_text(doc::Ptr &doc)
   {
@@ -769,6 +877,14 @@ namespace xxxml {
   {
     return new_doc_text(doc, text.c_str());
   }
+  xmlNode *new_doc_text(doc::Ptr &doc, const char *begin, const char *end)
+  {
+    xmlNode *r = xmlNewDocTextLen(doc.get(),
+        reinterpret_cast<const xmlChar*>(begin), end-begin);
+    if (!r)
+      throw Runtime_Error("Could not allocate doc text node");
+    return r;
+  }
 
 
   xmlNode *new_child(xmlNode *parent, const char *name)
@@ -798,6 +914,14 @@ namespace xxxml {
   {
     return new_child(parent, name.c_str(), content.c_str());
   }
+  xmlNode *new_child(xmlNode *parent, const char *name,
+      const char *begin, const char *end)
+  {
+    xmlNode *r = new_child(parent, name);
+    xmlNodeSetContentLen(r, reinterpret_cast<const xmlChar*>(begin),
+        end-begin);
+    return r;
+  }
 
   xmlNode *add_child(xmlNode *parent, xmlNode *node)
   {
@@ -839,6 +963,16 @@ namespace xxxml {
     node_set_name(node, name.c_str());
   }
 
+  void node_set_content(xmlNode *node, const char *begin, const char *end)
+  {
+    xmlNodeSetContentLen(node, reinterpret_cast<const xmlChar*>(begin),
+        end-begin);
+  }
+  void node_set_content(xmlNode *node, const std::string &content)
+  {
+    node_set_content(node, content.data(), content.data() + content.size());
+  }
+
   Node_Ptr unlink_node(xmlNode *node)
   {
     return Node_Ptr((xmlUnlinkNode(node), node), xmlFreeNode);
@@ -860,6 +994,29 @@ namespace xxxml {
     return new_prop(node, name.c_str(), value.c_str());
   }
 
+  // Sets the value of an attribute that was created/reset with a null
+  // value. As with xmlNewProp()/xmlSetProp(), the value isn't parsed for
+  // entity references.
+  static xmlAttr *set_prop_value(xmlNode *node, xmlAttr *a,
+      const char *begin, const char *end)
+  {
+    xmlNode *t = xmlNewDocTextLen(node->doc,
+        reinterpret_cast<const xmlChar*>(begin), end-begin);
+    if (!t)
+      throw Runtime_Error("Could not allocate property value");
+    t->parent = reinterpret_cast<xmlNode*>(a);
+    a->children = a->last = t;
+    if (xmlIsID(node->doc, node, a) == 1)
+      xmlAddID(nullptr, node->doc,
+          reinterpret_cast<const xmlChar*>(string(begin, end).c_str()), a);
+    return a;
+  }
+  xmlAttr *new_prop(xmlNode *node, const char *name,
+      const char *begin, const char *end)
+  {
+    return set_prop_value(node, new_prop(node, name, nullptr), begin, end);
+  }
+
   xmlAttr *set_prop(xmlNode *node, const char *name, const char *value)
   {
     auto r = xmlSetProp(node,
@@ -875,6 +1032,11 @@ namespace xxxml {
   {
     return set_prop(node, name.c_str(), value.c_str());
   }
+  xmlAttr *set_prop(xmlNode *node, const char *name,
+      const char *begin, const char *end)
+  {
+    return set_prop_value(node, set_prop(node, name, nullptr), begin, end);
+  }
 
   Char_Ptr get_prop(const xmlNode *node, const char *name)
   {
@@ -885,6 +1047,66 @@ namespace xxxml {
     return Char_Ptr(reinterpret_cast<char*>(r), xmlFree);
   }
 
+  xmlAttr *set_ns_prop(xmlNode *node, xmlNs *ns,
+      const char *name, const char *value)
+  {
+    auto r = xmlSetNsProp(node, ns,
+        reinterpret_cast<const xmlChar*>(name),
+        reinterpret_cast<const xmlChar*>(value)
+        );
+    if (!r)
+      throw Runtime_Error("Could not allocate ns property");
+    return r;
+  }
+  bool unset_prop(xmlNode *node, const char *name)
+  {
+    return !xmlUnsetProp(node, reinterpret_cast<const xmlChar*>(name));
+  }
+  bool unset_ns_prop(xmlNode *node, xmlNs *ns, const char *name)
+  {
+    return !xmlUnsetNsProp(node, ns, reinterpret_cast<const xmlChar*>(name));
+  }
+
+  xmlNs *search_ns_by_href(xmlNode *node, const char *href)
+  {
+    return xmlSearchNsByHref(node->doc, node,
+        reinterpret_cast<const xmlChar*>(href));
+  }
+  xmlNs *new_ns(xmlNode *node, const char *href, const char *prefix)
+  {
+    xmlNs *r = xmlNewNs(node, reinterpret_cast<const xmlChar*>(href),
+        reinterpret_cast<const xmlChar*>(prefix));
+    if (!r)
+      throw Runtime_Error("Could not create namespace: " + string(href));
+    return r;
+  }
+
+  namespace pattern {
+
+    Ptr compile(const char *pattern, int flags, const char **namespaces)
+    {
+      Ptr r(xmlPatterncompile(reinterpret_cast<const xmlChar*>(pattern),
+            nullptr, flags, reinterpret_cast<const xmlChar**>(namespaces)),
+          xmlFreePattern);
+      if (!r)
+        throw Runtime_Error("Could not compile pattern: " + string(pattern));
+      return r;
+    }
+    Ptr compile(const std::string &pattern, int flags, const char **namespaces)
+    {
+      return compile(pattern.c_str(), flags, namespaces);
+    }
+
+    bool match(const Ptr &pattern, const xmlNode *node)
+    {
+      int r = xmlPatternMatch(pattern.get(), const_cast<xmlNode*>(node));
+      if (r == -1)
+        throw Runtime_Error("pattern match failed");
+      return r;
+    }
+
+  }
+
   namespace text_reader {
 
     Ptr for_memory(const char *begin, const char *end,
@@ -931,6 +1153,68 @@ namespace xxxml {
     {
       return for_file(filename.c_str(), encoding, options);
     }
+    Ptr for_io(xmlInputReadCallback ioread, xmlInputCloseCallback ioclose,
+        void *ioctx, const char *url,
+        const char *encoding, int options)
+    {
+      Ptr r(xmlReaderForIO(ioread, ioclose, ioctx, url, encoding, options),
+          xmlFreeTextReader);
+      if (!r)
+        throw Runtime_Error("could not text read IO");
+      return r;
+    }
+
+    void reset_memory(Ptr &reader, const char *begin, const char *end,
+        const char *url,
+        const char *encoding, int options)
+    {
+      int r = xmlReaderNewMemory(reader.get(), begin, end-begin, url,
+          encoding, options);
+      if (r == -1)
+        throw Runtime_Error("could not reset text reader to memory");
+    }
+    void reset_memory(Ptr &reader, const char *s,
+        const char *url,
+        const char *encoding, int options)
+    {
+      reset_memory(reader, s, s + strlen(s), url, encoding, options);
+    }
+    void reset_memory(Ptr &reader, const std::string &s,
+        const char *url,
+        const char *encoding, int options)
+    {
+      reset_memory(reader, s.data(), s.data() + s.size(), url, encoding,
+          options);
+    }
+    void reset_file(Ptr &reader, const char *filename,
+        const char *encoding, int options)
+    {
+      int r = xmlReaderNewFile(reader.get(), filename, encoding, options);
+      if (r == -1)
+        throw Runtime_Error("could not reset text reader to file: "
+            + string(filename));
+    }
+    void reset_file(Ptr &reader, const std::string &filename,
+        const char *encoding, int options)
+    {
+      reset_file(reader, filename.c_str(), encoding, options);
+    }
+    void reset_io(Ptr &reader,
+        xmlInputReadCallback ioread, xmlInputCloseCallback ioclose,
+        void *ioctx, const char *url,
+        const char *encoding, int options)
+    {
+      int r = xmlReaderNewIO(reader.get(), ioread, ioclose, ioctx, url,
+          encoding, options);
+      if (r == -1)
+        throw Runtime_Error("could not reset text reader to IO");
+    }
+    void close(Ptr &reader)
+    {
+      int r = xmlTextReaderClose(reader.get());
+      if (r == -1)
+        throw Runtime_Error("text reader close failed");
+    }
 
     bool read(Ptr &reader)
     {
@@ -964,6 +1248,22 @@ namespace xxxml {
       return r;
     }
 
+    bool move_to_element(Ptr &reader)
+    {
+      int r = xmlTextReaderMoveToElement(reader.get());
+      if (r == -1)
+        throw Runtime_Error("text reader move to element failed");
+      return r;
+    }
+
+    bool is_namespace_decl(Ptr &reader)
+    {
+      int r = xmlTextReaderIsNamespaceDecl(reader.get());
+      if (r == -1)
+        throw Runtime_Error("text reader namespace decl check failed");
+      return r;
+    }
+
     const char *const_value(Ptr &reader)
     {
       return reinterpret_cast<const char*>(xmlTextReaderConstValue(reader.get()));
@@ -1027,6 +1327,32 @@ namespace xxxml {
       return r;
     }
 
+    bool next(Ptr &reader)
+    {
+      int r = xmlTextReaderNext(reader.get());
+      if (r == -1)
+        throw Runtime_Error("text reader next failed");
+      return r;
+    }
+    xmlNode *expand(Ptr &reader)
+    {
+      xmlNode *r = xmlTextReaderExpand(reader.get());
+      if (!r)
+        throw Runtime_Error("text reader expand failed");
+      return r;
+    }
+    xmlNode *current_node(Ptr &reader)
+    {
+      return xmlTextReaderCurrentNode(reader.get());
+    }
+    doc::Ptr current_doc(Ptr &reader)
+    {
+      doc::Ptr r(xmlTextReaderCurrentDoc(reader.get()), xmlFreeDoc);
+      if (!r)
+        throw Runtime_Error("text reader has no current document");
+      return r;
+    }
+
     void set_parser_prop(Ptr &reader, int prop, int value)
     {
       int r = xmlTextReaderSetParserProp(reader.get(), prop, value);
@@ -1037,6 +1363,12 @@ namespace xxxml {
       }
     }
 
+    void set_structured_error_handler(Ptr &reader, xmlStructuredErrorFunc f,
+        void *user_data)
+    {
+      xmlTextReaderSetStructuredErrorHandler(reader.get(), f, user_data);
+    }
+
     void relaxng_validate(Ptr &reader)
     {
       int r = xmlTextReaderRelaxNGValidate(reader.get(), nullptr);
@@ -1079,6 +1411,48 @@ namespace xxxml {
         throw Runtime_Error("Could not enable rng schema validation");
     }
 
+    void schema_validate(Ptr &reader)
+    {
+      int r = xmlTextReaderSchemaValidate(reader.get(), nullptr);
+      if (r == -1)
+        throw Runtime_Error("Could not disable xsd filename validation");
+    }
+    void schema_validate(Ptr &reader, const char *filename)
+    {
+      int r = xmlTextReaderSchemaValidate(reader.get(), filename);
+      if (r == -1)
+        throw Runtime_Error("Could not enable xsd filename validation: "
+            + string(filename));
+    }
+    void schema_validate(Ptr &reader, const std::string &filename)
+    {
+      schema_validate(reader, filename.c_str());
+    }
+    void schema_validate_ctxt(Ptr &reader)
+    {
+      int r = xmlTextReaderSchemaValidateCtxt(reader.get(), nullptr, 0);
+      if (r == -1)
+        throw Runtime_Error("Could not disable xsd context validation");
+    }
+    void schema_validate_ctxt(Ptr &reader, schema::Valid_Ctxt_Ptr &context)
+    {
+      int r = xmlTextReaderSchemaValidateCtxt(reader.get(), context.get(), 0);
+      if (r == -1)
+        throw Runtime_Error("Could not enable xsd context validation");
+    }
+    void schema_set_schema(Ptr &reader)
+    {
+      int r = xmlTextReaderSetSchema(reader.get(), nullptr);
+      if (r == -1)
+        throw Runtime_Error("Could not disable xsd schema validation");
+    }
+    void schema_set_schema(Ptr &reader, schema::Ptr &schema)
+    {
+      int r = xmlTextReaderSetSchema(reader.get(), schema.get());
+      if (r == -1)
+        throw Runtime_Error("Could not enable xsd schema validation");
+    }
+
   }
 
   namespace text_writer {
@@ -1177,6 +1551,48 @@ namespace xxxml {
         throw Runtime_Error("error closing attribute");
     }
 
+    // libxml2 writes strings depending on the writer state (and the
+    // document encoding), thus, we copy and pass those to libxml2
+    static int write_copy(xmlTextWriter *w, const char *begin,
+        const char *end)
+    {
+      static thread_local string buffer;
+      buffer.assign(begin, end);
+      return xmlTextWriterWriteString(w,
+          reinterpret_cast<const xmlChar*>(buffer.c_str()));
+    }
+    // NODE_TEXT: text as node_dump_output() escapes it (cf.
+    // xmlEscapeContent()), i.e. '"' isn't escaped
+    enum class Content { ELEMENT, ATTRIBUTE, NODE_TEXT };
+    // Writes the runs without special characters directly, they are
+    // searched with SIMD instructions, cf. escape.hh.
+    // The rest of non-ASCII content in attributes is passed to libxml2.
+    static int write_escaped(xmlTextWriter *w, const char *begin,
+        const char *end, Content c)
+    {
+      // an empty string still closes the start tag
+      if (begin == end)
+        return xmlTextWriterWriteRaw(w, reinterpret_cast<const xmlChar*>(""));
+      auto e = c == Content::ATTRIBUTE ? detail::Escape::ATTRIBUTE
+                                       : detail::Escape::TEXT;
+      const char *i = detail::escape_runs(begin, end, e,
+          [w](const char *first, const char *last) {
+            return xmlTextWriterWriteRawLen(w,
+                reinterpret_cast<const xmlChar*>(first), last-first) != -1; },
+          [w, c](char x) {
+            const char *r = c == Content::NODE_TEXT && x == '"' ? "\""
+              : detail::escape(x);
+            return xmlTextWriterWriteRaw(w,
+                reinterpret_cast<const xmlChar*>(r)) != -1; });
+      if (!i)
+        return -1;
+      if (i != end)
+        return write_copy(w, i, end);
+      return 0;
+    }
+
+    // the writer state isn't known, e.g. inside a CDATA section or
+    // comment libxml2 doesn't escape
     void write_string(Ptr &writer, const char *content)
     {
       int r = xmlTextWriterWriteString(writer.get(),
@@ -1184,6 +1600,11 @@ namespace xxxml {
       if (r == -1)
         throw Runtime_Error("error writing string ");
     }
+    void write_string(Ptr &writer, const char *begin, const char *end)
+    {
+      if (write_copy(writer.get(), begin, end) == -1)
+        throw Runtime_Error("error writing string ");
+    }
     void write_raw(Ptr &writer, const char *begin, const char *end)
     {
       int r = xmlTextWriterWriteRawLen(writer.get(),
@@ -1200,13 +1621,24 @@ namespace xxxml {
         throw Runtime_Error("error writing comment");
     }
 
+    // like xmlTextWriterWriteElement(), without content the
+    // element is written as empty-element tag
     void write_element(Ptr &writer, const char *name, const char *content)
     {
-      int r = xmlTextWriterWriteElement(writer.get(),
-          reinterpret_cast<const xmlChar*>(name),
-          reinterpret_cast<const xmlChar*>(content));
-      if (r == -1)
+      if (!content) {
+        start_element(writer, name);
+        end_element(writer);
+        return;
+      }
+      write_element(writer, name, content, content + strlen(content));
+    }
+    void write_element(Ptr &writer, const char *name,
+        const char *begin, const char *end)
+    {
+      start_element(writer, name);
+      if (write_escaped(writer.get(), begin, end, Content::ELEMENT) == -1)
         throw Runtime_Error("error writing element: " + string(name));
+      end_element(writer);
     }
 
     void write_element_ns(Ptr &writer, const char *prefix, const char *name,
@@ -1233,11 +1665,194 @@ namespace xxxml {
 
     void write_attribute(Ptr &writer, const char *name, const char *content)
     {
-      int r = xmlTextWriterWriteAttribute(writer.get(),
-          reinterpret_cast<const xmlChar*>(name),
-          reinterpret_cast<const xmlChar*>(content));
-      if (r == -1)
+      if (!content)
         throw Runtime_Error("error writing attribute: " + string(name));
+      write_attribute(writer, name, content, content + strlen(content));
+    }
+    void write_attribute(Ptr &writer, const char *name,
+        const char *begin, const char *end)
+    {
+      start_attribute(writer, name);
+      if (write_escaped(writer.get(), begin, end, Content::ATTRIBUTE) == -1)
+        throw Runtime_Error("error writing attribute: " + string(name));
+      end_attribute(writer);
+    }
+
+    namespace {
+      // the namespace declarations written by write_node()
+      class Ns_Scope {
+        public:
+          // i.e. it has to be declared
+          bool unbound(const xmlChar *prefix, const xmlChar *href) const
+          {
+            if (!href)
+              href = BAD_CAST "";
+            for (auto i = decls_.rbegin(); i != decls_.rend(); ++i)
+              if (xmlStrEqual(i->first, prefix))
+                return !xmlStrEqual(i->second, href);
+            // no default namespace is bound outside
+            return prefix || *href;
+          }
+          void push(const xmlChar *prefix, const xmlChar *href)
+          {
+            decls_.emplace_back(prefix, href);
+          }
+          size_t size() const
+          {
+            return decls_.size();
+          }
+          void pop(size_t n)
+          {
+            decls_.resize(n);
+          }
+        private:
+          vector<pair<const xmlChar*, const xmlChar*> > decls_;
+      };
+    }
+
+    static void check_node(int r)
+    {
+      if (r == -1)
+        throw Runtime_Error("error writing node");
+    }
+
+    static const xmlChar *qualified(string &buffer, const xmlNs *ns,
+        const xmlChar *name)
+    {
+      if (!ns || !ns->prefix)
+        return name;
+      buffer.assign(reinterpret_cast<const char*>(ns->prefix));
+      buffer += ':';
+      buffer += reinterpret_cast<const char*>(name);
+      return reinterpret_cast<const xmlChar*>(buffer.c_str());
+    }
+
+    static void write_text(xmlTextWriter *w, const xmlChar *s, Content c)
+    {
+      auto begin = reinterpret_cast<const char*>(s);
+      check_node(write_escaped(w, begin, begin + strlen(begin), c));
+    }
+
+    static void start_node(xmlTextWriter *w, const xmlNode *node,
+        Ns_Scope &scope, string &buffer)
+    {
+      static const xmlChar xmlns[] = "xmlns";
+      static const xmlChar empty[] = "";
+      check_node(xmlTextWriterStartElement(w,
+            qualified(buffer, node->ns, node->name)));
+      auto declare = [&](const xmlChar *prefix, const xmlChar *href) {
+        const xmlChar *name = xmlns;
+        if (prefix) {
+          buffer.assign("xmlns:");
+          buffer += reinterpret_cast<const char*>(prefix);
+          name = reinterpret_cast<const xmlChar*>(buffer.c_str());
+        }
+        check_node(xmlTextWriterStartAttribute(w, name));
+        write_text(w, href ? href : empty, Content::ATTRIBUTE);
+        check_node(xmlTextWriterEndAttribute(w));
+        scope.push(prefix, href ? href : empty);
+      };
+      for (auto ns = node->nsDef; ns; ns = ns->next)
+        declare(ns->prefix, ns->href);
+      const xmlChar *prefix = node->ns ? node->ns->prefix : nullptr;
+      const xmlChar *href = node->ns ? node->ns->href : nullptr;
+      if (scope.unbound(prefix, href))
+        declare(prefix, href);
+      for (auto a = node->properties; a; a = a->next)
+        if (a->ns && a->ns->prefix
+            && !xmlStrEqual(a->ns->prefix, BAD_CAST "xml")
+            && scope.unbound(a->ns->prefix, a->ns->href))
+          declare(a->ns->prefix, a->ns->href);
+      for (auto a = node->properties; a; a = a->next) {
+        check_node(xmlTextWriterStartAttribute(w,
+              qualified(buffer, a->ns, a->name)));
+        for (auto c = a->children; c; c = c->next) {
+          if (c->type == XML_TEXT_NODE) {
+            write_text(w, c->content, Content::ATTRIBUTE);
+          } else if (c->type == XML_ENTITY_REF_NODE) {
+            check_node(xmlTextWriterWriteFormatRaw(w, "&%s;", c->name));
+          }
+        }
+        check_node(xmlTextWriterEndAttribute(w));
+      }
+    }
+
+    void write_node(Ptr &writer, const doc::Ptr &doc, const xmlNode *node)
+    {
+      if (node->type == XML_DOCUMENT_NODE
+          || node->type == XML_HTML_DOCUMENT_NODE) {
+        for (auto x = node->children; x; x = x->next)
+          write_node(writer, doc, x);
+        return;
+      }
+      xmlTextWriter *w = writer.get();
+      Ns_Scope scope;
+      vector<size_t> marks;
+      string buffer;
+      auto end_node = [&]() {
+        check_node(xmlTextWriterEndElement(w));
+        scope.pop(marks.back());
+        marks.pop_back();
+      };
+      auto x = node;
+      for (;;) {
+        switch (x->type) {
+          case XML_ELEMENT_NODE:
+            marks.push_back(scope.size());
+            start_node(w, x, scope, buffer);
+            if (x->children) {
+              x = x->children;
+              continue;
+            }
+            end_node();
+            break;
+          case XML_TEXT_NODE:
+            if (!x->content)
+              break;
+            if (x->name == xmlStringTextNoenc)
+              check_node(xmlTextWriterWriteRaw(w, x->content));
+            else
+              write_text(w, x->content, Content::NODE_TEXT);
+            break;
+          case XML_CDATA_SECTION_NODE:
+            check_node(xmlTextWriterWriteCDATA(w, x->content));
+            break;
+          case XML_COMMENT_NODE:
+            check_node(xmlTextWriterWriteComment(w, x->content));
+            break;
+          case XML_PI_NODE:
+            check_node(xmlTextWriterWritePI(w, x->name, x->content));
+            break;
+          case XML_ENTITY_REF_NODE:
+            check_node(xmlTextWriterWriteFormatRaw(w, "&%s;", x->name));
+            break;
+          case XML_DTD_NODE:
+            {
+              // small, thus, dumped as is
+              Output_Buffer_Ptr o = output_buffer_create_mem(buffer);
+              buffer.clear();
+              node_dump_output(o, doc, x, 0, false);
+              output_buffer_flush(o);
+              check_node(xmlTextWriterWriteRawLen(w,
+                    reinterpret_cast<const xmlChar*>(buffer.data()),
+                    buffer.size()));
+            }
+            break;
+          default:
+            // declarations inside the DTD, XInclude markers etc.
+            break;
+        }
+        for (;;) {
+          if (x == node)
+            return;
+          if (x->next) {
+            x = x->next;
+            break;
+          }
+          x = x->parent;
+          end_node();
+        }
+      }
     }
 
     void flush(Ptr &writer)
@@ -1256,6 +1871,14 @@ namespace xxxml {
       throw Runtime_Error("Could not create text writer for output buffer");
     return r;
   }
+  text_writer::Ptr new_text_writer(std::string &buffer)
+  {
+    return new_text_writer(output_buffer_create_mem(buffer));
+  }
+  text_writer::Ptr new_text_writer(std::vector<char> &buffer)
+  {
+    return new_text_writer(output_buffer_create_mem(buffer));
+  }
   text_writer::Ptr new_text_writer_filename(const char *filename,
       bool compression)
   {
@@ -1281,5 +1904,114 @@ namespace xxxml {
         const_cast<xmlNode*>(cur), level, format, encoding);
   }
 
+  Input_Buffer_Ptr parser_input_buffer_create_mem(
+      const char *begin, const char *end, xmlCharEncoding enc)
+  {
+    Input_Buffer_Ptr r(xmlParserInputBufferCreateStatic(begin, end-begin,
+          enc), xmlFreeParserInputBuffer);
+    if (!r)
+      throw Runtime_Error("Could not create memory input buffer");
+    return r;
+  }
+  Input_Buffer_Ptr parser_input_buffer_create_filename(const char *filename,
+      xmlCharEncoding enc)
+  {
+    Input_Buffer_Ptr r(xmlParserInputBufferCreateFilename(filename, enc),
+        xmlFreeParserInputBuffer);
+    if (!r)
+      throw Runtime_Error("Could not open: " + string(filename));
+    return r;
+  }
+  Input_Buffer_Ptr parser_input_buffer_create_io(xmlInputReadCallback ioread,
+      xmlInputCloseCallback ioclose, void *ioctx, xmlCharEncoding enc)
+  {
+    Input_Buffer_Ptr r(xmlParserInputBufferCreateIO(ioread, ioclose, ioctx,
+          enc), xmlFreeParserInputBuffer);
+    if (!r)
+      throw Runtime_Error("Could not create IO input buffer");
+    return r;
+  }
+
+  Output_Buffer_Ptr output_buffer_create_io(xmlOutputWriteCallback iowrite,
+      xmlOutputCloseCallback ioclose, void *ioctx,
+      xmlCharEncodingHandler *encoder)
+  {
+    Output_Buffer_Ptr r(xmlOutputBufferCreateIO(iowrite, ioclose, ioctx,
+          encoder), xmlOutputBufferClose);
+    if (!r)
+      throw Runtime_Error("Could not create IO output buffer");
+    return r;
+  }
+  Output_Buffer_Ptr output_buffer_create_fd(int fd,
+      xmlCharEncodingHandler *encoder)
+  {
+    Output_Buffer_Ptr r(xmlOutputBufferCreateFd(fd, encoder),
+        xmlOutputBufferClose);
+    if (!r)
+      throw Runtime_Error("Could not create fd output buffer");
+    return r;
+  }
+  Output_Buffer_Ptr output_buffer_create_mem(std::string &buffer,
+      xmlCharEncodingHandler *encoder)
+  {
+    return output_buffer_create_io(detail::append_cb<string>, nullptr,
+        &buffer, encoder);
+  }
+  Output_Buffer_Ptr output_buffer_create_mem(std::vector<char> &buffer,
+      xmlCharEncodingHandler *encoder)
+  {
+    return output_buffer_create_io(detail::append_cb<vector<char> >,
+        nullptr, &buffer, encoder);
+  }
+  void output_buffer_write(Output_Buffer_Ptr &buf,
+      const char *begin, const char *end)
+  {
+    int r = xmlOutputBufferWrite(buf.get(), end-begin, begin);
+    if (r == -1)
+      throw Runtime_Error("Could not write to output buffer");
+  }
+  void output_buffer_flush(Output_Buffer_Ptr &buf)
+  {
+    int r = xmlOutputBufferFlush(buf.get());
+    if (r == -1)
+      throw Runtime_Error("Could not flush output buffer");
+  }
+
+  Save_Ctxt_Ptr save_to_io(xmlOutputWriteCallback iowrite,
+      xmlOutputCloseCallback ioclose, void *ioctx,
+      const char *encoding, int options)
+  {
+    Save_Ctxt_Ptr r(xmlSaveToIO(iowrite, ioclose, ioctx, encoding, options),
+        xmlSaveClose);
+    if (!r)
+      throw Runtime_Error("Could not create IO save context");
+    return r;
+  }
+  Save_Ctxt_Ptr save_to_fd(int fd, const char *encoding, int options)
+  {
+    Save_Ctxt_Ptr r(xmlSaveToFd(fd, encoding, options), xmlSaveClose);
+    if (!r)
+      throw Runtime_Error("Could not create fd save context");
+    return r;
+  }
+  void save_doc(Save_Ctxt_Ptr &ctxt, const doc::Ptr &doc)
+  {
+    long r = xmlSaveDoc(ctxt.get(), const_cast<xmlDoc*>(doc.get()));
+    if (r == -1)
+      throw Runtime_Error("Could not save document");
+  }
+  void save_tree(Save_Ctxt_Ptr &ctxt, const xmlNode *node)
+  {
+    long r = xmlSaveTree(ctxt.get(), const_cast<xmlNode*>(node));
+    if (r == -1)
+      throw Runtime_Error("Could not save tree");
+  }
+  void save_flush(Save_Ctxt_Ptr &ctxt)
+  {
+    int r = xmlSaveFlush(ctxt.get());
+    if (r == -1)
+      throw Runtime_Error("Could not flush save context");
+  }
+
 
 }
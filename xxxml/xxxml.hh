@@ -4,6 +4,7 @@
 #include <string>
 #include <stdexcept>
 #include <memory>
+#include <vector>
 
 #include <libxml/tree.h>
 #include <libxml/xpath.h>
@@ -12,6 +13,8 @@
 #include <libxml/relaxng.h>
 #include <libxml/xmlreader.h>
 #include <libxml/xmlwriter.h>
+#include <libxml/xmlsave.h>
+#include <libxml/pattern.h>
 
 /* ## General libxml2 Notes
  
@@ -107,13 +110,23 @@ namespace xxxml {
   class Library {
     public:
       Library();
+      // also installs an external entity loader (e.g.
+      // util::Entity_Cache::loader), the previous one is restored
+      // on destruction
+      explicit Library(xmlExternalEntityLoader loader);
       ~Library();
     private:
       Library(const Library&) =delete;
       Library &operator=(const Library&) = delete;
       static bool initialized_;
+      xmlExternalEntityLoader old_loader_ {nullptr};
   };
 
+  // global, i.e. should be called before other threads are started,
+  // returns the previous loader
+  xmlExternalEntityLoader set_external_entity_loader(
+      xmlExternalEntityLoader loader);
+
   using Char_Ptr = std::unique_ptr<char, void (*)(void*)>;
 
   using Node_Ptr = std::unique_ptr<xmlNode, void(*)(xmlNode*)>;
@@ -165,6 +178,19 @@ namespace xxxml {
       const char *encoding = nullptr,
       int options = 0);
 
+  // The read callback returns the number of bytes read, 0 at the end
+  // of the input and -1 on error; the close callback (may be nullptr)
+  // is called when the parser is done with the input.
+  // cf. xxxml/io.hh for C++ source objects
+  doc::Ptr ctxt_read_io(Parser_Ctxt_Ptr &parser_context,
+      xmlInputReadCallback ioread, xmlInputCloseCallback ioclose, void *ioctx,
+      const char *URL = nullptr, const char *encoding = nullptr,
+      int options = 0);
+  doc::Ptr read_io(
+      xmlInputReadCallback ioread, xmlInputCloseCallback ioclose, void *ioctx,
+      const char *URL = nullptr, const char *encoding = nullptr,
+      int options = 0);
+
   doc::Ptr read_memory(
       const char *begin, const char *end,
       const char *URL = nullptr, const char *encoding = nullptr,
@@ -257,16 +283,22 @@ namespace xxxml {
   xmlNode *new_doc_node(doc::Ptr &doc, const char *name, const char *content);
   xmlNode *new_doc_node(doc::Ptr &doc, const std::string &name,
       const std::string &content);
+  // the content doesn't need to be NUL-terminated
+  xmlNode *new_doc_node(doc::Ptr &doc, const char *name,
+      const char *begin, const char *end);
   // XXX add namespace overload
   xmlNode *new_doc_text(doc::Ptr &doc);
   xmlNode *new_doc_text(doc::Ptr &doc, const char *text);
   xmlNode *new_doc_text(doc::Ptr &doc, const std::string &text);
+  xmlNode *new_doc_text(doc::Ptr &doc, const char *begin, const char *end);
 
   xmlNode *new_child(xmlNode *parent, const char *name);
   xmlNode *new_child(xmlNode *parent, const std::string &name);
   xmlNode *new_child(xmlNode *parent, const char *name, const char *content);
   xmlNode *new_child(xmlNode *parent, const std::string &name,
       const std::string &content);
+  xmlNode *new_child(xmlNode *parent, const char *name,
+      const char *begin, const char *end);
   // XXX add namespace overload
 
   xmlNode *add_child(xmlNode *parent, xmlNode *node);
@@ -279,21 +311,41 @@ namespace xxxml {
   void node_set_name(xmlNode *node, const char *name);
   void node_set_name(xmlNode *node, const std::string &name);
 
+  // for text/comment/CDATA nodes the content is copied as-is,
+  // for element nodes it is parsed for entity references
+  void node_set_content(xmlNode *node, const char *begin, const char *end);
+  void node_set_content(xmlNode *node, const std::string &content);
+
 
   Node_Ptr unlink_node(xmlNode *node);
 
   xmlAttr *new_prop(xmlNode *node, const char *name, const char *value);
   xmlAttr *new_prop(xmlNode *node,
       const std::string &name, const std::string &value);
+  // the value doesn't need to be NUL-terminated
+  xmlAttr *new_prop(xmlNode *node, const char *name,
+      const char *begin, const char *end);
   // XXX add ns version
 
 
   xmlAttr *set_prop(xmlNode *node, const char *name, const char *value);
   xmlAttr *set_prop(xmlNode *node,
       const std::string &name, const std::string &value);
+  xmlAttr *set_prop(xmlNode *node, const char *name,
+      const char *begin, const char *end);
 
   Char_Ptr get_prop(const xmlNode *node, const char *name);
 
+  xmlAttr *set_ns_prop(xmlNode *node, xmlNs *ns,
+      const char *name, const char *value);
+  // return false if the attribute doesn't exist
+  bool unset_prop(xmlNode *node, const char *name);
+  bool unset_ns_prop(xmlNode *node, xmlNs *ns, const char *name);
+
+  // returns nullptr if no such namespace is in scope
+  xmlNs *search_ns_by_href(xmlNode *node, const char *href);
+  xmlNs *new_ns(xmlNode *node, const char *href, const char *prefix);
+
   using Output_Buffer_Ptr
     = std::unique_ptr<xmlOutputBuffer, int (*)(xmlOutputBuffer*)>;
 
@@ -304,6 +356,52 @@ namespace xxxml {
       const xmlNode *cur, int level = 2, bool format = true,
       const char *encoding = nullptr);
 
+  // the callbacks return the number of bytes written/-1 on error
+  Output_Buffer_Ptr output_buffer_create_io(xmlOutputWriteCallback iowrite,
+      xmlOutputCloseCallback ioclose, void *ioctx,
+      xmlCharEncodingHandler *encoder = nullptr);
+  // the fd isn't closed by the output buffer
+  Output_Buffer_Ptr output_buffer_create_fd(int fd,
+      xmlCharEncodingHandler *encoder = nullptr);
+  // Appends to a caller-owned buffer that must outlive the output buffer.
+  // The buffer isn't cleared, thus, after a clear() it can be re-used
+  // for the next document without re-allocating.
+  Output_Buffer_Ptr output_buffer_create_mem(std::string &buffer,
+      xmlCharEncodingHandler *encoder = nullptr);
+  Output_Buffer_Ptr output_buffer_create_mem(std::vector<char> &buffer,
+      xmlCharEncodingHandler *encoder = nullptr);
+  void output_buffer_write(Output_Buffer_Ptr &buf,
+      const char *begin, const char *end);
+  void output_buffer_flush(Output_Buffer_Ptr &buf);
+
+  using Input_Buffer_Ptr
+    = std::unique_ptr<xmlParserInputBuffer, void (*)(xmlParserInputBuffer*)>;
+
+  // the memory isn't copied, i.e. it must outlive the buffer
+  Input_Buffer_Ptr parser_input_buffer_create_mem(
+      const char *begin, const char *end,
+      xmlCharEncoding enc = XML_CHAR_ENCODING_NONE);
+  // also handles compressed files and URIs
+  Input_Buffer_Ptr parser_input_buffer_create_filename(const char *filename,
+      xmlCharEncoding enc = XML_CHAR_ENCODING_NONE);
+  // callbacks as with read_io()
+  Input_Buffer_Ptr parser_input_buffer_create_io(xmlInputReadCallback ioread,
+      xmlInputCloseCallback ioclose, void *ioctx,
+      xmlCharEncoding enc = XML_CHAR_ENCODING_NONE);
+
+  // xmlSaveClose() also flushes
+  using Save_Ctxt_Ptr = std::unique_ptr<xmlSaveCtxt, int (*)(xmlSaveCtxt*)>;
+
+  // options: e.g. XML_SAVE_FORMAT, XML_SAVE_NO_DECL
+  Save_Ctxt_Ptr save_to_io(xmlOutputWriteCallback iowrite,
+      xmlOutputCloseCallback ioclose, void *ioctx,
+      const char *encoding = nullptr, int options = 0);
+  Save_Ctxt_Ptr save_to_fd(int fd, const char *encoding = nullptr,
+      int options = 0);
+  void save_doc(Save_Ctxt_Ptr &ctxt, const doc::Ptr &doc);
+  void save_tree(Save_Ctxt_Ptr &ctxt, const xmlNode *node);
+  void save_flush(Save_Ctxt_Ptr &ctxt);
+
   namespace xpath {
 
     using Context_Ptr
@@ -325,6 +423,8 @@ namespace xxxml {
     Object_Ptr new_cstring(const std::string &value);
 
     Context_Ptr new_context(const doc::Ptr &doc);
+    // e.g. for a document that is owned by a text reader
+    Context_Ptr new_context(const xmlDoc *doc);
 
     void register_ns(Context_Ptr &, const std::string &prefix, const std::string &ns);
     void register_ns(Context_Ptr &, const char *prefix, const char *ns);
@@ -381,6 +481,30 @@ namespace xxxml {
 
     void validate_doc(Valid_Ctxt_Ptr &valid_ctxt, const doc::Ptr &doc);
 
+    // Streaming validation, i.e. no tree is built. The optional SAX
+    // handler receives the parser events, as well.
+    // The input buffer is consumed.
+    void validate_stream(Valid_Ctxt_Ptr &valid_ctxt, Input_Buffer_Ptr input,
+        xmlCharEncoding enc = XML_CHAR_ENCODING_NONE,
+        xmlSAXHandler *sax = nullptr, void *user_data = nullptr);
+    void validate_memory(Valid_Ctxt_Ptr &valid_ctxt,
+        const char *begin, const char *end);
+    void validate_memory(Valid_Ctxt_Ptr &valid_ctxt, const char *s);
+    void validate_memory(Valid_Ctxt_Ptr &valid_ctxt, const std::string &s);
+    void validate_file(Valid_Ctxt_Ptr &valid_ctxt, const char *filename);
+    void validate_file(Valid_Ctxt_Ptr &valid_ctxt, const std::string &filename);
+    // cf. xxxml/io.hh for validating from a C++ source object
+
+    // For validating while parsing with an own SAX handler: sax and
+    // user_data are replaced with the plugged versions, which then
+    // have to be passed to the parser. Unplugged on destruction.
+    using SAX_Plug_Ptr
+      = std::unique_ptr<xmlSchemaSAXPlugStruct, int (*)(xmlSchemaSAXPlugStruct*)>;
+    SAX_Plug_Ptr sax_plug(Valid_Ctxt_Ptr &valid_ctxt, xmlSAXHandler **sax,
+        void **user_data);
+    // i.e. no errors reported so far
+    bool is_valid(Valid_Ctxt_Ptr &valid_ctxt);
+
     void set_valid_structured_errors(Valid_Ctxt_Ptr &v, xmlStructuredErrorFunc f,
         void *user_ptr);
   }
@@ -435,6 +559,21 @@ namespace xxxml {
 
   }
 
+  namespace pattern {
+
+    using Ptr = std::unique_ptr<xmlPattern, void(*)(xmlPattern*)>;
+
+    // streamable XPath subset, e.g. "/root/rec" or ".//rec"
+    // namespaces: array of href, prefix pairs, terminated by a nullptr pair
+    Ptr compile(const char *pattern, int flags = 0,
+        const char **namespaces = nullptr);
+    Ptr compile(const std::string &pattern, int flags = 0,
+        const char **namespaces = nullptr);
+
+    bool match(const Ptr &pattern, const xmlNode *node);
+
+  }
+
   namespace text_reader {
 
     using Ptr = std::unique_ptr<xmlTextReader, void(*)(xmlTextReader*)>;
@@ -452,11 +591,42 @@ namespace xxxml {
         int options = 0);
     Ptr for_file(const std::string &filename, const char *encoding = nullptr,
         int options = 0);
+    // callbacks as with read_io(), cf. xxxml/io.hh for C++ source objects
+    Ptr for_io(xmlInputReadCallback ioread, xmlInputCloseCallback ioclose,
+        void *ioctx, const char *url = nullptr,
+        const char *encoding = nullptr, int options = 0);
+
+    // Re-uses the reader (including its parser context, buffers and
+    // dictionary) for another input. Note that this resets the
+    // parser properties and disables validation, i.e. they have to
+    // be set again.
+    void reset_memory(Ptr &reader, const char *begin, const char *end,
+        const char *url = nullptr,
+        const char *encoding = nullptr, int options = 0);
+    void reset_memory(Ptr &reader, const char *s,
+        const char *url = nullptr,
+        const char *encoding = nullptr, int options = 0);
+    void reset_memory(Ptr &reader, const std::string &s,
+        const char *url = nullptr,
+        const char *encoding = nullptr, int options = 0);
+    void reset_file(Ptr &reader, const char *filename,
+        const char *encoding = nullptr, int options = 0);
+    void reset_file(Ptr &reader, const std::string &filename,
+        const char *encoding = nullptr, int options = 0);
+    void reset_io(Ptr &reader,
+        xmlInputReadCallback ioread, xmlInputCloseCallback ioclose,
+        void *ioctx, const char *url = nullptr,
+        const char *encoding = nullptr, int options = 0);
+    // frees the current document and closes the input
+    void close(Ptr &reader);
 
     bool read(Ptr &reader);
     bool read_attribute_value(Ptr &reader);
     bool move_to_first_attribute(Ptr &reader);
     bool move_to_next_attribute(Ptr &reader);
+    // moves back from an attribute to its element
+    bool move_to_element(Ptr &reader);
+    bool is_namespace_decl(Ptr &reader);
 
     const char *const_value(Ptr &reader);
     const char *const_local_name(Ptr &reader);
@@ -471,7 +641,24 @@ namespace xxxml {
     bool is_valid(Ptr &reader);
     unsigned depth(Ptr &reader);
 
+    // skips the subtree of the current node
+    bool next(Ptr &reader);
+    // reads the subtree of the current node into memory - it's freed
+    // by the reader after moving on, e.g. via next()
+    xmlNode *expand(Ptr &reader);
+    // returns nullptr if there is no current node
+    xmlNode *current_node(Ptr &reader);
+    // The reader doesn't free the returned document, thus, it has to be
+    // destroyed after the reader. Note that xmlTextReaderCurrentDoc()
+    // makes the reader preserve all nodes, i.e. from then on it doesn't
+    // free nodes it has moved past and the document grows with the
+    // whole input - this defeats streaming with bounded memory.
+    doc::Ptr current_doc(Ptr &reader);
+
     void set_parser_prop(Ptr &reader, int prop, int value);
+    // parser and validation errors, f == nullptr restores the default
+    void set_structured_error_handler(Ptr &reader, xmlStructuredErrorFunc f,
+        void *user_data);
 
     void relaxng_validate(Ptr &reader);
     void relaxng_validate(Ptr &reader, const char *filename);
@@ -481,7 +668,14 @@ namespace xxxml {
     void relaxng_set_schema(Ptr &reader);
     void relaxng_set_schema(Ptr &reader, relaxng::Ptr &schema);
 
-    // XXX add xsd methods
+    // XSD validation, the overloads without schema disable it
+    void schema_validate(Ptr &reader);
+    void schema_validate(Ptr &reader, const char *filename);
+    void schema_validate(Ptr &reader, const std::string &filename);
+    void schema_validate_ctxt(Ptr &reader);
+    void schema_validate_ctxt(Ptr &reader, schema::Valid_Ctxt_Ptr &context);
+    void schema_set_schema(Ptr &reader);
+    void schema_set_schema(Ptr &reader, schema::Ptr &schema);
 
   }
 
@@ -509,12 +703,23 @@ namespace xxxml {
     void start_attribute(Ptr &writer, const char *name);
     void end_attribute(Ptr &writer);
 
+    // escaped by libxml2 depending on the writer state, e.g. not inside
+    // a CDATA section or comment
     void write_string(Ptr &writer, const char *content);
+    void write_string(Ptr &writer, const char *begin, const char *end);
     void write_raw(Ptr &writer, const char *begin, const char *end);
 
     void write_comment(Ptr &writer, const char *comment);
 
+    // The content of write_element() and write_attribute() is escaped
+    // by xxxml, i.e. it's scanned with SIMD instructions and runs
+    // without special characters are written without copying.
+    // Non-ASCII attribute content (which libxml2 escapes depending on
+    // the encoding) is copied and passed to libxml2.
+    // The output is identical to libxml2's functions.
     void write_element(Ptr &writer, const char *name, const char *content);
+    void write_element(Ptr &writer, const char *name,
+        const char *begin, const char *end);
 
     void write_element_ns(Ptr &writer, const char *prefix, const char *name,
         const char *namespace_uri, const char *content);
@@ -522,12 +727,25 @@ namespace xxxml {
         const char *content);
 
     void write_attribute(Ptr &writer, const char *name, const char *content);
+    void write_attribute(Ptr &writer, const char *name,
+        const char *begin, const char *end);
+
+    // Writes a subtree, e.g. a stored fragment, directly into the
+    // writer, i.e. without dumping it into a temporary buffer.
+    // Namespaces that are declared outside of the subtree are declared
+    // on the topmost element that uses them. For a document node its
+    // children are written, including the DTD.
+    void write_node(Ptr &writer, const doc::Ptr &doc, const xmlNode *node);
 
     void flush(Ptr &writer);
 
   }
 
   text_writer::Ptr new_text_writer(Output_Buffer_Ptr o);
+  // cf. output_buffer_create_mem(), the buffer is complete
+  // after text_writer::flush() (or end_document())
+  text_writer::Ptr new_text_writer(std::string &buffer);
+  text_writer::Ptr new_text_writer(std::vector<char> &buffer);
   text_writer::Ptr new_text_writer_filename(const char *filename,
       bool compression = false);
   text_writer::Ptr new_text_writer_filename(const std::string &s,